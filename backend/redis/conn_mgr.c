@@ -31,7 +31,10 @@
 #include <stddef.h>
 #include <string.h>
 #include <stdio.h>
-#include <unistd.h> // usleep
+#include <unistd.h> // close
+#include <poll.h>
+#include <sys/time.h>
+#include <sys/socket.h>
 #include <sys/types.h> // getifaddr
 #include <ifaddrs.h> // getifaddr
 
@@ -39,6 +42,10 @@
 
 #define DBBE_REDIS_INFO_PER_SERVER ( 4096 )
 
+static void dbBE_Redis_connection_mgr_background_destroy( struct dbBE_Redis_background_link *bl );
+static dbBE_Redis_cluster_info_t* dbBE_Redis_connection_mgr_cluster_info_complete( dbBE_Redis_connection_mgr_t *conn_mgr,
+                                                                                   dbBE_Redis_cluster_info_t *cl_info );
+
 
 /*
  * initialize the connection mgr
@@ -105,6 +112,14 @@ void dbBE_Redis_connection_mgr_exit( dbBE_Redis_connection_mgr_t *conn_mgr )
 
   dbBE_Redis_event_mgr_exit( conn_mgr->_ev_mgr );
 
+  // the event base is gone, so there are no more callbacks for background links
+  for( n = 0; n < DBBE_REDIS_BACKGROUND_LINKS_MAX; ++n )
+    if( conn_mgr->_links[ n ] != NULL )
+      dbBE_Redis_connection_mgr_background_destroy( conn_mgr->_links[ n ] );
+
+  if( conn_mgr->_recovery._update != NULL )
+    dbBE_Redis_cluster_info_destroy( conn_mgr->_recovery._update );
+
   if( conn_mgr->_local )
     dbBE_Network_address_destroy( conn_mgr->_local );
 
@@ -166,59 +181,890 @@ int dbBE_Redis_connection_mgr_add( dbBE_Redis_connection_mgr_t *conn_mgr,
   ++conn_mgr->_connection_count;
   conn->_index = i;
 
-  int rc = dbBE_Redis_event_mgr_add( conn_mgr->_ev_mgr, conn );
-  if( rc != 0 )
+  int rc = dbBE_Redis_event_mgr_add( conn_mgr->_ev_mgr, conn );
+  if( rc != 0 )
+  {
+    LOG( DBG_ERR, stderr, "connection_mgr_add: failed to add conn=%p (socket=%d) to event_mgr. rc=%d\n", conn, conn->_socket, rc );
+    return rc;
+  }
+
+  return 0;
+}
+
+/*
+ * length of the first complete RESP reply in buf
+ * returns 0 if the reply is incomplete and -1 on protocol errors
+ * (the parser terminates strings in place, so replies are only parsed once complete)
+ */
+static
+ssize_t dbBE_Redis_connection_mgr_reply_len( const char *buf, const size_t len )
+{
+  size_t head = 0;
+  while(( head + 1 < len ) && (( buf[ head ] != '\r' ) || ( buf[ head + 1 ] != '\n' )))
+    ++head;
+  if( head + 1 >= len )
+    return 0;
+  head += 2;
+
+  long n;
+  size_t pos = head;
+  switch( buf[ 0 ] )
+  {
+    case '+':
+    case '-':
+    case ':':
+    case '_': // RESP3 null, boolean, double, and big number
+    case '#':
+    case ',':
+    case '(':
+      return head;
+    case '$':
+    case '=': // RESP3 verbatim string and blob error
+    case '!':
+      n = strtol( buf + 1, NULL, 10 );
+      if( n < 0 )
+        return head;
+      return ( head + n + 2 <= len ) ? (ssize_t)( head + n + 2 ) : 0;
+    case '*':
+    case '~': // RESP3 set, push, map, and attribute (which is followed by the actual reply)
+    case '>':
+    case '%':
+    case '|':
+      n = strtol( buf + 1, NULL, 10 );
+      if(( buf[ 0 ] == '%' ) || ( buf[ 0 ] == '|' ))
+        n *= 2;
+      if( buf[ 0 ] == '|' )
+        ++n;
+      for( ; n > 0; --n )
+      {
+        ssize_t elen = dbBE_Redis_connection_mgr_reply_len( buf + pos, len - pos );
+        if( elen <= 0 )
+          return elen;
+        pos += elen;
+      }
+      return pos;
+    default:
+      return -1;
+  }
+}
+
+typedef enum
+{
+  DBBE_REDIS_LINKUP_FAILED = -1,
+  DBBE_REDIS_LINKUP_CONNECTING = 0,
+  DBBE_REDIS_LINKUP_HANDSHAKE = 1,
+  DBBE_REDIS_LINKUP_DONE = 2
+} dbBE_Redis_linkup_state_t;
+
+/*
+ * one connection of a parallel link-up
+ */
+typedef struct
+{
+  dbBE_Redis_connection_t *_conn;
+  dbBE_Redis_sr_buffer_t *_buf; ///< handshake replies
+  dbBE_Redis_linkup_state_t _state;
+  int _probe_ok;
+  dbBE_Redis_cluster_info_t *_cluster; ///< reply of a CLUSTER SLOTS probe (NULL if it's not a cluster)
+} dbBE_Redis_linkup_t;
+
+/*
+ * the handshake that goes out right after the connect: AUTH (if needed), HELLO (if RESP3 is requested), and the probe in one write
+ */
+typedef struct
+{
+  char *_cmd;
+  size_t _len;
+  int _auth; ///< first reply is the AUTH response
+  int _hello; ///< the next reply is the response to HELLO 3
+  int _replies; ///< number of replies to expect
+  dbBE_Redis_cluster_info_category_t _probe;
+} dbBE_Redis_handshake_t;
+
+/*
+ * evaluate the complete handshake replies of a connection
+ */
+static
+int dbBE_Redis_connection_mgr_linkup_check( dbBE_Redis_linkup_t *lu,
+                                            const dbBE_Redis_handshake_t *hs )
+{
+  dbBE_Redis_result_t result;
+  int rc = 0;
+  int n;
+  for( n = 0; ( n < hs->_replies ) && ( rc == 0 ); ++n )
+  {
+    memset( &result, 0, sizeof( result ) );
+    if( dbBE_Redis_parse_sr_buffer( lu->_buf, &result ) != 0 )
+      return -EPROTO;
+
+    int is_ok = ( result._type == dbBE_REDIS_TYPE_CHAR ) &&
+        ( strncmp( result._data._string._data, "OK", result._data._string._size ) == 0 );
+    if(( n == 0 ) && ( hs->_auth ))
+    {
+      if( ! is_ok )
+      {
+        LOG( DBG_ERR, stderr, "Redis Authentication error at %s\n", lu->_conn->_url );
+        rc = -EPERM;
+      }
+    }
+    else if(( n == hs->_auth ) && ( hs->_hello ))
+    {
+      // servers without RESP3 reject HELLO; they keep talking RESP2
+      lu->_conn->_protocol = ( result._type == dbBE_REDIS_TYPE_MAP ) ? 3 : 2;
+      if( lu->_conn->_protocol != 3 )
+        LOG( DBG_VERBOSE, stderr, "No RESP3 at %s. Using RESP2\n", lu->_conn->_url );
+    }
+    else if( hs->_probe == DBBE_INFO_CATEGORY_ROLE )
+    {
+      if(( result._type == dbBE_REDIS_TYPE_ARRAY ) &&
+          ( result._data._array._len >= 3 ) &&
+          ( result._data._array._data[0]._type == dbBE_REDIS_TYPE_CHAR ))
+        lu->_probe_ok = ( strncmp( result._data._array._data[0]._data._string._data, "master",
+                                   result._data._array._data[0]._data._string._size ) == 0 );
+      else
+        rc = -ENOTCONN;
+    }
+    else if( hs->_probe == DBBE_INFO_CATEGORY_CLUSTER_SLOTS )
+    {
+      // an error reply is fine too: the node isn't part of a cluster
+      lu->_cluster = dbBE_Redis_cluster_info_create( &result );
+      lu->_probe_ok = ( lu->_cluster != NULL );
+    }
+    else
+      lu->_probe_ok = is_ok;
+    dbBE_Redis_result_cleanup( &result, 0 );
+  }
+  return rc;
+}
+
+/*
+ * move a connection of a parallel link-up forward after its socket became ready
+ */
+static
+void dbBE_Redis_connection_mgr_linkup_advance( dbBE_Redis_linkup_t *lu,
+                                               const dbBE_Redis_handshake_t *hs )
+{
+  ssize_t rc;
+  switch( lu->_state )
+  {
+    case DBBE_REDIS_LINKUP_CONNECTING:
+    {
+      if( dbBE_Redis_connection_link_finish( lu->_conn ) != 0 )
+      {
+        lu->_state = DBBE_REDIS_LINKUP_FAILED;
+        return;
+      }
+      size_t sent = 0;
+      while( sent < hs->_len )
+      {
+        rc = send( lu->_conn->_socket, hs->_cmd + sent, hs->_len - sent, 0 );
+        if(( rc < 0 ) && ( errno == EINTR ))
+          continue;
+        if( rc <= 0 )
+        {
+          lu->_state = DBBE_REDIS_LINKUP_FAILED;
+          return;
+        }
+        sent += rc;
+      }
+      lu->_state = ( hs->_replies > 0 ) ? DBBE_REDIS_LINKUP_HANDSHAKE : DBBE_REDIS_LINKUP_DONE;
+      break;
+    }
+    case DBBE_REDIS_LINKUP_HANDSHAKE:
+    {
+      if( dbBE_Transport_sr_buffer_remaining( lu->_buf ) <= 0 )
+      {
+        lu->_state = DBBE_REDIS_LINKUP_FAILED;
+        return;
+      }
+      rc = recv( lu->_conn->_socket,
+                 dbBE_Transport_sr_buffer_get_available_position( lu->_buf ),
+                 dbBE_Transport_sr_buffer_remaining( lu->_buf ),
+                 MSG_DONTWAIT );
+      if(( rc < 0 ) && (( errno == EINTR ) || ( errno == EAGAIN )))
+        return;
+      if( rc <= 0 )
+      {
+        lu->_state = DBBE_REDIS_LINKUP_FAILED;
+        return;
+      }
+      dbBE_Transport_sr_buffer_add_data( lu->_buf, rc, 0 );
+
+      // wait until all replies are complete
+      const char *buf = dbBE_Transport_sr_buffer_get_start( lu->_buf );
+      size_t len = dbBE_Transport_sr_buffer_available( lu->_buf );
+      size_t pos = 0;
+      int n;
+      for( n = 0; n < hs->_replies; ++n )
+      {
+        rc = dbBE_Redis_connection_mgr_reply_len( buf + pos, len - pos );
+        if( rc < 0 )
+          lu->_state = DBBE_REDIS_LINKUP_FAILED;
+        if( rc <= 0 )
+          return;
+        pos += rc;
+      }
+      lu->_state = ( dbBE_Redis_connection_mgr_linkup_check( lu, hs ) == 0 ) ? DBBE_REDIS_LINKUP_DONE : DBBE_REDIS_LINKUP_FAILED;
+      break;
+    }
+    default:
+      break;
+  }
+}
+
+static
+int dbBE_Redis_connection_mgr_linkup_active( dbBE_Redis_linkup_t *lu )
+{
+  return ( lu->_state == DBBE_REDIS_LINKUP_CONNECTING ) || ( lu->_state == DBBE_REDIS_LINKUP_HANDSHAKE );
+}
+
+/*
+ * assemble the handshake for new connections: AUTH (if configured) followed by the probe command
+ */
+static
+int dbBE_Redis_connection_mgr_handshake_init( dbBE_Redis_handshake_t *hs,
+                                              const dbBE_Redis_cluster_info_category_t probe,
+                                              const int protocol )
+{
+  const char *hello_cmd = ( protocol == 3 ) ? "*2\r\n$5\r\nHELLO\r\n$1\r\n3\r\n" : "";
+  const char *probe_cmd = NULL;
+  switch( probe )
+  {
+    case DBBE_INFO_CATEGORY_UNSPECIFIED:
+      probe_cmd = "";
+      break;
+    case DBBE_INFO_CATEGORY_ROLE:
+      probe_cmd = "*1\r\n$4\r\nROLE\r\n";
+      break;
+    case DBBE_INFO_CATEGORY_READONLY:
+      probe_cmd = "*1\r\n$8\r\nREADONLY\r\n";
+      break;
+    case DBBE_INFO_CATEGORY_CLUSTER_SLOTS:
+      probe_cmd = "*2\r\n$7\r\nCLUSTER\r\n$5\r\nSLOTS\r\n";
+      break;
+    default:
+      return -EINVAL;
+  }
+
+  char *authfile = dbBE_Extract_env( DBR_SERVER_AUTHFILE_ENV, DBR_SERVER_DEFAULT_AUTHFILE );
+  if( authfile == NULL )
+    return -ENOMEM;
+  char *auth_cmd = NULL;
+  ssize_t auth_len = dbBE_Redis_connection_auth_cmd( authfile, &auth_cmd );
+  free( authfile );
+  if( auth_len < 0 )
+    return (int)auth_len;
+
+  hs->_len = auth_len + strlen( hello_cmd ) + strlen( probe_cmd );
+  hs->_auth = ( auth_len > 0 );
+  hs->_hello = ( protocol == 3 );
+  hs->_replies = hs->_auth + hs->_hello + ( probe != DBBE_INFO_CATEGORY_UNSPECIFIED );
+  hs->_probe = probe;
+  hs->_cmd = (char*)malloc( hs->_len + 1 );
+  if(( hs->_cmd != NULL ) && ( auth_len > 0 ))
+    memcpy( hs->_cmd, auth_cmd, auth_len );
+  if( auth_cmd != NULL )
+  {
+    memset( auth_cmd, 0, auth_len );
+    free( auth_cmd );
+  }
+  if( hs->_cmd == NULL )
+    return -ENOMEM;
+  strcpy( hs->_cmd + auth_len, hello_cmd );
+  strcat( hs->_cmd + auth_len, probe_cmd );
+  return 0;
+}
+
+/*
+ * wipe the handshake since it contains the credentials
+ */
+static
+void dbBE_Redis_connection_mgr_handshake_release( dbBE_Redis_handshake_t *hs )
+{
+  if( hs->_cmd == NULL )
+    return;
+  memset( hs->_cmd, 0, hs->_len );
+  free( hs->_cmd );
+  hs->_cmd = NULL;
+}
+
+int dbBE_Redis_connection_mgr_newlinks( dbBE_Redis_connection_mgr_t *conn_mgr,
+                                        char **urls,
+                                        const int count,
+                                        const dbBE_Redis_cluster_info_category_t probe,
+                                        dbBE_Redis_connection_t **conns,
+                                        int *probe_ok )
+{
+  if(( conn_mgr == NULL ) || ( urls == NULL ) || ( count <= 0 ) || ( conns == NULL ))
+    return -EINVAL;
+
+  dbBE_Redis_handshake_t hs;
+  int rc = dbBE_Redis_connection_mgr_handshake_init( &hs, probe, conn_mgr->_config->_protocol );
+  if( rc != 0 )
+    return rc;
+
+  dbBE_Redis_linkup_t *lu = (dbBE_Redis_linkup_t*)calloc( count, sizeof( dbBE_Redis_linkup_t ) );
+  struct pollfd *pfd = (struct pollfd*)calloc( count, sizeof( struct pollfd ) );
+  if(( lu == NULL ) || ( pfd == NULL ))
+  {
+    dbBE_Redis_connection_mgr_handshake_release( &hs );
+    free( lu );
+    free( pfd );
+    return -ENOMEM;
+  }
+
+  // start all connects at once
+  int n;
+  for( n = 0; n < count; ++n )
+  {
+    conns[ n ] = NULL;
+    if( probe_ok != NULL )
+      probe_ok[ n ] = 0;
+    lu[ n ]._state = DBBE_REDIS_LINKUP_FAILED;
+    if( urls[ n ] == NULL )
+      continue;
+    lu[ n ]._conn = dbBE_Redis_connection_create( conn_mgr->_config->_rbuf_len );
+    lu[ n ]._buf = dbBE_Transport_sr_buffer_allocate( DBBE_REDIS_INFO_PER_SERVER );
+    if(( lu[ n ]._conn == NULL ) || ( lu[ n ]._buf == NULL ))
+      continue;
+
+    rc = dbBE_Redis_connection_link_start( lu[ n ]._conn, urls[ n ] );
+    if(( rc == 0 ) || ( rc == -EINPROGRESS ))
+      lu[ n ]._state = DBBE_REDIS_LINKUP_CONNECTING;
+    if( rc == 0 )
+      dbBE_Redis_connection_mgr_linkup_advance( &lu[ n ], &hs );
+  }
+
+  // then complete connects and handshakes in whatever order the nodes respond
+  struct timeval start, now;
+  gettimeofday( &start, NULL );
+  int pending = 1;
+  while( pending )
+  {
+    pending = 0;
+    for( n = 0; n < count; ++n )
+    {
+      pfd[ n ].fd = -1;
+      pfd[ n ].revents = 0;
+      if( dbBE_Redis_connection_mgr_linkup_active( &lu[ n ] ) )
+      {
+        pfd[ n ].fd = lu[ n ]._conn->_socket;
+        pfd[ n ].events = ( lu[ n ]._state == DBBE_REDIS_LINKUP_CONNECTING ) ? POLLOUT : POLLIN;
+        ++pending;
+      }
+    }
+    if( pending == 0 )
+      break;
+
+    gettimeofday( &now, NULL );
+    int64_t remaining = DBBE_REDIS_LINKUP_TIMEOUT
+        - ( now.tv_sec - start.tv_sec ) * 1000 - ( now.tv_usec - start.tv_usec ) / 1000;
+    if( remaining <= 0 )
+    {
+      LOG( DBG_ERR, stderr, "connection_mgr_newlinks: %d of %d connections timed out\n", pending, count );
+      break;
+    }
+
+    rc = poll( pfd, count, remaining );
+    if(( rc < 0 ) && ( errno != EINTR ))
+      break;
+
+    for( n = 0; ( rc > 0 ) && ( n < count ); ++n )
+      if( pfd[ n ].revents != 0 )
+        dbBE_Redis_connection_mgr_linkup_advance( &lu[ n ], &hs );
+  }
+
+  int linked = 0;
+  for( n = 0; n < count; ++n )
+  {
+    dbBE_Redis_connection_t *conn = lu[ n ]._conn;
+    if( lu[ n ]._state == DBBE_REDIS_LINKUP_DONE )
+    {
+      conn->_status = DBBE_CONNECTION_STATUS_AUTHORIZED;
+      if( dbBE_Redis_connection_mgr_add( conn_mgr, conn ) == 0 )
+      {
+        conns[ n ] = conn;
+        if( probe_ok != NULL )
+          probe_ok[ n ] = lu[ n ]._probe_ok;
+        ++linked;
+        conn = NULL;
+      }
+    }
+    else if( urls[ n ] != NULL )
+      LOG( DBG_ERR, stderr, "connection_mgr_newlinks: unable to connect to: %s\n", urls[ n ] );
+
+    if( conn != NULL )
+    {
+      // a connect that is still in progress has no status yet
+      if(( conn->_socket >= 0 ) && ( conn->_status == DBBE_CONNECTION_STATUS_INITIALIZED ))
+      {
+        close( conn->_socket );
+        conn->_socket = -1;
+      }
+      dbBE_Redis_connection_destroy( conn );
+    }
+    if( lu[ n ]._cluster != NULL )
+      dbBE_Redis_cluster_info_destroy( lu[ n ]._cluster );
+    if( lu[ n ]._buf != NULL )
+    {
+      memset( dbBE_Transport_sr_buffer_get_start( lu[ n ]._buf ), 0, dbBE_Transport_sr_buffer_get_size( lu[ n ]._buf ) );
+      dbBE_Transport_sr_buffer_free( lu[ n ]._buf );
+    }
+  }
+
+  dbBE_Redis_connection_mgr_handshake_release( &hs );
+  free( lu );
+  free( pfd );
+  return linked;
+}
+
+dbBE_Redis_connection_t* dbBE_Redis_connection_mgr_newlink( dbBE_Redis_connection_mgr_t *conn_mgr,
+                                                            const char *url )
+{
+  if( conn_mgr == NULL )
+  {
+    errno = EINVAL;
+    return NULL;
+  }
+
+  dbBE_Redis_connection_t *new_conn = NULL;
+  char *urls[ 1 ] = { (char*)url };
+  int rc = dbBE_Redis_connection_mgr_newlinks( conn_mgr, urls, 1, DBBE_INFO_CATEGORY_UNSPECIFIED, &new_conn, NULL );
+  if( rc != 1 )
+  {
+    errno = ( rc < 0 ) ? -rc : ENOTCONN;
+    return NULL;
+  }
+  return new_conn;
+}
+
+/*
+ * a connection that links up in the background, driven by one-shot event_mgr watches
+ */
+typedef struct dbBE_Redis_background_link dbBE_Redis_background_link_t;
+
+/*
+ * completion of a background link that has an owner (done or failed, see lu->_state)
+ * the owner may take lu->_conn and lu->_cluster (and set them to NULL); everything else gets cleaned up
+ */
+typedef void (*dbBE_Redis_link_done_fn)( dbBE_Redis_connection_mgr_t *conn_mgr,
+                                         dbBE_Redis_linkup_t *lu,
+                                         void *arg );
+
+struct dbBE_Redis_background_link
+{
+  dbBE_Redis_linkup_t _lu;
+  dbBE_Redis_handshake_t _hs;
+  dbBE_Redis_connection_mgr_t *_conn_mgr;
+  dbBE_Redis_link_done_fn _done; ///< NULL for links that get added to the mgr on completion
+  void *_arg; ///< owned by the link
+  struct timeval _start;
+  char _url[ DBR_SERVER_URL_MAX_LENGTH ];
+};
+
+static
+void dbBE_Redis_connection_mgr_background_callback( evutil_socket_t socket, short ev_type, void *arg );
+
+/*
+ * destroy a background link including a connection that never made it into the mgr
+ */
+static
+void dbBE_Redis_connection_mgr_background_destroy( dbBE_Redis_background_link_t *bl )
+{
+  if( bl->_lu._conn != NULL )
+  {
+    if( bl->_lu._conn->_status == DBBE_CONNECTION_STATUS_INITIALIZED )
+    {
+      close( bl->_lu._conn->_socket );
+      bl->_lu._conn->_socket = -1;
+    }
+    dbBE_Redis_connection_destroy( bl->_lu._conn );
+  }
+  if( bl->_lu._cluster != NULL )
+    dbBE_Redis_cluster_info_destroy( bl->_lu._cluster );
+  dbBE_Redis_connection_mgr_handshake_release( &bl->_hs );
+  if( bl->_lu._buf != NULL )
+    dbBE_Transport_sr_buffer_free( bl->_lu._buf );
+  free( bl->_arg );
+  free( bl );
+}
+
+/*
+ * close the socket of a failed link-up; the connection object stays around for a restart
+ */
+static
+void dbBE_Redis_connection_mgr_background_abort( dbBE_Redis_background_link_t *bl )
+{
+  dbBE_Redis_connection_t *conn = bl->_lu._conn;
+  bl->_lu._state = DBBE_REDIS_LINKUP_FAILED;
+  if( conn->_socket >= 0 )
+  {
+    close( conn->_socket );
+    conn->_socket = -1;
+  }
+  conn->_status = DBBE_CONNECTION_STATUS_DISCONNECTED;
+  dbBE_Redis_connection_mgr_handshake_release( &bl->_hs );
+  LOG( DBG_ERR, stderr, "connection_mgr_link_async: unable to connect to: %s\n", bl->_url );
+}
+
+static
+void dbBE_Redis_connection_mgr_background_remove( dbBE_Redis_background_link_t *bl )
+{
+  int n;
+  for( n = 0; n < DBBE_REDIS_BACKGROUND_LINKS_MAX; ++n )
+    if( bl->_conn_mgr->_links[ n ] == bl )
+      bl->_conn_mgr->_links[ n ] = NULL;
+}
+
+/*
+ * wait for the next step of a background link-up or finish it
+ */
+static
+void dbBE_Redis_connection_mgr_background_next( dbBE_Redis_background_link_t *bl )
+{
+  dbBE_Redis_connection_mgr_t *conn_mgr = bl->_conn_mgr;
+  if( dbBE_Redis_connection_mgr_linkup_active( &bl->_lu ) )
+  {
+    struct timeval now;
+    gettimeofday( &now, NULL );
+    int64_t remaining = (int64_t)DBBE_REDIS_LINKUP_TIMEOUT * 1000
+        - ( now.tv_sec - bl->_start.tv_sec ) * 1000000 - ( now.tv_usec - bl->_start.tv_usec );
+    if(( remaining > 0 ) &&
+        ( dbBE_Redis_event_mgr_watch( conn_mgr->_ev_mgr,
+                                      bl->_lu._conn->_socket,
+                                      ( bl->_lu._state == DBBE_REDIS_LINKUP_CONNECTING ) ? EV_WRITE : EV_READ,
+                                      (unsigned)remaining,
+                                      dbBE_Redis_connection_mgr_background_callback,
+                                      bl ) == 0 ))
+      return;
+    bl->_lu._state = DBBE_REDIS_LINKUP_FAILED;
+  }
+
+  // a link with an owner hands over the result and goes away either way
+  if( bl->_done != NULL )
+  {
+    if( bl->_lu._state == DBBE_REDIS_LINKUP_DONE )
+      bl->_lu._conn->_status = DBBE_CONNECTION_STATUS_AUTHORIZED;
+    else
+      dbBE_Redis_connection_mgr_background_abort( bl );
+    dbBE_Redis_connection_mgr_background_remove( bl );
+    bl->_done( conn_mgr, &bl->_lu, bl->_arg );
+    dbBE_Redis_connection_mgr_background_destroy( bl );
+    return;
+  }
+
+  if( bl->_lu._state != DBBE_REDIS_LINKUP_DONE )
+  {
+    dbBE_Redis_connection_mgr_background_abort( bl );
+    return;
+  }
+
+  // complete: the connection now belongs to the mgr
+  dbBE_Redis_connection_t *conn = bl->_lu._conn;
+  conn->_status = DBBE_CONNECTION_STATUS_AUTHORIZED;
+  if( dbBE_Redis_connection_mgr_add( conn_mgr, conn ) != 0 )
+  {
+    dbBE_Redis_connection_mgr_background_abort( bl );
+    return;
+  }
+  LOG( DBG_VERBOSE, stderr, "connection_mgr_link_async: linked conn %d to %s\n", conn->_index, bl->_url );
+
+  dbBE_Redis_connection_mgr_background_remove( bl );
+  bl->_lu._conn = NULL;
+  dbBE_Redis_connection_mgr_background_destroy( bl );
+}
+
+static
+void dbBE_Redis_connection_mgr_background_callback( evutil_socket_t socket, short ev_type, void *arg )
+{
+  dbBE_Redis_background_link_t *bl = (dbBE_Redis_background_link_t*)arg;
+  if(( ev_type & ( EV_READ | EV_WRITE )) != 0 )
+    dbBE_Redis_connection_mgr_linkup_advance( &bl->_lu, &bl->_hs );
+  else
+    bl->_lu._state = DBBE_REDIS_LINKUP_FAILED;
+  dbBE_Redis_connection_mgr_background_next( bl );
+}
+
+/*
+ * (re)start the connect of a background link-up
+ */
+static
+int dbBE_Redis_connection_mgr_background_start( dbBE_Redis_background_link_t *bl,
+                                                const dbBE_Redis_cluster_info_category_t probe )
+{
+  dbBE_Redis_connection_t *conn = bl->_lu._conn;
+  int rc = dbBE_Redis_connection_mgr_handshake_init( &bl->_hs, probe, bl->_conn_mgr->_config->_protocol );
+  if( rc != 0 )
+  {
+    bl->_lu._state = DBBE_REDIS_LINKUP_FAILED;
+    return rc;
+  }
+
+  // a restart after a failed handshake still has the address of the last attempt
+  if( conn->_address != NULL )
+    dbBE_Network_address_destroy( conn->_address );
+  conn->_address = NULL;
+  dbBE_Transport_sr_buffer_reset( bl->_lu._buf );
+  bl->_lu._probe_ok = 0;
+  gettimeofday( &bl->_start, NULL );
+
+  rc = dbBE_Redis_connection_link_start( conn, bl->_url );
+  if(( rc != 0 ) && ( rc != -EINPROGRESS ))
+  {
+    dbBE_Redis_connection_mgr_background_abort( bl );
+    return rc;
+  }
+  bl->_lu._state = DBBE_REDIS_LINKUP_CONNECTING;
+  if( rc == 0 )
+    dbBE_Redis_connection_mgr_linkup_advance( &bl->_lu, &bl->_hs );
+  dbBE_Redis_connection_mgr_background_next( bl );
+  return 0;
+}
+
+/*
+ * allocate a background link in a free entry of the link table
+ * the replies of a CLUSTER SLOTS probe need room for the whole cluster
+ */
+static
+dbBE_Redis_background_link_t* dbBE_Redis_connection_mgr_background_create( dbBE_Redis_connection_mgr_t *conn_mgr,
+                                                                           const char *url,
+                                                                           const dbBE_Redis_cluster_info_category_t probe )
+{
+  int n;
+  for( n = 0; ( n < DBBE_REDIS_BACKGROUND_LINKS_MAX ) && ( conn_mgr->_links[ n ] != NULL ); ++n ) {}
+  if( n >= DBBE_REDIS_BACKGROUND_LINKS_MAX )
+  {
+    LOG( DBG_ERR, stderr, "connection_mgr_link_async: too many background links. Can't link to %s\n", url );
+    errno = ENOSPC;
+    return NULL;
+  }
+
+  dbBE_Redis_background_link_t *bl = (dbBE_Redis_background_link_t*)calloc( 1, sizeof( dbBE_Redis_background_link_t ) );
+  if( bl == NULL )
+  {
+    errno = ENOMEM;
+    return NULL;
+  }
+  bl->_conn_mgr = conn_mgr;
+  snprintf( bl->_url, DBR_SERVER_URL_MAX_LENGTH, "%s", url );
+  bl->_lu._conn = dbBE_Redis_connection_create( conn_mgr->_config->_rbuf_len );
+  bl->_lu._buf = dbBE_Transport_sr_buffer_allocate(
+      ( probe == DBBE_INFO_CATEGORY_CLUSTER_SLOTS ) ? DBBE_REDIS_MAX_CONNECTIONS * DBBE_REDIS_INFO_PER_SERVER : DBBE_REDIS_INFO_PER_SERVER );
+  if(( bl->_lu._conn == NULL ) || ( bl->_lu._buf == NULL ))
+  {
+    dbBE_Redis_connection_mgr_background_destroy( bl );
+    errno = ENOMEM;
+    return NULL;
+  }
+  conn_mgr->_links[ n ] = bl;
+  return bl;
+}
+
+dbBE_Redis_connection_t* dbBE_Redis_connection_mgr_link_async( dbBE_Redis_connection_mgr_t *conn_mgr,
+                                                               const char *url,
+                                                               const dbBE_Redis_cluster_info_category_t probe )
+{
+  if(( conn_mgr == NULL ) || ( url == NULL ))
+  {
+    errno = EINVAL;
+    return NULL;
+  }
+
+  // an ongoing or failed link-up to the same destination
+  int n;
+  for( n = 0; n < DBBE_REDIS_BACKGROUND_LINKS_MAX; ++n )
+  {
+    dbBE_Redis_background_link_t *bl = conn_mgr->_links[ n ];
+    if(( bl == NULL ) || ( bl->_done != NULL ) || ( strncmp( bl->_url, url, DBR_SERVER_URL_MAX_LENGTH ) != 0 ))
+      continue;
+
+    if(( bl->_lu._state == DBBE_REDIS_LINKUP_FAILED ) &&
+        ( dbBE_Redis_connection_mgr_background_start( bl, probe ) != 0 ))
+    {
+      errno = ENOTCONN;
+      return NULL;
+    }
+    return bl->_lu._conn;
+  }
+
+  // failed entries are kept because requests may still refer to their connection
+  dbBE_Redis_background_link_t *bl = dbBE_Redis_connection_mgr_background_create( conn_mgr, url, probe );
+  if( bl == NULL )
+    return NULL;
+
+  dbBE_Redis_connection_t *conn = bl->_lu._conn;
+  if( dbBE_Redis_connection_mgr_background_start( bl, probe ) != 0 )
+  {
+    errno = ENOTCONN;
+    return NULL;
+  }
+  return conn;
+}
+
+/*
+ * link to url in the background and hand the result to done() instead of adding it to the mgr
+ * done() may get called before this returns; arg gets freed with the link
+ */
+static
+int dbBE_Redis_connection_mgr_link_owned( dbBE_Redis_connection_mgr_t *conn_mgr,
+                                          const char *url,
+                                          const dbBE_Redis_cluster_info_category_t probe,
+                                          dbBE_Redis_link_done_fn done,
+                                          void *arg )
+{
+  dbBE_Redis_background_link_t *bl = dbBE_Redis_connection_mgr_background_create( conn_mgr, url, probe );
+  if( bl == NULL )
+  {
+    free( arg );
+    return -errno;
+  }
+  bl->_done = done;
+  bl->_arg = arg;
+
+  int rc = dbBE_Redis_connection_mgr_handshake_init( &bl->_hs, probe, bl->_conn_mgr->_config->_protocol );
+  if( rc != 0 )
+  {
+    dbBE_Redis_connection_mgr_background_remove( bl );
+    dbBE_Redis_connection_mgr_background_destroy( bl );
+    return rc;
+  }
+  gettimeofday( &bl->_start, NULL );
+
+  // a failed connect is reported through done() as well
+  rc = dbBE_Redis_connection_link_start( bl->_lu._conn, bl->_url );
+  bl->_lu._state = (( rc == 0 ) || ( rc == -EINPROGRESS )) ? DBBE_REDIS_LINKUP_CONNECTING : DBBE_REDIS_LINKUP_FAILED;
+  if( rc == 0 )
+    dbBE_Redis_connection_mgr_linkup_advance( &bl->_lu, &bl->_hs );
+  dbBE_Redis_connection_mgr_background_next( bl );
+  return 0;
+}
+
+int dbBE_Redis_connection_mgr_link_status( dbBE_Redis_connection_mgr_t *conn_mgr,
+                                           const dbBE_Redis_connection_t *conn )
+{
+  if(( conn_mgr == NULL ) || ( conn == NULL ))
+    return -EINVAL;
+
+  int n;
+  for( n = 0; n < DBBE_REDIS_BACKGROUND_LINKS_MAX; ++n )
   {
-    LOG( DBG_ERR, stderr, "connection_mgr_add: failed to add conn=%p (socket=%d) to event_mgr. rc=%d\n", conn, conn->_socket, rc );
-    return rc;
+    dbBE_Redis_background_link_t *bl = conn_mgr->_links[ n ];
+    if(( bl == NULL ) || ( bl->_lu._conn != conn ))
+      continue;
+    return dbBE_Redis_connection_mgr_linkup_active( &bl->_lu ) ? 1 : -ENOTCONN;
   }
+  return 0;
+}
+
+/*
+ * make a READONLY connection serve reads for the slots of its master
+ */
+int dbBE_Redis_connection_mgr_add_reader( dbBE_Redis_connection_mgr_t *conn_mgr,
+                                          dbBE_Redis_connection_t *reader,
+                                          dbBE_Redis_connection_t *master )
+{
+  if(( conn_mgr == NULL ) || ( reader == NULL ) || ( master == NULL ) ||
+      ( (unsigned)master->_index >= DBBE_REDIS_MAX_CONNECTIONS ))
+    return -EINVAL;
 
+  dbBE_Redis_reader_set_t *rs = &conn_mgr->_readers[ master->_index ];
+  if( rs->_count >= DBBE_REDIS_CLUSTER_MAX_REPLICA )
+    return -ENOSPC;
+
+  reader->_primary = master->_index;
+  rs->_idx[ rs->_count++ ] = reader->_index;
+  LOG( DBG_VERBOSE, stderr, "Replica %s serves reads for connection %d\n", reader->_url, master->_index );
   return 0;
 }
 
-dbBE_Redis_connection_t* dbBE_Redis_connection_mgr_newlink( dbBE_Redis_connection_mgr_t *conn_mgr,
-                                                            const char *url )
+dbBE_Redis_connection_t* dbBE_Redis_connection_mgr_newreader( dbBE_Redis_connection_mgr_t *conn_mgr,
+                                                              const char *url,
+                                                              dbBE_Redis_connection_t *master )
 {
-  int rc = 0;
-  if( conn_mgr == NULL )
+  if(( conn_mgr == NULL ) || ( url == NULL ) || ( master == NULL ) ||
+      ( (unsigned)master->_index >= DBBE_REDIS_MAX_CONNECTIONS ))
   {
     errno = EINVAL;
     return NULL;
   }
 
-  char *authfile = dbBE_Extract_env( DBR_SERVER_AUTHFILE_ENV, DBR_SERVER_DEFAULT_AUTHFILE );
-  LOG( DBG_VERBOSE, stderr, "authfile=%s\n", authfile );
+  if( conn_mgr->_readers[ master->_index ]._count >= DBBE_REDIS_CLUSTER_MAX_REPLICA )
+  {
+    errno = ENOSPC;
+    return NULL;
+  }
 
-  dbBE_Redis_connection_t *new_conn = dbBE_Redis_connection_create( conn_mgr->_config->_rbuf_len );
-  if( new_conn == NULL )
+  // without READONLY, a replica answers every request with MOVED to its master
+  dbBE_Redis_connection_t *reader = NULL;
+  int readonly = 0;
+  char *urls[ 1 ] = { (char*)url };
+  if( dbBE_Redis_connection_mgr_newlinks( conn_mgr, urls, 1, DBBE_INFO_CATEGORY_READONLY, &reader, &readonly ) != 1 )
   {
-    rc = -ENOMEM;
-    goto exit_connect;
+    errno = ENOTCONN;
+    return NULL;
   }
 
-  dbBE_Network_address_t *srv_addr = dbBE_Redis_connection_link( new_conn, url, authfile );
-  if( srv_addr == NULL )
+  if( readonly == 0 )
   {
-    rc = -ENOTCONN;
-    dbBE_Redis_connection_destroy( new_conn );
-    goto exit_connect;
+    LOG( DBG_ERR, stderr, "connection_mgr_newreader: replica %s refused READONLY mode\n", url );
+    dbBE_Redis_connection_mgr_rm( conn_mgr, reader );
+    dbBE_Redis_connection_destroy( reader );
+    errno = ENOTCONN;
+    return NULL;
   }
 
-  rc = dbBE_Redis_connection_mgr_add( conn_mgr, new_conn );
-  if( rc != 0 )
+  dbBE_Redis_connection_mgr_add_reader( conn_mgr, reader, master );
+  return reader;
+}
+
+/*
+ * make a connection to the node of a master share the requests for the master's slots
+ */
+int dbBE_Redis_connection_mgr_add_pooled( dbBE_Redis_connection_mgr_t *conn_mgr,
+                                          dbBE_Redis_connection_t *pooled,
+                                          dbBE_Redis_connection_t *master )
+{
+  if(( conn_mgr == NULL ) || ( pooled == NULL ) || ( master == NULL ) ||
+      ( (unsigned)master->_index >= DBBE_REDIS_MAX_CONNECTIONS ))
+    return -EINVAL;
+
+  dbBE_Redis_pool_set_t *ps = &conn_mgr->_pool[ master->_index ];
+  if( ps->_count >= DBBE_REDIS_POOL_MAX - 1 )
+    return -ENOSPC;
+
+  pooled->_primary = master->_index;
+  pooled->_pooled = 1;
+  ps->_idx[ ps->_count++ ] = pooled->_index;
+  LOG( DBG_VERBOSE, stderr, "Connection %d joins the pool of connection %d to %s\n", pooled->_index, master->_index, pooled->_url );
+  return 0;
+}
+
+int dbBE_Redis_connection_mgr_rm_reader( dbBE_Redis_connection_mgr_t *conn_mgr,
+                                         dbBE_Redis_connection_t *reader )
+{
+  if(( conn_mgr == NULL ) || ( ! dbBE_Redis_connection_is_secondary( reader ) ) ||
+      ( (unsigned)reader->_primary >= DBBE_REDIS_MAX_CONNECTIONS ))
+    return -EINVAL;
+
+  dbBE_Redis_locator_index_t *idx = conn_mgr->_readers[ reader->_primary ]._idx;
+  int *count = &conn_mgr->_readers[ reader->_primary ]._count;
+  if( reader->_pooled )
   {
-    dbBE_Redis_connection_unlink( new_conn );
-    dbBE_Redis_connection_destroy( new_conn );
-    goto exit_connect;
+    idx = conn_mgr->_pool[ reader->_primary ]._idx;
+    count = &conn_mgr->_pool[ reader->_primary ]._count;
   }
 
-  free( authfile );
-  return new_conn;
+  int n;
+  for( n = 0; n < *count; ++n )
+    if( idx[ n ] == reader->_index )
+    {
+      idx[ n ] = idx[ --(*count) ];
+      break;
+    }
 
-exit_connect:
-  free( authfile );
-  errno = rc;
-  return NULL;
+  reader->_primary = DBBE_REDIS_LOCATOR_INDEX_INVAL;
+  reader->_pooled = 0;
+  return dbBE_Redis_connection_mgr_rm( conn_mgr, reader );
 }
 
 
@@ -260,125 +1106,178 @@ int dbBE_Redis_connection_mgr_conn_fail( dbBE_Redis_connection_mgr_t *conn_mgr,
  */
 #define DBBE_CONNECTION_MGR_SLOT_EMPTY( cm, n ) (( (cm)->_connections[ (n) ] == NULL ) && ( (cm)->_broken[ (n) ] == NULL ))
 
-static int dbBE_Redis_connection_mgr_restore_master_conn( dbBE_Redis_connection_mgr_t *conn_mgr,
-                                                          dbBE_Redis_locator_t *locator,
-                                                          dbBE_Redis_connection_t *conn,
-                                                          dbBE_Redis_locator_index_t idx )
+/*
+ * a recovery link and the connection it's meant to replace
+ */
+typedef struct
 {
-  int slot;
+  int _idx;
+  int _broken; ///< replaces a broken connection (or a live connection to a replica)
+  char _replaces[ DBR_SERVER_URL_MAX_LENGTH ];
+  char _url[ DBR_SERVER_URL_MAX_LENGTH ];
+} dbBE_Redis_recovery_target_t;
+
+/*
+ * put a new connection in place of an old one; it takes over index and slot range of the old one
+ * so requests that still refer to the index end up at the new connection
+ */
+static
+int dbBE_Redis_connection_mgr_replace( dbBE_Redis_connection_mgr_t *conn_mgr,
+                                       dbBE_Redis_locator_t *locator,
+                                       dbBE_Redis_connection_t *old,
+                                       dbBE_Redis_connection_t *conn )
+{
+  int idx = old->_index;
+  int rc = dbBE_Redis_connection_mgr_rm( conn_mgr, old );
+  if( rc != 0 )
+    return rc;
+
+  dbBE_Redis_slot_bitmap_t *slots = conn->_slots;
+  conn->_slots = old->_slots;
+  old->_slots = slots;
+  dbBE_Redis_connection_destroy( old );
+
   conn_mgr->_connections[ idx ] = conn;
-  conn_mgr->_broken[ idx ] = NULL;
-  dbBE_Redis_event_mgr_add( conn_mgr->_ev_mgr, conn );
-  dbBE_Redis_slot_bitmap_t *bitmap = dbBE_Redis_connection_get_slot_range( conn );
-  for( slot=0;
-      ( bitmap != NULL ) && (slot < DBBE_REDIS_HASH_SLOT_MAX);
-      ++slot )
-  {
-    if( dbBE_Redis_slot_bitmap_get( bitmap, slot ) != 0 )
+  ++conn_mgr->_connection_count;
+  conn->_index = idx;
+  if( dbBE_Redis_event_mgr_add( conn_mgr->_ev_mgr, conn ) != 0 )
+    LOG( DBG_ERR, stderr, "connection_mgr_replace: failed to add conn=%p (socket=%d) to event_mgr.\n", conn, conn->_socket );
+
+  int slot;
+  for( slot = 0; ( conn->_slots != NULL ) && ( slot < DBBE_REDIS_HASH_SLOT_MAX ); ++slot )
+    if( dbBE_Redis_slot_bitmap_get( conn->_slots, slot ) != 0 )
       dbBE_Redis_locator_assign_conn_index( locator, idx, slot );
-  }
-  LOG( DBG_VERBOSE, stderr, "Recovered as master connection idx: %d\n", conn->_index );
   return 0;
 }
 
-
 /*
- * replace the input connection (replica) with its master connection after updating the cluster info
+ * completion of a recovery link: a master takes over for the connection it's meant to replace
  */
-static int dbBE_Redis_connection_mgr_fail_over_new_master( dbBE_Redis_connection_mgr_t *conn_mgr,
-                                                           dbBE_Redis_locator_t *locator,
-                                                           dbBE_Redis_connection_t *conn,
-                                                           dbBE_Redis_cluster_info_t **cluster )
+static
+void dbBE_Redis_connection_mgr_recovery_linked( dbBE_Redis_connection_mgr_t *conn_mgr,
+                                                dbBE_Redis_linkup_t *lu,
+                                                void *arg )
 {
-  dbBE_Redis_cluster_info_t *tmp_cluster = dbBE_Redis_connection_mgr_get_cluster_info( conn_mgr );
-  if( tmp_cluster == NULL )
-    return DBBE_REDIS_CONNECTION_UNRECOVERABLE;
+  dbBE_Redis_recovery_t *rec = &conn_mgr->_recovery;
+  dbBE_Redis_recovery_target_t *target = (dbBE_Redis_recovery_target_t*)arg;
+  --rec->_pending;
 
-  // update global cluster info since we got a new one here
-  dbBE_Redis_cluster_info_destroy( *cluster );
-  *cluster = tmp_cluster;
+  // the next step retries after the backoff
+  if( lu->_state != DBBE_REDIS_LINKUP_DONE )
+    return;
 
-  char *url = dbBE_Redis_connection_get_url( conn );
-  dbBE_Redis_server_info_t *si = dbBE_Redis_cluster_info_get_server_by_addr( tmp_cluster, url );
-  if( si == NULL )
+  // the node came back as a replica or the fail-over hasn't happened yet
+  if( lu->_probe_ok == 0 )
   {
-    LOG( DBG_ERR, stderr, "Unable to find updated master info for %s\n", url );
-    return DBBE_REDIS_CONNECTION_UNRECOVERABLE;
+    LOG( DBG_INFO, stderr, "Recovery: %s is not a master (yet). Retrying with updated cluster info.\n", target->_url );
+    rec->_refresh = 1;
+    return;
   }
 
-  // clean up the old connection
-  dbBE_Redis_connection_mgr_rm( conn_mgr, conn );
-  dbBE_Redis_connection_destroy( conn );
-
-  conn = dbBE_Redis_connection_mgr_newlink( conn_mgr, dbBE_Redis_server_info_get_master( si ) );
-  if( conn == NULL )
-    return DBBE_REDIS_CONNECTION_UNRECOVERABLE;
-
-  dbBE_Redis_hash_slot_t first_slot = dbBE_Redis_server_info_get_first_slot( si );
-  dbBE_Redis_hash_slot_t last_slot = dbBE_Redis_server_info_get_last_slot( si );
-
-  dbBE_Redis_connection_assign_slot_range( conn,
-                                           first_slot,
-                                           last_slot );
-
-  // update locator
-  dbBE_Redis_locator_associate_range_conn_index( locator, first_slot, last_slot, conn->_index );
-  LOG( DBG_VERBOSE, stderr, "Recovered connection by switching to %s\n", dbBE_Redis_server_info_get_master( si ) );
-
-  return DBBE_REDIS_CONNECTION_RECOVERED;
-}
-
+  // skip if another link took over already or the old connection still expects responses
+  dbBE_Redis_connection_t *old = target->_broken ? conn_mgr->_broken[ target->_idx ] : conn_mgr->_connections[ target->_idx ];
+  if(( old == NULL ) ||
+      ( strncmp( old->_url, target->_replaces, DBR_SERVER_URL_MAX_LENGTH ) != 0 ) ||
+      ( dbBE_Redis_s2r_queue_len( old->_posted_q ) != 0 ))
+    return;
 
-static dbBE_Redis_connection_recoverable_t
-dbBE_Redis_connection_mgr_connect_check_replica( dbBE_Redis_connection_mgr_t *conn_mgr,
-                                                 dbBE_Redis_locator_t *locator,
-                                                 dbBE_Redis_server_info_t *server,
-                                                 dbBE_Redis_connection_t *conn,
-                                                 const char *url,
-                                                 dbBE_Redis_locator_index_t first_slot,
-                                                 dbBE_Redis_locator_index_t last_slot )
-{
-  LOG( DBG_VERBOSE, stderr, "Got replica: %s\n", url );
+  dbBE_Redis_connection_t *conn = lu->_conn;
+  if( dbBE_Redis_connection_mgr_replace( conn_mgr, rec->_locator, old, conn ) != 0 )
+    return;
+  lu->_conn = NULL;
+  LOG( DBG_INFO, stderr, "Recovered connection idx: %d to %s\n", conn->_index, target->_url );
 
-  dbBE_Redis_connection_t *repl_conn = dbBE_Redis_connection_mgr_newlink( conn_mgr, url );
-  if( repl_conn == NULL )
+  // a replica took over; make it the master of its server entry
+  if( strncmp( target->_url, target->_replaces, DBR_SERVER_URL_MAX_LENGTH ) != 0 )
   {
-    LOG( DBG_INFO, stderr, "Replica: %s not yet ready to connect\n", url );
-    return DBBE_REDIS_CONNECTION_RECOVERABLE;
+    dbBE_Redis_server_info_t *si = dbBE_Redis_cluster_info_get_server_by_addr( *rec->_cluster, target->_replaces );
+    int n;
+    for( n = 0; ( si != NULL ) && ( n < dbBE_Redis_server_info_getsize( si ) ); ++n )
+    {
+      char *url = dbBE_Redis_server_info_get_replica( si, n );
+      if(( url != NULL ) && ( strncmp( url, target->_url, DBR_SERVER_URL_MAX_LENGTH ) == 0 ))
+      {
+        dbBE_Redis_server_info_update_master( si, n );
+        break;
+      }
+    }
   }
 
-  LOG( DBG_VERBOSE, stderr, "Replica: %s connected\n", url );
+  // take the next step right away
+  dbBE_Redis_event_mgr_timer_arm( conn_mgr->_ev_mgr, DBBE_REDIS_TIMER_RECOVERY, 0 );
+}
 
-  // assign the connection slot range
-  dbBE_Redis_connection_assign_slot_range( repl_conn,
-                                           first_slot,
-                                           last_slot );
+/*
+ * completion of a cluster info query; the next recovery step picks up the result
+ */
+static
+void dbBE_Redis_connection_mgr_recovery_info( dbBE_Redis_connection_mgr_t *conn_mgr,
+                                              dbBE_Redis_linkup_t *lu,
+                                              void *arg )
+{
+  dbBE_Redis_recovery_t *rec = &conn_mgr->_recovery;
+  --rec->_pending;
+  if( lu->_state != DBBE_REDIS_LINKUP_DONE )
+    return;
 
-  dbBE_Redis_connection_mgr_rm( conn_mgr, conn ); // remove the old connection from recv processing
-  dbBE_Redis_connection_destroy( conn ); // delete the old connection
+  dbBE_Redis_cluster_info_t *cl_info = dbBE_Redis_connection_mgr_cluster_info_complete( conn_mgr, lu->_cluster );
+  lu->_cluster = NULL;
+  if( cl_info == NULL )
+    return;
 
-  // if we connected to a replica that's still in replica mode, we end up with MOVED responses all over the place
-  // so tear it down and come back later...
-  switch( dbBE_Redis_connection_mgr_is_master( conn_mgr, repl_conn ) )
-  {
-    case 0:
-      LOG( DBG_INFO, stderr, "Cluster fail-over hasn't happen yet. Retrying later.\n");
-      return DBBE_REDIS_CONNECTION_RECOVERABLE;
-    case 1:
-      LOG( DBG_VERBOSE, stderr, "Replica: %s is voted master by Redis now\n", url );
+  if( rec->_update != NULL )
+    dbBE_Redis_cluster_info_destroy( rec->_update );
+  rec->_update = cl_info;
+  rec->_refresh = 0;
+  dbBE_Redis_event_mgr_timer_arm( conn_mgr->_ev_mgr, DBBE_REDIS_TIMER_RECOVERY, 0 );
+}
 
-      // update locator
-      dbBE_Redis_locator_associate_range_conn_index( locator,
-                                                     first_slot,
-                                                     last_slot,
-                                                     repl_conn->_index );
+/*
+ * start to link to url in order to replace the connection old if it turns out to be a master
+ */
+static
+int dbBE_Redis_connection_mgr_recovery_link( dbBE_Redis_connection_mgr_t *conn_mgr,
+                                             dbBE_Redis_connection_t *old,
+                                             const char *url )
+{
+  dbBE_Redis_recovery_target_t *target = (dbBE_Redis_recovery_target_t*)calloc( 1, sizeof( dbBE_Redis_recovery_target_t ) );
+  if( target == NULL )
+    return -ENOMEM;
+  target->_idx = old->_index;
+  target->_broken = ( conn_mgr->_broken[ old->_index ] == old );
+  snprintf( target->_replaces, DBR_SERVER_URL_MAX_LENGTH, "%s", dbBE_Redis_connection_get_url( old ) );
+  snprintf( target->_url, DBR_SERVER_URL_MAX_LENGTH, "%s", url );
+
+  // the completion might come before the link call returns
+  ++conn_mgr->_recovery._pending;
+  int rc = dbBE_Redis_connection_mgr_link_owned( conn_mgr, url, DBBE_INFO_CATEGORY_ROLE,
+                                                 dbBE_Redis_connection_mgr_recovery_linked, target );
+  if( rc != 0 )
+    --conn_mgr->_recovery._pending;
+  return rc;
+}
 
-      break;
-    default:
-      return DBBE_REDIS_CONNECTION_ERROR;
-  }
+/*
+ * start a query for updated cluster info, preferably at a node that's still reachable
+ */
+static
+void dbBE_Redis_connection_mgr_recovery_query( dbBE_Redis_connection_mgr_t *conn_mgr )
+{
+  const char *url = NULL;
+  unsigned n;
+  for( n = 0; ( n < DBBE_REDIS_MAX_CONNECTIONS ) && ( url == NULL ); ++n )
+    if( dbBE_Redis_connection_RTR( conn_mgr->_connections[ n ] ) && ( ! dbBE_Redis_connection_is_secondary( conn_mgr->_connections[ n ] )))
+      url = dbBE_Redis_connection_get_url( conn_mgr->_connections[ n ] );
+  for( n = 0; ( n < DBBE_REDIS_MAX_CONNECTIONS ) && ( url == NULL ); ++n )
+    if( conn_mgr->_broken[ n ] != NULL )
+      url = dbBE_Redis_connection_get_url( conn_mgr->_broken[ n ] );
+  if( url == NULL )
+    return;
 
-  return DBBE_REDIS_CONNECTION_RECOVERED;
+  ++conn_mgr->_recovery._pending;
+  if( dbBE_Redis_connection_mgr_link_owned( conn_mgr, url, DBBE_INFO_CATEGORY_CLUSTER_SLOTS,
+                                            dbBE_Redis_connection_mgr_recovery_info, NULL ) != 0 )
+    --conn_mgr->_recovery._pending;
 }
 
 static int
@@ -462,31 +1361,6 @@ dbBE_Redis_connection_mgr_compare_cluster_info( dbBE_Redis_cluster_info_t *new_c
   return master_count;
 }
 
-static int
-dbBE_Redis_connection_mgr_wipe_replica_connections( dbBE_Redis_connection_mgr_t *conn_mgr )
-{
-  int n, i;
-  for( n=0, i=0; DBBE_CONNECTIONS_TO_GO( conn_mgr, n, i ); ++n )
-  {
-    if( DBBE_CONNECTION_MGR_SLOT_EMPTY( conn_mgr, n ))
-      continue;
-    ++i;
-    if( conn_mgr->_broken[ n ] != NULL )
-    {
-      dbBE_Redis_connection_t *conn = conn_mgr->_broken[ n ];
-      dbBE_Redis_connection_mgr_rm( conn_mgr, conn );
-      dbBE_Redis_connection_destroy( conn );
-    }
-    dbBE_Redis_connection_t *conn = conn_mgr->_connections[ n ];
-    if( dbBE_Redis_connection_mgr_is_master( conn_mgr, conn ) == 0 )
-    {
-      dbBE_Redis_connection_mgr_rm( conn_mgr, conn );
-      dbBE_Redis_connection_destroy( conn );
-    }
-  }
-  return 0;
-}
-
 static dbBE_Redis_connection_recoverable_t
 dbBE_Redis_connection_mgr_update_all_hash_ranges( dbBE_Redis_connection_mgr_t *conn_mgr,
                                                   dbBE_Redis_locator_t *locator,
@@ -517,9 +1391,11 @@ dbBE_Redis_connection_mgr_update_all_hash_ranges( dbBE_Redis_connection_mgr_t *c
   return DBBE_REDIS_CONNECTION_RECOVERED;
 }
 
+/*
+ * link to the masters of remaining connections to replicas; they replace the replica connections
+ */
 static dbBE_Redis_connection_recoverable_t
 dbBE_Redis_connection_mgr_replica_to_master( dbBE_Redis_connection_mgr_t *conn_mgr,
-                                             dbBE_Redis_locator_t *locator,
                                              dbBE_Redis_cluster_info_t *cluster,
                                              dbBE_Redis_connection_t **connections,
                                              int connection_count )
@@ -539,233 +1415,154 @@ dbBE_Redis_connection_mgr_replica_to_master( dbBE_Redis_connection_mgr_t *conn_m
       return DBBE_REDIS_CONNECTION_UNRECOVERABLE;
     }
 
-    // check connection to master:
-    c_url = dbBE_Redis_server_info_get_master( si );
-    dbBE_Redis_connection_t *mconn = dbBE_Redis_connection_mgr_newlink( conn_mgr, c_url );
-    if( mconn == NULL )
-    {
-      LOG( DBG_ERR, stderr, "Master %s still unavailable without failover. Retry later\n", c_url );
-      return DBBE_REDIS_CONNECTION_RECOVERABLE;
-    }
-
-    dbBE_Redis_connection_mgr_rm( conn_mgr, sconn );
-    connections[ n ] = NULL;
-    int first_slot = dbBE_Redis_server_info_get_first_slot( si );
-    int last_slot = dbBE_Redis_server_info_get_last_slot( si );
-
-    // assign the connection slot range
-    dbBE_Redis_connection_assign_slot_range( mconn,
-                                             first_slot,
-                                             last_slot );
-    // update locator
-    dbBE_Redis_locator_associate_range_conn_index( locator,
-                                                   first_slot,
-                                                   last_slot,
-                                                   mconn->_index );
+    dbBE_Redis_connection_mgr_recovery_link( conn_mgr, sconn, dbBE_Redis_server_info_get_master( si ) );
   }
-  return DBBE_REDIS_CONNECTION_RECOVERED;
+  return DBBE_REDIS_CONNECTION_RECOVERABLE;
 }
 
 /*
- * return recoverable status
- * -1 -> impossible to recover
- * 0 -> successfully recovered
- * 1 -> recovery still possible
+ * start links to replace broken connections or to switch from replicas to masters
+ * old_cluster is set if the cluster info got updated for this step
  */
-dbBE_Redis_connection_recoverable_t dbBE_Redis_connection_mgr_conn_recover(
-    dbBE_Redis_connection_mgr_t *conn_mgr,
-    dbBE_Redis_locator_t *locator,
-    dbBE_Redis_cluster_info_t **cluster )
+static dbBE_Redis_connection_recoverable_t
+dbBE_Redis_connection_mgr_recovery_step( dbBE_Redis_connection_mgr_t *conn_mgr,
+                                         dbBE_Redis_locator_t *locator,
+                                         dbBE_Redis_cluster_info_t *cluster,
+                                         dbBE_Redis_cluster_info_t *old_cluster )
 {
-  if(( conn_mgr == NULL ) || ( locator == NULL ) || ( cluster == NULL ) || ( *cluster == NULL ))
-    return DBBE_REDIS_CONNECTION_ERROR;
+  dbBE_Redis_recovery_t *rec = &conn_mgr->_recovery;
+  if( dbBE_Redis_locator_hash_covered( locator ) == 1 )
+    return DBBE_REDIS_CONNECTION_RECOVERED;
 
-  // two recovery types:
-  // 1) broken connection: recover it
-  // 2) incomplete hash coverage caused by recovery to replica
+  // wait for the links and queries of the previous step
+  if( rec->_pending > 0 )
+    return DBBE_REDIS_CONNECTION_RECOVERABLE;
 
+  if(( rec->_refresh != 0 ) && ( old_cluster == NULL ))
+    dbBE_Redis_connection_mgr_recovery_query( conn_mgr );
 
-  // 1) check for broken connections
-  unsigned c;
-  int orig_conn_index = -1;
-  dbBE_Redis_connection_recoverable_t recoverable = DBBE_REDIS_CONNECTION_RECOVERABLE;  // assume recoverable but not yet recovered
-  int recovered = 0;
-  int unbroken = 0; // count the unbroken/empty
-  for( c=0; (c < DBBE_REDIS_MAX_CONNECTIONS) && (unbroken+recovered < conn_mgr->_connection_count); ++c )
+  // two recovery types:
+  // 1) broken connection: link to its node again or to the node that took over
+  // 2) incomplete hash coverage caused by recovery to replica
+  int n, i;
+  int unbroken = 0;
+  for( n=0, i=0; DBBE_CONNECTIONS_TO_GO( conn_mgr, n, i ); ++n )
   {
-    if( DBBE_CONNECTION_MGR_SLOT_EMPTY( conn_mgr, c ) )
+    if( DBBE_CONNECTION_MGR_SLOT_EMPTY( conn_mgr, n ))
       continue;
-
-    dbBE_Redis_connection_t *broke = conn_mgr->_broken[ c ];
-    if( broke != NULL )
+    ++i;
+    dbBE_Redis_connection_t *broke = conn_mgr->_broken[ n ];
+    if( broke == NULL )
     {
-      orig_conn_index = broke->_index;
-      broke->_status = DBBE_CONNECTION_STATUS_DISCONNECTED;
-      if( dbBE_Redis_connection_reconnect( broke ) == 0 ) // try reconnect and if successful:
-      {
-        LOG( DBG_INFO, stderr, "Recovered connection idx: %d\n", broke->_index );
-        switch( dbBE_Redis_connection_mgr_is_master( conn_mgr, broke ) )
-        {
-          case 1: // recovered connection is a master, we're back to normal
-          {
-            dbBE_Redis_connection_mgr_restore_master_conn( conn_mgr, locator, broke, c );
-            ++recovered;
-            break;
-          }
-          case 0: // recovered connection is now a replica, need to update clusterinfo and connect to master
-          {
-            LOG( DBG_VERBOSE, stderr, "Connection switching required because it's a replica\n" );
-            recoverable = dbBE_Redis_connection_mgr_fail_over_new_master( conn_mgr, locator, broke, cluster);
-            if( recoverable == DBBE_REDIS_CONNECTION_RECOVERED )
-              ++recovered;
-            else
-              return recoverable;
-            break;
-          }
-          default:
-            return DBBE_REDIS_CONNECTION_UNRECOVERABLE;
-        } // switch (is_master)
-
-      }
-      else // if reconnect failed
-      {
-        // allow failed attempts to reconnect to original connection, until it's declared unrecoverable
-        if( dbBE_Redis_connection_recoverable( broke ) != DBBE_REDIS_CONNECTION_UNRECOVERABLE )
-        {
-          usleep(250000);
-          break;
-        }
-
-        char *url = dbBE_Redis_connection_get_url( broke );
-        LOG( DBG_INFO, stderr, "Master connection to %s unrecoverable. Switching to replica\n", url );
-        dbBE_Redis_server_info_t *server = dbBE_Redis_cluster_info_get_server_by_addr( *cluster,
-                                                                                       url );
-        if( server != NULL )
-        {
-          int first_slot = dbBE_Redis_server_info_get_first_slot( server );
-          int last_slot = dbBE_Redis_server_info_get_last_slot( server );
-          int n;
-
-          if(( server->_server_count == 1 ) && ( dbBE_Redis_connection_recoverable( broke ) == DBBE_REDIS_CONNECTION_UNRECOVERABLE ))
-          {
-            return DBBE_REDIS_CONNECTION_UNRECOVERABLE;  // return as unable to recover
-          }
-
-          for( n = 0; ( n < server->_server_count ) && ( recovered == 0 ); ++n )
-          {
-            // don't retry the master, that failed above already. (assuming the bookkeeping is correct)
-            char *addr = dbBE_Redis_server_info_get_replica( server, n );
-            if( addr == dbBE_Redis_server_info_get_master( server ) )
-              continue;
-
-            recoverable = dbBE_Redis_connection_mgr_connect_check_replica( conn_mgr, locator, server,
-                                                                           broke, addr, first_slot, last_slot );
-            switch( recoverable )
-            {
-              case DBBE_REDIS_CONNECTION_RECOVERED:
-                dbBE_Redis_server_info_update_master( server, n ); // make the connection to this replica the new master
-                ++recovered;
-                break;
-              case DBBE_REDIS_CONNECTION_RECOVERABLE:
-                usleep( 250000 );
-                break;
-              case DBBE_REDIS_CONNECTION_UNRECOVERABLE:
-              default:
-                return recoverable;
-            }
-          }
-        } // if( server != NULL )
-      } // if( dbBE_Redis_connection_reconnect( rec ) == 0 )
-
-      if( recovered == 0 )
-        LOG( DBG_VERBOSE, stderr, "conn_mgr_conn_recover: failed to reconnect or recover index %d. Also failed to find/connect to replicas\n", orig_conn_index );
-    } // if( rec != NULL )
-    else
       ++unbroken;
-  } //  for( c=0; ... )
-
-  if( unbroken == conn_mgr->_connection_count ) // need recovery and have no broken connections? Lets check clusterinfo...
-  {
-    LOG( DBG_INFO, stderr, "Recovery requested while all known connections alive. Need new cluster info?\n" );
-    // todo retrieve cluster info and make sure we're only connected to master instances
-    dbBE_Redis_cluster_info_t *new_cluster = dbBE_Redis_connection_mgr_get_cluster_info( conn_mgr );
-    if( new_cluster == NULL )
-      return DBBE_REDIS_CONNECTION_UNRECOVERABLE;
-
-
-    dbBE_Redis_connection_t **tmp_conns;
-    int tmp_conn_count = dbBE_Redis_connection_mgr_create_connection_list( conn_mgr, &tmp_conns );
-    if( tmp_conn_count < 0 )
-    {
-      dbBE_Redis_cluster_info_destroy( new_cluster );
-      return DBBE_REDIS_CONNECTION_UNRECOVERABLE;
+      continue;
     }
 
-    // compare clusterinfo:
-    int master_count = dbBE_Redis_connection_mgr_compare_cluster_info( new_cluster, *cluster, tmp_conns, tmp_conn_count );
-    if( master_count < 0 )
+    char *url = dbBE_Redis_connection_get_url( broke );
+    dbBE_Redis_server_info_t *server = dbBE_Redis_cluster_info_get_server_by_addr( cluster, url );
+    char *master = ( server != NULL ) ? dbBE_Redis_server_info_get_master( server ) : url;
+    if( strncmp( master, url, DBR_SERVER_URL_MAX_LENGTH ) != 0 )
     {
-      dbBE_Redis_cluster_info_destroy( new_cluster );
-      free( tmp_conns );
-      return DBBE_REDIS_CONNECTION_UNRECOVERABLE;
+      LOG( DBG_VERBOSE, stderr, "Connection switching required because %s is a replica of %s now\n", url, master );
+      dbBE_Redis_connection_mgr_recovery_link( conn_mgr, broke, master );
     }
-
-    // update global cluster info since we got a new one here
-    dbBE_Redis_cluster_info_destroy( *cluster );
-    *cluster = new_cluster;
-
-    if( master_count == tmp_conn_count )
+    // allow attempts to reconnect to the original node, until it's declared unrecoverable
+    else if( dbBE_Redis_connection_recoverable( broke ) != DBBE_REDIS_CONNECTION_UNRECOVERABLE )
+      dbBE_Redis_connection_mgr_recovery_link( conn_mgr, broke, url );
+    else
     {
-      // all masters connected. Why did this recovery get triggered?
-      LOG( DBG_ERR, stderr, "Requested recovery while all connections link to masters of updated cluster info.\n");
-
-      // temp connections should be all NULL right now and we don't need them any more in this branch
-      free( tmp_conns );
-
-      // remove any non-master connections for conn_mgr
-      if( tmp_conn_count != conn_mgr->_connection_count )
+      LOG( DBG_INFO, stderr, "Master connection to %s unrecoverable. Switching to replica\n", url );
+      if(( server == NULL ) || ( dbBE_Redis_server_info_getsize( server ) == 1 ))
       {
-        LOG( DBG_ERR, stderr, "There are unnecessary connections: %d\n", conn_mgr->_connection_count - tmp_conn_count );
-        dbBE_Redis_connection_mgr_wipe_replica_connections( conn_mgr );
+        // nobody can take over; keep probing the node in case it comes back
+        dbBE_Redis_connection_mgr_recovery_link( conn_mgr, broke, url );
+        return DBBE_REDIS_CONNECTION_UNRECOVERABLE;
       }
 
-      // checking/updating hash coverage...
-      if( dbBE_Redis_locator_hash_covered( locator ) )
-        return DBBE_REDIS_CONNECTION_RECOVERED;
-
-      recoverable = dbBE_Redis_connection_mgr_update_all_hash_ranges( conn_mgr, locator, *cluster );
-    }
-
-    // any remaining connections must be replica links which need to be switched to their master
-    // only attempt to switch if we're still not recovered yet:
-    if( recoverable != DBBE_REDIS_CONNECTION_RECOVERED )
-    {
-      recoverable = dbBE_Redis_connection_mgr_replica_to_master( conn_mgr, locator, *cluster, tmp_conns, tmp_conn_count );
-      switch( recoverable )
+      // whichever replica got promoted takes over
+      int s;
+      for( s = 0; s < dbBE_Redis_server_info_getsize( server ); ++s )
       {
-        case DBBE_REDIS_CONNECTION_RECOVERABLE:
-          usleep( 250000 );
-          break;
-        case DBBE_REDIS_CONNECTION_RECOVERED:
-          break;
-        case DBBE_REDIS_CONNECTION_UNRECOVERABLE:
-        default:
-          break;
+        char *addr = dbBE_Redis_server_info_get_replica( server, s );
+        if(( addr != NULL ) && ( addr != master ))
+          dbBE_Redis_connection_mgr_recovery_link( conn_mgr, broke, addr );
       }
-      free( tmp_conns );
     }
+  }
+
+  if( unbroken < conn_mgr->_connection_count )
+    return DBBE_REDIS_CONNECTION_RECOVERABLE;
+
+  // need recovery and have no broken connections? Lets check clusterinfo...
+  if( old_cluster == NULL )
+  {
+    LOG( DBG_INFO, stderr, "Recovery requested while all known connections alive. Need new cluster info?\n" );
+    if( rec->_pending == 0 )
+      dbBE_Redis_connection_mgr_recovery_query( conn_mgr );
+    return DBBE_REDIS_CONNECTION_RECOVERABLE;
+  }
+
+  dbBE_Redis_connection_t **tmp_conns;
+  int tmp_conn_count = dbBE_Redis_connection_mgr_create_connection_list( conn_mgr, &tmp_conns );
+  if( tmp_conn_count < 0 )
+    return DBBE_REDIS_CONNECTION_UNRECOVERABLE;
 
+  // compare clusterinfo:
+  dbBE_Redis_connection_recoverable_t recoverable = DBBE_REDIS_CONNECTION_RECOVERABLE;
+  int master_count = dbBE_Redis_connection_mgr_compare_cluster_info( cluster, old_cluster, tmp_conns, tmp_conn_count );
+  if( master_count < 0 )
+    recoverable = DBBE_REDIS_CONNECTION_UNRECOVERABLE;
+  else if( master_count == tmp_conn_count )
+  {
+    // all masters connected. Why did this recovery get triggered?
+    LOG( DBG_ERR, stderr, "Requested recovery while all connections link to masters of updated cluster info.\n");
+    recoverable = dbBE_Redis_connection_mgr_update_all_hash_ranges( conn_mgr, locator, cluster );
   }
+  else
+    // any remaining connections must be replica links which need to be switched to their master
+    recoverable = dbBE_Redis_connection_mgr_replica_to_master( conn_mgr, cluster, tmp_conns, tmp_conn_count );
+  free( tmp_conns );
+
+  if(( recoverable == DBBE_REDIS_CONNECTION_UNRECOVERABLE ) || ( recoverable == DBBE_REDIS_CONNECTION_ERROR ))
+    return recoverable;
 
   // check how far we got with recovery
   if( dbBE_Redis_locator_hash_covered( locator ) == 1 )
-    recoverable = DBBE_REDIS_CONNECTION_RECOVERED;
-  else
-    recoverable = DBBE_REDIS_CONNECTION_RECOVERABLE;
+    return DBBE_REDIS_CONNECTION_RECOVERED;
+  return DBBE_REDIS_CONNECTION_RECOVERABLE;
+}
+
+dbBE_Redis_connection_recoverable_t dbBE_Redis_connection_mgr_conn_recover(
+    dbBE_Redis_connection_mgr_t *conn_mgr,
+    dbBE_Redis_locator_t *locator,
+    dbBE_Redis_cluster_info_t **cluster )
+{
+  if(( conn_mgr == NULL ) || ( locator == NULL ) || ( cluster == NULL ) || ( *cluster == NULL ))
+    return DBBE_REDIS_CONNECTION_ERROR;
+
+  // the callbacks of recovery links refer to these
+  dbBE_Redis_recovery_t *rec = &conn_mgr->_recovery;
+  rec->_locator = locator;
+  rec->_cluster = cluster;
+
+  // cluster info that arrived since the last step replaces the global one
+  dbBE_Redis_cluster_info_t *old_cluster = NULL;
+  if( rec->_update != NULL )
+  {
+    old_cluster = *cluster;
+    *cluster = rec->_update;
+    rec->_update = NULL;
+  }
 
+  dbBE_Redis_connection_recoverable_t recoverable =
+      dbBE_Redis_connection_mgr_recovery_step( conn_mgr, locator, *cluster, old_cluster );
+
+  if( old_cluster != NULL )
+    dbBE_Redis_cluster_info_destroy( old_cluster );
   return recoverable;
 }
 
+
 /*
  * Remove a connection from the mgr regardless of status
  */
@@ -831,14 +1628,34 @@ dbBE_Redis_connection_t* dbBE_Redis_connection_mgr_get_connection_to( dbBE_Redis
   for( i = 0; (i < DBBE_REDIS_MAX_CONNECTIONS); ++i )
   {
     conn = conn_mgr->_connections[ i ];
-    if(( conn  != NULL ) && ( dbBE_Network_address_compare( conn->_address, d_addr ) == 0 ))
+    if(( conn  != NULL ) && ( ! dbBE_Redis_connection_is_secondary( conn ) ) &&
+        ( dbBE_Network_address_compare( conn->_address, d_addr ) == 0 ))
       break;
   }
+  if( i >= DBBE_REDIS_MAX_CONNECTIONS )
+    conn = NULL;
   dbBE_Network_address_destroy( d_addr );
   return conn;
 }
 
 
+dbBE_Redis_connection_t* dbBE_Redis_connection_mgr_next_master( dbBE_Redis_connection_mgr_t *conn_mgr,
+                                                                const int after )
+{
+  if( conn_mgr == NULL )
+    return NULL;
+
+  unsigned i;
+  for( i = (unsigned)( after + 1 ); i < DBBE_REDIS_MAX_CONNECTIONS; ++i )
+  {
+    dbBE_Redis_connection_t *conn = conn_mgr->_connections[ i ];
+    if( dbBE_Redis_connection_RTR( conn ) && ( ! dbBE_Redis_connection_is_secondary( conn ) ))
+      return conn;
+  }
+  return NULL;
+}
+
+
 dbBE_Redis_connection_t* dbBE_Redis_connection_mgr_get_active( dbBE_Redis_connection_mgr_t *conn_mgr, const int blocking )
 {
   if( conn_mgr != NULL )
@@ -861,7 +1678,8 @@ dbBE_Redis_request_t* dbBE_Redis_connection_mgr_request_each( dbBE_Redis_connect
   for( i = 0; (i < DBBE_REDIS_MAX_CONNECTIONS); ++i )
   {
     if(( conn_mgr->_connections[ i ] != NULL ) &&
-        (dbBE_Redis_connection_RTR( conn_mgr->_connections[ i ] ) ))
+        (dbBE_Redis_connection_RTR( conn_mgr->_connections[ i ] ) ) &&
+        ( ! dbBE_Redis_connection_is_secondary( conn_mgr->_connections[ i ] ) ))
     {
       // if local-directory is requested, skip any non-local Redis servers
       if(( template_request->_user->_group == DBR_GROUP_LOCAL ) &&
@@ -874,6 +1692,7 @@ dbBE_Redis_request_t* dbBE_Redis_connection_mgr_request_each( dbBE_Redis_connect
       req->_location._type = DBBE_REDIS_REQUEST_LOCATION_TYPE_SLOT;
       req->_location._data._conn_idx = conn_mgr->_connections[ i ]->_index;
       req->_step = template_request->_step;
+      req->_flags = template_request->_flags & DBBE_REDIS_REQUEST_FLAG_MASTER_ONLY;
       memcpy( &req->_status, &template_request->_status, sizeof( dbBE_Redis_intern_data_t ));
       req->_next = queue;
       queue = req;
@@ -908,6 +1727,9 @@ dbBE_Redis_result_t* dbBE_Redis_connection_mgr_retrieve_info( dbBE_Redis_connect
     case DBBE_INFO_CATEGORY_CLUSTER_SLOTS:
       len = snprintf( sbuf, buf_space, "*2\r\n$7\r\nCLUSTER\r\n$5\r\nSLOTS\r\n" );
       break;
+    case DBBE_INFO_CATEGORY_READONLY:
+      len = snprintf( sbuf, buf_space, "*1\r\n$8\r\nREADONLY\r\n" );
+      break;
     default:
       return NULL;
   }
@@ -1032,6 +1854,8 @@ DBR_Errorcode_t dbBE_Redis_connection_mgr_set_local_address( dbBE_Redis_connecti
       {
         if( dbBE_Network_address_compare_ip( (struct sockaddr_in*)it->ifa_addr, &addr->_address ) == 0 )
         {
+          if( conn_mgr->_local != NULL )
+            dbBE_Network_address_destroy( conn_mgr->_local );
           conn_mgr->_local = addr;
           freeifaddrs( ifs );
           return DBR_SUCCESS;
@@ -1053,26 +1877,57 @@ dbBE_Redis_cluster_info_t* dbBE_Redis_connection_mgr_get_cluster_info( dbBE_Redi
     return NULL;
 
   // search for a functional connection
+  // the query bypasses the receiver, so it must not use a connection with responses in flight
   dbBE_Redis_connection_t *initial_conn = NULL;
+  dbBE_Redis_connection_t *busy_conn = NULL;
   unsigned n;
   for( n=0; (n<DBBE_REDIS_MAX_CONNECTIONS) && (initial_conn == NULL); ++n )
     if( dbBE_Redis_connection_RTR( conn_mgr->_connections[ n ] ) )
-      initial_conn = conn_mgr->_connections[ n ];
+    {
+      if( dbBE_Redis_s2r_queue_len( conn_mgr->_connections[ n ]->_posted_q ) == 0 )
+        initial_conn = conn_mgr->_connections[ n ];
+      else if( busy_conn == NULL )
+        busy_conn = conn_mgr->_connections[ n ];
+    }
+
+  // all connections busy (recovery while traffic continues): use a temporary link to the same server
+  dbBE_Redis_connection_t *temp_conn = NULL;
+  if(( initial_conn == NULL ) && ( busy_conn != NULL ))
+  {
+    char *authfile = dbBE_Extract_env( DBR_SERVER_AUTHFILE_ENV, DBR_SERVER_DEFAULT_AUTHFILE );
+    temp_conn = dbBE_Redis_connection_create( conn_mgr->_config->_rbuf_len );
+    if(( temp_conn != NULL ) &&
+        ( dbBE_Redis_connection_link( temp_conn, dbBE_Redis_connection_get_url( busy_conn ), authfile ) == NULL ))
+    {
+      dbBE_Redis_connection_destroy( temp_conn );
+      temp_conn = NULL;
+    }
+    free( authfile );
+    initial_conn = temp_conn;
+  }
 
   if( initial_conn == NULL )
     return NULL;
 
   dbBE_Redis_sr_buffer_t *iobuf = dbBE_Transport_sr_buffer_allocate(
       DBBE_REDIS_MAX_CONNECTIONS * DBBE_REDIS_INFO_PER_SERVER );
-  if( iobuf == NULL )
-    return NULL;
+  dbBE_Redis_result_t *result = NULL;
 
   // retrieve the cluster info
-  dbBE_Redis_result_t *result = dbBE_Redis_connection_mgr_retrieve_info(
-      conn_mgr, initial_conn, iobuf, DBBE_INFO_CATEGORY_CLUSTER_SLOTS );
+  if( iobuf != NULL )
+    result = dbBE_Redis_connection_mgr_retrieve_info(
+        conn_mgr, initial_conn, iobuf, DBBE_INFO_CATEGORY_CLUSTER_SLOTS );
+
+  if( temp_conn != NULL )
+  {
+    dbBE_Redis_connection_unlink( temp_conn );
+    dbBE_Redis_connection_destroy( temp_conn );
+  }
+
   if( result == NULL )
   {
-    dbBE_Transport_sr_buffer_free( iobuf );
+    if( iobuf != NULL )
+      dbBE_Transport_sr_buffer_free( iobuf );
     return NULL;
   }
 
@@ -1081,6 +1936,13 @@ dbBE_Redis_cluster_info_t* dbBE_Redis_connection_mgr_get_cluster_info( dbBE_Redi
 
   dbBE_Transport_sr_buffer_free( iobuf );
 
+  return dbBE_Redis_connection_mgr_cluster_info_complete( conn_mgr, cl_info );
+}
+
+static
+dbBE_Redis_cluster_info_t* dbBE_Redis_connection_mgr_cluster_info_complete( dbBE_Redis_connection_mgr_t *conn_mgr,
+                                                                            dbBE_Redis_cluster_info_t *cl_info )
+{
   // do we have single-node Redis server?
   if( cl_info == NULL )
   {
@@ -1092,6 +1954,7 @@ dbBE_Redis_cluster_info_t* dbBE_Redis_connection_mgr_get_cluster_info( dbBE_Redi
     }
   }
 
-  dbBE_Redis_connection_mgr_set_local_address( conn_mgr, cl_info );
+  if( cl_info != NULL )
+    dbBE_Redis_connection_mgr_set_local_address( conn_mgr, cl_info );
   return cl_info;
 }
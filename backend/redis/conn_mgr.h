@@ -33,15 +33,53 @@ typedef enum
   DBBE_INFO_CATEGORY_UNSPECIFIED = 0,
   DBBE_INFO_CATEGORY_ROLE = 1,
   DBBE_INFO_CATEGORY_CLUSTER_SLOTS = 2,
-  DBBE_INFO_CATEGORY_MAX = 3
+  DBBE_INFO_CATEGORY_READONLY = 3,
+  DBBE_INFO_CATEGORY_MAX = 4
 }  dbBE_Redis_cluster_info_category_t;
 
 typedef struct
 {
   size_t _rbuf_len; ///< length of receive buffer for new connections
   size_t _sbuf_len; ///< length of send buffer for new connections
+  int _read_replicas; ///< open READONLY connections to replicas and balance reads across them
+  int _pool_size; ///< number of connections per master node (1..DBBE_REDIS_POOL_MAX)
+  int _protocol; ///< RESP version to ask for with HELLO on new connections (3; otherwise no HELLO)
+  char _read_your_writes[ DBBE_REDIS_READ_YOUR_WRITES_MAX ]; ///< namespaces that keep reading from the masters
 } dbBE_Redis_conn_mgr_config_t;
 
+/*
+ * READONLY replica connections that serve reads for the slots of one master connection
+ */
+typedef struct
+{
+  dbBE_Redis_locator_index_t _idx[ DBBE_REDIS_CLUSTER_MAX_REPLICA ];
+  int _count;
+  unsigned _next; ///< round-robin position; the master itself takes every (_count+1)th read
+} dbBE_Redis_reader_set_t;
+
+/*
+ * additional connections to the node of one master connection; the master connection is lane _count
+ */
+typedef struct
+{
+  dbBE_Redis_locator_index_t _idx[ DBBE_REDIS_POOL_MAX - 1 ];
+  int _count;
+} dbBE_Redis_pool_set_t;
+
+struct dbBE_Redis_background_link;
+
+/*
+ * progress of a cluster recovery; its links and queries complete in event_mgr callbacks
+ */
+typedef struct
+{
+  dbBE_Redis_locator_t *_locator;
+  dbBE_Redis_cluster_info_t **_cluster;
+  dbBE_Redis_cluster_info_t *_update; ///< cluster info that arrived since the last recovery step
+  int _pending; ///< links and cluster info queries in flight
+  int _refresh; ///< a node reported a different role than expected; query the cluster info again
+} dbBE_Redis_recovery_t;
+
 typedef struct
 {
   // connection list
@@ -53,9 +91,20 @@ typedef struct
 
   int _connection_count;
 
+  // replica connections per master connection index
+  dbBE_Redis_reader_set_t _readers[ DBBE_REDIS_MAX_CONNECTIONS ];
+
+  // pooled connections per master connection index
+  dbBE_Redis_pool_set_t _pool[ DBBE_REDIS_MAX_CONNECTIONS ];
+
   // active connections?
   // disabled/old/disconnected connections?
 
+  // connections that are still linking up in the background (or failed to)
+  struct dbBE_Redis_background_link *_links[ DBBE_REDIS_BACKGROUND_LINKS_MAX ];
+
+  dbBE_Redis_recovery_t _recovery;
+
   dbBE_Redis_event_mgr_t *_ev_mgr;
 } dbBE_Redis_connection_mgr_t;
 
@@ -84,7 +133,10 @@ int dbBE_Redis_connection_mgr_conn_fail( dbBE_Redis_connection_mgr_t *conn_mgr,
                                          dbBE_Redis_connection_t *conn );
 
 /*
- * attempt to recover the conn_mgr connectivity
+ * take one non-blocking step to recover the conn_mgr connectivity
+ * starts background links to replace broken connections (or to query the cluster info) and returns;
+ * a completed link takes over the index of the connection it replaces and re-arms
+ * DBBE_REDIS_TIMER_RECOVERY to have the caller take the next step right away
  */
 dbBE_Redis_connection_recoverable_t dbBE_Redis_connection_mgr_conn_recover(
     dbBE_Redis_connection_mgr_t *conn_mgr,
@@ -103,6 +155,64 @@ int dbBE_Redis_connection_mgr_rm( dbBE_Redis_connection_mgr_t *conn_mgr,
 dbBE_Redis_connection_t* dbBE_Redis_connection_mgr_newlink( dbBE_Redis_connection_mgr_t *conn_mgr,
                                                             const char *url );
 
+/*
+ * Insert and connect new connections to a set of urls concurrently
+ * connects are non-blocking; AUTH and the probe (ROLE, READONLY, or UNSPECIFIED for none)
+ * are pipelined in a single write per connection
+ * conns[i] is NULL if urls[i] failed; probe_ok[i] (if not NULL) is 1 if the node
+ * reported to be a master (ROLE) or accepted READONLY
+ * returns the number of new connections or <0 on error
+ */
+int dbBE_Redis_connection_mgr_newlinks( dbBE_Redis_connection_mgr_t *conn_mgr,
+                                        char **urls,
+                                        const int count,
+                                        const dbBE_Redis_cluster_info_category_t probe,
+                                        dbBE_Redis_connection_t **conns,
+                                        int *probe_ok );
+
+/*
+ * Start connecting to url in the background and return the (not yet ready) connection right away
+ * connect, AUTH and the probe advance in event_mgr callbacks; the connection gets added to the mgr once complete
+ * a repeated call for the same url returns the same connection and restarts a failed attempt
+ */
+dbBE_Redis_connection_t* dbBE_Redis_connection_mgr_link_async( dbBE_Redis_connection_mgr_t *conn_mgr,
+                                                               const char *url,
+                                                               const dbBE_Redis_cluster_info_category_t probe );
+
+/*
+ * state of a connection that got started by dbBE_Redis_connection_mgr_link_async()
+ * returns 1 while linking, 0 if it's not (or no longer) linking in the background, <0 if it failed
+ */
+int dbBE_Redis_connection_mgr_link_status( dbBE_Redis_connection_mgr_t *conn_mgr,
+                                           const dbBE_Redis_connection_t *conn );
+
+/*
+ * Add a connected READONLY replica connection to the reader set of the given master connection
+ */
+int dbBE_Redis_connection_mgr_add_reader( dbBE_Redis_connection_mgr_t *conn_mgr,
+                                          dbBE_Redis_connection_t *reader,
+                                          dbBE_Redis_connection_t *master );
+
+/*
+ * Insert and connect a READONLY connection to a replica of the given master connection
+ */
+dbBE_Redis_connection_t* dbBE_Redis_connection_mgr_newreader( dbBE_Redis_connection_mgr_t *conn_mgr,
+                                                              const char *url,
+                                                              dbBE_Redis_connection_t *master );
+
+/*
+ * Add a connection to the node of the given master connection to the master's pool
+ */
+int dbBE_Redis_connection_mgr_add_pooled( dbBE_Redis_connection_mgr_t *conn_mgr,
+                                          dbBE_Redis_connection_t *pooled,
+                                          dbBE_Redis_connection_t *master );
+
+/*
+ * Remove a secondary (READONLY replica or pooled) connection from its master's set and from the mgr
+ */
+int dbBE_Redis_connection_mgr_rm_reader( dbBE_Redis_connection_mgr_t *conn_mgr,
+                                         dbBE_Redis_connection_t *reader );
+
 /*
  * get the number of (active) connections
  */
@@ -128,7 +238,60 @@ dbBE_Redis_connection_t* dbBE_Redis_connection_mgr_get_connection_at( dbBE_Redis
 }
 
 /*
- * return the connection entry to a given destination address
+ * pick the connection to serve a read for the slots of a master connection
+ * round-robin across the master and its ready replica connections
+ * returns the master if read scaling is disabled or there are no replicas
+ */
+static inline
+dbBE_Redis_connection_t* dbBE_Redis_connection_mgr_get_reader( dbBE_Redis_connection_mgr_t *conn_mgr,
+                                                               dbBE_Redis_connection_t *master )
+{
+  if(( conn_mgr == NULL ) || ( master == NULL ) || ( conn_mgr->_config->_read_replicas == 0 ) ||
+      ( (unsigned)master->_index >= DBBE_REDIS_MAX_CONNECTIONS ))
+    return master;
+
+  dbBE_Redis_reader_set_t *rs = &conn_mgr->_readers[ master->_index ];
+  if( rs->_count == 0 )
+    return master;
+
+  unsigned n = rs->_next++ % ( rs->_count + 1 );
+  if( n == (unsigned)rs->_count )
+    return master;
+
+  dbBE_Redis_connection_t *reader = conn_mgr->_connections[ rs->_idx[ n ] ];
+  return dbBE_Redis_connection_RTR( reader ) ? reader : master;
+}
+
+/*
+ * pick the connection of a master's pool that serves a hash slot
+ * the same slot always maps to the same connection to keep the order of requests per key
+ * returns the master if there's no pool or the selected connection isn't ready
+ */
+static inline
+dbBE_Redis_connection_t* dbBE_Redis_connection_mgr_get_pooled( dbBE_Redis_connection_mgr_t *conn_mgr,
+                                                               dbBE_Redis_connection_t *master,
+                                                               const dbBE_Redis_hash_slot_t slot )
+{
+  if(( conn_mgr == NULL ) || ( master == NULL ) || ( (unsigned)master->_index >= DBBE_REDIS_MAX_CONNECTIONS ))
+    return master;
+
+  dbBE_Redis_pool_set_t *ps = &conn_mgr->_pool[ master->_index ];
+  unsigned n = slot % ( ps->_count + 1 );
+  if( n == (unsigned)ps->_count )
+    return master;
+
+  dbBE_Redis_connection_t *pooled = conn_mgr->_connections[ ps->_idx[ n ] ];
+  return dbBE_Redis_connection_RTR( pooled ) ? pooled : master;
+}
+
+/*
+ * return the first ready master connection with an index larger than after (-1 to start at the beginning)
+ */
+dbBE_Redis_connection_t* dbBE_Redis_connection_mgr_next_master( dbBE_Redis_connection_mgr_t *conn_mgr,
+                                                                const int after );
+
+/*
+ * return the (master) connection entry to a given destination address
  */
 dbBE_Redis_connection_t* dbBE_Redis_connection_mgr_get_connection_to( dbBE_Redis_connection_mgr_t *conn_mgr,
                                                                       const char *dest );
@@ -141,7 +304,7 @@ dbBE_Redis_connection_t* dbBE_Redis_connection_mgr_get_active( dbBE_Redis_connec
 
 
 /*
- * return a list of empty requests, one for each (connected/authorized) connection
+ * return a list of empty requests, one for each (connected/authorized) master connection
  */
 dbBE_Redis_request_t* dbBE_Redis_connection_mgr_request_each( dbBE_Redis_connection_mgr_t *conn_mgr,
                                                               dbBE_Redis_request_t *template_request );
@@ -24,6 +24,9 @@
 #include <string.h>
 #include <stdio.h>
 #include <errno.h>
+#include <pthread.h>
+#include <poll.h>
+#include <sys/time.h>
 
 #include <sys/types.h>
 #include <sys/stat.h>
@@ -78,6 +81,8 @@ dbBE_Redis_connection_t *dbBE_Redis_connection_create( const uint64_t sr_buffer_
 
   conn->_recvbuf = recvb;
   conn->_index = DBBE_REDIS_LOCATOR_INDEX_INVAL;
+  conn->_primary = DBBE_REDIS_LOCATOR_INDEX_INVAL;
+  conn->_protocol = 2;
   conn->_socket = -1;
   conn->_status = DBBE_CONNECTION_STATUS_INITIALIZED;
   if(( send_tr == NULL ) || ( recvb == NULL ))
@@ -251,6 +256,7 @@ dbBE_Network_address_t* dbBE_Redis_connection_link( dbBE_Redis_connection_t *con
   {
     dbBE_Redis_connection_unlink( conn );
     dbBE_Network_address_destroy( conn->_address );
+    conn->_address = NULL;
     return NULL;
   }
 
@@ -274,6 +280,90 @@ dbBE_Network_address_t* dbBE_Redis_connection_link( dbBE_Redis_connection_t *con
   return conn->_address;
 }
 
+int dbBE_Redis_connection_link_start( dbBE_Redis_connection_t *conn,
+                                      const char *url )
+{
+  if(( conn == NULL ) || ( url == NULL ) ||
+      (( conn->_status != DBBE_CONNECTION_STATUS_INITIALIZED ) &&
+       ( conn->_status != DBBE_CONNECTION_STATUS_DISCONNECTED )) )
+    return -EINVAL;
+
+  struct addrinfo *addrs = dbBE_Common_resolve_address( url, 0 );
+  if( addrs == NULL )
+  {
+    LOG( DBG_ERR, stderr, "connection_link_start: unable to resolve: %s\n", url );
+    return -ENOTCONN;
+  }
+
+  int rc = -ENOTCONN;
+  struct addrinfo *iface;
+  for( iface = addrs; iface != NULL; iface = iface->ai_next )
+  {
+    int s = socket( iface->ai_family, iface->ai_socktype, iface->ai_protocol );
+    if( s < 0 )
+    {
+      rc = -errno;
+      if(( errno == ENFILE ) || ( errno == EMFILE ) || ( errno == ENOBUFS ) || ( errno == ENOMEM ))
+        break;
+      continue;
+    }
+
+    int flags = fcntl( s, F_GETFL, 0 );
+    if(( flags < 0 ) || ( fcntl( s, F_SETFL, flags | O_NONBLOCK ) != 0 ))
+    {
+      rc = -errno;
+      close( s );
+      continue;
+    }
+
+    rc = connect( s, iface->ai_addr, iface->ai_addrlen );
+    if(( rc == 0 ) || ( errno == EINPROGRESS ))
+    {
+      rc = ( rc == 0 ) ? 0 : -EINPROGRESS;
+      conn->_socket = s;
+      conn->_address = dbBE_Network_address_copy( iface->ai_addr, iface->ai_addrlen );
+      break;
+    }
+
+    rc = -errno;
+    close( s );
+  }
+
+  dbBE_Common_release_addrinfo( &addrs );
+  return rc;
+}
+
+int dbBE_Redis_connection_link_finish( dbBE_Redis_connection_t *conn )
+{
+  if(( conn == NULL ) || ( conn->_socket < 0 ))
+    return -EINVAL;
+
+  int err = 0;
+  socklen_t len = sizeof( err );
+  if( getsockopt( conn->_socket, SOL_SOCKET, SO_ERROR, &err, &len ) != 0 )
+    err = errno;
+
+  // the rest of the backend expects blocking sockets
+  int flags = fcntl( conn->_socket, F_GETFL, 0 );
+  if(( err == 0 ) && (( flags < 0 ) || ( fcntl( conn->_socket, F_SETFL, flags & ~O_NONBLOCK ) != 0 )))
+    err = errno;
+
+  if( err != 0 )
+  {
+    LOG( DBG_VERBOSE, stderr, "connection_link_finish: connect failed: %s\n", strerror( err ) );
+    close( conn->_socket );
+    conn->_socket = -1;
+    dbBE_Network_address_destroy( conn->_address );
+    conn->_address = NULL;
+    conn->_status = DBBE_CONNECTION_STATUS_DISCONNECTED;
+    return -err;
+  }
+
+  conn->_status = DBBE_CONNECTION_STATUS_CONNECTED;
+  dbBE_Network_address_to_string( conn->_address, conn->_url, DBR_SERVER_URL_MAX_LENGTH );
+  return 0;
+}
+
 dbBE_Redis_connection_recoverable_t dbBE_Redis_connection_recoverable( dbBE_Redis_connection_t *conn )
 {
   // grab the timestamp or reconnection counter and decide based on that whether it's considered recoverable or not
@@ -612,121 +702,232 @@ int dbBE_Redis_connection_unlink( dbBE_Redis_connection_t *conn )
   return 0;
 }
 
-int dbBE_Redis_connection_auth( dbBE_Redis_connection_t *conn, const char *authfile_name )
+/*
+ * the AUTH command is built once per process from the auth file and then reused for every connection
+ * (wiped at exit by dbBE_Redis_connection_auth_cmd_release)
+ */
+static pthread_mutex_t dbBE_Redis_auth_lock = PTHREAD_MUTEX_INITIALIZER;
+static char *dbBE_Redis_auth_file = NULL;
+static char *dbBE_Redis_auth_cmd = NULL;
+static ssize_t dbBE_Redis_auth_cmd_len = 0;
+
+static
+ssize_t dbBE_Redis_connection_auth_cmd_build( const char *authfile_name, char **cmd )
 {
-  int rc = 0;
-  int auth_error = 0;
   struct stat auth_file_stat;
 
-  // skip authentication if authfile name is explicitly set to NONE
-  if( strncmp( authfile_name, "NONE", 5 ) == 0 )
-  {
-    conn->_status = DBBE_CONNECTION_STATUS_AUTHORIZED;
-    return 0;
-  }
-
-  const size_t AUTHBUF_SIZE = 16384;
-  dbBE_Redis_sr_buffer_t *sbuf = dbBE_Transport_sr_buffer_allocate( AUTHBUF_SIZE );
-
   // open the file
   int auth_fd = open( authfile_name, O_RDONLY );
   if( auth_fd < 0 )
   {
     perror( authfile_name );
-    dbBE_Transport_sr_buffer_free( sbuf );
-    return -1;
+    return -errno;
   }
 
-  size_t authbuf_size = 0;
-  char *authbuf = NULL;
-
   // get the file size to determine the buffer size
-  rc = fstat( auth_fd, &auth_file_stat );
-  if( rc == 0 )
+  if( fstat( auth_fd, &auth_file_stat ) != 0 )
   {
-    // allocate and reset the buffer
-    authbuf_size = auth_file_stat.st_size + 128;
+    int err = errno;
+    close( auth_fd );
+    return -err;
+  }
+
+  size_t authbuf_size = auth_file_stat.st_size + 1;
+  char *authbuf = (char*)calloc( 1, authbuf_size );
+  if( authbuf == NULL )
+  {
+    close( auth_fd );
+    return -ENOMEM;
+  }
 
-    if( dbBE_Transport_sr_buffer_get_size( sbuf ) < authbuf_size )
+  ssize_t rc = -EINVAL;
+  ssize_t rlen = read( auth_fd, authbuf, authbuf_size - 1 );
+  close( auth_fd );
+  if( rlen <= 0 )
+    perror( "Read authfile" );
+  else
+  {
+    int plen = strcspn( authbuf, "\r\n" );  // strip the auth-string
+    if(( plen > 0 ) && ( authbuf[ plen - 1 ] == ' ' ))
     {
-      LOG( DBG_ERR, stderr, "connection_auth: send/recv buffer too small for auth operation.\n" );
-      close( auth_fd );
-      dbBE_Transport_sr_buffer_free( sbuf );
-      return -1;
+      LOG( DBG_WARN, stderr, "Warning, password in file ends with white space. Double check if you have authentication problems.\n" );
     }
+    if( plen > 0 )
+    {
+      authbuf[ plen ] = '\0';
+      size_t cmd_size = plen + 64;
+      *cmd = (char*)malloc( cmd_size );
+      if( *cmd == NULL )
+        rc = -ENOMEM;
+      else
+        rc = snprintf( *cmd, cmd_size, "*2\r\n$4\r\nAUTH\r\n$%d\r\n%s\r\n", plen, authbuf );
+    }
+  }
 
-    authbuf = (char*)malloc( authbuf_size );
-    memset( authbuf, 0, authbuf_size );
+  memset( authbuf, 0, authbuf_size );
+  free( authbuf );
+  return rc;
+}
 
-    // read the file data
-    ssize_t rlen = read( auth_fd, authbuf, authbuf_size );
-    if( rlen <= 0 )
-      perror( "Read authfile" );  // no exit needed because rc is 0
-    else
+static
+void dbBE_Redis_connection_auth_cmd_wipe()
+{
+  if( dbBE_Redis_auth_cmd != NULL )
+  {
+    memset( dbBE_Redis_auth_cmd, 0, dbBE_Redis_auth_cmd_len );
+    free( dbBE_Redis_auth_cmd );
+  }
+  if( dbBE_Redis_auth_file != NULL )
+    free( dbBE_Redis_auth_file );
+  dbBE_Redis_auth_cmd = NULL;
+  dbBE_Redis_auth_file = NULL;
+  dbBE_Redis_auth_cmd_len = 0;
+}
+
+void dbBE_Redis_connection_auth_cmd_release()
+{
+  pthread_mutex_lock( &dbBE_Redis_auth_lock );
+  dbBE_Redis_connection_auth_cmd_wipe();
+  pthread_mutex_unlock( &dbBE_Redis_auth_lock );
+}
+
+ssize_t dbBE_Redis_connection_auth_cmd( const char *authfile_name, char **cmd )
+{
+  if(( authfile_name == NULL ) || ( cmd == NULL ))
+    return -EINVAL;
+
+  *cmd = NULL;
+
+  // skip authentication if authfile name is explicitly set to NONE
+  if( strncmp( authfile_name, "NONE", 5 ) == 0 )
+    return 0;
+
+  ssize_t rc = 0;
+  pthread_mutex_lock( &dbBE_Redis_auth_lock );
+  if(( dbBE_Redis_auth_file == NULL ) || ( strcmp( dbBE_Redis_auth_file, authfile_name ) != 0 ))
+  {
+    char *new_cmd = NULL;
+    rc = dbBE_Redis_connection_auth_cmd_build( authfile_name, &new_cmd );
+    if( rc > 0 )
     {
-      rc = strcspn( authbuf, "\r\n" );  // strip the auth-string and update rc to enter the processing
-      if( authbuf[ rc - 1 ] == ' ' )
-      {
-        LOG( DBG_WARN, stderr, "Warning, password in file ends with white space. Double check if you have authentication problems.\n" );
-      }
+      dbBE_Redis_connection_auth_cmd_wipe();
+      dbBE_Redis_auth_file = strdup( authfile_name );
+      dbBE_Redis_auth_cmd = new_cmd;  // nul-terminated by snprintf
+      dbBE_Redis_auth_cmd_len = rc;
     }
-    if( rc > 0 )
+  }
+  if( rc >= 0 )
+  {
+    // hand out a copy, the cache may be released by another thread
+    rc = -ENOMEM;
+    *cmd = (char*)malloc( dbBE_Redis_auth_cmd_len + 1 );
+    if( *cmd != NULL )
     {
-      authbuf[ rc ] = '\0'; // terminate the authbuf and remove and newlines
-      int len = snprintf( dbBE_Transport_sr_buffer_get_start( sbuf ),
-                          dbBE_Transport_sr_buffer_remaining( sbuf ),
-                          "*2\r\n$4\r\nAUTH\r\n$%d\r\n%s\r\n", rc, authbuf );
-      if( len > 0 )
-      {
-        dbBE_Transport_sr_buffer_add_data( sbuf, len, 1 );
-
-        conn->_status = DBBE_CONNECTION_STATUS_AUTHORIZED; // assume authorized for a brief moment to allow using the send/recv functions
-        rc = dbBE_Redis_connection_send( conn, sbuf );
-        if( rc > 0 )
-        {
-          memset( authbuf, 0, authbuf_size );
-          rc = 0;
-          while( rc == 0 )
-          {
-            rc = recv( conn->_socket, authbuf, authbuf_size, 0 );
-            if(( rc == -1 ) && ( errno == EAGAIN ))
-              rc = 0;
-          }
-          if( rc > 0 )
-          {
-            if( strncmp( authbuf, "+OK\r\n", 5 ) != 0 )
-            {
-              LOG( DBG_ERR, stderr, "Redis Authentication error: %s\n", &authbuf[1] );
-              conn->_status = DBBE_CONNECTION_STATUS_CONNECTED;
-              auth_error = EPERM;
-            }
-          }
-          else
-            auth_error = errno;
-        }
-        else
-          auth_error = errno;
-      }
-      else
-        auth_error = errno;
+      memcpy( *cmd, dbBE_Redis_auth_cmd, dbBE_Redis_auth_cmd_len + 1 );
+      rc = dbBE_Redis_auth_cmd_len;
     }
-    else
-      auth_error = errno;
   }
-  else
-    auth_error = errno;
+  pthread_mutex_unlock( &dbBE_Redis_auth_lock );
+  return rc;
+}
 
-  close( auth_fd );
-  if( authbuf != NULL )
+
+/*
+ * wait for the socket to become ready within the remaining link-up time budget
+ * returns 0 if ready, ETIMEDOUT or errno otherwise
+ */
+static
+int dbBE_Redis_connection_auth_wait( dbBE_Redis_connection_t *conn,
+                                     const short events,
+                                     const struct timeval *start )
+{
+  struct timeval now;
+  gettimeofday( &now, NULL );
+  int64_t remaining = DBBE_REDIS_LINKUP_TIMEOUT
+      - ( now.tv_sec - start->tv_sec ) * 1000 - ( now.tv_usec - start->tv_usec ) / 1000;
+  if( remaining <= 0 )
+    return ETIMEDOUT;
+
+  struct pollfd pfd = { .fd = conn->_socket, .events = events, .revents = 0 };
+  int rc = poll( &pfd, 1, remaining );
+  if( rc > 0 )
+    return 0;
+  if(( rc < 0 ) && ( errno == EINTR ))
+    return 0;
+  return ( rc == 0 ) ? ETIMEDOUT : errno;
+}
+
+int dbBE_Redis_connection_auth( dbBE_Redis_connection_t *conn, const char *authfile_name )
+{
+  char *cmd = NULL;
+  ssize_t len = dbBE_Redis_connection_auth_cmd( authfile_name, &cmd );
+  if( len < 0 )
+    return -1;
+
+  if( len == 0 )
   {
-    memset( authbuf, 0, authbuf_size );
-    free( authbuf );
+    conn->_status = DBBE_CONNECTION_STATUS_AUTHORIZED;
+    return 0;
   }
 
-  dbBE_Transport_sr_buffer_free( sbuf );
+  struct timeval start;
+  gettimeofday( &start, NULL );
+  ssize_t sent = 0;
+  int auth_error = 0;
+  while(( sent < len ) && ( auth_error == 0 ))
+  {
+    ssize_t rc = send( conn->_socket, cmd + sent, len - sent, 0 );
+    if(( rc < 0 ) && ( errno == EINTR ))
+      continue;
+    if(( rc < 0 ) && ( errno == EAGAIN ))
+      auth_error = dbBE_Redis_connection_auth_wait( conn, POLLOUT, &start );
+    else if( rc < 0 )
+      auth_error = errno;
+    else
+      sent += rc;
+  }
+  memset( cmd, 0, len );
+  free( cmd );
   if( auth_error != 0 )
+  {
     LOG( DBG_INFO, stderr, "completing authentication rc=%d\n", auth_error );
-  return auth_error;
+    return auth_error;
+  }
+
+  // the reply is a single line; either +OK or an error
+  char reply[ 256 ];
+  size_t rlen = 0;
+  memset( reply, 0, sizeof( reply ) );
+  while(( rlen < sizeof( reply ) - 1 ) && ( strstr( reply, "\r\n" ) == NULL ))
+  {
+    ssize_t rc = recv( conn->_socket, reply + rlen, sizeof( reply ) - 1 - rlen, 0 );
+    if(( rc < 0 ) && ( errno == EINTR ))
+      continue;
+    if(( rc < 0 ) && ( errno == EAGAIN ))
+    {
+      auth_error = dbBE_Redis_connection_auth_wait( conn, POLLIN, &start );
+      if( auth_error == 0 )
+        continue;
+    }
+    if( rc <= 0 )
+    {
+      if( auth_error == 0 )
+        auth_error = ( rc == 0 ) ? ENOTCONN : errno;
+      LOG( DBG_INFO, stderr, "completing authentication rc=%d\n", auth_error );
+      return auth_error;
+    }
+    rlen += rc;
+  }
+
+  if( strncmp( reply, "+OK\r\n", 5 ) != 0 )
+  {
+    LOG( DBG_ERR, stderr, "Redis Authentication error: %s\n", &reply[1] );
+    conn->_status = DBBE_CONNECTION_STATUS_CONNECTED;
+    return EPERM;
+  }
+
+  conn->_status = DBBE_CONNECTION_STATUS_AUTHORIZED;
+  return 0;
 }
 
 /*
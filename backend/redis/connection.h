@@ -61,6 +61,9 @@ typedef struct dbBE_Redis_connection
   volatile dbBE_Connection_status_t _status;
   struct timeval _last_alive;
   dbBE_Transport_sge_buffer_t *_cmd;
+  int _primary; // index of the master connection if this is a secondary (READONLY replica or pooled) connection
+  int _pooled; // secondary connection to the master node itself; serves writes as well
+  int _protocol; // RESP version of the connection (3 after a successful HELLO 3)
   char _url[ DBR_SERVER_URL_MAX_LENGTH ];
 } dbBE_Redis_connection_t;
 
@@ -83,6 +86,23 @@ dbBE_Redis_connection_t *dbBE_Redis_connection_create( const uint64_t sr_buffer_
  */
 #define dbBE_Redis_connection_get_index( conn ) ( ( (conn) != NULL ) ? (conn)->_index : -1 )
 
+/*
+ * check whether the connection serves the slots of another (master) connection
+ * (i.e. it's a READONLY replica connection or an additional pooled connection to the master)
+ */
+#define dbBE_Redis_connection_is_secondary( conn ) ( ( (conn) != NULL ) && ( (conn)->_primary != DBBE_REDIS_LOCATOR_INDEX_INVAL ) )
+
+/*
+ * check whether the connection is a READONLY connection to a replica
+ * (i.e. only usable for reads of the slots of its master connection)
+ */
+#define dbBE_Redis_connection_is_reader( conn ) ( dbBE_Redis_connection_is_secondary( conn ) && ( (conn)->_pooled == 0 ) )
+
+/*
+ * check whether the connection is an additional connection to the node of its master connection
+ */
+#define dbBE_Redis_connection_is_pooled( conn ) ( dbBE_Redis_connection_is_secondary( conn ) && ( (conn)->_pooled != 0 ) )
+
 /*
  * return the slot-range bitmap ptr
  */
@@ -143,6 +163,20 @@ dbBE_Network_address_t* dbBE_Redis_connection_link( dbBE_Redis_connection_t *con
                                                   const char *url,
                                                   const char *authfile );
 
+/*
+ * start a non-blocking connect to the destination url
+ * returns 0 if connected immediately, -EINPROGRESS if the socket becomes writable on completion, <0 on error
+ */
+int dbBE_Redis_connection_link_start( dbBE_Redis_connection_t *conn,
+                                      const char *url );
+
+/*
+ * complete a connect started by dbBE_Redis_connection_link_start()
+ * switches the socket back to blocking mode and sets the connection to CONNECTED
+ * on failure, the socket is closed and the connection is DISCONNECTED
+ */
+int dbBE_Redis_connection_link_finish( dbBE_Redis_connection_t *conn );
+
 /*
  * return 0 if the connection is considered not recoverable
  * return 1 otherwise
@@ -207,6 +241,18 @@ int dbBE_Redis_connection_unlink( dbBE_Redis_connection_t *conn );
  */
 int dbBE_Redis_connection_auth( dbBE_Redis_connection_t *conn, const char *authfile );
 
+/*
+ * return a copy of the AUTH command for the secret in authfile in *cmd and its length
+ * the caller wipes and frees the copy
+ * the file is read only once per process; returns 0 (and *cmd=NULL) if authfile is NONE
+ */
+ssize_t dbBE_Redis_connection_auth_cmd( const char *authfile, char **cmd );
+
+/*
+ * wipe the cached AUTH command
+ */
+void dbBE_Redis_connection_auth_cmd_release();
+
 /*
  * destroy a Redis connection object and free the
  * does not destroy the sr_buffers
@@ -145,59 +145,73 @@ int Redis_insert_to_sr_buffer( dbBE_Redis_sr_buffer_t *sr_buf, dbBE_REDIS_DATA_T
   return data_len;
 }
 
+/*
+ * copy the cached namespace prefix and the tuple name into keybuf
+ */
+static inline
+int dbBE_Redis_create_ns_key( dbBE_Redis_namespace_t *ns, const char *key, char *keybuf, uint16_t size )
+{
+  size_t prefix_len = dbBE_Redis_namespace_get_prefix_len( ns );
+  size_t keylen = strnlen( key, size );
+  if( prefix_len + keylen >= size )
+    return -EMSGSIZE;
+
+  memcpy( keybuf, dbBE_Redis_namespace_get_prefix( ns ), prefix_len );
+  memcpy( &keybuf[ prefix_len ], key, keylen );
+  keybuf[ prefix_len + keylen ] = '\0';
+  return (int)( prefix_len + keylen );
+}
+
+/*
+ * create the key of the refcnt shard of this process for the namespace name
+ */
+static inline
+int dbBE_Redis_create_refshard_key( const char *name, char *keybuf, uint16_t size )
+{
+  char tag[ 16 ];
+  int taglen = dbBE_Redis_namespace_refcnt_tag( tag, sizeof( tag ), dbBE_Redis_namespace_refcnt_shard() );
+  if( taglen < 0 )
+    return taglen;
+
+  int len = snprintf( keybuf, size, "%s%s", name, tag );
+  if(( len < 0 ) || ( len >= size ))
+    return -EMSGSIZE;
+  return len;
+}
+
 /*
  * create the key, based on the command type
  */
 int dbBE_Redis_create_key( dbBE_Redis_request_t *request, char *keybuf, uint16_t size )
 {
-  if( keybuf == NULL )
+  if(( keybuf == NULL ) || ( size == 0 ))
     return -EINVAL;
 
   int len = 0;
   dbBE_Redis_namespace_t *ns = (dbBE_Redis_namespace_t*)request->_user->_ns_hdl;
-  memset( keybuf, 0, size );
+  keybuf[ 0 ] = '\0';
   switch( request->_user->_opcode )
   {
     case DBBE_OPCODE_PUT:
     case DBBE_OPCODE_GET:
     case DBBE_OPCODE_READ:
     case DBBE_OPCODE_REMOVE:
-    {
-      len = snprintf( keybuf, size, "%s%s%s",
-                          dbBE_Redis_namespace_get_name( ns ),
-                          DBBE_REDIS_NAMESPACE_SEPARATOR,
-                          request->_user->_key );
-      if(( len < 0 ) || ( len >= size ))
-        return -EMSGSIZE;
+      len = dbBE_Redis_create_ns_key( ns, request->_user->_key, keybuf, size );
       break;
-    }
 
     case DBBE_OPCODE_MOVE:
     {
-      len = 0;
-      switch( request->_step->_stage )
-      {
-        case DBBE_REDIS_MOVE_STAGE_RESTORE: // restore stage uses the new namespace for the key
-          ns = (dbBE_Redis_namespace_t*)request->_user->_sge[0].iov_base;  // destination namespace is in the first SGE arg
-          len = snprintf( keybuf, size, "%s%s%s",
-                          dbBE_Redis_namespace_get_name( ns ),
-                          DBBE_REDIS_NAMESPACE_SEPARATOR,
-                          request->_user->_key );
-          break;
-        default:
-          len = snprintf( keybuf, size, "%s%s%s",
-                          dbBE_Redis_namespace_get_name( ns ),
-                          DBBE_REDIS_NAMESPACE_SEPARATOR,
-                          request->_user->_key );
-          break;
-      }
-      if(( len < 0 ) || ( len >= size ))
-        return -EMSGSIZE;
+      // restore stage uses the new namespace for the key
+      if( request->_step->_stage == DBBE_REDIS_MOVE_STAGE_RESTORE )
+        ns = (dbBE_Redis_namespace_t*)request->_user->_sge[0].iov_base;  // destination namespace is in the first SGE arg
+      len = dbBE_Redis_create_ns_key( ns, request->_user->_key, keybuf, size );
       break;
     }
     case DBBE_OPCODE_NSCREATE:
     case DBBE_OPCODE_NSATTACH:
     {
+      if( dbBE_Redis_request_refshard_stage( request ) )
+        return dbBE_Redis_create_refshard_key( request->_user->_key, keybuf, size );
       len = snprintf( keybuf, size, "%s", request->_user->_key );
       if(( len < 0 ) || ( len >= size ))
         return -EMSGSIZE;
@@ -206,7 +220,18 @@ int dbBE_Redis_create_key( dbBE_Redis_request_t *request, char *keybuf, uint16_t
     case DBBE_OPCODE_NSDETACH:
     case DBBE_OPCODE_NSDELETE:
     {
-      len = snprintf( keybuf, size, "%s", dbBE_Redis_namespace_get_name( ns ) );
+      if( dbBE_Redis_request_refshard_stage( request ) )
+        return dbBE_Redis_create_refshard_key( dbBE_Redis_namespace_get_name( ns ), keybuf, size );
+
+      // keys to delete are complete already (including the prefix)
+      char *name = dbBE_Redis_namespace_get_name( ns );
+      if(( request->_user->_opcode == DBBE_OPCODE_NSDETACH ) &&
+          ( request->_step->_stage == DBBE_REDIS_NSDETACH_STAGE_DELKEYS ))
+        name = request->_status.nsdetach.scankey;
+      if( name == NULL )
+        return -EINVAL;
+
+      len = snprintf( keybuf, size, "%s", name );
       if(( len < 0 ) || ( len >= size ))
         return -EMSGSIZE;
       break;
@@ -349,14 +374,18 @@ int dbBE_Redis_create_command_sge( dbBE_Redis_request_t *request,
     case DBBE_OPCODE_NSCREATE:
       switch( stage->_stage )
       {
-        case 0: // HSETNX ns_name id ns_name
+        case DBBE_REDIS_NSCREATE_STAGE_ID: // HSETNX ns_name id ns_name
           rc = dbBE_Redis_command_hsetnx_create( request, buf, cmd, "id", request->_user->_key );
           break;
 
-        case 1: // HMSET ns_name refcnt 1 groups permissions
+        case DBBE_REDIS_NSCREATE_STAGE_META: // HMSET ns_name refcnt 1 groups permissions
           rc = dbBE_Redis_command_hmset_create( request, buf, cmd );
           break;
 
+        case DBBE_REDIS_NSCREATE_STAGE_REFSHARD: // INCR ns_name#refcnt:<shard>
+          rc = dbBE_Redis_command_refshard_create( request, buf, cmd );
+          break;
+
         default:
           return -EINVAL;
       }
@@ -366,15 +395,19 @@ int dbBE_Redis_create_command_sge( dbBE_Redis_request_t *request,
       rc = dbBE_Redis_command_hmgetall_create( request, buf, cmd );
       break;
 
-    case DBBE_OPCODE_NSATTACH: // EXISTS ns_name; HINCRBY ns_name refcnt 1
+    case DBBE_OPCODE_NSATTACH: // EXISTS ns_name; INCR ns_name#refcnt:<shard>; HINCRBY ns_name refcnt 1
     {
       switch( stage->_stage )
       {
-        case 0:
+        case DBBE_REDIS_NSATTACH_STAGE_EXIST:
           rc = dbBE_Redis_command_hmget_create( request, buf, cmd );
           break;
 
-        case 1:
+        case DBBE_REDIS_NSATTACH_STAGE_REFSHARD:
+          rc = dbBE_Redis_command_refshard_create( request, buf, cmd );
+          break;
+
+        case DBBE_REDIS_NSATTACH_STAGE_REFCNT:
           rc = dbBE_Redis_command_hincrby_create( request, buf, cmd, 1 );
           break;
 
@@ -384,10 +417,14 @@ int dbBE_Redis_create_command_sge( dbBE_Redis_request_t *request,
       break;
     }
 
-    case DBBE_OPCODE_NSDETACH: // EXISTS ns_name; HINCRBY ns_name refcnt -1
+    case DBBE_OPCODE_NSDETACH: // DECR ns_name#refcnt:<shard>; HINCRBY ns_name refcnt -1 ...
     {
       switch( stage->_stage )
       {
+        case DBBE_REDIS_NSDETACH_STAGE_REFSHARD:
+          rc = dbBE_Redis_command_refshard_create( request, buf, cmd );
+          break;
+
         case DBBE_REDIS_NSDETACH_STAGE_DELCHECK:
           rc = dbBE_Redis_command_delcheck_create( request, buf, cmd, -1 );
           break;
@@ -430,6 +467,10 @@ int dbBE_Redis_create_command_sge( dbBE_Redis_request_t *request,
           rc = dbBE_Redis_command_hmget_create( request, buf, cmd );
           break;
 
+        case DBBE_REDIS_NSDELETE_STAGE_REFSHARD: // GET ns_name#refcnt:<shard>
+          rc = dbBE_Redis_command_refshard_create( request, buf, cmd );
+          break;
+
         case DBBE_REDIS_NSDELETE_STAGE_SETFLAG: // HSET flags 1
           rc = dbBE_Redis_command_hset_create( request, buf, cmd, "flags", "1" );
           break;
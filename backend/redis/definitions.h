@@ -43,6 +43,41 @@
 #define DBR_SERVER_DEFAULT_HOST "sock://localhost:6379"
 #define DBR_SERVER_DEFAULT_AUTHFILE ".redis.auth"
 
+/*
+ * protocol version to negotiate with HELLO on new connections ("2" or "3")
+ * servers without HELLO keep talking RESP2; the parser understands both
+ */
+#define DBR_SERVER_PROTOCOL_ENV "DBR_RESP_PROTOCOL"
+#define DBR_SERVER_DEFAULT_PROTOCOL "2"
+
+/*
+ * opt-in read scaling: send non-destructive reads (READ, DIRECTORY, ITERATOR)
+ * to READONLY connections of the replicas as well ("1" to enable)
+ * namespaces listed in DBR_READ_YOUR_WRITES (comma separated, "*" for all)
+ * keep reading from the masters to always see their own writes
+ */
+#define DBR_SERVER_READ_REPLICAS_ENV "DBR_READ_REPLICAS"
+#define DBR_SERVER_DEFAULT_READ_REPLICAS "0"
+#define DBR_SERVER_READ_YOUR_WRITES_ENV "DBR_READ_YOUR_WRITES"
+#define DBBE_REDIS_READ_YOUR_WRITES_MAX ( 1024 )
+
+/*
+ * number of connections per Redis node ("1" for a single connection)
+ * requests get striped across them by hash slot: requests for the same key keep their order
+ * while a large value only holds up the requests that share its connection
+ */
+#define DBR_SERVER_CONNECTIONS_ENV "DBR_CONNECTIONS_PER_NODE"
+#define DBR_SERVER_DEFAULT_CONNECTIONS "1"
+#define DBBE_REDIS_POOL_MAX ( 8 )
+
+/*
+ * upper bound (in msec) of a random delay before the first connect to spread
+ * the connection setup of many simultaneously starting clients ("0" to disable)
+ */
+#define DBR_SERVER_STARTUP_JITTER_ENV "DBR_STARTUP_JITTER"
+#define DBR_SERVER_DEFAULT_STARTUP_JITTER "0"
+#define DBBE_REDIS_STARTUP_JITTER_MAX ( 10000 )
+
 #define DBR_SERVER_URL_MAX_LENGTH ( 1024 )
 /*
  * max number of Redis connections that can be handled simultaneously by the library
@@ -74,6 +109,12 @@ typedef enum
   dbBE_REDIS_TYPE_ARRAY, ///< an array of results is parsed off the string
   dbBE_REDIS_TYPE_REDIRECT, ///< Redis returned ASK to temporarily redirect a request
   dbBE_REDIS_TYPE_RELOCATE, ///< Redis returned MOVED to permanently redirect a request
+  dbBE_REDIS_TYPE_MAP, ///< RESP3 map; the array holds alternating keys and values
+  dbBE_REDIS_TYPE_SET, ///< RESP3 set; same layout as an array
+  dbBE_REDIS_TYPE_PUSH, ///< RESP3 out-of-band push frame; same layout as an array
+  dbBE_REDIS_TYPE_DOUBLE, ///< RESP3 double
+  dbBE_REDIS_TYPE_BOOL, ///< RESP3 boolean (as integer 0 or 1)
+  dbBE_REDIS_TYPE_BIGNUM, ///< RESP3 big number (as decimal string)
   dbBE_REDIS_TYPE_INVALID, ///< the returned value is invalid due to parser errors
   dbBE_REDIS_TYPE_MAX ///< limiter for sanity checks
 } dbBE_REDIS_DATA_TYPE;
@@ -110,6 +151,7 @@ typedef struct {
  */
 typedef union {
   int64_t _integer;
+  double _double;
   dbBE_Redis_string_t _string;
   dbBE_Redis_string_part_t _pstring;
   dbBE_Redis_array_t _array;
@@ -121,6 +163,14 @@ typedef struct dbBE_Redis_result {
   dbBE_Redis_data_t _data;
 } dbBE_Redis_result_t;
 
+/*
+ * arrays, and RESP3 maps and sets which share the array layout
+ */
+#define dbBE_Redis_result_is_array( result ) \
+  ( ( (result)->_type == dbBE_REDIS_TYPE_ARRAY ) || \
+    ( (result)->_type == dbBE_REDIS_TYPE_MAP ) || \
+    ( (result)->_type == dbBE_REDIS_TYPE_SET ) )
+
 /*
  * represent an invalid number
  */
@@ -132,6 +182,33 @@ typedef struct dbBE_Redis_result {
 #define DBBE_REDIS_NAMESPACE_SEPARATOR "::"
 #define DBBE_REDIS_NAMESPACE_SEPARATOR_LEN ( 2 )
 
+/*
+ * attach references of a namespace are counted in a set of shard counters "<name>#refcnt:<n>"
+ * that spread across the cluster instead of a single hot field of the namespace hash;
+ * each process always uses the same shard and the refcnt field of the hash only counts the open shards
+ */
+#define DBBE_REDIS_NAMESPACE_REFCNT_SHARDS ( 16 )
+#define DBBE_REDIS_NAMESPACE_REFCNT_TAG "#refcnt:"
+
 #define DBBE_REDIS_RECONNECT_TIMEOUT ( 5 )
 
+/*
+ * time limit (in msec) for connect, AUTH, and probe when linking a set of nodes in parallel
+ */
+#define DBBE_REDIS_LINKUP_TIMEOUT ( 10000 )
+
+/*
+ * max number of connections that link up in the background (e.g. to an unknown ASK destination)
+ */
+#define DBBE_REDIS_BACKGROUND_LINKS_MAX ( 16 )
+
+/*
+ * backoff range (in usec) between recovery attempts for uncovered slots
+ * and between retries of requests that got a CLUSTERDOWN response
+ */
+#define DBBE_REDIS_RECOVERY_BACKOFF_MIN ( 10000 )
+#define DBBE_REDIS_RECOVERY_BACKOFF_MAX ( 500000 )
+#define DBBE_REDIS_RETRY_BACKOFF_MIN ( 1000 )
+#define DBBE_REDIS_RETRY_BACKOFF_MAX ( 1000000 )
+
 #endif /* BACKEND_REDIS_DEFINITIONS_H_ */
@@ -29,6 +29,7 @@
 #include <event2/event.h>
 
 void dbBE_Redis_event_mgr_callback( evutil_socket_t socket, short ev_type, void *arg );
+void dbBE_Redis_event_mgr_timer_callback( evutil_socket_t socket, short ev_type, void *arg );
 
 /*
  * create and initialize the event mgr
@@ -61,6 +62,18 @@ dbBE_Redis_event_mgr_t* dbBE_Redis_event_mgr_init( unsigned default_timeout )
     return NULL;
   }
 
+  int t;
+  for( t = 0; t < DBBE_REDIS_TIMER_MAX; ++t )
+  {
+    evmgr->_timers[ t ] = evtimer_new( evmgr->_evbase, dbBE_Redis_event_mgr_timer_callback, (void*)evmgr );
+    if( evmgr->_timers[ t ] == NULL )
+    {
+      LOG( DBG_ERR, stderr, "event_mgr_init: Failed to create timer\n" );
+      dbBE_Redis_event_mgr_exit( evmgr );
+      return NULL;
+    }
+  }
+
   evmgr->_timeout.tv_sec = default_timeout;
 
   return evmgr;
@@ -78,6 +91,11 @@ int dbBE_Redis_event_mgr_exit( dbBE_Redis_event_mgr_t *ev_mgr )
     return -EINVAL;
   }
 
+  int t;
+  for( t = 0; t < DBBE_REDIS_TIMER_MAX; ++t )
+    if( ev_mgr->_timers[ t ] != NULL )
+      event_free( ev_mgr->_timers[ t ] );
+
   if( ev_mgr->_evbase != NULL )
   {
     event_base_free( ev_mgr->_evbase );
@@ -310,3 +328,109 @@ dbBE_Redis_connection_t* dbBE_Redis_event_mgr_next( dbBE_Redis_event_mgr_t *ev_m
 
   return next;
 }
+
+
+void dbBE_Redis_event_mgr_timer_callback( evutil_socket_t socket, short ev_type, void *arg )
+{
+  // nothing to do here; an expired timer is simply no longer pending
+  LOG( DBG_TRACE, stderr, "Triggered timer callback ev_type=%d, arg=%p\n", ev_type, arg );
+}
+
+
+int dbBE_Redis_event_mgr_timer_arm( dbBE_Redis_event_mgr_t *ev_mgr,
+                                    const dbBE_Redis_timer_t timer,
+                                    const unsigned usec )
+{
+  if(( ev_mgr == NULL ) || ( (unsigned)timer >= DBBE_REDIS_TIMER_MAX ))
+  {
+    LOG( DBG_ERR, stderr, "event_mgr_timer_arm: Invalid argument: ev_mgr=%p, timer=%d\n", ev_mgr, timer );
+    return -EINVAL;
+  }
+
+  struct timeval delay;
+  delay.tv_sec = usec / 1000000;
+  delay.tv_usec = usec % 1000000;
+  if( evtimer_add( ev_mgr->_timers[ timer ], &delay ) != 0 )
+  {
+    LOG( DBG_ERR, stderr, "event_mgr_timer_arm: failed to arm timer %d.\n", timer );
+    return -EFAULT;
+  }
+  return 0;
+}
+
+
+int dbBE_Redis_event_mgr_timer_handler( dbBE_Redis_event_mgr_t *ev_mgr,
+                                        const dbBE_Redis_timer_t timer,
+                                        event_callback_fn cb,
+                                        void *arg )
+{
+  if(( ev_mgr == NULL ) || ( (unsigned)timer >= DBBE_REDIS_TIMER_MAX ))
+  {
+    LOG( DBG_ERR, stderr, "event_mgr_timer_handler: Invalid argument: ev_mgr=%p, timer=%d\n", ev_mgr, timer );
+    return -EINVAL;
+  }
+
+  if( cb == NULL )
+  {
+    cb = dbBE_Redis_event_mgr_timer_callback;
+    arg = (void*)ev_mgr;
+  }
+
+  // replacing the event also disarms the timer
+  struct event *ev = evtimer_new( ev_mgr->_evbase, cb, arg );
+  if( ev == NULL )
+  {
+    LOG( DBG_ERR, stderr, "event_mgr_timer_handler: failed to create timer %d.\n", timer );
+    return -ENOMEM;
+  }
+  event_free( ev_mgr->_timers[ timer ] );
+  ev_mgr->_timers[ timer ] = ev;
+  return 0;
+}
+
+
+int dbBE_Redis_event_mgr_timer_expired( dbBE_Redis_event_mgr_t *ev_mgr,
+                                        const dbBE_Redis_timer_t timer )
+{
+  if(( ev_mgr == NULL ) || ( (unsigned)timer >= DBBE_REDIS_TIMER_MAX ))
+    return 1;
+
+  struct timeval deadline;
+  if( evtimer_pending( ev_mgr->_timers[ timer ], &deadline ) == 0 )
+    return 1;
+
+  // the event loop only runs when the receiver runs out of active connections
+  // so don't rely on the callback alone and compare against the deadline
+  struct timeval now;
+  evutil_gettimeofday( &now, NULL );
+  if( evutil_timercmp( &now, &deadline, < ) )
+    return 0;
+
+  evtimer_del( ev_mgr->_timers[ timer ] );
+  return 1;
+}
+
+
+int dbBE_Redis_event_mgr_watch( dbBE_Redis_event_mgr_t *ev_mgr,
+                                const evutil_socket_t socket,
+                                const short what,
+                                const unsigned usec,
+                                event_callback_fn cb,
+                                void *arg )
+{
+  if(( ev_mgr == NULL ) || ( socket < 0 ) || ( cb == NULL ))
+  {
+    LOG( DBG_ERR, stderr, "event_mgr_watch: Invalid argument: ev_mgr=%p, socket=%d, cb=%p\n", ev_mgr, socket, cb );
+    return -EINVAL;
+  }
+
+  struct timeval delay;
+  delay.tv_sec = usec / 1000000;
+  delay.tv_usec = usec % 1000000;
+  if( event_base_once( ev_mgr->_evbase, socket, what, cb, arg, &delay ) != 0 )
+  {
+    LOG( DBG_ERR, stderr, "event_mgr_watch: failed to watch socket=%d.\n", socket );
+    return -EFAULT;
+  }
+  return 0;
+}
@@ -25,11 +25,22 @@
 #include "connection.h"
 #include "connection_queue.h"
 
+/*
+ * one-shot timers that pace deferred work of the progress path
+ */
+typedef enum
+{
+  DBBE_REDIS_TIMER_RECOVERY = 0,  // next attempt to recover uncovered slots
+  DBBE_REDIS_TIMER_RETRY = 1,     // next replay of requests that got CLUSTERDOWN
+  DBBE_REDIS_TIMER_MAX
+} dbBE_Redis_timer_t;
+
 typedef struct dbBE_Redis_event_mgr
 {
   struct timeval _timeout;
   struct event_base *_evbase;
   struct event *_events[ DBBE_REDIS_MAX_CONNECTIONS ];
+  struct event *_timers[ DBBE_REDIS_TIMER_MAX ];
   dbBE_Redis_connection_queue_t *_active_queue;
 } dbBE_Redis_event_mgr_t;
 
@@ -83,4 +94,39 @@ int dbBE_Redis_event_mgr_rm( dbBE_Redis_event_mgr_t *ev_mgr,
 dbBE_Redis_connection_t* dbBE_Redis_event_mgr_next( dbBE_Redis_event_mgr_t *ev_mgr );
 
 
+/*
+ * (re)arm a timer to expire after usec microseconds
+ */
+int dbBE_Redis_event_mgr_timer_arm( dbBE_Redis_event_mgr_t *ev_mgr,
+                                    const dbBE_Redis_timer_t timer,
+                                    const unsigned usec );
+
+/*
+ * run cb( -1, EV_TIMEOUT, arg ) whenever the timer expires (NULL restores a timer without callback)
+ * a timer with a callback fires from the event loop; don't poll it with dbBE_Redis_event_mgr_timer_expired()
+ */
+int dbBE_Redis_event_mgr_timer_handler( dbBE_Redis_event_mgr_t *ev_mgr,
+                                        const dbBE_Redis_timer_t timer,
+                                        event_callback_fn cb,
+                                        void *arg );
+
+/*
+ * check whether a timer has expired
+ * returns 1 if the timer expired or was never armed, 0 while it's still pending
+ */
+int dbBE_Redis_event_mgr_timer_expired( dbBE_Redis_event_mgr_t *ev_mgr,
+                                        const dbBE_Redis_timer_t timer );
+
+/*
+ * one-shot watch of a socket that isn't a tracked connection yet (e.g. a connect in progress)
+ * cb is called once the socket is ready for what (EV_READ or EV_WRITE) or with EV_TIMEOUT after usec
+ */
+int dbBE_Redis_event_mgr_watch( dbBE_Redis_event_mgr_t *ev_mgr,
+                                const evutil_socket_t socket,
+                                const short what,
+                                const unsigned usec,
+                                event_callback_fn cb,
+                                void *arg );
+
+
 #endif /* BACKEND_REDIS_EVENT_MGR_H_ */
@@ -15,6 +15,9 @@
  *
  */
 
+#include <stdio.h>
+#include <unistd.h>
+
 #include "logutil.h"
 #include "memutil.h"
 #include "namespace.h"
@@ -66,6 +69,61 @@ int dbBE_Redis_namespace_validate( const dbBE_Redis_namespace_t *ns )
   return 0;
 }
 
+int dbBE_Redis_namespace_refcnt_shard( void )
+{
+  static int shard = -1;
+  if( shard >= 0 )
+    return shard;
+
+  // FNV-1a of host name and pid: ranks on the same host get different shards as well
+  char host[ 256 ];
+  if( gethostname( host, sizeof( host ) ) != 0 )
+    host[ 0 ] = '\0';
+  host[ sizeof( host ) - 1 ] = '\0';
+
+  uint32_t hash = 2166136261u;
+  char *c;
+  for( c = host; *c != '\0'; ++c )
+    hash = ( hash ^ (uint8_t)*c ) * 16777619u;
+  uint32_t pid = (uint32_t)getpid();
+  int i;
+  for( i = 0; i < 4; ++i, pid >>= 8 )
+    hash = ( hash ^ ( pid & 0xFF )) * 16777619u;
+
+  shard = (int)( hash % DBBE_REDIS_NAMESPACE_REFCNT_SHARDS );
+  return shard;
+}
+
+int dbBE_Redis_namespace_refcnt_tag( char *buf, size_t size, int shard )
+{
+  if(( buf == NULL ) || ( shard < 0 ) || ( shard >= DBBE_REDIS_NAMESPACE_REFCNT_SHARDS ))
+    return -EINVAL;
+
+  int len = snprintf( buf, size, DBBE_REDIS_NAMESPACE_REFCNT_TAG "%d", shard );
+  if(( len < 0 ) || ( (size_t)len >= size ))
+    return -EINVAL;
+  return len;
+}
+
+int dbBE_Redis_namespace_listed( const char *list, const char *name )
+{
+  if(( list == NULL ) || ( name == NULL ))
+    return 0;
+
+  size_t len = strnlen( name, DBR_MAX_KEY_LEN + 1 );
+  while( *list != '\0' )
+  {
+    size_t tok = strcspn( list, "," );
+    if((( tok == 1 ) && ( list[0] == '*' )) ||
+        (( tok == len ) && ( strncmp( list, name, len ) == 0 )))
+      return 1;
+    list += tok;
+    if( *list == ',' )
+      ++list;
+  }
+  return 0;
+}
+
 dbBE_Redis_namespace_t* dbBE_Redis_namespace_create( const char *name )
 {
   if( name == NULL )
@@ -81,7 +139,8 @@ dbBE_Redis_namespace_t* dbBE_Redis_namespace_create( const char *name )
     return NULL;
   }
 
-  dbBE_Redis_namespace_t *ns = (dbBE_Redis_namespace_t*)calloc( 1, sizeof( dbBE_Redis_namespace_t ) + len + 4 ); // +4 for trailling \0 and checksum calc
+  // +4 for trailling \0 and checksum calc; the key prefix follows the terminated name
+  dbBE_Redis_namespace_t *ns = (dbBE_Redis_namespace_t*)calloc( 1, sizeof( dbBE_Redis_namespace_t ) + 2 * len + DBBE_REDIS_NAMESPACE_SEPARATOR_LEN + 4 );
   if( ns == NULL )
   {
     errno = ENOMEM;
@@ -92,6 +151,10 @@ dbBE_Redis_namespace_t* dbBE_Redis_namespace_create( const char *name )
   strncpy( ns->_name, name, len );
   // no explicit setting of terminating '\0' because calloc already has a trailing zero
 
+  char *prefix = dbBE_Redis_namespace_get_prefix( ns );
+  memcpy( prefix, name, len );
+  memcpy( &prefix[ len ], DBBE_REDIS_NAMESPACE_SEPARATOR, DBBE_REDIS_NAMESPACE_SEPARATOR_LEN );
+
   ns->_refcnt = 1;
   ns->_chksum = dbBE_Redis_namespace_checksum( ns );
   return ns;
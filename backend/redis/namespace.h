@@ -19,6 +19,7 @@
 #define BACKEND_REDIS_NAMESPACE_H_
 
 #include "libdatabroker.h"
+#include "definitions.h"
 
 #include <inttypes.h> // int64_t
 #include <stddef.h> // NULL
@@ -30,17 +31,31 @@
 #include <malloc.h>
 #endif
 
+/*
+ * reads of this namespace always go to the master connections (see DBR_SERVER_READ_YOUR_WRITES_ENV)
+ * set by the backend when the namespace gets created or attached
+ */
+#define DBBE_REDIS_NAMESPACE_FLAG_READ_YOUR_WRITES ( 0x1 )
+
 typedef struct dbBE_Redis_namespace
 {
   int64_t _chksum; // a simple checksum to allow some validity checks; e.g. for use-after-free cases
   uint32_t _refcnt;     // local reference counting
   uint32_t _len;        // length of the namespace string to speed up length calculation
-  char _name[0];   // space holder for the actual namespace string
+  uint32_t _flags;      // local access options
+  char _name[0];   // space holder for the actual namespace string followed by the key prefix
 } dbBE_Redis_namespace_t;
 
 
 #define dbBE_Redis_namespace_get_name( ns ) ( (ns)->_name )
 #define dbBE_Redis_namespace_get_len( ns ) ( (ns)->_len )
+
+/*
+ * the key prefix "<name>::" of tuples in this namespace is kept right behind the terminated name
+ * so key creation can copy it without formatting
+ */
+#define dbBE_Redis_namespace_get_prefix( ns ) ( &(ns)->_name[ (ns)->_len + 1 ] )
+#define dbBE_Redis_namespace_get_prefix_len( ns ) ( (ns)->_len + DBBE_REDIS_NAMESPACE_SEPARATOR_LEN )
 #define dbBE_Redis_namespace_get_refcnt( ns ) ( (ns)->_refcnt )
 
 int dbBE_Redis_namespace_validate( const dbBE_Redis_namespace_t *ns );
@@ -49,4 +64,20 @@ int dbBE_Redis_namespace_destroy( dbBE_Redis_namespace_t *ns );
 int dbBE_Redis_namespace_attach( dbBE_Redis_namespace_t *ns );
 int dbBE_Redis_namespace_detach( dbBE_Redis_namespace_t *ns );
 
+/*
+ * the refcnt shard of this process (fixed for the lifetime of the process)
+ */
+int dbBE_Redis_namespace_refcnt_shard( void );
+
+/*
+ * create the "#refcnt:<n>" suffix that turns a namespace name into the key of a refcnt shard
+ * returns the length of the suffix or -EINVAL
+ */
+int dbBE_Redis_namespace_refcnt_tag( char *buf, size_t size, int shard );
+
+/*
+ * returns 1 if name is in the comma separated list of namespaces ("*" matches all)
+ */
+int dbBE_Redis_namespace_listed( const char *list, const char *name );
+
 #endif /* BACKEND_REDIS_NAMESPACE_H_ */
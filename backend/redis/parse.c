@@ -431,9 +431,22 @@ int dbBE_Redis_parse_sr_buffer_check( dbBE_Redis_sr_buffer_t *sr_buf,
     }
 
     case '*': // parse an array by just skipping the array size and repeat the first
+    case '%': // RESP3 map: parsed like an array of alternating keys and values
+    case '~': // RESP3 set
+    case '>': // RESP3 push frame
     {
       int n;
+      dbBE_REDIS_DATA_TYPE aggregate_type = dbBE_REDIS_TYPE_ARRAY;
+      switch( type )
+      {
+        case '%': aggregate_type = dbBE_REDIS_TYPE_MAP; break;
+        case '~': aggregate_type = dbBE_REDIS_TYPE_SET; break;
+        case '>': aggregate_type = dbBE_REDIS_TYPE_PUSH; break;
+        default: break;
+      }
       int64_t tmp_len = dbBE_Redis_extract_integer( p, &parsed, available );
+      if(( type == '%' ) && ( tmp_len > 0 ))
+        tmp_len *= 2;
       result->_data._array._len = (int)tmp_len;
       if(( result->_data._array._len == -EAGAIN ) && ( parsed == 0 ))
       {
@@ -457,16 +470,138 @@ int dbBE_Redis_parse_sr_buffer_check( dbBE_Redis_sr_buffer_t *sr_buf,
         rc = dbBE_Redis_parse_sr_buffer_check( sr_buf, &result->_data._array._data[ n ], 0 );
       if(( rc == -EAGAIN ) || ( rc == -ENODATA ))
       {
-        result->_type = dbBE_REDIS_TYPE_ARRAY;
+        result->_type = aggregate_type;
         dbBE_Redis_result_cleanup( result, 0 );
         parsed = 0;
         rc = -EAGAIN;
         break;
       }
-      result->_type = dbBE_REDIS_TYPE_ARRAY;
+      result->_type = aggregate_type;
       parsed = 0;
       break;
     }
+
+    case '_': // RESP3 null: same as the RESP2 nil bulk string
+      len = dbBE_Redis_nul_terminate_string( p, &parsed, available );
+      if( len == -EAGAIN )
+      {
+        rc = -EAGAIN;
+        break;
+      }
+      result->_data._string._data = NULL;
+      result->_data._string._size = 0;
+      result->_type = dbBE_REDIS_TYPE_CHAR;
+      break;
+
+    case '#': // RESP3 boolean
+      len = dbBE_Redis_nul_terminate_string( p, &parsed, available );
+      if( len == -EAGAIN )
+      {
+        rc = -EAGAIN;
+        break;
+      }
+      if(( len != 1 ) || (( *p != 't' ) && ( *p != 'f' )))
+      {
+        rc = -EBADMSG;
+        result->_type = dbBE_REDIS_TYPE_INVALID;
+        break;
+      }
+      result->_data._integer = ( *p == 't' );
+      result->_type = dbBE_REDIS_TYPE_BOOL;
+      break;
+
+    case ',': // RESP3 double (including inf, -inf, and nan)
+    {
+      len = dbBE_Redis_nul_terminate_string( p, &parsed, available );
+      if( len == -EAGAIN )
+      {
+        rc = -EAGAIN;
+        break;
+      }
+      char *end = NULL;
+      result->_data._double = strtod( p, &end );
+      if(( len <= 0 ) || ( end != p + len ))
+      {
+        rc = -EBADMSG;
+        result->_type = dbBE_REDIS_TYPE_INVALID;
+        break;
+      }
+      result->_type = dbBE_REDIS_TYPE_DOUBLE;
+      break;
+    }
+
+    case '(': // RESP3 big number: kept as its decimal string
+      len = dbBE_Redis_nul_terminate_string( p, &parsed, available );
+      if( len == -EAGAIN )
+      {
+        rc = -EAGAIN;
+        break;
+      }
+      result->_data._string._data = p;
+      result->_data._string._size = len;
+      result->_type = dbBE_REDIS_TYPE_BIGNUM;
+      break;
+
+    case '=': // RESP3 verbatim string: a bulk string with a 3 character format prefix (e.g. "txt:")
+    case '!': // RESP3 blob error
+    {
+      char *str = p;
+      len = dbBE_Redis_extract_bulk_string( &str, &parsed, available, NULL );
+      if( len == -EAGAIN )
+      {
+        rc = -EAGAIN;
+        break;
+      }
+      if(( len < 0 ) || ( str == NULL ) || (( type == '=' ) && (( len < 4 ) || ( str[ 3 ] != ':' ))))
+      {
+        rc = -EBADMSG;
+        result->_type = dbBE_REDIS_TYPE_INVALID;
+        break;
+      }
+      if( type == '=' )
+      {
+        str += 4;
+        len -= 4;
+      }
+      result->_data._string._data = str;
+      result->_data._string._size = len;
+      result->_type = ( type == '=' ) ? dbBE_REDIS_TYPE_CHAR : dbBE_REDIS_TYPE_ERROR;
+      break;
+    }
+
+    case '|': // RESP3 attributes: auxiliary map that precedes the actual reply; skipped
+    {
+      int64_t tmp_len = dbBE_Redis_extract_integer( p, &parsed, available );
+      if(( tmp_len == -EAGAIN ) && ( parsed == 0 ))
+      {
+        rc = -EAGAIN;
+        break;
+      }
+      if(( tmp_len == DBBE_REDIS_NAN ) || ( tmp_len < 0 ))
+      {
+        rc = -EBADMSG;
+        result->_type = dbBE_REDIS_TYPE_INVALID;
+        break;
+      }
+      dbBE_Transport_sr_buffer_advance( sr_buf, parsed );
+      parsed = 0;
+
+      dbBE_Redis_result_t attribute;
+      int64_t n;
+      for( n = 0; ( n < 2 * tmp_len ) && ( rc == 0 ); ++n )
+      {
+        memset( &attribute, 0, sizeof( attribute ) );
+        rc = dbBE_Redis_parse_sr_buffer_check( sr_buf, &attribute, 0 );
+        dbBE_Redis_result_cleanup( &attribute, 0 );
+      }
+      // the actual reply follows
+      if( rc == 0 )
+        rc = dbBE_Redis_parse_sr_buffer_check( sr_buf, result, toplevel );
+      if( rc == -ENODATA )
+        rc = -EAGAIN;
+      break;
+    }
+
     default:
       // this is a parsing error
       fprintf( stderr, "DataBroker library error: Redis response parser: Protocol error. t=%c\n", type );
@@ -938,7 +1073,7 @@ int dbBE_Redis_process_directory( dbBE_Redis_request_t **in_out_request,
       {
         char* b = (char*)request->_user->_sge[0].iov_base;
         b[0] = '\0';
-        if(( result->_type != dbBE_REDIS_TYPE_ARRAY ) || ( result->_data._array._len <= 0 ))
+        if(( ! dbBE_Redis_result_is_array( result ) ) || ( result->_data._array._len <= 0 ))
         {
           rc = return_error_clean_result( -ENOENT, result );
           break;
@@ -1084,9 +1219,23 @@ int dbBE_Redis_process_directory( dbBE_Redis_request_t **in_out_request,
   return rc;
 }
 
+/*
+ * create the local namespace handle with the access options of the backend config
+ */
+static
+dbBE_Redis_namespace_t* dbBE_Redis_process_ns_new( const char *name,
+                                                   const dbBE_Redis_conn_mgr_config_t *config )
+{
+  dbBE_Redis_namespace_t *ns = dbBE_Redis_namespace_create( name );
+  if(( ns != NULL ) && ( config != NULL ) && dbBE_Redis_namespace_listed( config->_read_your_writes, name ))
+    ns->_flags |= DBBE_REDIS_NAMESPACE_FLAG_READ_YOUR_WRITES;
+  return ns;
+}
+
 int dbBE_Redis_process_nshandling( dbBE_Redis_namespace_list_t **s,
                                    dbBE_Redis_request_t *request,
                                    dbBE_Redis_result_t *result,
+                                   const dbBE_Redis_conn_mgr_config_t *config,
                                    int rc )
 {
   if(( rc != 0 ) || (( request != NULL ) && ( request->_step->_final == 0 )))
@@ -1097,7 +1246,7 @@ int dbBE_Redis_process_nshandling( dbBE_Redis_namespace_list_t **s,
   {
     case DBBE_OPCODE_NSCREATE:
     {
-      ns = dbBE_Redis_namespace_create( request->_user->_key );
+      ns = dbBE_Redis_process_ns_new( request->_user->_key, config );
       if( ns == NULL )
         rc = return_error_clean_result( -errno, result );
 
@@ -1121,7 +1270,7 @@ int dbBE_Redis_process_nshandling( dbBE_Redis_namespace_list_t **s,
       dbBE_Redis_namespace_list_t *tmp = dbBE_Redis_namespace_list_get( *s, request->_user->_key );
       if( tmp == NULL )
       {
-        ns = dbBE_Redis_namespace_create( request->_user->_key );
+        ns = dbBE_Redis_process_ns_new( request->_user->_key, config );
         tmp = dbBE_Redis_namespace_list_insert( *s, ns );
         if( tmp == NULL )
         {
@@ -1171,14 +1320,14 @@ int dbBE_Redis_process_nscreate( dbBE_Redis_request_t *request,
 
   switch( request->_step->_stage )
   {
-    case 0: // stage HSETNX
+    case DBBE_REDIS_NSCREATE_STAGE_ID: // stage HSETNX
       if( rc == 0 )
       {
         if( result->_data._integer == 0 )                 // error: already exists
           rc = return_error_clean_result( -EEXIST, result );
       }
       break;
-    case 1: // stage HMSET
+    case DBBE_REDIS_NSCREATE_STAGE_META: // stage HMSET
       if( rc == 0 )
       {
         if( strncmp( result->_data._string._data, "OK", result->_data._string._size ) != 0 )  // error: no OK returned
@@ -1191,6 +1340,19 @@ int dbBE_Redis_process_nscreate( dbBE_Redis_request_t *request,
         }
       }
       break;
+    case DBBE_REDIS_NSCREATE_STAGE_REFSHARD: // stage INCR shard; the refcnt of the hash already counts it
+      if( rc == 0 )
+      {
+        if( result->_data._integer < 1 )
+          rc = return_error_clean_result( -EOVERFLOW, result );
+        else
+        {
+          dbBE_Redis_result_cleanup( result, 0 );
+          result->_type = dbBE_REDIS_TYPE_INT;
+          result->_data._integer = 0;
+        }
+      }
+      break;
     default:
       rc = return_error_clean_result( -EPROTO, result );
       break;
@@ -1298,14 +1460,31 @@ int dbBE_Redis_process_nsattach( dbBE_Redis_request_t *request,
 
   switch( request->_step->_stage )
   {
-    case 0:
+    case DBBE_REDIS_NSATTACH_STAGE_EXIST:
       if( rc == 0 )
       {
         if( result->_data._integer == 0 ) // if the return signals: not existent, return error
           rc = return_error_clean_result( -ENOENT, result );
       }
       break;
-    case 1:
+    case DBBE_REDIS_NSATTACH_STAGE_REFSHARD:
+      if( rc == 0 )
+      {
+        int64_t shard_cnt = result->_data._integer;
+        if( shard_cnt < 1 )
+        {
+          rc = return_error_clean_result( -EOVERFLOW, result );
+          break;
+        }
+        // the shard is counted in the namespace hash already: skip to the final stage to complete
+        if( shard_cnt > 1 )
+          dbBE_Redis_request_stage_transition( request );
+        dbBE_Redis_result_cleanup( result, 0 );
+        result->_type = dbBE_REDIS_TYPE_INT;
+        result->_data._integer = 0;
+      }
+      break;
+    case DBBE_REDIS_NSATTACH_STAGE_REFCNT:
       if( rc == 0 )
       {
         if( result->_data._integer < 1 )
@@ -1386,6 +1565,29 @@ int dbBE_Redis_process_nsdetach( dbBE_Redis_request_t **in_out_request,
 
   switch( request->_step->_stage )
   {
+    case DBBE_REDIS_NSDETACH_STAGE_REFSHARD:
+      rc = dbBE_Redis_process_general( request, result );
+      if( rc != 0 )
+      {
+        rc = return_error_clean_result( rc, result );
+        break;
+      }
+      if( result->_data._integer < 0 )
+      {
+        rc = return_error_clean_result( -EOVERFLOW, result );
+        break;
+      }
+
+      // only the last reference of a shard goes on to the namespace hash to check for deletion
+      // otherwise mark this request as 'detach-only' and transition to a final stage (so it can complete)
+      request->_status.nsdetach.to_delete = ( result->_data._integer == 0 );
+      if( request->_status.nsdetach.to_delete == 0 )
+        dbBE_Redis_request_stage_transition( request );
+      dbBE_Redis_result_cleanup( result, 0 );
+      result->_type = dbBE_REDIS_TYPE_INT;
+      result->_data._integer = 0;
+      break;
+
     case DBBE_REDIS_NSDETACH_STAGE_DELCHECK:
       switch( remaining_responses )
       {
@@ -1452,6 +1654,8 @@ int dbBE_Redis_process_nsdetach( dbBE_Redis_request_t **in_out_request,
 
         request->_status.nsdetach.to_delete = 1;
         dbBE_Redis_request_t *scan_list = dbBE_Redis_connection_mgr_request_each( conn_mgr, request );
+        dbBE_Request_t *user = request->_user;
+        dbBE_Refcounter_t *reference = request->_status.nsdetach.reference;
 
         // if we created new requests, we need to destroy the old one
         if( scan_list != NULL )
@@ -1484,6 +1688,37 @@ int dbBE_Redis_process_nsdetach( dbBE_Redis_request_t **in_out_request,
           }
           dbBE_Refcounter_up( scan->_status.nsdetach.reference );
         }
+
+        // the refcnt shards are outside of the namespace prefix and need to be deleted separately
+        int shard;
+        for( shard = 0; ( shard < DBBE_REDIS_NAMESPACE_REFCNT_SHARDS ) && ( rc == 0 ); ++shard )
+        {
+          dbBE_Redis_request_t *delshard = dbBE_Redis_request_allocate( user );
+          if( delshard == NULL )
+            continue;
+          char tag[ 16 ];
+          char *name = dbBE_Redis_namespace_get_name( (dbBE_Redis_namespace_t*)user->_ns_hdl );
+          size_t keylen = strnlen( name, DBR_MAX_KEY_LEN ) + sizeof( tag );
+          delshard->_status.nsdetach.scankey = (char*)malloc( keylen );
+          if(( delshard->_status.nsdetach.scankey == NULL ) ||
+              ( dbBE_Redis_namespace_refcnt_tag( tag, sizeof( tag ), shard ) < 0 ))
+          {
+            free( delshard->_status.nsdetach.scankey );
+            dbBE_Redis_request_destroy( delshard );
+            continue;
+          }
+          snprintf( delshard->_status.nsdetach.scankey, keylen, "%s%s", name, tag );
+          delshard->_status.nsdetach.reference = reference;
+          delshard->_status.nsdetach.to_delete = 1;
+          delshard->_step = &gRedis_command_spec[ DBBE_OPCODE_NSDETACH * DBBE_REDIS_COMMAND_STAGE_MAX + DBBE_REDIS_NSDETACH_STAGE_DELKEYS ];
+          if( dbBE_Redis_s2r_queue_push( post_queue, delshard ) != 0 )
+          {
+            free( delshard->_status.nsdetach.scankey );
+            dbBE_Redis_request_destroy( delshard );
+            continue;
+          }
+          dbBE_Refcounter_up( reference );
+        }
         dbBE_Redis_result_cleanup( result, 0 );
         result->_type = dbBE_REDIS_TYPE_INT;
         result->_data._integer = 0;
@@ -1664,27 +1899,37 @@ int dbBE_Redis_process_nsdelete( dbBE_Redis_request_t *request,
         break;
       }
 
-      int refcnt = 0;
+      // keep the number of open refcnt shards until the shard of this process has been checked
+      request->_status.nsdelete.refcnt = 0;
       if( refcnt_data->_data._string._data != NULL )
-        refcnt = strtoll( refcnt_data->_data._string._data, NULL, 10 );
-
-      // todo: check flag and skip the second stage
-      // (optimization that's hard to do with early result stage)
-//      int flags = strtoll( flags_data->_data._string._data, NULL, 10 );
-//
-//      if( ( flags & DBBE_REDIS_META_DELETE_FLAG) != 0 )
-//      {
-//        dbBE_Redis_result_cleanup( result, 0 );
-//        result->_type = dbBE_REDIS_TYPE_INT;
-//        result->_data._integer = 0;
-//        break;
-//      }
+        request->_status.nsdelete.refcnt = strtoll( refcnt_data->_data._string._data, NULL, 10 );
+
       dbBE_Redis_result_cleanup( result, 0 );
       result->_type = dbBE_REDIS_TYPE_INT;
-      if( refcnt > 1 )
+      result->_data._integer = 0;
+      break;
+    }
+
+    case DBBE_REDIS_NSDELETE_STAGE_REFSHARD:
+    {
+      if( rc != 0 )
+        break;
+
+      int64_t shard_cnt = 0;
+      if( result->_data._string._data != NULL )
+        shard_cnt = strtoll( result->_data._string._data, NULL, 10 );
+
+      // busy if any other shard is open or if another attachment shares the shard of this process
+      int64_t others = request->_status.nsdelete.refcnt - 1;
+      if( shard_cnt > 1 )
+        others += shard_cnt - 1;
+
+      dbBE_Redis_result_cleanup( result, 0 );
+      result->_type = dbBE_REDIS_TYPE_INT;
+      if( others > 0 )
       {
         rc = EBUSY; // positive result because this is not an actual request error/problem
-        result->_data._integer = refcnt - 1;
+        result->_data._integer = others;
       }
       else
         result->_data._integer = 0;
@@ -1753,19 +1998,12 @@ int dbBE_Redis_process_iterator( dbBE_Redis_request_t **in_out_request,
     it->_cursor[ result->_data._array._data[0]._data._string._size ] = '\0';  // make sure the string is terminated
     if( it->_cursor[0] == '0' )
     {
-      // find the next connection
-      unsigned i;
-      dbBE_Redis_connection_t *conn = NULL;
-      for( i = it->_connection->_index + 1; (i < DBBE_REDIS_MAX_CONNECTIONS); ++i )
-      {
-        if(( conn_mgr->_connections[ i ] != NULL ) &&
-            (dbBE_Redis_connection_RTR( conn_mgr->_connections[ i ] ) ))
-        {
-          conn = conn_mgr->_connections[ i ];
-          break;
-        }
-      }
-      it->_connection = conn; // if this is MAX_CONNECTIONS then the cursor is remote-complete
+      // find the next master connection (the current one might be a replica of the previous master)
+      int current = dbBE_Redis_connection_is_secondary( it->_connection ) ? it->_connection->_primary : it->_connection->_index;
+      dbBE_Redis_connection_t *conn = dbBE_Redis_connection_mgr_next_master( conn_mgr, current );
+      if(( conn != NULL ) && ( dbBE_Redis_request_replica_readable( request ) ))
+        conn = dbBE_Redis_connection_mgr_get_reader( conn_mgr, conn );
+      it->_connection = conn; // if this is NULL then the cursor is remote-complete
 
       // append an EOF key to terminate the iteration
       if( conn == NULL )
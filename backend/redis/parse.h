@@ -123,6 +123,7 @@ int dbBE_Redis_process_directory( dbBE_Redis_request_t **in_out_request,
 int dbBE_Redis_process_nshandling( dbBE_Redis_namespace_list_t **s,
                                    dbBE_Redis_request_t *request,
                                    dbBE_Redis_result_t *result,
+                                   const dbBE_Redis_conn_mgr_config_t *config,
                                    int rc );
 
 /*
@@ -209,6 +210,12 @@ int dbBE_Redis_process_general( dbBE_Redis_request_t *request,
         // update request connection index
         // update location manager
         break;
+      case dbBE_REDIS_TYPE_MAP:
+      case dbBE_REDIS_TYPE_SET:
+        // RESP3 maps and sets are fine wherever an array is expected
+        if( spec->_expect != dbBE_REDIS_TYPE_ARRAY )
+          rc = -EBADMSG;
+        break;
       case dbBE_REDIS_TYPE_STRING_PART:
         // partial strings are ok, if the expected type is char/string too
         if(( spec->_expect == dbBE_REDIS_TYPE_CHAR ) &&
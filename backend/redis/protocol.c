@@ -22,12 +22,56 @@
 #include <malloc.h>
 #endif
 #include <string.h>
+#include <errno.h>
 
 #include "protocol.h"
 
 dbBE_Redis_command_stage_spec_t *gRedis_command_spec = NULL;
 static int gRedis_command_spec_refcnt = 0;
 
+int dbBE_Redis_command_stage_compile( dbBE_Redis_command_stage_spec_t *stage )
+{
+  if( stage == NULL )
+    return -EINVAL;
+
+  char *cmdptr = stage->_command;
+  char *cmdend = stage->_command + strnlen( stage->_command, DBBE_REDIS_COMMAND_LENGTH_MAX );
+  int seg = 0;
+
+  stage->_seg_cnt = 0;
+  while( cmdptr < cmdend )
+  {
+    char *loc = strchr( cmdptr, '%' );
+    if( loc == NULL )
+      loc = cmdend;
+
+    // constant part up to the next placeholder, if any
+    if( loc != cmdptr )
+    {
+      if( seg >= DBBE_REDIS_COMMAND_SEGMENTS_MAX )
+        return -EBADMSG;
+      stage->_seg[ seg ]._base = cmdptr;
+      stage->_seg[ seg ]._len = (uint16_t)( loc - cmdptr );
+      ++seg;
+    }
+    if( loc == cmdend )
+      break;
+
+    // what positional arg to insert?
+    int idx = (int)loc[1] - 48;
+    if(( idx < 0 ) || ( idx >= stage->_array_len ) || ( seg >= DBBE_REDIS_COMMAND_SEGMENTS_MAX ))
+      return -EBADMSG;
+    stage->_seg[ seg ]._base = NULL;
+    stage->_seg[ seg ]._len = 0;
+    stage->_seg[ seg ]._arg = (uint8_t)idx;
+    ++seg;
+
+    cmdptr = loc + 2;
+  }
+  stage->_seg_cnt = (uint8_t)seg;
+  return 0;
+}
+
 /*
  * Command stage specs are initialized in a 2D array by indexing a 1D array via:
  *    index = opcode * MAX_STAGE + stage
@@ -135,12 +179,13 @@ dbBE_Redis_command_stage_spec_t* dbBE_Redis_command_stages_spec_init()
 
 
   /*
-   * CreateNS ( 2-stage )
+   * CreateNS ( 3-stage )
    * - HSETNX ns_name id ns_name
    * - if return 1: HMSET ns_name refcnt 1 groups permissions flags 0
+   * - INCR ns_name#refcnt:<shard>    (the refcnt of the hash already counts this shard)
    */
   op = DBBE_OPCODE_NSCREATE;
-  stage = 0;
+  stage = DBBE_REDIS_NSCREATE_STAGE_ID;
   index = op * DBBE_REDIS_COMMAND_STAGE_MAX + stage;
   s = &specs[ index ];
   s->_array_len = 3;
@@ -151,25 +196,38 @@ dbBE_Redis_command_stage_spec_t* dbBE_Redis_command_stages_spec_init()
   strcpy( s->_command, "*4\r\n$6\r\nHSETNX\r\n%0%1%2" );
   s->_stage = stage;
 
-  stage = 1;
+  stage = DBBE_REDIS_NSCREATE_STAGE_META;
   index = op * DBBE_REDIS_COMMAND_STAGE_MAX + stage;
   s = &specs[ index ];
   s->_array_len = 7;
   s->_resp_cnt = 1;
-  s->_final = 1;
-  s->_result = 1;
+  s->_final = 0;
+  s->_result = 0;
   s->_expect = dbBE_REDIS_TYPE_CHAR; // will return simple OK string
   strcpy( s->_command, "*8\r\n$5\r\nHMSET\r\n%0%1%2%3%4%5%6" );
   s->_stage = stage;
 
+  stage = DBBE_REDIS_NSCREATE_STAGE_REFSHARD;
+  index = op * DBBE_REDIS_COMMAND_STAGE_MAX + stage;
+  s = &specs[ index ];
+  s->_array_len = 1;
+  s->_resp_cnt = 1;
+  s->_final = 1;
+  s->_result = 1;
+  s->_expect = dbBE_REDIS_TYPE_INT; // will return new value of the shard
+  strcpy( s->_command, "*2\r\n$4\r\nINCR\r\n%0" );
+  s->_stage = stage;
+
   /*
-   * AttachNS ( 2-stage )
-   * - EXISTS ns_name  (if exists, then next stage)
-   * - HINCRBY ns_name refcnt 1
+   * AttachNS ( 3-stage )
+   * - EXISTS ns_name  (if exists, then next stage; skipped if the namespace is already attached locally)
+   * - INCR ns_name#refcnt:<shard>
+   * -  if the shard was already open (return > 1), complete right away
+   * - HINCRBY ns_name refcnt 1  (count the newly opened shard)
    * -  check return for > 1
    */
   op = DBBE_OPCODE_NSATTACH;
-  stage = 0;
+  stage = DBBE_REDIS_NSATTACH_STAGE_EXIST;
   index = op * DBBE_REDIS_COMMAND_STAGE_MAX + stage;
   s = &specs[ index ];
   s->_array_len = 1;
@@ -180,7 +238,18 @@ dbBE_Redis_command_stage_spec_t* dbBE_Redis_command_stages_spec_init()
   strcpy( s->_command, "*2\r\n$6\r\nEXISTS\r\n%0" );
   s->_stage = stage;
 
-  stage = 1;
+  stage = DBBE_REDIS_NSATTACH_STAGE_REFSHARD;
+  index = op * DBBE_REDIS_COMMAND_STAGE_MAX + stage;
+  s = &specs[ index ];
+  s->_array_len = 1;
+  s->_resp_cnt = 1;
+  s->_final = 0;
+  s->_result = 0;
+  s->_expect = dbBE_REDIS_TYPE_INT; // will return new value of the shard
+  strcpy( s->_command, "*2\r\n$4\r\nINCR\r\n%0" );
+  s->_stage = stage;
+
+  stage = DBBE_REDIS_NSATTACH_STAGE_REFCNT;
   index = op * DBBE_REDIS_COMMAND_STAGE_MAX + stage;
   s = &specs[ index ];
   s->_array_len = 2;
@@ -211,13 +280,14 @@ dbBE_Redis_command_stage_spec_t* dbBE_Redis_command_stages_spec_init()
 
   /*
    * DetachNS (serves as delete determined by refcount and delete flag
+   * - DECR ns_name#refcnt:<shard>      if the shard is still open (return > 0), complete right away
    * - HMGET ns_name FLAGS REFCNT       check for DELETED flag then transition to
    *     DETACH or SCAN
    *
    * - SCAN 0 MATCH ns_name::*          start the scan on all connections
    * - SCAN <cursor> MATCH ns_name::*   repeat until return from server is 0, delete each returned key
    *
-   * - DEL remaining keys
+   * - DEL remaining keys (and the refcnt shards)
    * - HINCRBY ns_name refcnt -1        check return for >= 0
    *
    *  request has 2 final stages because it might go 2 different paths
@@ -226,6 +296,17 @@ dbBE_Redis_command_stage_spec_t* dbBE_Redis_command_stages_spec_init()
    *
    */
   op = DBBE_OPCODE_NSDETACH;
+  stage = DBBE_REDIS_NSDETACH_STAGE_REFSHARD;
+  index = op * DBBE_REDIS_COMMAND_STAGE_MAX + stage;
+  s = &specs[ index ];
+  s->_array_len = 1;
+  s->_resp_cnt = 1;
+  s->_final = 0;
+  s->_result = 0;
+  s->_expect = dbBE_REDIS_TYPE_INT; // will return new value of the shard
+  strcpy( s->_command, "*2\r\n$4\r\nDECR\r\n%0" );
+  s->_stage = stage;
+
   stage = DBBE_REDIS_NSDETACH_STAGE_DELCHECK;
   index = op * DBBE_REDIS_COMMAND_STAGE_MAX + stage;
   s = &specs[ index ];
@@ -273,6 +354,7 @@ dbBE_Redis_command_stage_spec_t* dbBE_Redis_command_stages_spec_init()
   /*
    * DeleteNS
    * - HMGET refcnt flags: required for error handling purposes
+   * - GET ns_name#refcnt:<shard>: other attachments in the shard of this process
    * - HSET flags 1: delete marker
    * - Only mark as: to delete
    * - upper layers are required to call detach after delete
@@ -284,11 +366,22 @@ dbBE_Redis_command_stage_spec_t* dbBE_Redis_command_stages_spec_init()
   s->_array_len = 1;
   s->_resp_cnt = 1;
   s->_final = 0;
-  s->_result = 1;
+  s->_result = 0;
   s->_expect = dbBE_REDIS_TYPE_ARRAY; // will return refcnt and flags as array
   strcpy( s->_command, "*4\r\n$5\r\nHMGET\r\n%0$6\r\nrefcnt\r\n$5\r\nflags\r\n" );
   s->_stage = stage;
 
+  stage = DBBE_REDIS_NSDELETE_STAGE_REFSHARD;
+  index = op * DBBE_REDIS_COMMAND_STAGE_MAX + stage;
+  s = &specs[ index ];
+  s->_array_len = 1;
+  s->_resp_cnt = 1;
+  s->_final = 0;
+  s->_result = 1;
+  s->_expect = dbBE_REDIS_TYPE_CHAR; // will return the value of the shard
+  strcpy( s->_command, "*2\r\n$3\r\nGET\r\n%0" );
+  s->_stage = stage;
+
   stage = DBBE_REDIS_NSDELETE_STAGE_SETFLAG;
   index = op * DBBE_REDIS_COMMAND_STAGE_MAX + stage;
   s = &specs[ index ];
@@ -377,6 +470,15 @@ dbBE_Redis_command_stage_spec_t* dbBE_Redis_command_stages_spec_init()
   strcpy( s->_command, "*6\r\n$4\r\nSCAN\r\n%0$5\r\nMATCH\r\n%1$5\r\nCOUNT\r\n$2\r\n10\r\n" );
   s->_stage = stage;
 
+  // compile all command strings; an invalid spec is a bug that needs to surface right away
+  for( index = 0; index < total_stages; ++index )
+    if( dbBE_Redis_command_stage_compile( &specs[ index ] ) != 0 )
+    {
+      free( specs );
+      --gRedis_command_spec_refcnt;
+      return NULL;
+    }
+
   gRedis_command_spec = specs;
 
   return specs;
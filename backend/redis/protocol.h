@@ -26,7 +26,7 @@
 /*
  * max number of stages that can be spec'd for one opcode
  */
-#define DBBE_REDIS_COMMAND_STAGE_MAX ( 4 )
+#define DBBE_REDIS_COMMAND_STAGE_MAX ( 5 )
 
 /*
  * max length of a command string (base command without arguments)
@@ -38,6 +38,11 @@
  */
 #define DBBE_REDIS_COMMAND_ARGS_MAX ( 6 )
 
+/*
+ * max number of segments (constant strings and argument slots) of a compiled command
+ */
+#define DBBE_REDIS_COMMAND_SEGMENTS_MAX ( 16 )
+
 
 /*
  * enumeration of the directory scan stages
@@ -49,15 +54,36 @@ typedef enum
 } dbBE_Redis_directory_stages_t;
 
 
+/*
+ * enumeration of the name space create stages
+ */
+typedef enum
+{
+  DBBE_REDIS_NSCREATE_STAGE_ID = 0,
+  DBBE_REDIS_NSCREATE_STAGE_META = 1,
+  DBBE_REDIS_NSCREATE_STAGE_REFSHARD = 2
+} dbBE_Redis_nscreate_stages_t;
+
+/*
+ * enumeration of the name space attach stages
+ */
+typedef enum
+{
+  DBBE_REDIS_NSATTACH_STAGE_EXIST = 0,
+  DBBE_REDIS_NSATTACH_STAGE_REFSHARD = 1,
+  DBBE_REDIS_NSATTACH_STAGE_REFCNT = 2
+} dbBE_Redis_nsattach_stages_t;
+
 /*
  * enumeration of the name space detach stages
  */
 typedef enum
 {
-  DBBE_REDIS_NSDETACH_STAGE_DELCHECK = 0,
-  DBBE_REDIS_NSDETACH_STAGE_SCAN = 1,
-  DBBE_REDIS_NSDETACH_STAGE_DELKEYS = 2,
-  DBBE_REDIS_NSDETACH_STAGE_DELNS = 3
+  DBBE_REDIS_NSDETACH_STAGE_REFSHARD = 0,
+  DBBE_REDIS_NSDETACH_STAGE_DELCHECK = 1,
+  DBBE_REDIS_NSDETACH_STAGE_SCAN = 2,
+  DBBE_REDIS_NSDETACH_STAGE_DELKEYS = 3,
+  DBBE_REDIS_NSDETACH_STAGE_DELNS = 4
 } dbBE_Redis_nsdetach_stages_t;
 
 /*
@@ -66,7 +92,8 @@ typedef enum
 typedef enum
 {
   DBBE_REDIS_NSDELETE_STAGE_EXIST = 0,
-  DBBE_REDIS_NSDELETE_STAGE_SETFLAG = 1
+  DBBE_REDIS_NSDELETE_STAGE_REFSHARD = 1,
+  DBBE_REDIS_NSDELETE_STAGE_SETFLAG = 2
 } dbBE_Redis_nsdelete_stages_t;
 
 /*
@@ -79,6 +106,17 @@ typedef enum
   DBBE_REDIS_MOVE_STAGE_DEL = 2
 } dbBE_Redis_move_stages_t;
 
+/*
+ * one segment of a compiled command:
+ * either a constant part of the command string or the slot of a positional argument
+ */
+typedef struct dbBE_Redis_command_segment
+{
+  char *_base; // start of the constant part within the command string; NULL for an argument slot
+  uint16_t _len; // length of the constant part
+  uint8_t _arg; // index of the argument to insert if _base is NULL
+} dbBE_Redis_command_segment_t;
+
 /*
  * holds the generic spec of a command stage
  * - stage number
@@ -93,6 +131,8 @@ typedef struct dbBE_Redis_command_stage_spec
   uint8_t _final; // is it the last stage of this command?
   uint8_t _result; // is it the result-stage of this command?
   dbBE_REDIS_DATA_TYPE _expect; // what result type to expect for this stage
+  uint8_t _seg_cnt; // number of segments of the compiled command
+  dbBE_Redis_command_segment_t _seg[ DBBE_REDIS_COMMAND_SEGMENTS_MAX ]; // command string compiled at init time
   char _command[ DBBE_REDIS_COMMAND_LENGTH_MAX ]; // Redis command string
 } dbBE_Redis_command_stage_spec_t;
 
@@ -101,9 +141,17 @@ extern dbBE_Redis_command_stage_spec_t *gRedis_command_spec;
 /*
  * Command stage specs are initialized in a 2D array by indexing a 1D array via:
  *    index = opcode * MAX_STAGE + stage
+ * Each command string with its %<n> argument placeholders gets compiled into segments
+ * so that command creation doesn't have to parse the command string per request.
  */
 dbBE_Redis_command_stage_spec_t* dbBE_Redis_command_stages_spec_init();
 
+/*
+ * split the command string of a stage into constant segments and argument slots
+ * returns 0 on success or -EBADMSG if a placeholder is invalid or there are too many segments
+ */
+int dbBE_Redis_command_stage_compile( dbBE_Redis_command_stage_spec_t *stage );
+
 /*
  * destroy the stage specs (if refcount is 0)
  */
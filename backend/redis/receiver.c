@@ -43,6 +43,100 @@ typedef struct dbBE_Redis_receiver_args
 } dbBE_Redis_receiver_args_t;
 
 
+/*
+ * a connection went down: place its posted requests (and the one in progress, if any) for retry
+ */
+static
+void dbBE_Redis_receiver_conn_lost( dbBE_Redis_context_t *backend,
+                                    dbBE_Redis_connection_t *conn,
+                                    dbBE_Redis_request_t *current )
+{
+  // replica and pooled connections are just dropped; their requests go back to the master
+  if( dbBE_Redis_connection_is_secondary( conn ) )
+  {
+    if( current != NULL )
+    {
+      dbBE_Redis_reader_fallback( backend, current, conn );
+      dbBE_Redis_s2r_queue_push( backend->_retry_q, current );
+    }
+    dbBE_Redis_drop_reader( backend, conn );
+    return;
+  }
+
+  // drain the posted queue of this connection and place the requests for retry
+  dbBE_Redis_request_t *request = current;
+  if( request == NULL )
+    request = dbBE_Redis_s2r_queue_pop( conn->_posted_q );
+  while( request != NULL )
+  {
+    dbBE_Redis_request_ask_reset( request );
+    dbBE_Redis_s2r_queue_push( backend->_retry_q, request );
+    request = dbBE_Redis_s2r_queue_pop( conn->_posted_q );
+  }
+  // remove the connection from the locator index
+  dbBE_Redis_locator_reassociate_conn_index( backend->_locator,
+                                             conn->_index,
+                                             DBBE_REDIS_LOCATOR_INDEX_INVAL );
+
+  // remove the connection from the connection mgr
+  dbBE_Redis_connection_mgr_conn_fail( backend->_conn_mgr, conn );
+
+  // todo: cancel all remaining requests for cleanup
+}
+
+
+/*
+ * RESP3 push frames are out-of-band: they don't belong to any posted request
+ * hand the ones in front of the next response to the push handler
+ * with wait set, a request is in progress and its response is due: keep receiving until it starts
+ * returns 0 if a response is next, 1 if the buffer got drained, or <0 if the connection is broken
+ */
+static
+int dbBE_Redis_receiver_push_frames( dbBE_Redis_context_t *backend,
+                                     dbBE_Redis_connection_t *conn,
+                                     const int wait )
+{
+  int rc = 0;
+  dbBE_Redis_sr_buffer_t *sr_buf = dbBE_Transport_dbuffer_get_active( conn->_recvbuf );
+  while( rc == 0 )
+  {
+    if( dbBE_Transport_sr_buffer_empty( sr_buf ) )
+    {
+      if( ! wait )
+        return 1;
+      rc = dbBE_Redis_connection_recv_more( conn, sr_buf );
+      if(( rc == 0 ) || (( rc < 0 ) && ( rc != -EAGAIN ) && ( rc != -EWOULDBLOCK )))
+        return -ENOTCONN;
+      rc = 0;
+      continue;
+    }
+    if( *dbBE_Transport_sr_buffer_get_processed_position( sr_buf ) != '>' )
+      return 0;
+
+    dbBE_Redis_result_t push;
+    memset( &push, 0, sizeof( push ) );
+    rc = dbBE_Redis_parse_sr_buffer( sr_buf, &push );
+    while( rc == -EAGAIN )
+    {
+      rc = dbBE_Redis_connection_recv_more( conn, sr_buf );
+      if(( rc == 0 ) || (( rc < 0 ) && ( rc != -EAGAIN ) && ( rc != -EWOULDBLOCK )))
+        return -ENOTCONN;
+      rc = dbBE_Redis_parse_sr_buffer( sr_buf, &push );
+    }
+    if( rc == 0 )
+    {
+      if( backend->_push_handler != NULL )
+        backend->_push_handler( backend->_push_arg, conn, &push );
+      else
+        LOG( DBG_VERBOSE, stderr, "Dropping push frame of %d entries from conn %d\n", push._data._array._len, conn->_index );
+    }
+    else
+      LOG( DBG_ERR, stderr, "Failed to parse push frame from conn %d. rc=%d\n", conn->_index, rc );
+    dbBE_Redis_result_cleanup( &push, 0 );
+  }
+  return rc;
+}
+
 void* dbBE_Redis_receiver( void *args )
 {
   int rc = 0;
@@ -94,22 +188,7 @@ receive_more_responses:
       default:
         LOG( DBG_ERR, stderr, "Recv from conn %d returned %d\n", conn->_index, rc );
 
-        // drain the posted queue of this connection and place the requests for retry
-        dbBE_Redis_request_t *request;
-        while( ( request = dbBE_Redis_s2r_queue_pop( conn->_posted_q ) ) != NULL )
-        {
-          dbBE_Redis_s2r_queue_push( input->_backend->_retry_q, request );
-        }
-        // remove the connection from the locator index
-        dbBE_Redis_locator_reassociate_conn_index( input->_backend->_locator,
-                                                   conn->_index,
-                                                   DBBE_REDIS_LOCATOR_INDEX_INVAL );
-
-        // remove the connection from the connection mgr
-        dbBE_Redis_connection_mgr_conn_fail( input->_backend->_conn_mgr, conn );
-
-        // todo: cancel all remaining requests for cleanup
-
+        dbBE_Redis_receiver_conn_lost( input->_backend, conn, NULL );
         // intentionally no break
       case 0:
         goto skip_receiving;
@@ -127,6 +206,24 @@ receive_more_responses:
 
 process_next_item:
 
+  // push frames between two requests' responses
+  if( responses_remain <= 0 )
+  {
+    rc = dbBE_Redis_receiver_push_frames( input->_backend, conn, 0 );
+    if( rc != 0 )
+    {
+      dbBE_Redis_result_cleanup( &result, 0 );
+      if( rc < 0 )
+      {
+        dbBE_Redis_receiver_conn_lost( input->_backend, conn, NULL );
+        goto skip_receiving;
+      }
+      if( receive_limit > 0 )
+        goto receive_more_responses;
+      goto skip_receiving;
+    }
+  }
+
   // when we received something:
   // fetch first request from sender's request queue
   if( responses_remain <= 0 )
@@ -147,16 +244,17 @@ process_next_item:
   else
     --responses_remain;
 
+parse_next_response:
   // parse buffer for next complete response including nested arrays
   dbBE_Redis_result_cleanup( &result, 0 );
 
-
-
-
-
-
-
-
+  // push frames ahead of the response of this request
+  if( dbBE_Redis_receiver_push_frames( input->_backend, conn, 1 ) < 0 )
+  {
+    LOG( DBG_ERR, stderr, "Redis connection %d lost while waiting for a response\n", conn->_index );
+    dbBE_Redis_receiver_conn_lost( input->_backend, conn, request );
+    goto skip_receiving;
+  }
 
   sr_buf = dbBE_Transport_dbuffer_get_active( conn->_recvbuf );
   rc = dbBE_Redis_parse_sr_buffer( sr_buf, &result );
@@ -173,9 +271,13 @@ process_next_item:
   {
     LOG( DBG_VERBOSE, stdout, "Incomplete recv. Trying to retrieve more data.\n" );
     rc = dbBE_Redis_connection_recv_more( conn, sr_buf );
-    if( rc == 0 )
+    if(( rc == 0 ) || (( rc < 0 ) && ( rc != -EAGAIN ) && ( rc != -EWOULDBLOCK )))
     {
-      rc = -EAGAIN;
+      // the rest of the response will never arrive
+      LOG( DBG_ERR, stderr, "Redis connection %d lost with an incomplete response. rc=%d\n", conn->_index, rc );
+      dbBE_Redis_result_cleanup( &result, 0 );
+      dbBE_Redis_receiver_conn_lost( input->_backend, conn, request );
+      goto skip_receiving;
     }
     rc = dbBE_Redis_parse_sr_buffer( sr_buf, &result );
 
@@ -188,20 +290,113 @@ process_next_item:
     }
   }
 
+  // the response to the ASKING prefix of a redirected request is not part of the request's responses
+  if(( request->_flags & DBBE_REDIS_REQUEST_FLAG_ASKING_SENT ) != 0 )
+  {
+    request->_flags &= ~DBBE_REDIS_REQUEST_FLAG_ASKING_SENT;
+    if( result._type != dbBE_REDIS_TYPE_CHAR )
+      LOG( DBG_ERR, stderr, "Unexpected response type %d to ASKING on conn %d\n", result._type, conn->_index );
+
+    // the response of the redirected command might still be on the way
+    // leave the request at the head of the posted queue and resume with the next receive
+    sr_buf = dbBE_Transport_dbuffer_get_active( conn->_recvbuf );
+    if( ! dbBE_Transport_sr_buffer_empty( sr_buf ) )
+      goto parse_next_response;
+
+    dbBE_Redis_s2r_queue_push_front( conn->_posted_q, request );
+    dbBE_Redis_result_cleanup( &result, 0 );
+    if( receive_limit > 0 )
+      goto receive_more_responses;
+    goto skip_receiving;
+  }
+
   // decide:
   //  - it's completed and goes to the completion queue
   //  - it's a redirect and needs to be returned to sender
   //    - extract the destination node and queue
-  switch( result._type )
+  // once a stage got redirected by ASK, its remaining responses are just drained
+  dbBE_REDIS_DATA_TYPE response_type = result._type;
+  if(( request->_flags & DBBE_REDIS_REQUEST_FLAG_ASK_DRAIN ) != 0 )
+    response_type = dbBE_REDIS_TYPE_REDIRECT;
+
+  switch( response_type )
   {
     case dbBE_REDIS_TYPE_REDIRECT:
-      // retrieve/connect the destination connection and add the index
-      // to the request that's pushed to the sender-queue
+    {
+      /*
+       * ASK: the slot is being migrated and the key already lives at the destination
+       * repeat only this command at the destination prefixed by ASKING
+       * the slot stays with the current connection until a MOVED says otherwise
+       */
+      if(( request->_flags & DBBE_REDIS_REQUEST_FLAG_ASK_DRAIN ) == 0 )
+      {
+        dbBE_Redis_request_ask_reset( request );
+        dbBE_Redis_connection_t *dest =
+            dbBE_Redis_connection_mgr_get_connection_to( input->_backend->_conn_mgr,
+                                                         result._data._location._address );
+        if( dest == NULL )
+        {
+          // a migration target that we don't know yet (e.g. a new node while scaling up)
+          // link up in the background; the sender holds the request back until the connection is ready
+          char address[ DBR_SERVER_URL_MAX_LENGTH ];
+          snprintf( address, DBR_SERVER_URL_MAX_LENGTH, "sock://%s", result._data._location._address );
+          dest = dbBE_Redis_connection_mgr_link_async( input->_backend->_conn_mgr, address, DBBE_INFO_CATEGORY_UNSPECIFIED );
+        }
+
+        if( dest != NULL )
+        {
+          LOG( DBG_VERBOSE, stderr, "Received ASK for slot %d. Asking conn %d\n", (int)result._data._location._hash, dest->_index );
+          request->_location._type = DBBE_REDIS_REQUEST_LOCATION_TYPE_CONNECTION;
+          request->_location._data._connection = dest;
+          request->_flags |= DBBE_REDIS_REQUEST_FLAG_ASKING;
+        }
+        else
+          LOG( DBG_ERR, stderr, "Unable to connect to ASK destination %s\n", result._data._location._address );
+        request->_flags |= DBBE_REDIS_REQUEST_FLAG_ASK_DRAIN;
+      }
+
+      // a multi-response stage (MULTI/EXEC) has the remaining responses in the pipe; skip them
+      if( responses_remain > 0 )
+        break;
+      request->_flags &= ~DBBE_REDIS_REQUEST_FLAG_ASK_DRAIN;
+
+      if(( request->_flags & DBBE_REDIS_REQUEST_FLAG_ASKING ) != 0 )
+      {
+        dbBE_Redis_s2r_queue_push( input->_backend->_retry_q, request );
+        break;
+      }
 
+      // unable to reach the destination, failing the request
+      dbBE_Completion_t *completion = dbBE_Redis_complete_error( request, DBR_ERR_NOCONNECT, 0 );
+      if( request->_completion != NULL )
+        free( request->_completion );
+      dbBE_Redis_request_destroy( request );
+      request = NULL;
+      if(( completion == NULL ) || ( dbBE_Completion_queue_push( input->_backend->_compl_q, completion ) != 0 ))
+      {
+        free( completion );
+        LOG( DBG_ERR, stderr, "RedisBE: Failed to queue error completion.\n" );
+      }
       break;
+    }
 
     case dbBE_REDIS_TYPE_RELOCATE:
     {
+      // a pending ASK redirect is void: the slot map is updated below
+      dbBE_Redis_request_ask_reset( request );
+
+      // a replica doesn't (or no longer) serve(s) this slot: repeat on the master and leave the slot map alone
+      // (same for a pooled connection; the master takes care of the slot map once it gets the MOVED)
+      if( dbBE_Redis_connection_is_secondary( conn ) )
+      {
+        LOG( DBG_VERBOSE, stderr, "Received MOVED from secondary conn %d. Falling back to master\n", conn->_index );
+        if( dbBE_Redis_connection_is_reader( conn ) )
+          request->_flags |= DBBE_REDIS_REQUEST_FLAG_MASTER_ONLY;
+        dbBE_Redis_reader_fallback( input->_backend, request, conn );
+        dbBE_Redis_s2r_queue_push( input->_backend->_retry_q, request );
+        break;
+      }
+
       // unset the connection slot in old place
       dbBE_Redis_slot_bitmap_t *slots = dbBE_Redis_connection_get_slot_range( conn );
       dbBE_Redis_slot_bitmap_unset( slots, result._data._location._hash );
@@ -238,6 +433,7 @@ process_next_item:
             // drain the posted queue of this connection and place the requests for retry
             while( ( request = dbBE_Redis_s2r_queue_pop( conn->_posted_q ) ) != NULL )
             {
+              dbBE_Redis_request_ask_reset( request );
               dbBE_Redis_s2r_queue_push( input->_backend->_retry_q, request );
             }
             // remove the connection from the locator index
@@ -294,14 +490,15 @@ process_next_item:
     default:
       if( request != NULL )
       {
-        // in case we receive a CLUSTERDOWN error, assume this is recoverable and retry the request
+        // in case we receive a CLUSTERDOWN error, assume this is recoverable and retry the request after a backoff
         if(( result._type == dbBE_REDIS_TYPE_ERROR ) &&
             ( result._data._string._data != NULL ) &&
             ( strncmp( result._data._string._data, "CLUSTERDOWN", 11 ) == 0 ))
         {
-          dbBE_Redis_s2r_queue_push( input->_backend->_retry_q, request );
+          dbBE_Redis_backoff_request( input->_backend, request );
           break;
         }
+        input->_backend->_retry_backoff = DBBE_REDIS_RETRY_BACKOFF_MIN;
 
         switch( request->_user->_opcode )
         {
@@ -330,7 +527,8 @@ process_next_item:
             break;
           case DBBE_OPCODE_NSCREATE:
             rc = dbBE_Redis_process_nscreate( request, &result );
-            rc = dbBE_Redis_process_nshandling( &input->_backend->_namespaces, request, &result, rc );
+            rc = dbBE_Redis_process_nshandling( &input->_backend->_namespaces, request, &result,
+                                                input->_backend->_conn_mgr->_config, rc );
             break;
 
           case DBBE_OPCODE_NSQUERY:
@@ -339,7 +537,8 @@ process_next_item:
 
           case DBBE_OPCODE_NSATTACH:
             rc = dbBE_Redis_process_nsattach( request, &result );
-            rc = dbBE_Redis_process_nshandling( &input->_backend->_namespaces, request, &result, rc );
+            rc = dbBE_Redis_process_nshandling( &input->_backend->_namespaces, request, &result,
+                                                input->_backend->_conn_mgr->_config, rc );
             break;
 
           case DBBE_OPCODE_NSDETACH:
@@ -26,6 +26,8 @@
 #include <string.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <unistd.h>
+#include <sys/time.h>
 
 #include "logutil.h"
 #include "../common/data_transport.h"
@@ -115,6 +117,19 @@ dbBE_Handle_t Redis_initialize(void)
 
   context->_retry_q = retry_q;
 
+  // create the shelf for requests that have to wait for recovery
+  dbBE_Redis_s2r_queue_t *shelf_q = dbBE_Redis_s2r_queue_create( 1 );
+  if( shelf_q == NULL )
+  {
+    LOG( DBG_ERR, stderr, "dbBE_Redis_context_t::initialize: Failed to allocate request shelf.\n" );
+    Redis_exit( context );
+    return NULL;
+  }
+
+  context->_shelf_q = shelf_q;
+  context->_recovery_backoff = DBBE_REDIS_RECOVERY_BACKOFF_MIN;
+  context->_retry_backoff = DBBE_REDIS_RETRY_BACKOFF_MIN;
+
   dbBE_Request_set_t *cancel = dbBE_Request_set_create( DBBE_REDIS_WORK_QUEUE_DEPTH );
   if( cancel == NULL )
   {
@@ -152,6 +167,31 @@ dbBE_Handle_t Redis_initialize(void)
   dbBE_Redis_conn_mgr_config_t config;
   config._rbuf_len = transport->_recv_buffer_len;
   config._sbuf_len = transport->_send_buffer_len;
+  char *read_replicas = dbBE_Extract_env( DBR_SERVER_READ_REPLICAS_ENV, DBR_SERVER_DEFAULT_READ_REPLICAS );
+  config._read_replicas = ( read_replicas != NULL ) ? ( strtol( read_replicas, NULL, 10 ) != 0 ) : 0;
+  free( read_replicas );
+  char *pool_size = dbBE_Extract_env( DBR_SERVER_CONNECTIONS_ENV, DBR_SERVER_DEFAULT_CONNECTIONS );
+  config._pool_size = ( pool_size != NULL ) ? strtol( pool_size, NULL, 10 ) : 1;
+  free( pool_size );
+  if(( config._pool_size < 1 ) || ( config._pool_size > DBBE_REDIS_POOL_MAX ))
+  {
+    LOG( DBG_ERR, stderr, "%s out of range [1..%d]. Using %d\n", DBR_SERVER_CONNECTIONS_ENV, DBBE_REDIS_POOL_MAX,
+         config._pool_size < 1 ? 1 : DBBE_REDIS_POOL_MAX );
+    config._pool_size = ( config._pool_size < 1 ) ? 1 : DBBE_REDIS_POOL_MAX;
+  }
+  char *protocol = dbBE_Extract_env( DBR_SERVER_PROTOCOL_ENV, DBR_SERVER_DEFAULT_PROTOCOL );
+  config._protocol = ( protocol != NULL ) ? strtol( protocol, NULL, 10 ) : 2;
+  free( protocol );
+  if(( config._protocol != 2 ) && ( config._protocol != 3 ))
+  {
+    LOG( DBG_ERR, stderr, "%s has to be 2 or 3. Using 2\n", DBR_SERVER_PROTOCOL_ENV );
+    config._protocol = 2;
+  }
+  char *read_your_writes = dbBE_Extract_env( DBR_SERVER_READ_YOUR_WRITES_ENV, "" );
+  if(( read_your_writes != NULL ) && ( strlen( read_your_writes ) >= DBBE_REDIS_READ_YOUR_WRITES_MAX ))
+    LOG( DBG_ERR, stderr, "%s exceeds %d characters and gets truncated\n", DBR_SERVER_READ_YOUR_WRITES_ENV, DBBE_REDIS_READ_YOUR_WRITES_MAX - 1 );
+  snprintf( config._read_your_writes, DBBE_REDIS_READ_YOUR_WRITES_MAX, "%s", read_your_writes != NULL ? read_your_writes : "" );
+  free( read_your_writes );
 
   // create connection mgr
   dbBE_Redis_connection_mgr_t *conn_mgr = dbBE_Redis_connection_mgr_init( &config );
@@ -164,6 +204,14 @@ dbBE_Handle_t Redis_initialize(void)
 
   context->_conn_mgr = conn_mgr;
 
+  // recovery steps run from the event loop
+  if( dbBE_Redis_event_mgr_timer_handler( conn_mgr->_ev_mgr, DBBE_REDIS_TIMER_RECOVERY, dbBE_Redis_recovery_callback, context ) != 0 )
+  {
+    LOG( DBG_ERR, stderr, "dbBE_Redis_context_t::initialize: Failed to set up recovery timer.\n" );
+    Redis_exit( context );
+    return NULL;
+  }
+
   // initialize an empty list of namespaces
   context->_namespaces = NULL;
 
@@ -211,6 +259,8 @@ int Redis_exit( dbBE_Handle_t be )
     if( context->_sender_connections != NULL )
       free( context->_sender_connections );
     dbBE_Transport_sr_buffer_free( context->_sender_buffer );
+    temp = dbBE_Redis_s2r_queue_destroy( context->_shelf_q );
+    if(( temp != 0 ) && ( rc == 0 )) rc = temp;
     temp = dbBE_Redis_s2r_queue_destroy( context->_retry_q );
     if(( temp != 0 ) && ( rc == 0 )) rc = temp;
     temp = dbBE_Completion_queue_destroy( context->_compl_q );
@@ -218,6 +268,7 @@ int Redis_exit( dbBE_Handle_t be )
     temp = dbBE_Request_queue_destroy( context->_work_q );
     if(( temp != 0 ) && ( rc == 0 )) rc = temp;
     dbBE_Redis_command_stages_spec_destroy( context->_spec );
+    dbBE_Redis_connection_auth_cmd_release();
     memset( context, 0, sizeof( dbBE_Redis_context_t ) );
     free( context );
     if( gScrapSpace != NULL )
@@ -390,6 +441,32 @@ dbBE_Completion_t* Redis_test_any( dbBE_Handle_t be )
   return compl;
 }
 
+/*
+ * wait for a random time up to DBR_STARTUP_JITTER msec (capped at DBBE_REDIS_STARTUP_JITTER_MAX)
+ * spreads the connection setup of many clients that start at the same time
+ */
+static
+void dbBE_Redis_startup_jitter()
+{
+  char *jitter_env = dbBE_Extract_env( DBR_SERVER_STARTUP_JITTER_ENV, DBR_SERVER_DEFAULT_STARTUP_JITTER );
+  long jitter = ( jitter_env != NULL ) ? strtol( jitter_env, NULL, 10 ) : 0;
+  free( jitter_env );
+  if( jitter <= 0 )
+    return;
+  if( jitter > DBBE_REDIS_STARTUP_JITTER_MAX )
+  {
+    LOG( DBG_WARN, stderr, "%s=%ld exceeds the limit, using %d msec\n", DBR_SERVER_STARTUP_JITTER_ENV, jitter, DBBE_REDIS_STARTUP_JITTER_MAX );
+    jitter = DBBE_REDIS_STARTUP_JITTER_MAX;
+  }
+
+  struct timeval now;
+  gettimeofday( &now, NULL );
+  unsigned seed = (unsigned)( now.tv_usec ^ ( getpid() << 12 ) ^ now.tv_sec );
+  useconds_t delay = (useconds_t)( rand_r( &seed ) % ( jitter * 1000 ) );
+  LOG( DBG_VERBOSE, stderr, "startup jitter: %u usec\n", delay );
+  usleep( delay );
+}
+
 /*
  * create the initial connection to Redis with srbuffers by extracting the url from the ENV variable
  */
@@ -411,21 +488,18 @@ int dbBE_Redis_connect_initial( dbBE_Redis_context_t *ctx )
 
   LOG(DBG_VERBOSE, stderr, "url=%s\n", env_url );
 
-  dbBE_Redis_connection_t *initial_conn = dbBE_Redis_connection_mgr_newlink( ctx->_conn_mgr, env_url );
-  if( initial_conn == NULL )
-  {
-    rc = -ENOTCONN;
-    goto exit_connect;
-  }
+  dbBE_Redis_startup_jitter();
 
-  // find out if we need to tear down the initial connection later because it's a connection to a replica
-  int replica_conn = dbBE_Redis_connection_mgr_is_master( ctx->_conn_mgr, initial_conn );
-  if( replica_conn < 0 )
+  // AUTH and ROLE go out together with the initial connect
+  // ROLE tells if we need to tear down the initial connection later because it's a connection to a replica
+  dbBE_Redis_connection_t *initial_conn = NULL;
+  int is_master = 0;
+  if( dbBE_Redis_connection_mgr_newlinks( ctx->_conn_mgr, &env_url, 1, DBBE_INFO_CATEGORY_ROLE, &initial_conn, &is_master ) != 1 )
   {
-    rc = -EAFNOSUPPORT;
+    rc = -ENOTCONN;
     goto exit_connect;
   }
-  replica_conn = 1 - replica_conn; // flip the logic, since so far it contains 1 if it's a master connection
+  int replica_conn = 1 - is_master;
 
   dbBE_Redis_cluster_info_t *cl_info = dbBE_Redis_connection_mgr_get_cluster_info( ctx->_conn_mgr );
   if( cl_info == NULL )
@@ -444,7 +518,10 @@ int dbBE_Redis_connect_initial( dbBE_Redis_context_t *ctx )
 
   ctx->_cluster_info = cl_info;
 
+  // connect to all masters at once (replica connections will be created only if a master goes down)
   int n, s;
+  int count = 0;
+  char *urls[ DBBE_REDIS_MAX_CONNECTIONS ];
   for( n = 0; n < dbBE_Redis_cluster_info_getsize( cl_info ); ++n )
   {
     dbBE_Redis_server_info_t *si = dbBE_Redis_cluster_info_get_server( cl_info, n );
@@ -455,47 +532,308 @@ int dbBE_Redis_connect_initial( dbBE_Redis_context_t *ctx )
       goto exit_connect;
     }
 
+    char *url = dbBE_Redis_server_info_get_master( si );
+    if( url == NULL )
+    {
+      LOG( DBG_ERR, stderr, "No master url available for node %d\n", n );
+      rc = -ENOTCONN;
+      goto exit_connect;
+    }
+
+    // a master with several slot ranges shows up multiple times
+    int known = ( dbBE_Redis_connection_mgr_get_connection_to( ctx->_conn_mgr, url ) != NULL );
+    for( s = 0; ( s < count ) && ( known == 0 ); ++s )
+      known = ( strncmp( urls[ s ], url, DBR_SERVER_URL_MAX_LENGTH ) == 0 );
+    if( known )
+      continue;
+
+    if( (unsigned)count >= DBBE_REDIS_MAX_CONNECTIONS )
+    {
+      rc = -ENOLINK;
+      goto exit_connect;
+    }
+    urls[ count++ ] = url;
+  }
+
+  if( count > 0 )
+  {
+    dbBE_Redis_connection_t *conns[ count ];
+    int masters[ count ];
+    if( dbBE_Redis_connection_mgr_newlinks( ctx->_conn_mgr, urls, count, DBBE_INFO_CATEGORY_ROLE, conns, masters ) != count )
+    {
+      rc = -ENOLINK;
+      goto exit_connect;
+    }
+
+    // a node that isn't a master (anymore) answers with MOVED and the slot map gets updated from there
+    for( s = 0; s < count; ++s )
+      if( masters[ s ] == 0 )
+        LOG( DBG_WARN, stderr, "Node %s is listed as master but reports a different role\n", urls[ s ] );
+  }
+
+  for( n = 0; n < dbBE_Redis_cluster_info_getsize( cl_info ); ++n )
+  {
+    dbBE_Redis_server_info_t *si = dbBE_Redis_cluster_info_get_server( cl_info, n );
     dbBE_Redis_hash_slot_t first_slot = dbBE_Redis_server_info_get_first_slot( si );
     dbBE_Redis_hash_slot_t last_slot = dbBE_Redis_server_info_get_last_slot( si );
 
-    for( s = 0; s < dbBE_Redis_server_info_getsize( si ); ++ s )
+    dbBE_Redis_connection_t *dest =
+        dbBE_Redis_connection_mgr_get_connection_to( ctx->_conn_mgr, dbBE_Redis_server_info_get_master( si ) );
+    if( dest == NULL )
+    {
+      rc = -ENOLINK;
+      goto exit_connect;
+    }
+
+    dbBE_Redis_connection_assign_slot_range( dest,
+                                             first_slot,
+                                             last_slot );
+
+    // update locator
+    dbBE_Redis_locator_associate_range_conn_index( ctx->_locator, first_slot, last_slot, dest->_index );
+  }
+
+  dbBE_Redis_connect_pooled( ctx );
+  dbBE_Redis_connect_readers( ctx );
+
+exit_connect:
+  free( env_url );
+  return rc;
+}
+
+/*
+ * open READONLY connections to the replicas of all connected masters (if read scaling is enabled)
+ * replicas that aren't reachable are skipped; reads then stay with the master
+ */
+int dbBE_Redis_connect_readers( dbBE_Redis_context_t *ctx )
+{
+  if(( ctx == NULL ) || ( ctx->_cluster_info == NULL ))
+    return -EINVAL;
+
+  dbBE_Redis_connection_mgr_t *conn_mgr = ctx->_conn_mgr;
+  if( conn_mgr->_config->_read_replicas == 0 )
+    return 0;
+
+  // collect the replicas that aren't connected yet, then connect them all at once
+  int n, s, r;
+  int count = 0;
+  char *urls[ DBBE_REDIS_MAX_CONNECTIONS ];
+  dbBE_Redis_connection_t *masters[ DBBE_REDIS_MAX_CONNECTIONS ];
+  for( n = 0; n < dbBE_Redis_cluster_info_getsize( ctx->_cluster_info ); ++n )
+  {
+    dbBE_Redis_server_info_t *si = dbBE_Redis_cluster_info_get_server( ctx->_cluster_info, n );
+    char *master_url = dbBE_Redis_server_info_get_master( si );
+    dbBE_Redis_connection_t *master = dbBE_Redis_connection_mgr_get_connection_to( conn_mgr, master_url );
+    if( master == NULL )
+      continue;
+
+    dbBE_Redis_reader_set_t *rs = &conn_mgr->_readers[ master->_index ];
+    for( s = 0; s < dbBE_Redis_server_info_getsize( si ); ++s )
     {
       char *url = dbBE_Redis_server_info_get_replica( si, s );
-      if( url == NULL )
+      if(( url == NULL ) || ( url == master_url ))
+        continue;
+
+      // a master with several slot ranges shows up multiple times
+      int known = 0;
+      for( r = 0; ( r < rs->_count ) && ( known == 0 ); ++r )
       {
-        LOG( DBG_ERR, stderr, "No replica url available for node %d:%d\n", n, s );
-        rc = -ENOTCONN;
-        goto exit_connect;
+        dbBE_Redis_connection_t *reader = conn_mgr->_connections[ rs->_idx[ r ] ];
+        known = ( reader != NULL ) && ( strncmp( reader->_url, url, DBR_SERVER_URL_MAX_LENGTH ) == 0 );
       }
-
-      // replica connections will be created only if a master goes down
-      if( s > 0 )
+      for( r = 0; ( r < count ) && ( known == 0 ); ++r )
+        known = ( strncmp( urls[ r ], url, DBR_SERVER_URL_MAX_LENGTH ) == 0 );
+      if( known || ( (unsigned)count >= DBBE_REDIS_MAX_CONNECTIONS ))
         continue;
 
-      // check and create connection
-      // check connection exists,
-      dbBE_Redis_connection_t *dest =
-          dbBE_Redis_connection_mgr_get_connection_to( ctx->_conn_mgr, url );
+      urls[ count ] = url;
+      masters[ count ] = master;
+      ++count;
+    }
+  }
 
-      if( dest == NULL )
-        dest = dbBE_Redis_connection_mgr_newlink( ctx->_conn_mgr, url );
+  if( count == 0 )
+    return 0;
 
-      if( dest == NULL )
-      {
-        rc = -ENOLINK;
-        goto exit_connect;
-      }
+  dbBE_Redis_connection_t *readers[ count ];
+  int readonly[ count ];
+  dbBE_Redis_connection_mgr_newlinks( conn_mgr, urls, count, DBBE_INFO_CATEGORY_READONLY, readers, readonly );
+
+  int linked = 0;
+  for( r = 0; r < count; ++r )
+  {
+    // without READONLY, a replica answers every request with MOVED to its master
+    if(( readers[ r ] != NULL ) && (( readonly[ r ] == 0 ) ||
+        ( dbBE_Redis_connection_mgr_add_reader( conn_mgr, readers[ r ], masters[ r ] ) != 0 )))
+    {
+      dbBE_Redis_connection_mgr_rm( conn_mgr, readers[ r ] );
+      dbBE_Redis_connection_destroy( readers[ r ] );
+      readers[ r ] = NULL;
+    }
+
+    if( readers[ r ] != NULL )
+      ++linked;
+    else
+      LOG( DBG_INFO, stderr, "Replica %s unavailable for reads\n", urls[ r ] );
+  }
+  return linked;
+}
+
+/*
+ * open the additional connections to each connected master to fill up its pool
+ * a master with fewer pooled connections (e.g. some failed to connect) just serves more slots itself
+ */
+int dbBE_Redis_connect_pooled( dbBE_Redis_context_t *ctx )
+{
+  if( ctx == NULL )
+    return -EINVAL;
 
-      dbBE_Redis_connection_assign_slot_range( dest,
-                                               first_slot,
-                                               last_slot );
+  dbBE_Redis_connection_mgr_t *conn_mgr = ctx->_conn_mgr;
+  if( conn_mgr->_config->_pool_size <= 1 )
+    return 0;
 
-      // update locator
-      dbBE_Redis_locator_associate_range_conn_index( ctx->_locator, first_slot, last_slot, dest->_index );
+  int n, p;
+  int count = 0;
+  char *urls[ DBBE_REDIS_MAX_CONNECTIONS ];
+  dbBE_Redis_connection_t *masters[ DBBE_REDIS_MAX_CONNECTIONS ];
+  dbBE_Redis_connection_t *master = NULL;
+  while( ( master = dbBE_Redis_connection_mgr_next_master( conn_mgr, dbBE_Redis_connection_get_index( master ) )) != NULL )
+  {
+    for( p = conn_mgr->_pool[ master->_index ]._count;
+        ( p < conn_mgr->_config->_pool_size - 1 ) && ( (unsigned)count < DBBE_REDIS_MAX_CONNECTIONS );
+        ++p )
+    {
+      urls[ count ] = master->_url;
+      masters[ count ] = master;
+      ++count;
     }
   }
 
-exit_connect:
-  free( env_url );
-  return rc;
+  if( count == 0 )
+    return 0;
+
+  dbBE_Redis_connection_t *pooled[ count ];
+  dbBE_Redis_connection_mgr_newlinks( conn_mgr, urls, count, DBBE_INFO_CATEGORY_UNSPECIFIED, pooled, NULL );
+
+  int linked = 0;
+  for( n = 0; n < count; ++n )
+  {
+    if(( pooled[ n ] != NULL ) && ( dbBE_Redis_connection_mgr_add_pooled( conn_mgr, pooled[ n ], masters[ n ] ) != 0 ))
+    {
+      dbBE_Redis_connection_mgr_rm( conn_mgr, pooled[ n ] );
+      dbBE_Redis_connection_destroy( pooled[ n ] );
+      pooled[ n ] = NULL;
+    }
+
+    if( pooled[ n ] != NULL )
+      ++linked;
+    else
+      LOG( DBG_INFO, stderr, "Pooled connection to %s unavailable\n", urls[ n ] );
+  }
+  return linked;
+}
+
+static inline
+dbBE_Redis_connection_t* dbBE_Redis_reader_master( dbBE_Redis_connection_mgr_t *conn_mgr,
+                                                   dbBE_Redis_connection_t *reader )
+{
+  dbBE_Redis_connection_t *master = conn_mgr->_connections[ reader->_primary ];
+  if( master == NULL )
+    master = conn_mgr->_broken[ reader->_primary ];
+  return master;
+}
+
+void dbBE_Redis_reader_fallback( dbBE_Redis_context_t *ctx,
+                                 dbBE_Redis_request_t *request,
+                                 dbBE_Redis_connection_t *reader )
+{
+  if(( ctx == NULL ) || ( request == NULL ) || ( ! dbBE_Redis_connection_is_secondary( reader ) ))
+    return;
+
+  if(( request->_location._type == DBBE_REDIS_REQUEST_LOCATION_TYPE_SLOT ) &&
+      ( request->_location._data._conn_idx == reader->_index ))
+    request->_location._data._conn_idx = reader->_primary;
+  else if(( request->_location._type == DBBE_REDIS_REQUEST_LOCATION_TYPE_CONNECTION ) &&
+      ( request->_location._data._connection == reader ))
+    request->_location._data._connection = dbBE_Redis_reader_master( ctx->_conn_mgr, reader );
+}
+
+/*
+ * shut down a READONLY replica connection and hand its requests and iterators to the master
+ */
+void dbBE_Redis_drop_reader( dbBE_Redis_context_t *ctx,
+                             dbBE_Redis_connection_t *reader )
+{
+  if(( ctx == NULL ) || ( ! dbBE_Redis_connection_is_secondary( reader ) ))
+    return;
+
+  dbBE_Redis_connection_mgr_t *conn_mgr = ctx->_conn_mgr;
+  dbBE_Redis_connection_t *master = dbBE_Redis_reader_master( conn_mgr, reader );
+
+  LOG( DBG_INFO, stderr, "Dropping %s connection %d of master %d\n",
+       reader->_pooled ? "pooled" : "replica", reader->_index, reader->_primary );
+
+  dbBE_Redis_request_t *request;
+  for( request = ctx->_retry_q->_head; request != NULL; request = request->_next )
+    dbBE_Redis_reader_fallback( ctx, request, reader );
+  for( request = ctx->_shelf_q->_head; request != NULL; request = request->_next )
+    dbBE_Redis_reader_fallback( ctx, request, reader );
+  while( ( request = dbBE_Redis_s2r_queue_pop( reader->_posted_q ) ) != NULL )
+  {
+    dbBE_Redis_reader_fallback( ctx, request, reader );
+    dbBE_Redis_s2r_queue_push( ctx->_retry_q, request );
+  }
+
+  // a SCAN cursor is only valid on the node that returned it; restart the scan of these slots on the master
+  // SCAN may return keys more than once anyway, so the iterator stays consistent
+  int i;
+  for( i = 0; i < DBBE_REDIS_MAX_ITERATOR; ++i )
+    if( ctx->_iterators[ i ]._connection == reader )
+    {
+      ctx->_iterators[ i ]._connection = master;
+      snprintf( ctx->_iterators[ i ]._cursor, DBBE_REDIS_MAX_CURSOR_LEN, "0" );
+    }
+
+  dbBE_Redis_connection_mgr_rm_reader( conn_mgr, reader );
+  dbBE_Redis_connection_destroy( reader );
+}
+
+void dbBE_Redis_drop_readers( dbBE_Redis_context_t *ctx )
+{
+  if( ctx == NULL )
+    return;
+
+  unsigned n;
+  for( n = 0; n < DBBE_REDIS_MAX_CONNECTIONS; ++n )
+    if( dbBE_Redis_connection_is_secondary( ctx->_conn_mgr->_connections[ n ] ))
+      dbBE_Redis_drop_reader( ctx, ctx->_conn_mgr->_connections[ n ] );
+}
+
+void dbBE_Redis_shelve_request( dbBE_Redis_context_t *ctx,
+                                dbBE_Redis_request_t *request )
+{
+  if(( ctx == NULL ) || ( request == NULL ))
+    return;
+
+  dbBE_Redis_request_ask_reset( request );
+  dbBE_Redis_s2r_queue_push( ctx->_shelf_q, request );
+}
+
+void dbBE_Redis_backoff_request( dbBE_Redis_context_t *ctx,
+                                 dbBE_Redis_request_t *request )
+{
+  if(( ctx == NULL ) || ( request == NULL ))
+    return;
+
+  // the first CLUSTERDOWN after the last replay arms the timer and grows the backoff
+  dbBE_Redis_event_mgr_t *ev_mgr = ctx->_conn_mgr->_ev_mgr;
+  if( dbBE_Redis_event_mgr_timer_expired( ev_mgr, DBBE_REDIS_TIMER_RETRY ) )
+  {
+    LOG( DBG_VERBOSE, stderr, "CLUSTERDOWN: retrying in %u usec\n", ctx->_retry_backoff );
+    dbBE_Redis_event_mgr_timer_arm( ev_mgr, DBBE_REDIS_TIMER_RETRY, ctx->_retry_backoff );
+    ctx->_retry_backoff <<= 1;
+    if( ctx->_retry_backoff > DBBE_REDIS_RETRY_BACKOFF_MAX )
+      ctx->_retry_backoff = DBBE_REDIS_RETRY_BACKOFF_MAX;
+  }
+  dbBE_Redis_shelve_request( ctx, request );
 }
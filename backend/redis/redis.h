@@ -33,6 +33,14 @@
 #include "namespacelist.h"
 #include "iterator.h"
 
+/*
+ * handler for RESP3 push frames (e.g. invalidation messages of server-assisted client caching)
+ * gets called from the receiver with the parsed frame; the frame is cleaned up after the call
+ */
+typedef void (*dbBE_Redis_push_handler_t)( void *arg,
+                                           dbBE_Redis_connection_t *conn,
+                                           dbBE_Redis_result_t *push );
+
 typedef struct
 {
   dbBE_Redis_command_stage_spec_t *_spec;
@@ -42,12 +50,17 @@ typedef struct
   dbBE_Request_queue_t *_work_q;
   dbBE_Completion_queue_t *_compl_q;
   dbBE_Redis_s2r_queue_t *_retry_q;
+  dbBE_Redis_s2r_queue_t *_shelf_q;   // requests waiting for slot recovery or a CLUSTERDOWN backoff
+  unsigned _recovery_backoff;         // usec until the next recovery attempt
+  unsigned _retry_backoff;            // usec until the next CLUSTERDOWN replay
   dbBE_Request_set_t *_cancellations;
   dbBE_Data_transport_t *_transport;
   dbBE_Redis_sr_buffer_t *_sender_buffer;
   dbBE_Redis_namespace_list_t *_namespaces;
   int *_sender_connections;
   dbBE_Redis_iterator_list_t _iterators;
+  dbBE_Redis_push_handler_t _push_handler; // push frames go here instead of being matched against the posted requests
+  void *_push_arg;
   // sender/receiver threads
 
 } dbBE_Redis_context_t;
@@ -99,6 +112,53 @@ dbBE_Completion_t* Redis_test_any( dbBE_Handle_t be );
  */
 int dbBE_Redis_connect_initial( dbBE_Redis_context_t *ctx );
 
+/*
+ * open READONLY connections to the replicas of the connected masters if read scaling is enabled
+ * returns the number of new replica connections
+ */
+int dbBE_Redis_connect_readers( dbBE_Redis_context_t *ctx );
+
+/*
+ * open the additional pooled connections to the connected masters (DBR_CONNECTIONS_PER_NODE > 1)
+ * returns the number of new pooled connections
+ */
+int dbBE_Redis_connect_pooled( dbBE_Redis_context_t *ctx );
+
+/*
+ * point a request that was routed to a secondary (READONLY replica or pooled) connection to its master instead
+ */
+void dbBE_Redis_reader_fallback( dbBE_Redis_context_t *ctx,
+                                 dbBE_Redis_request_t *request,
+                                 dbBE_Redis_connection_t *reader );
+
+/*
+ * remove a secondary (READONLY replica or pooled) connection; pending requests and iterators fall back to its master
+ */
+void dbBE_Redis_drop_reader( dbBE_Redis_context_t *ctx,
+                             dbBE_Redis_connection_t *reader );
+
+/*
+ * remove all secondary connections (e.g. before cluster recovery)
+ */
+void dbBE_Redis_drop_readers( dbBE_Redis_context_t *ctx );
+
+/*
+ * put a request on the shelf until its slots are covered again
+ */
+void dbBE_Redis_shelve_request( dbBE_Redis_context_t *ctx,
+                                dbBE_Redis_request_t *request );
+
+/*
+ * shelve a request that got a CLUSTERDOWN response and retry it after an exponential backoff
+ */
+void dbBE_Redis_backoff_request( dbBE_Redis_context_t *ctx,
+                                 dbBE_Redis_request_t *request );
+
+/*
+ * timer callback that takes one recovery step if slots are uncovered (arg is the backend context)
+ */
+void dbBE_Redis_recovery_callback( evutil_socket_t socket, short what, void *arg );
+
 void dbBE_Redis_sender_trigger( dbBE_Redis_context_t *backend );
 void* dbBE_Redis_receiver( void *args );
 void dbBE_Redis_receiver_trigger( dbBE_Redis_context_t *backend );
@@ -28,7 +28,6 @@
 #include <string.h>
 #include <errno.h>
 #include <stdio.h>
-#include <math.h>
 
 /*
  * implementation of single redis command exec
@@ -42,6 +41,75 @@ int Redis_insert_redis_terminator( char *buf )
   return 2;
 }
 
+/*
+ * format the decimal digits of value into buf (at least 20 chars) without printf
+ * returns the number of digits; the string is not terminated
+ */
+static inline
+int dbBE_Redis_command_uint_to_str( char *buf, uint64_t value )
+{
+  char digits[ 20 ];
+  int n = 0;
+  do
+  {
+    digits[ n++ ] = (char)( '0' + ( value % 10 ));
+    value /= 10;
+  } while( value > 0 );
+
+  int pos = 0;
+  while( n > 0 )
+    buf[ pos++ ] = digits[ --n ];
+  return pos;
+}
+
+/*
+ * format the bulk string header "$<len>\r\n" into hdr (at least 24 chars)
+ * returns the length of the header
+ */
+static inline
+int dbBE_Redis_command_bulk_header( char *hdr, size_t len )
+{
+  int pos = 0;
+  hdr[ pos++ ] = '$';
+  pos += dbBE_Redis_command_uint_to_str( &hdr[ pos ], len );
+  hdr[ pos++ ] = '\r';
+  hdr[ pos++ ] = '\n';
+  return pos;
+}
+
+/*
+ * assemble the bulk string "$<len>\r\n<prefix><key>\r\n" of a key in keybuf
+ * the prefix is optional (NULL) and usually the cached namespace prefix
+ * returns the total length or -EMSGSIZE if it doesn't fit into size
+ */
+static inline
+int dbBE_Redis_command_bulk_key( char *keybuf, uint16_t size,
+                                 const char *prefix, size_t prefix_len,
+                                 const char *key )
+{
+  size_t keylen = strnlen( key, size );
+  char hdr[ 24 ];
+  int hdrlen = dbBE_Redis_command_bulk_header( hdr, prefix_len + keylen );
+  size_t len = hdrlen + prefix_len + keylen + 2;
+  if( len >= size )
+    return -EMSGSIZE;
+
+  char *pos = keybuf;
+  memcpy( pos, hdr, hdrlen );
+  pos += hdrlen;
+  if( prefix != NULL )
+  {
+    memcpy( pos, prefix, prefix_len );
+    pos += prefix_len;
+  }
+  memcpy( pos, key, keylen );
+  pos += keylen;
+  pos[0] = '\r';
+  pos[1] = '\n';
+  pos[2] = '\0';
+  return (int)len;
+}
+
 int Redis_insert_to_sr_buffer( dbBE_Redis_sr_buffer_t *sr_buf, dbBE_REDIS_DATA_TYPE type, dbBE_Redis_data_t *data );
 
 
@@ -68,52 +136,36 @@ int dbBE_Redis_create_key_cmd( dbBE_Redis_request_t *request, char *keybuf, uint
   if( keybuf == NULL )
     return -EINVAL;
 
-  int len = 0;
   dbBE_Redis_namespace_t *ns = (dbBE_Redis_namespace_t*)request->_user->_ns_hdl;
+  if( dbBE_Redis_request_refshard_stage( request ) )
+  {
+    char tag[ 16 ];
+    int taglen = dbBE_Redis_namespace_refcnt_tag( tag, sizeof( tag ), dbBE_Redis_namespace_refcnt_shard() );
+    if( taglen < 0 )
+      return taglen;
+    const char *name = (( request->_user->_opcode == DBBE_OPCODE_NSCREATE ) || ( request->_user->_opcode == DBBE_OPCODE_NSATTACH )) ?
+        request->_user->_key : dbBE_Redis_namespace_get_name( ns );
+    return dbBE_Redis_command_bulk_key( keybuf, size, name, strnlen( name, DBR_MAX_KEY_LEN ), tag );
+  }
+
   switch( request->_user->_opcode )
   {
     case DBBE_OPCODE_PUT:
     case DBBE_OPCODE_GET:
     case DBBE_OPCODE_READ:
     case DBBE_OPCODE_REMOVE:
-    {
-      int keylen = strnlen( dbBE_Redis_namespace_get_name( ns ), size ) + DBBE_REDIS_NAMESPACE_SEPARATOR_LEN + strnlen( request->_user->_key, size );
-      len = snprintf( keybuf, size, "$%d\r\n%s%s%s\r\n",
-                      keylen,
-                      dbBE_Redis_namespace_get_name( ns ),
-                      DBBE_REDIS_NAMESPACE_SEPARATOR,
-                      request->_user->_key );
-      if(( len < 0 ) || ( len >= size ))
-        return -EMSGSIZE;
-      break;
-    }
+      return dbBE_Redis_command_bulk_key( keybuf, size,
+                                          dbBE_Redis_namespace_get_prefix( ns ),
+                                          dbBE_Redis_namespace_get_prefix_len( ns ),
+                                          request->_user->_key );
     case DBBE_OPCODE_NSCREATE:
     case DBBE_OPCODE_NSATTACH:
-    {
-      int keylen = strnlen( request->_user->_key, size );
-      len = snprintf( keybuf, size, "$%d\r\n%s\r\n",
-                      keylen,
-                      request->_user->_key );
-      break;
-    }
+      return dbBE_Redis_command_bulk_key( keybuf, size, NULL, 0, request->_user->_key );
     case DBBE_OPCODE_DIRECTORY:
     case DBBE_OPCODE_NSQUERY:
     case DBBE_OPCODE_ITERATOR: // iterator should never get here to build a key (SCAN <cursor> MATCH ....) has no 'key'
-    {
-      int keylen = strnlen( dbBE_Redis_namespace_get_name( ns ), size );
-      len = snprintf( keybuf, size, "$%d\r\n%s\r\n",
-                      keylen,
-                      dbBE_Redis_namespace_get_name( ns ) );
-      break;
-    }
     case DBBE_OPCODE_NSDELETE:
-    {
-      int keylen = strnlen( dbBE_Redis_namespace_get_name( ns ), size );
-      len = snprintf( keybuf, size, "$%d\r\n%s\r\n",
-                      keylen,
-                      dbBE_Redis_namespace_get_name( ns ) );
-      break;
-    }
+      return dbBE_Redis_command_bulk_key( keybuf, size, NULL, 0, dbBE_Redis_namespace_get_name( ns ) );
 
     case DBBE_OPCODE_NSDETACH:
     {
@@ -121,59 +173,31 @@ int dbBE_Redis_create_key_cmd( dbBE_Redis_request_t *request, char *keybuf, uint
       {
         case DBBE_REDIS_NSDETACH_STAGE_DELCHECK: // HINCRBY ns_name refcnt -1; HMGET ns_name refcnt flags
         case DBBE_REDIS_NSDETACH_STAGE_DELNS: // DEL ns_name
-        {
-          int keylen = strnlen( dbBE_Redis_namespace_get_name( ns ), size );
-          len = snprintf( keybuf, size, "$%d\r\n%s\r\n",
-                          keylen,
-                          dbBE_Redis_namespace_get_name( ns ) );
-          break;
-        }
+          return dbBE_Redis_command_bulk_key( keybuf, size, NULL, 0, dbBE_Redis_namespace_get_name( ns ) );
         case DBBE_REDIS_NSDETACH_STAGE_SCAN: // SCAN 0 MATCH ns_name%sep;*
           return -ENOSYS;
-        case DBBE_REDIS_NSDETACH_STAGE_DELKEYS: // DEL ns_name%sep;key  (already complete key in nsdetach.scankey)
-        {
-          int keylen = strnlen( request->_status.nsdetach.scankey, size );
-          len = snprintf( keybuf, size, "$%d\r\n%s\r\n",
-                          keylen,
-                          request->_status.nsdetach.scankey );
-          if(( len < 0 ) || ( len >= size ))
-            return -EMSGSIZE;
-          break;
-        }
+        case DBBE_REDIS_NSDETACH_STAGE_DELKEYS: // DEL ns_name%sep;key or refcnt shard (already complete key in nsdetach.scankey)
+          return dbBE_Redis_command_bulk_key( keybuf, size, NULL, 0, request->_status.nsdetach.scankey );
         default:
           return -EPROTO;
       }
-      break;
     }
     case DBBE_OPCODE_MOVE:
     {
-      char *ns_name = NULL;
-      switch( request->_step->_stage )
-      {
-        case DBBE_REDIS_MOVE_STAGE_RESTORE: // restore stage uses the new namespace for the key
-          ns_name = dbBE_Redis_namespace_get_name( (dbBE_Redis_namespace_t*)request->_user->_sge[0].iov_base );
-          break;
-        default:
-          ns_name = dbBE_Redis_namespace_get_name( ns );
-          break;
-      }
-      if( ns_name == NULL )
+      // restore stage uses the new namespace for the key
+      if( request->_step->_stage == DBBE_REDIS_MOVE_STAGE_RESTORE )
+        ns = (dbBE_Redis_namespace_t*)request->_user->_sge[0].iov_base;
+      if( ns == NULL )
         return -EINVAL;
 
-      int keylen = strnlen( ns_name, size ) + DBBE_REDIS_NAMESPACE_SEPARATOR_LEN + strnlen( request->_user->_key, size );
-      len = snprintf( keybuf, size, "$%d\r\n%s%s%s\r\n",
-                      keylen,
-                      ns_name,
-                      DBBE_REDIS_NAMESPACE_SEPARATOR,
-                      request->_user->_key );
-      if(( len < 0 ) || ( len >= size ))
-        return -EMSGSIZE;
-      break;
+      return dbBE_Redis_command_bulk_key( keybuf, size,
+                                          dbBE_Redis_namespace_get_prefix( ns ),
+                                          dbBE_Redis_namespace_get_prefix_len( ns ),
+                                          request->_user->_key );
     }
     default:
       return -ENOSYS;
   }
-  return len;
 }
 
 
@@ -252,139 +276,84 @@ int dbBE_Redis_command_create_sgeN( dbBE_Redis_command_stage_spec_t *stage,
                                     dbBE_sge_t *args )
 {
   int rc = 0;
-  int n = 0;
-  char *cmdptr = stage->_command;
+  int s;
   char *initial = dbBE_Transport_sr_buffer_get_processed_position( sr_buf );
-  char *cmdend = stage->_command + strlen( stage->_command );
 
-  while((cmdptr < cmdend ))
+  for( s = 0; s < stage->_seg_cnt; ++s )
   {
-    // get next location of parameter
-    char *loc = index( cmdptr, '%' );
+    dbBE_Redis_command_segment_t *seg = &stage->_seg[ s ];
 
-    // no more parameters. break and add the remaining cmd string
-    if( loc == NULL )
-      break;
-
-    // index() did something funky...
-    if(( loc > cmdend ) || ( *loc != '%' ))
-      DBBE_REDIS_CMD_REWIND_BUF_AND_ERROR( -EBADMSG, sr_buf, initial );
+    // insert constant part of the command
+    if( seg->_base != NULL )
+    {
+      if( seg->_len > dbBE_Transport_sr_buffer_remaining( sr_buf ) )
+        DBBE_REDIS_CMD_REWIND_BUF_AND_ERROR( -ENOMEM, sr_buf, initial );
+      memcpy( dbBE_Transport_sr_buffer_get_processed_position( sr_buf ), seg->_base, seg->_len );
+      rc += dbBE_Transport_sr_buffer_add_data( sr_buf, seg->_len, 1 );
+      continue;
+    }
 
-    // what positional arg to insert?
-    int idx = (int)loc[1] - 48;
-    if(( idx < 0 )  ||  ( idx >= stage->_array_len )  || ( args[ idx ].iov_base == NULL ))
+    dbBE_sge_t *arg = &args[ seg->_arg ];
+    if( arg->iov_base == NULL )
       DBBE_REDIS_CMD_REWIND_BUF_AND_ERROR( -EBADMSG, sr_buf, initial );
 
-    // insert cmd string up to position
-    char tmp = *loc;
-    /*
-     *  todo: note this changes the cmd buffer and thus is not thread-safe
-     *        in case there are multiple threads creating commands
-     */
-    *loc = '\0';
-    int len = snprintf( dbBE_Transport_sr_buffer_get_processed_position( sr_buf ),
-                        dbBE_Transport_sr_buffer_remaining( sr_buf ),
-                        "%s", cmdptr );
-    *loc = tmp;
-    if( len < 0 ) // can be 0 if 2 args appear back-to-back
-      DBBE_REDIS_CMD_REWIND_BUF_AND_ERROR( -ENOMEM, sr_buf, initial );
-
-    rc += dbBE_Transport_sr_buffer_add_data( sr_buf, len, 1 );
-
-    // insert args[n]
-    len = snprintf( dbBE_Transport_sr_buffer_get_processed_position( sr_buf ),
-                    dbBE_Transport_sr_buffer_remaining( sr_buf ),
-                    "$%ld\r\n", args[ idx ].iov_len );
-    if( len < 4 ) // fixed chars + single digit number + one-length argument
+    // insert args[n] with its bulk string header
+    char hdr[ 24 ];
+    int len = dbBE_Redis_command_bulk_header( hdr, arg->iov_len );
+    if( (size_t)len + 2 > dbBE_Transport_sr_buffer_remaining( sr_buf ) )
       DBBE_REDIS_CMD_REWIND_BUF_AND_ERROR( -ENOMEM, sr_buf, initial );
-
+    memcpy( dbBE_Transport_sr_buffer_get_processed_position( sr_buf ), hdr, len );
     rc += dbBE_Transport_sr_buffer_add_data( sr_buf, len, 1 );
 
-    size_t maxlen = args[ idx ].iov_len;
+    size_t maxlen = arg->iov_len;
     if( maxlen > dbBE_Transport_sr_buffer_remaining( sr_buf ) - 2 ) // -2 because of cmd terminator
       maxlen = dbBE_Transport_sr_buffer_remaining( sr_buf ) - 2;
     memcpy( dbBE_Transport_sr_buffer_get_processed_position( sr_buf ),
-            args[ idx ].iov_base,
+            arg->iov_base,
             maxlen );
 
     rc += dbBE_Transport_sr_buffer_add_data( sr_buf, maxlen, 1 );
     rc += dbBE_Redis_command_create_terminate( sr_buf );
-
-    cmdptr = loc + 2;
-    ++n;
-  }
-
-  // add any remaining/trailing cmd string data
-  if( cmdptr < cmdend )
-  {
-    int len = snprintf( dbBE_Transport_sr_buffer_get_processed_position( sr_buf ),
-                        dbBE_Transport_sr_buffer_remaining( sr_buf ),
-                        "%s", cmdptr );
-    if( len <= 0 ) // if equal to zero, then cmdptr == cmdend - can't be true here
-      DBBE_REDIS_CMD_REWIND_BUF_AND_ERROR( -ENOMEM, sr_buf, initial );
-
-    rc += dbBE_Transport_sr_buffer_add_data( sr_buf, len, 1 );
   }
 
   return rc;
 }
 
+/*
+ * assemble the SGE list of a command from the compiled segments of the stage
+ * constant segments point into the stage spec, argument slots point to the prepared args
+ */
 static inline
 int dbBE_Redis_command_create_sgeN_uncheck( dbBE_Redis_command_stage_spec_t *stage,
                                             dbBE_sge_t *args,
                                             dbBE_sge_t *cmd )
 {
-  char *cmdptr = stage->_command;
-  char *cmdend = stage->_command + strlen( stage->_command );
-
   int cmd_idx = 0;
+  int s;
 
-  while((cmdptr < cmdend ))
+  for( s = 0; s < stage->_seg_cnt; ++s )
   {
-    // get next location of parameter
-    char *loc = index( cmdptr, '%' );
+    dbBE_Redis_command_segment_t *seg = &stage->_seg[ s ];
 
-    // no more parameters. break and add the remaining cmd string
-    if( loc == NULL )
-      break;
-
-    // index() did something funky...
-    if(( loc > cmdend ) || ( *loc != '%' ))
-      DBBE_REDIS_CMD_REWIND_CMD_AND_ERROR( -EBADMSG, cmd_idx );
-
-    // insert chars from defined cmd string, if any
-    if( loc != cmdptr )
+    // insert chars from defined cmd string
+    if( seg->_base != NULL )
     {
-      cmd[ cmd_idx ].iov_base = cmdptr;
-      cmd[ cmd_idx ].iov_len = (size_t)(loc - cmdptr);
-      cmdptr += cmd[ cmd_idx ].iov_len;
+      cmd[ cmd_idx ].iov_base = seg->_base;
+      cmd[ cmd_idx ].iov_len = seg->_len;
       ++cmd_idx;
+      continue;
     }
 
-    // what positional arg to insert?
-    int idx = (int)loc[1] - 48;
-    if(( idx < 0 )  ||  ( idx >= stage->_array_len ))
+    if( args[ seg->_arg ].iov_base == NULL )
       DBBE_REDIS_CMD_REWIND_CMD_AND_ERROR( -EBADMSG, cmd_idx );
 
-    if( args[ idx ].iov_base == NULL )
-      break;
-
     // insert args[n]
-    if( args[ idx ].iov_len > 0 )
+    if( args[ seg->_arg ].iov_len > 0 )
     {
-      cmd[ cmd_idx ].iov_base = args[ idx ].iov_base;
-      cmd[ cmd_idx ].iov_len = args[ idx ].iov_len;
+      cmd[ cmd_idx ].iov_base = args[ seg->_arg ].iov_base;
+      cmd[ cmd_idx ].iov_len = args[ seg->_arg ].iov_len;
       ++cmd_idx;
     }
-    cmdptr = loc + 2;
-  }
-
-  // add any remaining/trailing cmd string data
-  if( cmdptr < cmdend )
-  {
-    cmd[ cmd_idx ].iov_base = cmdptr;
-    cmd[ cmd_idx ].iov_len = (size_t)( cmdend - cmdptr );
-    ++cmd_idx;
   }
 
   return cmd_idx;
@@ -446,11 +415,12 @@ int dbBE_Redis_command_lindex_create( dbBE_Redis_request_t *req,
   sge[ req->_step->_array_len ].iov_len = 0;
 
   // insert the index to fetch (extracted from the flags value)
-  int64_t uindex = req->_user->_flags >> 4;
-  int uindex_len = uindex == 0 ? 1 : (int64_t)( log10( uindex )) + 1;
+  char uindex[ 24 ];
+  uindex[ dbBE_Redis_command_uint_to_str( uindex, (uint64_t)( req->_user->_flags >> 4 ) ) ] = '\0';
   char *lindex = dbBE_Transport_sr_buffer_get_available_position( buf );
-  int lindex_len = snprintf( lindex, dbBE_Transport_sr_buffer_remaining( buf ),
-                             "$%d\r\n%ld\r\n", uindex_len, uindex );
+  int lindex_len = dbBE_Redis_command_bulk_key( lindex,
+                                                dbBE_Transport_sr_buffer_remaining( buf ) >= DBBE_REDIS_MAX_KEY_LEN ? DBBE_REDIS_MAX_KEY_LEN : dbBE_Transport_sr_buffer_remaining( buf ),
+                                                NULL, 0, uindex );
   if(( lindex_len < 0 ) || ( ( dbBE_Transport_sr_buffer_add_data( buf, lindex_len, 1 ) != (size_t)lindex_len ) ))
     goto error;
 
@@ -551,6 +521,17 @@ int dbBE_Redis_command_exists_create( dbBE_Redis_request_t *req,
   return dbBE_Redis_command_create_sgeN_uncheck( stage, sge, cmd );
 }
 
+/*
+ * INCR, DECR, or GET of the refcnt shard of a namespace: the shard key is the only argument
+ */
+static inline
+int dbBE_Redis_command_refshard_create( dbBE_Redis_request_t *req,
+                                        dbBE_Redis_sr_buffer_t *buf,
+                                        dbBE_sge_t *cmd )
+{
+  return dbBE_Redis_command_exists_create( req, buf, cmd );
+}
+
 int dbBE_Redis_command_dump_create(  dbBE_Redis_request_t *req,
                                      dbBE_Redis_sr_buffer_t *buf,
                                      dbBE_sge_t *cmd )
@@ -904,6 +885,8 @@ int dbBE_Redis_command_rpush_create( dbBE_Redis_request_t *request,
   char *key = dbBE_Transport_sr_buffer_get_available_position( buf );
   int keylen = dbBE_Redis_create_key_cmd( request, key,
                                           dbBE_Transport_sr_buffer_remaining( buf ) >= DBBE_REDIS_MAX_KEY_LEN ? DBBE_REDIS_MAX_KEY_LEN : dbBE_Transport_sr_buffer_remaining( buf ) );
+  if( keylen < 0 )
+    return keylen;
   dbBE_Transport_sr_buffer_add_data( buf, keylen, 1 );
 
   // insert key into cmd sge
@@ -925,15 +908,13 @@ int dbBE_Redis_command_rpush_create( dbBE_Redis_request_t *request,
 
   // insert lenth-prefix to buffer
   char *valpre = dbBE_Transport_sr_buffer_get_available_position( buf );
-  if( dbBE_Transport_sr_buffer_remaining( buf ) <= (log10( vallen + 1 ) + 3 ) )  // pre-check if there's enough space for the prefix
-    return -E2BIG;
-
-  int valprelen = snprintf( valpre, dbBE_Transport_sr_buffer_remaining( buf ), "$%ld\r\n", vallen );
-  if( valprelen < 4 )
+  if( dbBE_Transport_sr_buffer_remaining( buf ) < 24 )  // pre-check if there's enough space for the prefix
   {
     dbBE_Transport_sr_buffer_rewind_available_to( buf, key );
     return -E2BIG;
   }
+
+  int valprelen = dbBE_Redis_command_bulk_header( valpre, vallen );
   dbBE_Transport_sr_buffer_add_data( buf, valprelen, 1 );
   int idx = rc;
 
@@ -67,11 +67,14 @@ int dbBE_Redis_request_stage_transition( dbBE_Redis_request_t *request )
   if( request->_step->_final == 1 )
     return -EALREADY;
 
+  dbBE_Redis_request_ask_reset( request );
+
   switch( request->_user->_opcode )
   {
     case DBBE_OPCODE_NSDETACH:
-      // the detach might skip
-      if(( request->_step->_stage == DBBE_REDIS_NSDETACH_STAGE_DELCHECK ) &&
+      // the detach might skip: the shard is still open or the namespace stays
+      if((( request->_step->_stage == DBBE_REDIS_NSDETACH_STAGE_REFSHARD ) ||
+          ( request->_step->_stage == DBBE_REDIS_NSDETACH_STAGE_DELCHECK )) &&
           ( request->_status.nsdetach.to_delete == 0 ))
         stage = DBBE_REDIS_NSDETACH_STAGE_DELNS;
       else
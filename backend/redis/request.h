@@ -24,6 +24,7 @@
 #include "refcounter.h"
 #include "locator.h"
 #include "iterator.h"
+#include "namespace.h"
 
 typedef struct dbBE_Redis_intern_detach_data
 {
@@ -32,6 +33,11 @@ typedef struct dbBE_Redis_intern_detach_data
   int to_delete;
 } dbBE_Redis_intern_detach_data_t;
 
+typedef struct dbBE_Redis_intern_delete_data
+{
+  int64_t refcnt; // number of open refcnt shards from the namespace hash
+} dbBE_Redis_intern_delete_data_t;
+
 typedef struct dbBE_Redis_intern_directory_data
 {
   dbBE_Refcounter_t *reference;
@@ -53,6 +59,7 @@ typedef struct dbBE_Redis_intern_iterator_data
 typedef union dbBE_Redis_intern_data
 {
   dbBE_Redis_intern_detach_data_t  nsdetach;
+  dbBE_Redis_intern_delete_data_t nsdelete;
   dbBE_Redis_intern_directory_data_t directory;
   dbBE_Redis_intern_move_data_t move;
   dbBE_Redis_intern_iterator_data_t iterator;
@@ -82,6 +89,14 @@ typedef struct dbBE_Redis_request_location
   dbBE_Redis_request_location_data_t _data;
 } dbBE_Redis_request_location_t;
 
+/*
+ * request flags
+ */
+#define DBBE_REDIS_REQUEST_FLAG_MASTER_ONLY ( 0x1 ) // don't send to replica connections (e.g. after MOVED from a replica)
+#define DBBE_REDIS_REQUEST_FLAG_ASKING ( 0x2 ) // ASK redirect: send to _location._data._connection prefixed by ASKING
+#define DBBE_REDIS_REQUEST_FLAG_ASKING_SENT ( 0x4 ) // the response to ASKING precedes the responses of this request
+#define DBBE_REDIS_REQUEST_FLAG_ASK_DRAIN ( 0x8 ) // skip the remaining responses of a stage that got redirected by ASK
+
 typedef struct dbBE_Redis_request
 {
   dbBE_Redis_intern_data_t _status;  // allows to keep some state to keep track of multistage-multinode request processing
@@ -89,9 +104,72 @@ typedef struct dbBE_Redis_request
   dbBE_Redis_command_stage_spec_t *_step;
   dbBE_Completion_t *_completion;  // multi-stage requests with early completions need to hold that here
   dbBE_Redis_request_location_t _location; // where this request should go (in case we know)
+  int _flags;
   struct dbBE_Redis_request *_next;
 } dbBE_Redis_request_t;
 
+/*
+ * check whether the request is a non-destructive read that may be served by a replica connection
+ */
+static inline
+int dbBE_Redis_request_replica_readable( dbBE_Redis_request_t *request )
+{
+  if(( request->_flags & DBBE_REDIS_REQUEST_FLAG_MASTER_ONLY ) != 0 )
+    return 0;
+
+  switch( request->_user->_opcode )
+  {
+    case DBBE_OPCODE_READ:
+    case DBBE_OPCODE_DIRECTORY:
+    case DBBE_OPCODE_ITERATOR:
+      break;
+    default:
+      return 0;
+  }
+
+  dbBE_Redis_namespace_t *ns = (dbBE_Redis_namespace_t*)request->_user->_ns_hdl;
+  return ( ns == NULL ) || (( ns->_flags & DBBE_REDIS_NAMESPACE_FLAG_READ_YOUR_WRITES ) == 0 );
+}
+
+/*
+ * check whether the current stage of a namespace request addresses the refcnt shard of this process
+ * instead of the namespace hash
+ */
+static inline
+int dbBE_Redis_request_refshard_stage( dbBE_Redis_request_t *request )
+{
+  switch( request->_user->_opcode )
+  {
+    case DBBE_OPCODE_NSCREATE:
+      return ( request->_step->_stage == DBBE_REDIS_NSCREATE_STAGE_REFSHARD );
+    case DBBE_OPCODE_NSATTACH:
+      return ( request->_step->_stage == DBBE_REDIS_NSATTACH_STAGE_REFSHARD );
+    case DBBE_OPCODE_NSDETACH:
+      return ( request->_step->_stage == DBBE_REDIS_NSDETACH_STAGE_REFSHARD );
+    case DBBE_OPCODE_NSDELETE:
+      return ( request->_step->_stage == DBBE_REDIS_NSDELETE_STAGE_REFSHARD );
+    default:
+      return 0;
+  }
+}
+
+/*
+ * an ASK redirect only applies to a single command
+ * drop the temporary destination so that the locator decides again
+ */
+static inline
+void dbBE_Redis_request_ask_reset( dbBE_Redis_request_t *request )
+{
+  if(( request->_flags & DBBE_REDIS_REQUEST_FLAG_ASKING ) != 0 )
+  {
+    request->_location._type = DBBE_REDIS_REQUEST_LOCATION_TYPE_UNKNOWN;
+    request->_location._data._connection = NULL;
+  }
+  request->_flags &= ~( DBBE_REDIS_REQUEST_FLAG_ASKING |
+                        DBBE_REDIS_REQUEST_FLAG_ASKING_SENT |
+                        DBBE_REDIS_REQUEST_FLAG_ASK_DRAIN );
+}
+
 /*
  * allocate the memory of a new request an initialize according to the user request
  */
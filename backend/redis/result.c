@@ -32,6 +32,9 @@ int dbBE_Redis_result_cleanup( dbBE_Redis_result_t *result, int dealloc )
   switch( result->_type )
   {
     case dbBE_REDIS_TYPE_ARRAY:
+    case dbBE_REDIS_TYPE_MAP:
+    case dbBE_REDIS_TYPE_SET:
+    case dbBE_REDIS_TYPE_PUSH:
     {
       int n;
       // cleanup and free array - the array creation mechanism allocates new memory
@@ -69,9 +72,12 @@ int dbBE_Redis_result_terminate_strings( dbBE_Redis_result_t *result )
   switch( result->_type )
   {
     case dbBE_REDIS_TYPE_INT:
+    case dbBE_REDIS_TYPE_BOOL:
+    case dbBE_REDIS_TYPE_DOUBLE:
       break;
     case dbBE_REDIS_TYPE_CHAR:
     case dbBE_REDIS_TYPE_ERROR:
+    case dbBE_REDIS_TYPE_BIGNUM:
       if( result->_data._string._data != NULL )
         result->_data._string._data[ result->_data._string._size ] = '\0';
       break;
@@ -87,6 +93,9 @@ int dbBE_Redis_result_terminate_strings( dbBE_Redis_result_t *result )
       break;
     }
     case dbBE_REDIS_TYPE_ARRAY:
+    case dbBE_REDIS_TYPE_MAP:
+    case dbBE_REDIS_TYPE_SET:
+    case dbBE_REDIS_TYPE_PUSH:
     {
       int n;
       int array_len = result->_data._array._len;
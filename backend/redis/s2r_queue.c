@@ -93,6 +93,23 @@ int dbBE_Redis_s2r_queue_push( dbBE_Redis_s2r_queue_t *queue,
   return 0;
 }
 
+/*
+ * put an entry back in front of the queue
+ */
+int dbBE_Redis_s2r_queue_push_front( dbBE_Redis_s2r_queue_t *queue,
+                                     dbBE_Redis_request_t *request )
+{
+  if(( queue == NULL ) || ( request == NULL ))
+    return -EINVAL;
+
+  request->_next = queue->_head;
+  queue->_head = request;
+  if( queue->_tail == NULL )
+    queue->_tail = request;
+  ++queue->_len;
+  return 0;
+}
+
 /*
  * retrieve the first entry from the queue
  */
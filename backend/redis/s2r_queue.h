@@ -50,6 +50,12 @@ size_t dbBE_Redis_s2r_queue_len( dbBE_Redis_s2r_queue_t *queue );
 int dbBE_Redis_s2r_queue_push( dbBE_Redis_s2r_queue_t *queue,
                                  dbBE_Redis_request_t *request );
 
+/*
+ * insert an entry at the head of the queue (e.g. to resume a partially processed request)
+ */
+int dbBE_Redis_s2r_queue_push_front( dbBE_Redis_s2r_queue_t *queue,
+                                     dbBE_Redis_request_t *request );
+
 /*
  * return and remove the first entry from the queue
  */
@@ -37,6 +37,12 @@ typedef struct dbBE_Redis_sender_args
   int _looping;
 } dbBE_Redis_sender_args_t;
 
+/*
+ * one-shot prefix for requests that got redirected by ASK
+ */
+static char dbBE_Redis_asking_cmd[] = "*1\r\n$6\r\nASKING\r\n";
+#define DBBE_REDIS_ASKING_CMD_LEN ( sizeof( dbBE_Redis_asking_cmd ) - 1 )
+
 int dbBE_Redis_create_send_error( dbBE_Completion_queue_t *cq, dbBE_Redis_request_t *request, int error )
 {
   dbBE_Completion_t *completion = dbBE_Redis_complete_error( request,
@@ -65,6 +71,11 @@ int dbBE_Redis_cmd_stage_needs_rekeying( dbBE_Redis_request_t *request )
   check += (( request->_step->_stage == 0 ) && ( request->_user->_opcode != DBBE_OPCODE_ITERATOR )); // all first-stage requests need to get checked (except iterators)
   check += ( request->_user->_opcode == DBBE_OPCODE_MOVE ); // MOVE cmd needs re-keying for each stage
   check += (( request->_user->_opcode == DBBE_OPCODE_NSDETACH ) && ( request->_step->_stage == DBBE_REDIS_NSDETACH_STAGE_DELNS ) );
+  // namespace requests switch between the namespace hash and the refcnt shard of this process
+  check += dbBE_Redis_request_refshard_stage( request );
+  check += (( request->_user->_opcode == DBBE_OPCODE_NSATTACH ) && ( request->_step->_stage == DBBE_REDIS_NSATTACH_STAGE_REFCNT ) );
+  check += (( request->_user->_opcode == DBBE_OPCODE_NSDETACH ) && ( request->_step->_stage == DBBE_REDIS_NSDETACH_STAGE_DELCHECK ) );
+  check += (( request->_user->_opcode == DBBE_OPCODE_NSDELETE ) && ( request->_step->_stage == DBBE_REDIS_NSDELETE_STAGE_SETFLAG ) );
   return check;
 }
 
@@ -73,6 +84,16 @@ dbBE_Redis_request_t* dbBE_Redis_request_preprocess( dbBE_Redis_context_t *backe
 {
   if(( request == NULL ) || ( backend == NULL ))
     return request;
+
+  // a namespace that's already attached by this process is known to exist, no need to check again
+  if(( request->_user->_opcode == DBBE_OPCODE_NSATTACH ) &&
+      ( request->_step->_stage == DBBE_REDIS_NSATTACH_STAGE_EXIST ) &&
+      ( dbBE_Redis_namespace_list_get( backend->_namespaces, request->_user->_key ) != NULL ))
+  {
+    dbBE_Redis_request_stage_transition( request );
+    return request;
+  }
+
   if( request->_user->_opcode == DBBE_OPCODE_ITERATOR )
   {
     dbBE_Redis_iterator_t *it = request->_status.iterator._it;
@@ -90,7 +111,6 @@ dbBE_Redis_request_t* dbBE_Redis_request_preprocess( dbBE_Redis_context_t *backe
     // new iterator
     if( it == NULL )
     {
-      unsigned i;
       it = dbBE_Redis_iterator_new( backend->_iterators );
       if( it == NULL )
       {
@@ -100,21 +120,14 @@ dbBE_Redis_request_t* dbBE_Redis_request_preprocess( dbBE_Redis_context_t *backe
       request->_status.iterator._it = it;
 
       // set the first connection index since this is a fresh iterator
-      dbBE_Redis_connection_t *conn = NULL;
-      for( i = 0; (i < DBBE_REDIS_MAX_CONNECTIONS); ++i )
-      {
-        if(( backend->_conn_mgr->_connections[ i ] != NULL ) &&
-            (dbBE_Redis_connection_RTR( backend->_conn_mgr->_connections[ i ] ) ))
-        {
-          conn = backend->_conn_mgr->_connections[ i ];
-          break;
-        }
-      }
-      if( i == DBBE_REDIS_MAX_CONNECTIONS )
+      dbBE_Redis_connection_t *conn = dbBE_Redis_connection_mgr_next_master( backend->_conn_mgr, -1 );
+      if( conn == NULL )
       {
         dbBE_Redis_create_send_error( backend->_compl_q, request, DBR_ERR_NOCONNECT );
         return NULL;
       }
+      if( dbBE_Redis_request_replica_readable( request ) )
+        conn = dbBE_Redis_connection_mgr_get_reader( backend->_conn_mgr, conn );
       request->_location._type = DBBE_REDIS_REQUEST_LOCATION_TYPE_CONNECTION;
       request->_location._data._connection = conn;
       it->_connection = conn;
@@ -181,17 +194,21 @@ dbBE_Redis_request_t* dbBE_Redis_request_preprocess( dbBE_Redis_context_t *backe
 }
 
 static
-dbBE_Redis_request_t* dbBE_Redis_sender_acquire_request( dbBE_Redis_context_t *backend )
+dbBE_Redis_request_t* dbBE_Redis_sender_acquire_request( dbBE_Redis_context_t *backend,
+                                                         const int shelf_open )
 {
   // check for any activity according to priority
   //  - request shelf (anything that had to wait because of broken connections)
   //  - repeat/multistage/redirect (anything that needs an additional iteration)
   //  - new user requests
-  dbBE_Redis_request_t *request = NULL; // todo: pick from shelf
+  dbBE_Redis_request_t *request = NULL;
   dbBE_Request_t *user_req = NULL;
 
   do
   {
+    if( shelf_open )
+      request = dbBE_Redis_s2r_queue_pop( backend->_shelf_q );
+
     if( request == NULL )
       request = dbBE_Redis_s2r_queue_pop( backend->_retry_q );
 
@@ -233,17 +250,24 @@ dbBE_Redis_request_t* dbBE_Redis_sender_acquire_request( dbBE_Redis_context_t *b
   return request;
 }
 
+/*
+ * find the connection for a request
+ * returns NULL if the request got completed with an error or shelved until its slot is covered again
+ */
 static
 dbBE_Redis_connection_t* dbBE_Redis_sender_find_connection( dbBE_Redis_context_t *backend,
-                                                            dbBE_Redis_request_t *request )
+                                                            dbBE_Redis_request_t *request,
+                                                            const int covered )
 {
   dbBE_Redis_connection_t *conn = NULL;
+  uint16_t slot = DBBE_REDIS_HASH_SLOT_MAX; // only known if the request got (re)keyed
 
   /*
    * Do the location check/retrieval each time and also for multi-stage requests
    * because the key might have changed and then the conn-index would be off.
    */
-  if( dbBE_Redis_cmd_stage_needs_rekeying( request ) != 0 )
+  if(( dbBE_Redis_cmd_stage_needs_rekeying( request ) != 0 ) ||
+      ( request->_location._type == DBBE_REDIS_REQUEST_LOCATION_TYPE_UNKNOWN ))
   {
     char keybuffer[ DBBE_REDIS_MAX_KEY_LEN ];
     if( dbBE_Redis_create_key( request, keybuffer, DBBE_REDIS_MAX_KEY_LEN ) < 0 )
@@ -257,7 +281,7 @@ dbBE_Redis_connection_t* dbBE_Redis_sender_find_connection( dbBE_Redis_context_t
      * unless it's a redirect (ASK) which directly contains
      * a direct connection pointer for temporary requesting a different server
      */
-    uint16_t slot = dbBE_Redis_locator_hash( keybuffer, strnlen( keybuffer, DBBE_REDIS_MAX_KEY_LEN ) );
+    slot = dbBE_Redis_locator_hash( keybuffer, strnlen( keybuffer, DBBE_REDIS_MAX_KEY_LEN ) );
     if( request->_location._type != DBBE_REDIS_REQUEST_LOCATION_TYPE_CONNECTION )
     {
       request->_location._data._conn_idx = dbBE_Redis_locator_get_conn_index( backend->_locator, slot );
@@ -269,20 +293,130 @@ dbBE_Redis_connection_t* dbBE_Redis_sender_find_connection( dbBE_Redis_context_t
 
     if( request->_location._type == DBBE_REDIS_REQUEST_LOCATION_TYPE_UNKNOWN )
     {
-      dbBE_Redis_create_send_error( backend->_compl_q, request, DBR_ERR_NOCONNECT );
+      if( covered )
+        dbBE_Redis_create_send_error( backend->_compl_q, request, DBR_ERR_NOCONNECT );
+      else
+        dbBE_Redis_shelve_request( backend, request );
       return NULL;
     }
   }
 
   // connection mgr to retrieve the sr_buffer + socket
   if( request->_location._type == DBBE_REDIS_REQUEST_LOCATION_TYPE_SLOT )
+  {
     conn = dbBE_Redis_connection_mgr_get_connection_at( backend->_conn_mgr, request->_location._data._conn_idx );
+
+    // spread reads across the replicas; a SCAN sticks to the connection that returned its cursor
+    if(( conn != NULL ) && ( ! dbBE_Redis_connection_is_secondary( conn ) ) &&
+        ( dbBE_Redis_request_replica_readable( request ) ) &&
+        (( request->_step->_stage == 0 ) ||
+            (( request->_user->_opcode == DBBE_OPCODE_DIRECTORY ) &&
+             ( request->_status.directory.scankey != NULL ) &&
+             ( strcmp( request->_status.directory.scankey, "0" ) == 0 ))) )
+    {
+      conn = dbBE_Redis_connection_mgr_get_reader( backend->_conn_mgr, conn );
+      request->_location._data._conn_idx = dbBE_Redis_connection_get_index( conn );
+    }
+
+    // stripe across the pool of the master by slot; requests without a key stay with the master
+    if(( conn != NULL ) && ( ! dbBE_Redis_connection_is_secondary( conn ) ) && ( slot < DBBE_REDIS_HASH_SLOT_MAX ))
+    {
+      conn = dbBE_Redis_connection_mgr_get_pooled( backend->_conn_mgr, conn, slot );
+      request->_location._data._conn_idx = dbBE_Redis_connection_get_index( conn );
+    }
+  }
   else
     conn = request->_location._data._connection;
 
+  if(( conn == NULL ) || ( ! dbBE_Redis_connection_RTS( conn ) ))
+  {
+    // an ASK destination that's still linking up in the background; keep the redirect while waiting
+    if(( conn != NULL ) && ( dbBE_Redis_connection_mgr_link_status( backend->_conn_mgr, conn ) > 0 ))
+      dbBE_Redis_s2r_queue_push( backend->_shelf_q, request );
+    // a broken connection is only worth waiting for while recovery is in progress
+    else if( covered )
+    {
+      LOG( DBG_ERR, stderr, "Associated connection not ready to send\n" );
+      dbBE_Redis_create_send_error( backend->_compl_q, request, DBR_ERR_NOCONNECT );
+    }
+    else
+      dbBE_Redis_shelve_request( backend, request );
+    conn = NULL;
+  }
+
   return conn;
 }
 
+/*
+ * one non-blocking step of the recovery state machine, run by the recovery timer
+ * attempts are paced by the recovery timer with an exponential backoff
+ */
+void dbBE_Redis_recovery_callback( evutil_socket_t socket, short what, void *arg )
+{
+  dbBE_Redis_context_t *backend = (dbBE_Redis_context_t*)arg;
+  if( backend == NULL )
+    return;
+
+  dbBE_Redis_event_mgr_t *ev_mgr = backend->_conn_mgr->_ev_mgr;
+
+  // recovery only deals with master connections; pooled and replica connections get re-established afterwards
+  // (the step after the last completed link finds the slots covered already)
+  if( ! dbBE_Redis_locator_hash_covered( backend->_locator ) )
+    dbBE_Redis_drop_readers( backend );
+
+  dbBE_Redis_connection_recoverable_t recoverable = dbBE_Redis_connection_mgr_conn_recover(
+      backend->_conn_mgr,
+      backend->_locator,
+      &( backend->_cluster_info ) );
+
+  switch( recoverable )
+  {
+    case DBBE_REDIS_CONNECTION_RECOVERED: // recovered
+      LOG( DBG_INFO, stderr, "Cluster recovered. Replaying shelved requests.\n" );
+      backend->_recovery_backoff = DBBE_REDIS_RECOVERY_BACKOFF_MIN;
+      dbBE_Redis_connect_pooled( backend );
+      dbBE_Redis_connect_readers( backend );
+      break;
+    case DBBE_REDIS_CONNECTION_RECOVERABLE:  // recoverable but not yet recovered
+      // completed recovery links re-arm the timer with 0 to take the next step right away
+      dbBE_Redis_event_mgr_timer_arm( ev_mgr, DBBE_REDIS_TIMER_RECOVERY, backend->_recovery_backoff );
+      backend->_recovery_backoff <<= 1;
+      if( backend->_recovery_backoff > DBBE_REDIS_RECOVERY_BACKOFF_MAX )
+        backend->_recovery_backoff = DBBE_REDIS_RECOVERY_BACKOFF_MAX;
+      break;
+    case DBBE_REDIS_CONNECTION_UNRECOVERABLE: // not recoverable at the moment
+      LOG( DBG_ERR, stderr, "Unrecoverable cluster connection. Completing shelved requests as failed.\n" );
+      // intentionally no break
+    default: // unrecognized
+    {
+      // only requests waiting for the missing slots fail; keep probing at the slowest pace
+      dbBE_Redis_request_t *request;
+      while( ( request = dbBE_Redis_s2r_queue_pop( backend->_shelf_q )) != NULL )
+        dbBE_Redis_create_send_error( backend->_compl_q, request, DBR_ERR_NOCONNECT );
+      backend->_recovery_backoff = DBBE_REDIS_RECOVERY_BACKOFF_MAX;
+      dbBE_Redis_event_mgr_timer_arm( ev_mgr, DBBE_REDIS_TIMER_RECOVERY, backend->_recovery_backoff );
+      break;
+    }
+  }
+}
+
+/*
+ * kick off recovery if slots are uncovered and no recovery step is scheduled
+ * returns 1 if all slots are covered, 0 while recovery is still in progress
+ */
+static
+int dbBE_Redis_sender_recover( dbBE_Redis_context_t *backend )
+{
+  if( dbBE_Redis_locator_hash_covered( backend->_locator ) )
+    return 1;
+
+  // an overdue step gets rescheduled because the event loop only runs once the receiver goes idle
+  dbBE_Redis_event_mgr_t *ev_mgr = backend->_conn_mgr->_ev_mgr;
+  if( dbBE_Redis_event_mgr_timer_expired( ev_mgr, DBBE_REDIS_TIMER_RECOVERY ) != 0 )
+    dbBE_Redis_event_mgr_timer_arm( ev_mgr, DBBE_REDIS_TIMER_RECOVERY, 0 );
+  return 0;
+}
+
 /*
  * sender function, creates requests to redis
  */
@@ -307,64 +441,35 @@ void* dbBE_Redis_sender( void *args )
   int request_limit = DBBE_REDIS_COALESCED_MAX * dbBE_Redis_connection_mgr_get_connections( input->_backend->_conn_mgr );
 
   /*
-   * check server connections,
-   * fail requests only if situation is not recoverable
+   * check server connections; requests for uncovered slots get shelved
+   * while traffic to the remaining connections continues
    */
-  if( dbBE_Redis_locator_hash_covered( input->_backend->_locator ) == 0 )
-  {
-    dbBE_Redis_connection_recoverable_t recoverable = dbBE_Redis_connection_mgr_conn_recover(
-        input->_backend->_conn_mgr,
-        input->_backend->_locator,
-        &( input->_backend->_cluster_info ) );
-
-    switch( recoverable )
-    {
-      case DBBE_REDIS_CONNECTION_RECOVERABLE:  // recoverable but not yet recovered
-        goto skip_sending;
-        break;
-      case DBBE_REDIS_CONNECTION_RECOVERED: // recovered
-        // nothing to do, we're good to continue
-        break;
-      case DBBE_REDIS_CONNECTION_UNRECOVERABLE: // not recoverable at the moment
-        LOG(DBG_ERR, stderr, "Unrecoverable cluster connection. Completing all requests as failed.\n")
-        // intentionally no break
-      default: // unrecognized
-      {
-        // flush queues
-        dbBE_Redis_request_t *request;
-        while( ( request = dbBE_Redis_s2r_queue_pop( input->_backend->_retry_q )) != NULL )
-          dbBE_Redis_create_send_error( input->_backend->_compl_q, request, DBR_ERR_NOCONNECT );
-        return NULL;
-        break;
-      }
-    }
-  }
+  int covered = dbBE_Redis_sender_recover( input->_backend );
+  int shelf_open = (( covered != 0 ) &&
+      ( dbBE_Redis_event_mgr_timer_expired( input->_backend->_conn_mgr->_ev_mgr, DBBE_REDIS_TIMER_RETRY ) != 0 ));
 
   dbBE_Redis_request_t *request = NULL;
   int *pending_conn = input->_backend->_sender_connections;
 
   while(( --request_limit > 0 ) && ( pending_last < DBBE_REDIS_COALESCED_MAX * dbBE_Redis_connection_mgr_get_connections( input->_backend->_conn_mgr ) ))
   {
-    request = dbBE_Redis_sender_acquire_request( input->_backend );
+    request = dbBE_Redis_sender_acquire_request( input->_backend, shelf_open );
     if( request == NULL )
       break;
 
-    // find out which connection to use
-    dbBE_Redis_connection_t *conn = dbBE_Redis_sender_find_connection( input->_backend, request );
+    // find out which connection to use; without one, the request is already failed or shelved
+    dbBE_Redis_connection_t *conn = dbBE_Redis_sender_find_connection( input->_backend, request, covered );
     if( conn == NULL )
-    {
-      LOG( DBG_ERR, stderr, "Failed to get back-end connection.\n" );
+      continue;
 
-      // todo: might have to create completion (unless there are more sub-tasks in flight)
-      rc = -ENOMSG;
-      break;
-    }
-
-    if( ! dbBE_Redis_connection_RTS( conn ) )
+    // a request redirected by ASK gets a one-shot ASKING in front
+    if(( request->_flags & DBBE_REDIS_REQUEST_FLAG_ASKING ) != 0 )
     {
-      LOG( DBG_ERR, stderr, "Associated connection not ready to send\n" );
-      rc = -ENOTCONN;
-      break;
+      dbBE_sge_t *asking = dbBE_Transport_sge_buffer_get_current( conn->_cmd );
+      asking->iov_base = dbBE_Redis_asking_cmd;
+      asking->iov_len = DBBE_REDIS_ASKING_CMD_LEN;
+      dbBE_Transport_sge_buffer_add( conn->_cmd, 1 );
+      request->_flags |= DBBE_REDIS_REQUEST_FLAG_ASKING_SENT;
     }
 
     // create_command assembles an SGE list
@@ -398,7 +503,6 @@ void* dbBE_Redis_sender( void *args )
     }
   }
 
-skip_sending:
   // before triggering the receiver, do the post on all pending connections
   while( pending_last >= 0 )
   {
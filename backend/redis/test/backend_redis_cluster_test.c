@@ -0,0 +1,774 @@
+/*
+ * Copyright © 2020 IBM Corporation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+/*
+ * cluster behavior of the Redis backend against its own resp_srv instances
+ * each scenario starts a server with the topology it needs and controls it with SIM commands
+ */
+
+#include "test_utils.h"
+#include "../backend/common/dbbe_api.h"
+#include "../redis.h"
+#include "../locator.h"
+
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <netdb.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+
+#ifndef RESP_SRV_BIN
+#error "RESP_SRV_BIN needs to point to the resp_srv executable"
+#endif
+
+#define TEST_VALUE "CLUSTERVALUE"
+#define TEST_VALUE_LEN ( 12 )
+#define TEST_REQUESTS ( 6 )
+#define TEST_TIMEOUT_MS ( 10000 )
+
+typedef struct
+{
+  int _port;
+  int _nodes;
+  char _pidfile[ 64 ];
+} test_server_t;
+
+static inline
+int64_t test_now_ms()
+{
+  struct timespec ts;
+  clock_gettime( CLOCK_MONOTONIC, &ts );
+  return (int64_t)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+static
+int test_connect( const int port )
+{
+  char service[ 16 ];
+  snprintf( service, sizeof( service ), "%d", port );
+  struct addrinfo hints, *addrs = NULL;
+  memset( &hints, 0, sizeof( hints ) );
+  hints.ai_family = AF_INET;
+  hints.ai_socktype = SOCK_STREAM;
+  if( getaddrinfo( "127.0.0.1", service, &hints, &addrs ) != 0 )
+    return -1;
+  int fd = socket( addrs->ai_family, addrs->ai_socktype, addrs->ai_protocol );
+  if(( fd >= 0 ) && ( connect( fd, addrs->ai_addr, addrs->ai_addrlen ) != 0 ))
+  {
+    close( fd );
+    fd = -1;
+  }
+  freeaddrinfo( addrs );
+  return fd;
+}
+
+/*
+ * start resp_srv with the given extra options and wait until it accepts connections
+ */
+static
+int test_server_start( test_server_t *srv, const int nodes, const char *replicas )
+{
+  srv->_port = 20000 + ( getpid() % 1000 ) * 8;
+  srv->_nodes = nodes;
+  snprintf( srv->_pidfile, sizeof( srv->_pidfile ), "/tmp/dbbe_cluster_test_%d.pid", getpid() );
+
+  char port[ 16 ], count[ 16 ];
+  snprintf( port, sizeof( port ), "%d", srv->_port );
+  snprintf( count, sizeof( count ), "%d", nodes );
+  pid_t pid = fork();
+  if( pid == 0 )
+  {
+    execl( RESP_SRV_BIN, "resp_srv", "-d", "-P", srv->_pidfile, "-p", port, "-n", count, "-r", replicas, (char*)NULL );
+    _exit( 127 );
+  }
+  int status = 0;
+  if(( pid < 0 ) || ( waitpid( pid, &status, 0 ) != pid ) || ! WIFEXITED( status ) || ( WEXITSTATUS( status ) != 0 ))
+    return -1;
+
+  int64_t until = test_now_ms() + 2000;
+  while( test_now_ms() < until )
+  {
+    int fd = test_connect( srv->_port );
+    if( fd >= 0 )
+    {
+      close( fd );
+      return 0;
+    }
+    usleep( 10000 );
+  }
+  return -1;
+}
+
+static
+void test_server_stop( test_server_t *srv )
+{
+  pid_t pid = fork();
+  if( pid == 0 )
+  {
+    execl( RESP_SRV_BIN, "resp_srv", "-k", "-P", srv->_pidfile, (char*)NULL );
+    _exit( 127 );
+  }
+  if( pid > 0 )
+    waitpid( pid, NULL, 0 );
+}
+
+/*
+ * send a command to node 0 and return the reply (status line or bulk string data)
+ */
+static
+int test_server_command( test_server_t *srv, char *reply, const size_t space, const int argc, ... )
+{
+  char cmd[ 512 ];
+  int len = snprintf( cmd, sizeof( cmd ), "*%d\r\n", argc );
+  va_list args;
+  va_start( args, argc );
+  int n;
+  for( n = 0; n < argc; ++n )
+  {
+    const char *arg = va_arg( args, const char* );
+    len += snprintf( cmd + len, sizeof( cmd ) - len, "$%zu\r\n%s\r\n", strlen( arg ), arg );
+  }
+  va_end( args );
+
+  int fd = test_connect( srv->_port );
+  if( fd < 0 )
+    return -1;
+  if( send( fd, cmd, len, 0 ) != len )
+  {
+    close( fd );
+    return -1;
+  }
+
+  // a bulk reply is complete after its announced length, everything else after the first line
+  char buf[ 1024 ];
+  size_t got = 0;
+  int complete = 0;
+  while( ! complete && ( got < sizeof( buf ) - 1 ))
+  {
+    ssize_t r = recv( fd, buf + got, sizeof( buf ) - 1 - got, 0 );
+    if( r <= 0 )
+      break;
+    got += r;
+    buf[ got ] = '\0';
+    char *eol = strstr( buf, "\r\n" );
+    if( eol == NULL )
+      continue;
+    if( buf[0] != '$' )
+      complete = 1;
+    else
+      complete = ( got >= (size_t)( eol - buf ) + 2 + strtol( buf + 1, NULL, 10 ) + 2 );
+  }
+  close( fd );
+  if( ! complete )
+    return -1;
+
+  char *data = buf;
+  if( buf[0] == '$' )
+  {
+    data = strstr( buf, "\r\n" ) + 2;
+    data[ strtol( buf + 1, NULL, 10 ) ] = '\0';
+  }
+  else
+    *strstr( buf, "\r\n" ) = '\0';
+  snprintf( reply, space, "%s", data );
+  return ( buf[0] == '-' ) ? -1 : 0;
+}
+
+static
+int64_t test_server_stat( test_server_t *srv, const char *name )
+{
+  char stats[ 1024 ];
+  if( test_server_command( srv, stats, sizeof( stats ), 2, "SIM", "STATS" ) != 0 )
+    return -1;
+  char *entry = strstr( stats, name );
+  if(( entry == NULL ) || ( entry[ strlen( name ) ] != ':' ))
+    return -1;
+  return strtoll( entry + strlen( name ) + 1, NULL, 10 );
+}
+
+static
+int test_server_sim( test_server_t *srv, const char *what, const char *arg1, const char *arg2 )
+{
+  char reply[ 128 ];
+  if( arg2 != NULL )
+    return test_server_command( srv, reply, sizeof( reply ), 4, "SIM", what, arg1, arg2 );
+  return test_server_command( srv, reply, sizeof( reply ), 3, "SIM", what, arg1 );
+}
+
+static
+dbBE_Request_t* test_request( dbBE_Opcode opcode, dbBE_NS_Handle_t ns, const char *key, char *buf, const size_t len )
+{
+  dbBE_Request_t *req = (dbBE_Request_t*)calloc( 1, sizeof( dbBE_Request_t ) + sizeof( dbBE_sge_t ) );
+  req->_opcode = opcode;
+  req->_ns_hdl = ns;
+  req->_user = req;
+  req->_key = (char*)key;
+  req->_sge_count = ( buf != NULL ) ? 1 : 0;
+  req->_sge[0].iov_base = buf;
+  req->_sge[0].iov_len = len;
+  return req;
+}
+
+/*
+ * wait for the completions of count posted requests and check their status
+ * returns the number of requests that failed or didn't complete
+ */
+static
+int test_complete( dbBE_Handle_t BE, dbBE_Request_t **reqs, const int count, const DBR_Errorcode_t expect, int64_t *rcs )
+{
+  int remaining = count;
+  int failed = 0;
+  int64_t until = test_now_ms() + TEST_TIMEOUT_MS;
+  while(( remaining > 0 ) && ( test_now_ms() < until ))
+  {
+    dbBE_Completion_t *comp = dbBE.test_any( BE );
+    if( comp == NULL )
+      continue;
+    int n;
+    for( n = 0; n < count; ++n )
+      if( comp->_user == reqs[ n ] )
+      {
+        if( rcs != NULL )
+          rcs[ n ] = comp->_rc;
+        if( comp->_status != expect )
+        {
+          LOG( DBG_ERR, stderr, "request %d completed with %d, expected %d\n", n, comp->_status, expect );
+          ++failed;
+        }
+        --remaining;
+      }
+    free( comp );
+  }
+  return failed + remaining;
+}
+
+static
+DBR_Errorcode_t test_execute( dbBE_Handle_t BE, dbBE_Request_t *req, int64_t *rc )
+{
+  if( dbBE.post( BE, req, 0 ) == NULL )
+    return DBR_ERR_BE_POST;
+  int64_t until = test_now_ms() + TEST_TIMEOUT_MS;
+  while( test_now_ms() < until )
+  {
+    dbBE_Completion_t *comp = dbBE.test_any( BE );
+    if( comp == NULL )
+      continue;
+    DBR_Errorcode_t status = comp->_status;
+    if( rc != NULL )
+      *rc = comp->_rc;
+    free( comp );
+    return status;
+  }
+  return DBR_ERR_TIMEOUT;
+}
+
+static
+dbBE_NS_Handle_t test_nscreate( dbBE_Handle_t BE, const char *name )
+{
+  int64_t handle = 0;
+  dbBE_Request_t *req = test_request( DBBE_OPCODE_NSCREATE, NULL, name, NULL, 0 );
+  DBR_Errorcode_t rc = test_execute( BE, req, &handle );
+  free( req );
+  return ( rc == DBR_SUCCESS ) ? (dbBE_NS_Handle_t)handle : NULL;
+}
+
+static
+int test_nsdelete( dbBE_Handle_t BE, dbBE_NS_Handle_t ns )
+{
+  dbBE_Request_t *req = test_request( DBBE_OPCODE_NSDELETE, ns, NULL, NULL, 0 );
+  DBR_Errorcode_t rc = test_execute( BE, req, NULL );
+  free( req );
+  return rc;
+}
+
+static
+int test_put( dbBE_Handle_t BE, dbBE_NS_Handle_t ns, const char *key )
+{
+  dbBE_Request_t *req = test_request( DBBE_OPCODE_PUT, ns, key, TEST_VALUE, TEST_VALUE_LEN );
+  DBR_Errorcode_t rc = test_execute( BE, req, NULL );
+  free( req );
+  return rc;
+}
+
+/*
+ * post count reads of the same key at once and check that all of them return the value
+ */
+static
+int test_reads( dbBE_Handle_t BE, dbBE_NS_Handle_t ns, const char *key, const int count )
+{
+  int rc = 0;
+  dbBE_Request_t *reqs[ count ];
+  char bufs[ count ][ 32 ];
+  int64_t sizes[ count ];
+  int n;
+  for( n = 0; n < count; ++n )
+  {
+    memset( bufs[ n ], 0, 32 );
+    reqs[ n ] = test_request( DBBE_OPCODE_READ, ns, key, bufs[ n ], 32 );
+    rc += TEST_NOT( dbBE.post( BE, reqs[ n ], 0 ), NULL );
+  }
+  rc += TEST( test_complete( BE, reqs, count, DBR_SUCCESS, sizes ), 0 );
+  for( n = 0; n < count; ++n )
+  {
+    rc += TEST( sizes[ n ], TEST_VALUE_LEN );
+    rc += TEST( memcmp( bufs[ n ], TEST_VALUE, TEST_VALUE_LEN ), 0 );
+    free( reqs[ n ] );
+  }
+  return rc;
+}
+
+/*
+ * slot and owner of a key in an evenly split cluster
+ */
+static
+int test_key_owner( test_server_t *srv, const char *ns_name, const char *key, char *slot, const size_t space )
+{
+  char fullkey[ 256 ];
+  int len = snprintf( fullkey, sizeof( fullkey ), "%s%s%s", ns_name, DBBE_REDIS_NAMESPACE_SEPARATOR, key );
+  dbBE_Redis_hash_slot_t s = dbBE_Redis_locator_hash( fullkey, len );
+  snprintf( slot, space, "%d", s );
+  return s / ( ( DBBE_REDIS_HASH_SLOT_MAX + srv->_nodes - 1 ) / srv->_nodes );
+}
+
+/*
+ * find a key of the namespace that's owned by node
+ */
+static
+void test_key_of_node( test_server_t *srv, const char *ns_name, const int node, char *key, const size_t space )
+{
+  char slot[ 16 ];
+  int n = 0;
+  do
+    snprintf( key, space, "key%d", n++ );
+  while( test_key_owner( srv, ns_name, key, slot, sizeof( slot ) ) != node );
+}
+
+/*
+ * post one read for each key and return the requests
+ */
+static
+int test_post_reads( dbBE_Handle_t BE, dbBE_NS_Handle_t ns, char keys[][ 16 ], const int count,
+                     dbBE_Request_t **reqs, char bufs[][ 32 ] )
+{
+  int rc = 0;
+  int n;
+  for( n = 0; n < count; ++n )
+  {
+    memset( bufs[ n ], 0, 32 );
+    reqs[ n ] = test_request( DBBE_OPCODE_READ, ns, keys[ n ], bufs[ n ], 32 );
+    rc += TEST_NOT( dbBE.post( BE, reqs[ n ], 0 ), NULL );
+  }
+  return rc;
+}
+
+static
+void test_free_requests( dbBE_Request_t **reqs, const int count )
+{
+  int n;
+  for( n = 0; n < count; ++n )
+    free( reqs[ n ] );
+}
+
+/*
+ * reads round-robin between masters and READONLY replicas, fall back to the master
+ * on redirects, and survive a replica connection that drops with reads in flight
+ */
+static
+int test_replica_reads()
+{
+  int rc = 0;
+  test_server_t srv;
+  rc += TEST( test_server_start( &srv, 2, "1" ), 0 );
+  TEST_BREAK( rc, "Server start failed" );
+
+  char url[ 64 ];
+  snprintf( url, sizeof( url ), "sock://localhost:%d", srv._port );
+  setenv( DBR_SERVER_HOST_ENV, url, 1 );
+  setenv( DBR_SERVER_READ_REPLICAS_ENV, "1", 1 );
+  setenv( DBR_SERVER_READ_YOUR_WRITES_ENV, "OTHER,RYW", 1 );
+
+  dbBE_Handle_t BE = NULL;
+  dbBE_NS_Handle_t ns = NULL;
+  dbBE_NS_Handle_t ryw = NULL;
+  rc += TEST_NOT_RC( dbBE.initialize(), NULL, BE );
+  if( BE != NULL )
+  {
+    rc += TEST_NOT_RC( test_nscreate( BE, "REPL" ), NULL, ns );
+    rc += TEST_NOT_RC( test_nscreate( BE, "RYW" ), NULL, ryw );
+  }
+  if( rc != 0 )
+  {
+    test_server_stop( &srv );
+    TEST_BREAK( rc, "Backend setup failed" );
+  }
+
+  rc += TEST( test_put( BE, ns, "key" ), DBR_SUCCESS );
+  rc += TEST( test_put( BE, ryw, "key" ), DBR_SUCCESS );
+
+  // every other read of a slot goes to its replica
+  int64_t replica_reads = test_server_stat( &srv, "replica_reads" );
+  rc += TEST( test_reads( BE, ns, "key", 8 ), 0 );
+  rc += TEST( test_server_stat( &srv, "replica_reads" ), replica_reads + 4 );
+
+  // read-your-writes namespaces stay with the masters
+  replica_reads = test_server_stat( &srv, "replica_reads" );
+  rc += TEST( test_reads( BE, ryw, "key", 8 ), 0 );
+  rc += TEST( test_server_stat( &srv, "replica_reads" ), replica_reads );
+  TEST_LOG( rc, "Round robin" );
+
+  // after a slot moved, master and replica answer with MOVED; the reads follow to the new owner
+  char slot[ 16 ], node[ 16 ];
+  int owner = test_key_owner( &srv, "REPL", "key", slot, sizeof( slot ) );
+  snprintf( node, sizeof( node ), "%d", 1 - owner );
+  int64_t moved = test_server_stat( &srv, "moved" );
+  rc += TEST( test_server_sim( &srv, "MIGRATE", slot, node ), 0 );
+  rc += TEST( test_reads( BE, ns, "key", 4 ), 0 );
+  rc += TEST( test_server_stat( &srv, "moved" ) > moved, 1 );
+  snprintf( node, sizeof( node ), "%d", owner );
+  rc += TEST( test_server_sim( &srv, "MIGRATE", slot, node ), 0 );
+  rc += TEST( test_reads( BE, ns, "key", 4 ), 0 );
+  TEST_LOG( rc, "MOVED from replica" );
+
+  // replica connection breaks while reads are waiting for their responses
+  dbBE_Request_t *reqs[ TEST_REQUESTS ];
+  char bufs[ TEST_REQUESTS ][ 32 ];
+  int64_t sizes[ TEST_REQUESTS ];
+  int n;
+  rc += TEST( test_server_sim( &srv, "LATENCY", "100000", NULL ), 0 );
+  for( n = 0; n < TEST_REQUESTS; ++n )
+  {
+    memset( bufs[ n ], 0, 32 );
+    reqs[ n ] = test_request( DBBE_OPCODE_READ, ns, "key", bufs[ n ], 32 );
+    rc += TEST_NOT( dbBE.post( BE, reqs[ n ], 0 ), NULL );
+  }
+  // get the requests out before the replica goes away
+  int64_t until = test_now_ms() + 20;
+  while( test_now_ms() < until )
+    rc += TEST( dbBE.test_any( BE ), NULL );
+  rc += TEST( test_server_sim( &srv, "DROP", node, NULL ), 0 );
+  rc += TEST( test_complete( BE, reqs, TEST_REQUESTS, DBR_SUCCESS, sizes ), 0 );
+  for( n = 0; n < TEST_REQUESTS; ++n )
+  {
+    rc += TEST( sizes[ n ], TEST_VALUE_LEN );
+    rc += TEST( memcmp( bufs[ n ], TEST_VALUE, TEST_VALUE_LEN ), 0 );
+    free( reqs[ n ] );
+  }
+  rc += TEST( test_server_sim( &srv, "LATENCY", "0", NULL ), 0 );
+
+  // the master serves all reads of the slot now
+  replica_reads = test_server_stat( &srv, "replica_reads" );
+  rc += TEST( test_reads( BE, ns, "key", 4 ), 0 );
+  rc += TEST( test_server_stat( &srv, "replica_reads" ), replica_reads );
+  TEST_LOG( rc, "Replica dropped" );
+
+  rc += TEST( test_nsdelete( BE, ryw ), DBR_SUCCESS );
+  rc += TEST( test_nsdelete( BE, ns ), DBR_SUCCESS );
+  rc += TEST( dbBE.exit( BE ), 0 );
+  test_server_stop( &srv );
+
+  unsetenv( DBR_SERVER_READ_REPLICAS_ENV );
+  unsetenv( DBR_SERVER_READ_YOUR_WRITES_ENV );
+  return rc;
+}
+
+/*
+ * a master goes down: requests for its slots wait on the shelf while the other nodes keep serving,
+ * get replayed once it's back, and fail after the reconnect timeout; CLUSTERDOWN responses get retried with a backoff
+ */
+static
+int test_node_down()
+{
+  int rc = 0;
+  test_server_t srv;
+  rc += TEST( test_server_start( &srv, 3, "0" ), 0 );
+  TEST_BREAK( rc, "Server start failed" );
+
+  char url[ 64 ];
+  snprintf( url, sizeof( url ), "sock://localhost:%d", srv._port );
+  setenv( DBR_SERVER_HOST_ENV, url, 1 );
+
+  dbBE_Handle_t BE = NULL;
+  dbBE_NS_Handle_t ns = NULL;
+  rc += TEST_NOT_RC( dbBE.initialize(), NULL, BE );
+  if( BE != NULL )
+    rc += TEST_NOT_RC( test_nscreate( BE, "DOWN" ), NULL, ns );
+  if( rc != 0 )
+  {
+    test_server_stop( &srv );
+    TEST_BREAK( rc, "Backend setup failed" );
+  }
+
+  // one key per node; node 1 goes down (node 0 takes the SIM commands)
+  char keys[ 3 ][ 16 ];
+  int n;
+  for( n = 0; n < 3; ++n )
+  {
+    test_key_of_node( &srv, "DOWN", n, keys[ n ], sizeof( keys[ n ] ) );
+    rc += TEST( test_put( BE, ns, keys[ n ] ), DBR_SUCCESS );
+  }
+  char up_keys[ 2 ][ 16 ];
+  strcpy( up_keys[ 0 ], keys[ 0 ] );
+  strcpy( up_keys[ 1 ], keys[ 2 ] );
+
+  dbBE_Request_t *down_reqs[ TEST_REQUESTS ];
+  char down_bufs[ TEST_REQUESTS ][ 32 ];
+  char down_keys[ TEST_REQUESTS ][ 16 ];
+  for( n = 0; n < TEST_REQUESTS; ++n )
+    strcpy( down_keys[ n ], keys[ 1 ] );
+  dbBE_Request_t *up_reqs[ 2 ];
+  char up_bufs[ 2 ][ 32 ];
+
+  // short outage: the shelf gets replayed after recovery
+  rc += TEST( test_server_sim( &srv, "DOWN", "1", "1500" ), 0 );
+  int64_t start = test_now_ms();
+  rc += test_post_reads( BE, ns, down_keys, TEST_REQUESTS, down_reqs, down_bufs );
+  rc += test_post_reads( BE, ns, up_keys, 2, up_reqs, up_bufs );
+  rc += TEST( test_complete( BE, up_reqs, 2, DBR_SUCCESS, NULL ), 0 );
+  rc += TEST( test_now_ms() - start < 1500, 1 );
+  test_free_requests( up_reqs, 2 );
+  rc += TEST( test_complete( BE, down_reqs, TEST_REQUESTS, DBR_SUCCESS, NULL ), 0 );
+  rc += TEST( test_now_ms() - start >= 1500, 1 );
+  for( n = 0; n < TEST_REQUESTS; ++n )
+    rc += TEST( memcmp( down_bufs[ n ], TEST_VALUE, TEST_VALUE_LEN ), 0 );
+  test_free_requests( down_reqs, TEST_REQUESTS );
+  rc += TEST( test_reads( BE, ns, keys[ 1 ], 2 ), 0 );
+  TEST_LOG( rc, "Shelf replay" );
+
+  // outage beyond the reconnect timeout: only the shelved requests fail
+  rc += TEST( test_server_sim( &srv, "DOWN", "1", "7000" ), 0 );
+  start = test_now_ms();
+  rc += test_post_reads( BE, ns, down_keys, TEST_REQUESTS, down_reqs, down_bufs );
+  rc += test_post_reads( BE, ns, up_keys, 2, up_reqs, up_bufs );
+  rc += TEST( test_complete( BE, up_reqs, 2, DBR_SUCCESS, NULL ), 0 );
+  test_free_requests( up_reqs, 2 );
+  rc += TEST( test_complete( BE, down_reqs, TEST_REQUESTS, DBR_ERR_NOCONNECT, NULL ), 0 );
+  rc += TEST( test_now_ms() - start < 7000, 1 );
+  test_free_requests( down_reqs, TEST_REQUESTS );
+  rc += TEST( test_reads( BE, ns, keys[ 0 ], 2 ), 0 );
+  rc += TEST( test_reads( BE, ns, keys[ 2 ], 2 ), 0 );
+
+  // the node gets picked up again once it's back
+  while( test_now_ms() - start < 7000 )
+    usleep( 100000 );
+  int64_t until = test_now_ms() + TEST_TIMEOUT_MS;
+  DBR_Errorcode_t status = DBR_ERR_NOCONNECT;
+  while(( status == DBR_ERR_NOCONNECT ) && ( test_now_ms() < until ))
+  {
+    dbBE_Request_t *req = test_request( DBBE_OPCODE_READ, ns, keys[ 1 ], down_bufs[ 0 ], 32 );
+    status = test_execute( BE, req, NULL );
+    free( req );
+  }
+  rc += TEST( status, DBR_SUCCESS );
+  TEST_LOG( rc, "Unrecoverable" );
+
+  // CLUSTERDOWN: requests wait with a backoff instead of hammering the cluster
+  rc += TEST( test_server_sim( &srv, "INJECT", "CLUSTERDOWN", "1" ), 0 );
+  int64_t clusterdown = test_server_stat( &srv, "clusterdown" );
+  rc += test_post_reads( BE, ns, down_keys, TEST_REQUESTS, down_reqs, down_bufs );
+  until = test_now_ms() + 300;
+  while( test_now_ms() < until )
+  {
+    rc += TEST( dbBE.test_any( BE ), NULL );
+    usleep( 1000 );
+  }
+  rc += TEST( test_server_stat( &srv, "clusterdown" ) - clusterdown < 100, 1 );
+  rc += TEST( test_server_sim( &srv, "INJECT", "CLUSTERDOWN", "0" ), 0 );
+  rc += TEST( test_complete( BE, down_reqs, TEST_REQUESTS, DBR_SUCCESS, NULL ), 0 );
+  test_free_requests( down_reqs, TEST_REQUESTS );
+  TEST_LOG( rc, "CLUSTERDOWN backoff" );
+
+  rc += TEST( test_nsdelete( BE, ns ), DBR_SUCCESS );
+  rc += TEST( dbBE.exit( BE ), 0 );
+  test_server_stop( &srv );
+  return rc;
+}
+
+/*
+ * several connections per node: requests get striped by slot and keep their order per key,
+ * small requests complete while a large value is in flight
+ */
+static
+int test_pooled()
+{
+  int rc = 0;
+  test_server_t srv;
+  rc += TEST( test_server_start( &srv, 2, "0" ), 0 );
+  TEST_BREAK( rc, "Server start failed" );
+
+  char url[ 64 ];
+  snprintf( url, sizeof( url ), "sock://localhost:%d", srv._port );
+  setenv( DBR_SERVER_HOST_ENV, url, 1 );
+  setenv( DBR_SERVER_CONNECTIONS_ENV, "3", 1 );
+
+  int64_t connections = test_server_stat( &srv, "connections" );
+  dbBE_Handle_t BE = NULL;
+  dbBE_NS_Handle_t ns = NULL;
+  rc += TEST_NOT_RC( dbBE.initialize(), NULL, BE );
+  if( BE != NULL )
+    rc += TEST_NOT_RC( test_nscreate( BE, "POOL" ), NULL, ns );
+  if( rc != 0 )
+  {
+    test_server_stop( &srv );
+    TEST_BREAK( rc, "Backend setup failed" );
+  }
+  // initial connection, 2 masters with 2 more connections each, and the stats query
+  rc += TEST( test_server_stat( &srv, "connections" ) - connections >= 7, 1 );
+
+  // put two values and get both of them all at once; the gets see the values in order
+  char keys[ TEST_REQUESTS ][ 16 ];
+  char values[ 2 ][ TEST_VALUE_LEN + 1 ] = { "FIRSTVALUE00", TEST_VALUE };
+  dbBE_Request_t *reqs[ 4 * TEST_REQUESTS ];
+  char bufs[ 2 * TEST_REQUESTS ][ 32 ];
+  int n;
+  for( n = 0; n < TEST_REQUESTS; ++n )
+  {
+    snprintf( keys[ n ], sizeof( keys[ n ] ), "key%d", n );
+    memset( bufs[ 2 * n ], 0, 32 );
+    memset( bufs[ 2 * n + 1 ], 0, 32 );
+    reqs[ 4 * n ] = test_request( DBBE_OPCODE_PUT, ns, keys[ n ], values[ 0 ], TEST_VALUE_LEN );
+    reqs[ 4 * n + 1 ] = test_request( DBBE_OPCODE_PUT, ns, keys[ n ], values[ 1 ], TEST_VALUE_LEN );
+    reqs[ 4 * n + 2 ] = test_request( DBBE_OPCODE_GET, ns, keys[ n ], bufs[ 2 * n ], 32 );
+    reqs[ 4 * n + 3 ] = test_request( DBBE_OPCODE_GET, ns, keys[ n ], bufs[ 2 * n + 1 ], 32 );
+  }
+  for( n = 0; n < 4 * TEST_REQUESTS; ++n )
+    rc += TEST_NOT( dbBE.post( BE, reqs[ n ], 0 ), NULL );
+  rc += TEST( test_complete( BE, reqs, 4 * TEST_REQUESTS, DBR_SUCCESS, NULL ), 0 );
+  for( n = 0; n < TEST_REQUESTS; ++n )
+  {
+    rc += TEST( memcmp( bufs[ 2 * n ], values[ 0 ], TEST_VALUE_LEN ), 0 );
+    rc += TEST( memcmp( bufs[ 2 * n + 1 ], values[ 1 ], TEST_VALUE_LEN ), 0 );
+  }
+  test_free_requests( reqs, 4 * TEST_REQUESTS );
+  TEST_LOG( rc, "Ordered per key" );
+
+  // a large value on one connection of a node doesn't hold up the requests of other slots of that node
+  size_t large_len = 64 * 1024 * 1024;
+  char *large = (char*)malloc( large_len );
+  rc += TEST_NOT( large, NULL );
+  if( large != NULL )
+  {
+    memset( large, 'L', large_len );
+    rc += TEST( test_put( BE, ns, keys[ 0 ] ), DBR_SUCCESS );
+    dbBE_Request_t *large_req = test_request( DBBE_OPCODE_PUT, ns, "large", large, large_len );
+    rc += TEST_NOT( dbBE.post( BE, large_req, 0 ), NULL );
+    rc += test_reads( BE, ns, keys[ 0 ], 4 );
+    rc += TEST( test_complete( BE, &large_req, 1, DBR_SUCCESS, NULL ), 0 );
+    free( large_req );
+    free( large );
+  }
+  TEST_LOG( rc, "Large value" );
+
+  rc += TEST( test_nsdelete( BE, ns ), DBR_SUCCESS );
+  rc += TEST( dbBE.exit( BE ), 0 );
+  test_server_stop( &srv );
+
+  unsetenv( DBR_SERVER_CONNECTIONS_ENV );
+  return rc;
+}
+
+/*
+ * RESP3 after HELLO 3: maps and nulls in place of arrays and nil strings,
+ * and invalidation push frames in front of the responses
+ */
+static
+int test_resp3()
+{
+  int rc = 0;
+  test_server_t srv;
+  rc += TEST( test_server_start( &srv, 2, "0" ), 0 );
+  TEST_BREAK( rc, "Server start failed" );
+
+  char url[ 64 ];
+  snprintf( url, sizeof( url ), "sock://localhost:%d", srv._port );
+  setenv( DBR_SERVER_HOST_ENV, url, 1 );
+  setenv( DBR_SERVER_PROTOCOL_ENV, "3", 1 );
+
+  dbBE_Handle_t BE = NULL;
+  dbBE_NS_Handle_t ns = NULL;
+  rc += TEST_NOT_RC( dbBE.initialize(), NULL, BE );
+  if( BE != NULL )
+    rc += TEST_NOT_RC( test_nscreate( BE, "RESP3" ), NULL, ns );
+  if( rc != 0 )
+  {
+    test_server_stop( &srv );
+    TEST_BREAK( rc, "Backend setup failed" );
+  }
+
+  // every 3rd keyed response comes with a push frame in front of it
+  rc += TEST( test_server_sim( &srv, "INJECT", "PUSH", "3" ), 0 );
+
+  char keys[ TEST_REQUESTS ][ 16 ];
+  dbBE_Request_t *reqs[ 2 * TEST_REQUESTS ];
+  char bufs[ TEST_REQUESTS ][ 32 ];
+  int n;
+  for( n = 0; n < TEST_REQUESTS; ++n )
+  {
+    snprintf( keys[ n ], sizeof( keys[ n ] ), "key%d", n );
+    memset( bufs[ n ], 0, 32 );
+    reqs[ 2 * n ] = test_request( DBBE_OPCODE_PUT, ns, keys[ n ], TEST_VALUE, TEST_VALUE_LEN );
+    reqs[ 2 * n + 1 ] = test_request( DBBE_OPCODE_GET, ns, keys[ n ], bufs[ n ], 32 );
+  }
+  for( n = 0; n < 2 * TEST_REQUESTS; ++n )
+    rc += TEST_NOT( dbBE.post( BE, reqs[ n ], 0 ), NULL );
+  rc += TEST( test_complete( BE, reqs, 2 * TEST_REQUESTS, DBR_SUCCESS, NULL ), 0 );
+  for( n = 0; n < TEST_REQUESTS; ++n )
+    rc += TEST( memcmp( bufs[ n ], TEST_VALUE, TEST_VALUE_LEN ), 0 );
+  test_free_requests( reqs, 2 * TEST_REQUESTS );
+  rc += TEST( test_server_stat( &srv, "pushes" ) >= TEST_REQUESTS / 2, 1 );
+  TEST_LOG( rc, "Push frames" );
+
+  // RESP3 null of a missing key
+  char buf[ 256 ];
+  dbBE_Request_t *req = test_request( DBBE_OPCODE_READ, ns, "missing", buf, sizeof( buf ) );
+  req->_flags = DBR_FLAGS_NOWAIT;
+  rc += TEST( test_execute( BE, req, NULL ), DBR_ERR_UNAVAIL );
+  free( req );
+
+  // namespace meta data comes as a map
+  memset( buf, 0, sizeof( buf ) );
+  req = test_request( DBBE_OPCODE_NSQUERY, ns, NULL, buf, sizeof( buf ) );
+  rc += TEST( test_execute( BE, req, NULL ), DBR_SUCCESS );
+  rc += TEST_NOT( strstr( buf, "RESP3" ), NULL );
+  free( req );
+  TEST_LOG( rc, "Typed replies" );
+
+  rc += TEST( test_server_sim( &srv, "INJECT", "PUSH", "0" ), 0 );
+  rc += TEST( test_nsdelete( BE, ns ), DBR_SUCCESS );
+  rc += TEST( dbBE.exit( BE ), 0 );
+  test_server_stop( &srv );
+
+  unsetenv( DBR_SERVER_PROTOCOL_ENV );
+  return rc;
+}
+
+int main( int argc, char ** argv )
+{
+  int rc = 0;
+
+  setenv( DBR_SERVER_AUTHFILE_ENV, "NONE", 1 );
+  rc += test_replica_reads();
+  rc += test_node_down();
+  rc += test_pooled();
+  rc += test_resp3();
+
+  printf( "Test exiting with rc=%d\n", rc );
+  return rc;
+}
@@ -22,6 +22,7 @@
 #include <malloc.h>
 #endif
 #include <string.h>
+#include <unistd.h>
 
 #include <sys/time.h>      // rlimit
 #include <sys/resource.h>  // rlimit
@@ -75,6 +76,113 @@ int test_request_each( dbBE_Redis_connection_mgr_t *conn_mgr )
 }
 
 
+/*
+ * reads of a master round-robin across its ready replica connections and the master itself
+ */
+int test_get_reader( dbBE_Redis_connection_mgr_t *mgr,
+                     dbBE_Redis_connection_t *master,
+                     dbBE_Redis_connection_t *r1,
+                     dbBE_Redis_connection_t *r2 )
+{
+  int rc = 0;
+  int64_t count = dbBE_Redis_connection_mgr_get_connections( mgr );
+
+  rc += TEST( dbBE_Redis_connection_mgr_get_reader( mgr, master ), master );
+  rc += TEST( dbBE_Redis_connection_mgr_add_reader( mgr, r1, master ), 0 );
+  rc += TEST( dbBE_Redis_connection_mgr_add_reader( mgr, r2, master ), 0 );
+  rc += TEST( dbBE_Redis_connection_is_reader( r1 ), 1 );
+  rc += TEST( r1->_primary, master->_index );
+
+  int n;
+  for( n = 0; n < 2; ++n )
+  {
+    rc += TEST( dbBE_Redis_connection_mgr_get_reader( mgr, master ), r1 );
+    rc += TEST( dbBE_Redis_connection_mgr_get_reader( mgr, master ), r2 );
+    rc += TEST( dbBE_Redis_connection_mgr_get_reader( mgr, master ), master );
+  }
+
+  // a replica that isn't ready leaves its turn to the master
+  dbBE_Connection_status_t status = r2->_status;
+  r2->_status = DBBE_CONNECTION_STATUS_DISCONNECTED;
+  rc += TEST( dbBE_Redis_connection_mgr_get_reader( mgr, master ), r1 );
+  rc += TEST( dbBE_Redis_connection_mgr_get_reader( mgr, master ), master );
+  rc += TEST( dbBE_Redis_connection_mgr_get_reader( mgr, master ), master );
+  r2->_status = status;
+
+  // replica reads disabled
+  ((dbBE_Redis_conn_mgr_config_t*)mgr->_config)->_read_replicas = 0;
+  rc += TEST( dbBE_Redis_connection_mgr_get_reader( mgr, master ), master );
+  rc += TEST( dbBE_Redis_connection_mgr_get_reader( mgr, master ), master );
+  ((dbBE_Redis_conn_mgr_config_t*)mgr->_config)->_read_replicas = 1;
+
+  // removing a reader takes it out of the rotation and the mgr; put it back as a regular connection
+  rc += TEST( dbBE_Redis_connection_mgr_rm_reader( mgr, r1 ), 0 );
+  rc += TEST( dbBE_Redis_connection_is_reader( r1 ), 0 );
+  rc += TEST( dbBE_Redis_connection_mgr_rm_reader( mgr, r1 ), -EINVAL );
+  for( n = 0; n < 4; ++n )
+    rc += TEST( dbBE_Redis_connection_mgr_get_reader( mgr, master ), ( n % 2 == 0 ) ? master : r2 );
+  rc += TEST( dbBE_Redis_connection_mgr_rm_reader( mgr, r2 ), 0 );
+  rc += TEST( dbBE_Redis_connection_mgr_get_reader( mgr, master ), master );
+
+  rc += TEST( dbBE_Redis_connection_mgr_get_connections( mgr ), count - 2 );
+  rc += TEST( dbBE_Redis_connection_mgr_add( mgr, r1 ), 0 );
+  rc += TEST( dbBE_Redis_connection_mgr_add( mgr, r2 ), 0 );
+  rc += TEST( dbBE_Redis_connection_mgr_get_connections( mgr ), count );
+
+  TEST_LOG( rc, "get_reader" );
+  return rc;
+}
+
+/*
+ * requests of a master get striped across its pool by slot; the same slot always picks the same connection
+ */
+int test_get_pooled( dbBE_Redis_connection_mgr_t *mgr,
+                     dbBE_Redis_connection_t *master,
+                     dbBE_Redis_connection_t *p1,
+                     dbBE_Redis_connection_t *p2 )
+{
+  int rc = 0;
+  int64_t count = dbBE_Redis_connection_mgr_get_connections( mgr );
+
+  rc += TEST( dbBE_Redis_connection_mgr_get_pooled( mgr, master, 1 ), master );
+  rc += TEST( dbBE_Redis_connection_mgr_add_pooled( mgr, p1, master ), 0 );
+  rc += TEST( dbBE_Redis_connection_mgr_add_pooled( mgr, p2, master ), 0 );
+  rc += TEST( dbBE_Redis_connection_is_pooled( p1 ), 1 );
+  rc += TEST( dbBE_Redis_connection_is_reader( p1 ), 0 );
+  rc += TEST( dbBE_Redis_connection_is_secondary( p1 ), 1 );
+  rc += TEST( p1->_primary, master->_index );
+
+  int n;
+  for( n = 0; n < 6; ++n )
+    rc += TEST( dbBE_Redis_connection_mgr_get_pooled( mgr, master, n ), ( n % 3 == 0 ) ? p1 : ( n % 3 == 1 ) ? p2 : master );
+  rc += TEST( dbBE_Redis_connection_mgr_get_pooled( mgr, master, 4711 ), dbBE_Redis_connection_mgr_get_pooled( mgr, master, 4711 ) );
+
+  // pooled connections are no masters and don't serve reads of replicas
+  rc += TEST( dbBE_Redis_connection_mgr_next_master( mgr, p1->_index - 1 ) == p1, 0 );
+  rc += TEST( dbBE_Redis_connection_mgr_get_reader( mgr, master ), master );
+
+  // a connection that isn't ready leaves its slots to the master
+  dbBE_Connection_status_t status = p2->_status;
+  p2->_status = DBBE_CONNECTION_STATUS_DISCONNECTED;
+  rc += TEST( dbBE_Redis_connection_mgr_get_pooled( mgr, master, 1 ), master );
+  p2->_status = status;
+
+  rc += TEST( dbBE_Redis_connection_mgr_rm_reader( mgr, p1 ), 0 );
+  rc += TEST( dbBE_Redis_connection_is_pooled( p1 ), 0 );
+  rc += TEST( dbBE_Redis_connection_mgr_get_pooled( mgr, master, 0 ), p2 );
+  rc += TEST( dbBE_Redis_connection_mgr_get_pooled( mgr, master, 1 ), master );
+  rc += TEST( dbBE_Redis_connection_mgr_rm_reader( mgr, p2 ), 0 );
+  rc += TEST( dbBE_Redis_connection_mgr_get_pooled( mgr, master, 0 ), master );
+
+  rc += TEST( dbBE_Redis_connection_mgr_get_connections( mgr ), count - 2 );
+  rc += TEST( dbBE_Redis_connection_mgr_add( mgr, p1 ), 0 );
+  rc += TEST( dbBE_Redis_connection_mgr_add( mgr, p2 ), 0 );
+  rc += TEST( dbBE_Redis_connection_mgr_get_connections( mgr ), count );
+
+  TEST_LOG( rc, "get_pooled" );
+  return rc;
+}
+
 int main( int argc, char ** argv )
 {
   int rc = 0;
@@ -109,7 +217,9 @@ int main( int argc, char ** argv )
   LOG( DBG_ALL, stdout, "Connections limited to #%"PRId64"\n", flimit );
 
   dbBE_Redis_conn_mgr_config_t config;
+  memset( &config, 0, sizeof( config ) );
   config._rbuf_len = 16384;
+  config._read_replicas = 1;
 
   rc += TEST_NOT_RC( dbBE_Redis_locator_create(), NULL, locator );
   rc += TEST( dbBE_Redis_connection_mgr_init( NULL ), NULL );
@@ -182,6 +292,8 @@ int main( int argc, char ** argv )
   rc += TEST( dbBE_Redis_connection_mgr_get_connections( mgr ), flimit );
 
   rc += test_request_each( mgr );
+  rc += test_get_reader( mgr, carray[ 0 ], carray[ 1 ], carray[ 2 ] );
+  rc += test_get_pooled( mgr, carray[ 0 ], carray[ 1 ], carray[ 2 ] );
 
   // try to add one more and fail
   dbBE_Redis_connection_t *conn2 = dbBE_Redis_connection_create( DBBE_REDIS_SR_BUFFER_LEN );
@@ -211,7 +323,19 @@ int main( int argc, char ** argv )
   dbBE_Redis_connection_t *dconn = carray[ 10 ];
   rc += TEST( dbBE_Redis_connection_assign_slot_range( dconn, 0, DBBE_REDIS_HASH_SLOT_MAX - 1 ), 0 );
   rc += TEST( dbBE_Redis_connection_mgr_conn_fail( mgr, dconn ), 0 );
-  rc += TEST( dbBE_Redis_connection_mgr_conn_recover( mgr, locator, &cluster ), DBBE_REDIS_CONNECTION_RECOVERED );
+  int didx = dconn->_index;
+  dbBE_Redis_connection_recoverable_t recoverable = DBBE_REDIS_CONNECTION_RECOVERABLE;
+  // recovery links up in the background; the event loop completes the links
+  for( i = 0; ( i < 1000 ) && ( recoverable == DBBE_REDIS_CONNECTION_RECOVERABLE ); ++i )
+  {
+    recoverable = dbBE_Redis_connection_mgr_conn_recover( mgr, locator, &cluster );
+    dbBE_Redis_connection_mgr_get_active( mgr, 0 );
+    usleep( 1000 );
+  }
+  rc += TEST( recoverable, DBBE_REDIS_CONNECTION_RECOVERED );
+  // the replacement took over the index and the failed connection is gone
+  rc += TEST_NOT_RC( dbBE_Redis_connection_mgr_get_connection_at( mgr, didx ), NULL, carray[ 10 ] );
+  rc += TEST_NOT( carray[ 10 ], dconn );
 
 
   // remove all connections
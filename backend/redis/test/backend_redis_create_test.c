@@ -66,6 +66,10 @@ int key_creation_test()
 
   int rc = 0;
   char *reference = (char*)malloc(DBBE_REDIS_MAX_KEY_LEN);
+  dbBE_Redis_namespace_t *test_ns = dbBE_Redis_namespace_create( "test" );
+  dbBE_Redis_namespace_t *moved_ns = dbBE_Redis_namespace_create( "moved" );
+  if(( test_ns == NULL ) || ( moved_ns == NULL ))
+    return 1;
 
   ureq->_flags = 0;
   ureq->_group = DBR_GROUP_LIST_EMPTY;
@@ -74,8 +78,8 @@ int key_creation_test()
   ureq->_next = NULL;
   ureq->_sge_count = 1;
   ureq->_user = NULL;
-  ureq->_sge[0].iov_base = "moved";
-  ureq->_sge[0].iov_len = 5;
+  ureq->_sge[0].iov_base = moved_ns;
+  ureq->_sge[0].iov_len = sizeof( dbBE_Redis_namespace_t* );
 
   dbBE_Redis_request_t *req = dbBE_Redis_request_allocate( ureq );
   if( req == NULL )
@@ -98,7 +102,7 @@ int key_creation_test()
         break;
         break;
       default:
-        ureq->_ns_hdl = "test";
+        ureq->_ns_hdl = test_ns;
         if( req->_step->_expect == dbBE_REDIS_TYPE_UNSPECIFIED )
           return 10000;
         break;
@@ -137,12 +141,55 @@ int key_creation_test()
   }
   dbBE_Redis_request_destroy( req );
   dbBE_Transport_sr_buffer_free( buf );
+  dbBE_Redis_namespace_destroy( moved_ns );
+  dbBE_Redis_namespace_destroy( test_ns );
   free( reference );
   free( ureq );
   return rc;
 }
 
 
+int stage_compile_test()
+{
+  int rc = 0;
+  dbBE_Redis_command_stage_spec_t stage;
+  memset( &stage, 0, sizeof( stage ) );
+
+  rc += TEST( dbBE_Redis_command_stage_compile( NULL ), -EINVAL );
+
+  // constant parts around and between the arguments
+  stage._array_len = 2;
+  strcpy( stage._command, "*6\r\n$4\r\nSCAN\r\n%0$5\r\nMATCH\r\n%1$5\r\nCOUNT\r\n$2\r\n10\r\n" );
+  rc += TEST( dbBE_Redis_command_stage_compile( &stage ), 0 );
+  rc += TEST( stage._seg_cnt, 5 );
+  rc += TEST( stage._seg[ 0 ]._base, stage._command );
+  rc += TEST( stage._seg[ 0 ]._len, 14 );
+  rc += TEST( stage._seg[ 1 ]._base, NULL );
+  rc += TEST( stage._seg[ 1 ]._arg, 0 );
+  rc += TEST( stage._seg[ 3 ]._base, NULL );
+  rc += TEST( stage._seg[ 3 ]._arg, 1 );
+  rc += TEST( strncmp( stage._seg[ 4 ]._base, "$5\r\nCOUNT\r\n$2\r\n10\r\n", stage._seg[ 4 ]._len ), 0 );
+
+  // back-to-back arguments and the command string itself is left untouched
+  strcpy( stage._command, "*3\r\n$5\r\nRPUSH\r\n%0%1" );
+  rc += TEST( dbBE_Redis_command_stage_compile( &stage ), 0 );
+  rc += TEST( stage._seg_cnt, 3 );
+  rc += TEST( stage._seg[ 1 ]._arg, 0 );
+  rc += TEST( stage._seg[ 2 ]._arg, 1 );
+  rc += TEST( strcmp( stage._command, "*3\r\n$5\r\nRPUSH\r\n%0%1" ), 0 );
+
+  // argument index beyond the number of args of the stage
+  strcpy( stage._command, "*2\r\n$3\r\nDEL\r\n%2" );
+  rc += TEST( dbBE_Redis_command_stage_compile( &stage ), -EBADMSG );
+
+  // empty spec compiles to nothing
+  stage._command[ 0 ] = '\0';
+  rc += TEST( dbBE_Redis_command_stage_compile( &stage ), 0 );
+  rc += TEST( stage._seg_cnt, 0 );
+
+  printf( "Stage compile test: rc=%d\n", rc );
+  return rc;
+}
 
 int main( int argc, char ** argv )
 {
@@ -288,6 +335,7 @@ int main( int argc, char ** argv )
   dbBE_Redis_request_destroy( req );
 
   // create an nscreate
+  int shard = dbBE_Redis_namespace_refcnt_shard();
   ureq->_opcode = DBBE_OPCODE_NSCREATE;
   ureq->_key = "TestNS";
   ureq->_ns_hdl = NULL;
@@ -338,6 +386,19 @@ int main( int argc, char ** argv )
 
   TEST_LOG( rc, dbBE_Transport_sr_buffer_get_start( data_buf ) );
 
+  // the creator holds the first reference in its refcnt shard
+  char shardcmd[ 128 ];
+  snprintf( shardcmd, sizeof( shardcmd ), "*2\r\n$4\r\nINCR\r\n$%d\r\nTestNS#refcnt:%d\r\n",
+            shard < 10 ? 15 : 16, shard );
+  rc += TEST( dbBE_Redis_request_stage_transition( req ), 0 );
+  rc += TEST( req->_step->_stage, DBBE_REDIS_NSCREATE_STAGE_REFSHARD );
+  dbBE_Transport_sr_buffer_reset( sr_buf );
+  rc += TEST_RC( dbBE_Redis_create_command_sge( req,
+                                                sr_buf,
+                                                cmd ), 2, cmdlen );
+  rc += TEST( Flatten_cmd( cmd, cmdlen, data_buf ), 0 );
+  rc += TEST( strcmp( shardcmd, dbBE_Transport_sr_buffer_get_start( data_buf ) ), 0 );
+  TEST_LOG( rc, dbBE_Transport_sr_buffer_get_start( data_buf ) );
 
   dbBE_Redis_request_destroy( req );
   free( ureq->_sge[ 0 ].iov_base );
@@ -387,6 +448,17 @@ int main( int argc, char ** argv )
   TEST_LOG( rc, dbBE_Transport_sr_buffer_get_start( data_buf ) );
 
   rc += TEST( dbBE_Redis_request_stage_transition( req ), 0 );
+  rc += TEST( req->_step->_stage, DBBE_REDIS_NSATTACH_STAGE_REFSHARD );
+  dbBE_Transport_sr_buffer_reset( sr_buf );
+  rc += TEST_RC( dbBE_Redis_create_command_sge( req,
+                                                sr_buf,
+                                                cmd ), 2, cmdlen );
+  rc += TEST( Flatten_cmd( cmd, cmdlen, data_buf ), 0 );
+  rc += TEST( strcmp( shardcmd, dbBE_Transport_sr_buffer_get_start( data_buf ) ), 0 );
+  TEST_LOG( rc, dbBE_Transport_sr_buffer_get_start( data_buf ) );
+
+  rc += TEST( dbBE_Redis_request_stage_transition( req ), 0 );
+  rc += TEST( req->_step->_stage, DBBE_REDIS_NSATTACH_STAGE_REFCNT );
   dbBE_Transport_sr_buffer_reset( sr_buf );
   rc += TEST_RC( dbBE_Redis_create_command_sge( req,
                                                 sr_buf,
@@ -411,6 +483,21 @@ int main( int argc, char ** argv )
   req = dbBE_Redis_request_allocate( ureq );
   rc += TEST_NOT( req, NULL );
 
+  rc += TEST( req->_step->_stage, DBBE_REDIS_NSDETACH_STAGE_REFSHARD );
+  dbBE_Transport_sr_buffer_reset( sr_buf );
+  rc += TEST_RC( dbBE_Redis_create_command_sge( req,
+                                                sr_buf,
+                                                cmd ), 2, cmdlen );
+  rc += TEST( Flatten_cmd( cmd, cmdlen, data_buf ), 0 );
+  snprintf( shardcmd, sizeof( shardcmd ), "*2\r\n$4\r\nDECR\r\n$%d\r\nTestNS#refcnt:%d\r\n",
+            shard < 10 ? 15 : 16, shard );
+  rc += TEST( strcmp( shardcmd, dbBE_Transport_sr_buffer_get_start( data_buf ) ), 0 );
+  TEST_LOG( rc, dbBE_Transport_sr_buffer_get_start( data_buf ) );
+
+  // the last reference of the shard continues with the delete check
+  req->_status.nsdetach.to_delete = 1;
+  rc += TEST( dbBE_Redis_request_stage_transition( req ), 0 );
+  rc += TEST( req->_step->_stage, DBBE_REDIS_NSDETACH_STAGE_DELCHECK );
   dbBE_Transport_sr_buffer_reset( sr_buf );
   rc += TEST_RC( dbBE_Redis_create_command_sge( req,
                                                 sr_buf,
@@ -490,6 +577,18 @@ int main( int argc, char ** argv )
   TEST_LOG( rc, dbBE_Transport_sr_buffer_get_start( data_buf ) );
 
 
+  rc += TEST( dbBE_Redis_request_stage_transition( req ), 0 );
+  rc += TEST( req->_step->_stage, DBBE_REDIS_NSDELETE_STAGE_REFSHARD );
+  dbBE_Transport_sr_buffer_reset( sr_buf );
+  rc += TEST_RC( dbBE_Redis_create_command_sge( req,
+                                                sr_buf,
+                                                cmd ), 2, cmdlen );
+  rc += TEST( Flatten_cmd( cmd, cmdlen, data_buf ), 0 );
+  snprintf( shardcmd, sizeof( shardcmd ), "*2\r\n$3\r\nGET\r\n$%d\r\nTestNS#refcnt:%d\r\n",
+            shard < 10 ? 15 : 16, shard );
+  rc += TEST( strcmp( shardcmd, dbBE_Transport_sr_buffer_get_start( data_buf ) ), 0 );
+  TEST_LOG( rc, dbBE_Transport_sr_buffer_get_start( data_buf ) );
+
   rc += TEST( dbBE_Redis_request_stage_transition( req ), 0 );
   rc += TEST( req->_step->_stage, DBBE_REDIS_NSDELETE_STAGE_SETFLAG );
   dbBE_Transport_sr_buffer_reset( sr_buf );
@@ -625,6 +724,7 @@ int main( int argc, char ** argv )
   free(ureq);
 
   rc += key_creation_test();
+  rc += stage_compile_test();
 
   dbBE_Redis_namespace_destroy( target_ns );
   dbBE_Redis_namespace_destroy( ns );
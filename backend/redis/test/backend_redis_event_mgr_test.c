@@ -30,6 +30,11 @@
 
 #define timeout 1
 
+static
+void test_timer_fired( evutil_socket_t socket, short ev_type, void *arg )
+{
+  ++( *(int*)arg );
+}
 
 
 int main( int argc, char **argv )
@@ -89,6 +94,48 @@ int main( int argc, char **argv )
 
   rc += TEST( dbBE_Redis_event_mgr_rm( mgr, conn ), 0 );
 
+  /////////////////////////////////////////////////////////
+  //  testing timers
+  rc += TEST( dbBE_Redis_event_mgr_timer_arm( NULL, DBBE_REDIS_TIMER_RECOVERY, 0 ), -EINVAL );
+  rc += TEST( dbBE_Redis_event_mgr_timer_arm( mgr, DBBE_REDIS_TIMER_MAX, 0 ), -EINVAL );
+
+  // never armed counts as expired
+  rc += TEST( dbBE_Redis_event_mgr_timer_expired( mgr, DBBE_REDIS_TIMER_RECOVERY ), 1 );
+  rc += TEST( dbBE_Redis_event_mgr_timer_arm( mgr, DBBE_REDIS_TIMER_RECOVERY, 10000000 ), 0 );
+  rc += TEST( dbBE_Redis_event_mgr_timer_expired( mgr, DBBE_REDIS_TIMER_RECOVERY ), 0 );
+  rc += TEST( dbBE_Redis_event_mgr_timer_expired( mgr, DBBE_REDIS_TIMER_RETRY ), 1 );
+
+  // re-arming replaces the deadline; expiry is detected even without running the event loop
+  // (sleeping well beyond the deadline because libevent may use a coarse clock)
+  rc += TEST( dbBE_Redis_event_mgr_timer_arm( mgr, DBBE_REDIS_TIMER_RECOVERY, 1000 ), 0 );
+  usleep( 20000 );
+  rc += TEST( dbBE_Redis_event_mgr_timer_expired( mgr, DBBE_REDIS_TIMER_RECOVERY ), 1 );
+
+  // and by the event loop
+  rc += TEST( dbBE_Redis_event_mgr_timer_arm( mgr, DBBE_REDIS_TIMER_RETRY, 1000 ), 0 );
+  usleep( 20000 );
+  rc += TEST( dbBE_Redis_event_mgr_next( mgr ), NULL );
+  rc += TEST( dbBE_Redis_event_mgr_timer_expired( mgr, DBBE_REDIS_TIMER_RETRY ), 1 );
+
+  // a timer with a handler fires its callback from the event loop
+  int fired = 0;
+  rc += TEST( dbBE_Redis_event_mgr_timer_handler( NULL, DBBE_REDIS_TIMER_RECOVERY, test_timer_fired, &fired ), -EINVAL );
+  rc += TEST( dbBE_Redis_event_mgr_timer_handler( mgr, DBBE_REDIS_TIMER_MAX, test_timer_fired, &fired ), -EINVAL );
+  rc += TEST( dbBE_Redis_event_mgr_timer_handler( mgr, DBBE_REDIS_TIMER_RECOVERY, test_timer_fired, &fired ), 0 );
+  rc += TEST( dbBE_Redis_event_mgr_timer_arm( mgr, DBBE_REDIS_TIMER_RECOVERY, 0 ), 0 );
+  rc += TEST( dbBE_Redis_event_mgr_next( mgr ), NULL );
+  rc += TEST( fired, 1 );
+  rc += TEST( dbBE_Redis_event_mgr_next( mgr ), NULL );
+  rc += TEST( fired, 1 );
+
+  // replacing the handler disarms the timer
+  rc += TEST( dbBE_Redis_event_mgr_timer_arm( mgr, DBBE_REDIS_TIMER_RECOVERY, 0 ), 0 );
+  rc += TEST( dbBE_Redis_event_mgr_timer_handler( mgr, DBBE_REDIS_TIMER_RECOVERY, NULL, NULL ), 0 );
+  rc += TEST( dbBE_Redis_event_mgr_next( mgr ), NULL );
+  rc += TEST( fired, 1 );
+  rc += TEST( dbBE_Redis_event_mgr_timer_expired( mgr, DBBE_REDIS_TIMER_RECOVERY ), 1 );
+  TEST_LOG( rc, "timer testing" );
+
 
   rc += TEST( dbBE_Redis_event_mgr_exit( NULL ), -EINVAL );
   rc += TEST( dbBE_Redis_event_mgr_exit( mgr ), 0 );
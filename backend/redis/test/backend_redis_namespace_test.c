@@ -105,6 +105,31 @@ int namespacetest()
   return rc;
 }
 
+int namespacelistedtest()
+{
+  int rc = 0;
+
+  rc += TEST( dbBE_Redis_namespace_listed( NULL, "Test" ), 0 );
+  rc += TEST( dbBE_Redis_namespace_listed( "Test", NULL ), 0 );
+  rc += TEST( dbBE_Redis_namespace_listed( "", "Test" ), 0 );
+  rc += TEST( dbBE_Redis_namespace_listed( "Test", "Test" ), 1 );
+  rc += TEST( dbBE_Redis_namespace_listed( "Other,Test", "Test" ), 1 );
+  rc += TEST( dbBE_Redis_namespace_listed( "Test,Other", "Test" ), 1 );
+  rc += TEST( dbBE_Redis_namespace_listed( "Test,Other", "Other" ), 1 );
+  rc += TEST( dbBE_Redis_namespace_listed( "Test,Other", "Tes" ), 0 );
+  rc += TEST( dbBE_Redis_namespace_listed( "Tes,Other", "Test" ), 0 );
+  rc += TEST( dbBE_Redis_namespace_listed( ",,Test,", "Test" ), 1 );
+  rc += TEST( dbBE_Redis_namespace_listed( "Other,*", "Test" ), 1 );
+  rc += TEST( dbBE_Redis_namespace_listed( "**", "Test" ), 0 );
+
+  // the backend sets the flag, not the plain create
+  dbBE_Redis_namespace_t *ns = NULL;
+  rc += TEST_NOT_RC( dbBE_Redis_namespace_create( "Test" ), NULL, ns );
+  rc += TEST( ns->_flags & DBBE_REDIS_NAMESPACE_FLAG_READ_YOUR_WRITES, 0 );
+  rc += TEST( dbBE_Redis_namespace_destroy( ns ), 0 );
+  return rc;
+}
+
 #define DBBE_TEST_NAMESPACE_COUNT (1000)
 
 int namespacelisttest()
@@ -200,6 +225,7 @@ int main( int argc, char ** argv )
 {
   int rc = 0;
 
+  rc += namespacelistedtest();
   rc += namespacetest();
   TEST_BREAK( rc, "Found error already. Skipping further tests" );
   rc += namespacelisttest();
@@ -23,6 +23,7 @@
 
 #include <stdio.h>
 #include <string.h>
+#include <math.h>
 
 #include <libdatabroker.h>
 #include "../backend/redis/result.h"
@@ -496,6 +497,133 @@ int TestRedis_parse_ctx_buffer()
   return rc;
 }
 
+int TestRedis_parse_resp3()
+{
+  int rc = 0;
+  size_t len;
+  int err_code;
+
+  dbBE_Redis_sr_buffer_t *sr_buf;
+  dbBE_Redis_result_t result;
+  memset( &result, 0, sizeof( result ) );
+
+  sr_buf = dbBE_Transport_sr_buffer_allocate( DBBE_TEST_BUFFER_LEN );
+  if( sr_buf == NULL )
+    return 1;
+
+  // a map keeps its keys and values in the array
+  len = TestReset_sr_buffer( sr_buf, "%2\r\n$2\r\nid\r\n:5\r\n+refcnt\r\n_\r\n" );
+  err_code = dbBE_Redis_parse_sr_buffer( sr_buf, &result );
+  rc += TEST( err_code, 0 );
+  rc += TEST( result._type, dbBE_REDIS_TYPE_MAP );
+  rc += TEST( dbBE_Redis_result_is_array( &result ), 1 );
+  rc += TEST( result._data._array._len, 4 );
+  if( result._data._array._len == 4 )
+  {
+    rc += TEST( strcmp( result._data._array._data[ 0 ]._data._string._data, "id" ), 0 );
+    rc += TEST( result._data._array._data[ 1 ]._data._integer, 5 );
+    rc += TEST( strcmp( result._data._array._data[ 2 ]._data._string._data, "refcnt" ), 0 );
+    // null is a nil string
+    rc += TEST( result._data._array._data[ 3 ]._type, dbBE_REDIS_TYPE_CHAR );
+    rc += TEST( result._data._array._data[ 3 ]._data._string._data, NULL );
+  }
+  rc += TEST( dbBE_Transport_sr_buffer_processed( sr_buf ), len );
+  dbBE_Redis_result_cleanup( &result, 0 );
+
+  // an incomplete map needs more data
+  len = TestReset_sr_buffer( sr_buf, "%2\r\n$2\r\nid\r\n:5\r\n+refcnt\r\n" );
+  err_code = dbBE_Redis_parse_sr_buffer( sr_buf, &result );
+  rc += TEST( err_code, -EAGAIN );
+  rc += TEST( dbBE_Transport_sr_buffer_processed( sr_buf ), 0 );
+  dbBE_Redis_result_cleanup( &result, 0 );
+
+  // sets and push frames
+  len = TestReset_sr_buffer( sr_buf, "~2\r\n+a\r\n+b\r\n>2\r\n$10\r\ninvalidate\r\n*1\r\n$3\r\nkey\r\n" );
+  err_code = dbBE_Redis_parse_sr_buffer( sr_buf, &result );
+  rc += TEST( err_code, 0 );
+  rc += TEST( result._type, dbBE_REDIS_TYPE_SET );
+  rc += TEST( result._data._array._len, 2 );
+  dbBE_Redis_result_cleanup( &result, 0 );
+  err_code = dbBE_Redis_parse_sr_buffer( sr_buf, &result );
+  rc += TEST( err_code, 0 );
+  rc += TEST( result._type, dbBE_REDIS_TYPE_PUSH );
+  rc += TEST( dbBE_Redis_result_is_array( &result ), 0 );
+  rc += TEST( result._data._array._len, 2 );
+  if( result._data._array._len == 2 )
+  {
+    rc += TEST( strcmp( result._data._array._data[ 0 ]._data._string._data, "invalidate" ), 0 );
+    rc += TEST( result._data._array._data[ 1 ]._type, dbBE_REDIS_TYPE_ARRAY );
+  }
+  rc += TEST( dbBE_Transport_sr_buffer_processed( sr_buf ), len );
+  dbBE_Redis_result_cleanup( &result, 0 );
+
+  // scalars
+  len = TestReset_sr_buffer( sr_buf, "#t\r\n#f\r\n,3.25\r\n,-inf\r\n(3492890328409238509324850943850943825024385\r\n" );
+  err_code = dbBE_Redis_parse_sr_buffer( sr_buf, &result );
+  rc += TEST( err_code, 0 );
+  rc += TEST( result._type, dbBE_REDIS_TYPE_BOOL );
+  rc += TEST( result._data._integer, 1 );
+  err_code = dbBE_Redis_parse_sr_buffer( sr_buf, &result );
+  rc += TEST( err_code, 0 );
+  rc += TEST( result._type, dbBE_REDIS_TYPE_BOOL );
+  rc += TEST( result._data._integer, 0 );
+  err_code = dbBE_Redis_parse_sr_buffer( sr_buf, &result );
+  rc += TEST( err_code, 0 );
+  rc += TEST( result._type, dbBE_REDIS_TYPE_DOUBLE );
+  rc += TEST( result._data._double == 3.25, 1 );
+  err_code = dbBE_Redis_parse_sr_buffer( sr_buf, &result );
+  rc += TEST( err_code, 0 );
+  rc += TEST( result._type, dbBE_REDIS_TYPE_DOUBLE );
+  rc += TEST( isinf( result._data._double ) && ( result._data._double < 0 ), 1 );
+  err_code = dbBE_Redis_parse_sr_buffer( sr_buf, &result );
+  rc += TEST( err_code, 0 );
+  rc += TEST( result._type, dbBE_REDIS_TYPE_BIGNUM );
+  rc += TEST( strcmp( result._data._string._data, "3492890328409238509324850943850943825024385" ), 0 );
+  rc += TEST( dbBE_Transport_sr_buffer_processed( sr_buf ), len );
+
+  // verbatim strings lose their format prefix; blob errors are errors
+  len = TestReset_sr_buffer( sr_buf, "=15\r\ntxt:Some string\r\n!21\r\nSYNTAX invalid syntax\r\n" );
+  err_code = dbBE_Redis_parse_sr_buffer( sr_buf, &result );
+  rc += TEST( err_code, 0 );
+  rc += TEST( result._type, dbBE_REDIS_TYPE_CHAR );
+  rc += TEST( result._data._string._size, 11 );
+  rc += TEST( strcmp( result._data._string._data, "Some string" ), 0 );
+  err_code = dbBE_Redis_parse_sr_buffer( sr_buf, &result );
+  rc += TEST( err_code, 0 );
+  rc += TEST( result._type, dbBE_REDIS_TYPE_ERROR );
+  rc += TEST( strcmp( result._data._string._data, "SYNTAX invalid syntax" ), 0 );
+  rc += TEST( dbBE_Transport_sr_buffer_processed( sr_buf ), len );
+
+  // attributes get skipped; the reply after them is the result
+  len = TestReset_sr_buffer( sr_buf, "|1\r\n+key-popularity\r\n%1\r\n$1\r\na\r\n,0.19\r\n*2\r\n:2039123\r\n:9543892\r\n" );
+  err_code = dbBE_Redis_parse_sr_buffer( sr_buf, &result );
+  rc += TEST( err_code, 0 );
+  rc += TEST( result._type, dbBE_REDIS_TYPE_ARRAY );
+  rc += TEST( result._data._array._len, 2 );
+  if( result._data._array._len == 2 )
+    rc += TEST( result._data._array._data[ 1 ]._data._integer, 9543892 );
+  rc += TEST( dbBE_Transport_sr_buffer_processed( sr_buf ), len );
+  dbBE_Redis_result_cleanup( &result, 0 );
+
+  // the attribute without the reply is incomplete
+  len = TestReset_sr_buffer( sr_buf, "|1\r\n+key-popularity\r\n%1\r\n$1\r\na\r\n,0.19\r\n" );
+  err_code = dbBE_Redis_parse_sr_buffer( sr_buf, &result );
+  rc += TEST( err_code, -EAGAIN );
+  rc += TEST( dbBE_Transport_sr_buffer_processed( sr_buf ), 0 );
+
+  // malformed scalars
+  len = TestReset_sr_buffer( sr_buf, "#x\r\n" );
+  rc += TEST( dbBE_Redis_parse_sr_buffer( sr_buf, &result ), -EBADMSG );
+  len = TestReset_sr_buffer( sr_buf, ",1.5x\r\n" );
+  rc += TEST( dbBE_Redis_parse_sr_buffer( sr_buf, &result ), -EBADMSG );
+  len = TestReset_sr_buffer( sr_buf, "=2\r\nab\r\n" );
+  rc += TEST( dbBE_Redis_parse_sr_buffer( sr_buf, &result ), -EBADMSG );
+
+  dbBE_Transport_sr_buffer_free( sr_buf );
+  printf( "TestRedis_parse_resp3 exiting with rc=%d\n", rc );
+  return rc;
+}
+
 int TestRedis_parse_ctx_buffer_errors()
 {
   int rc = 0;
@@ -850,6 +978,7 @@ int main( int argc, char ** argv )
   rc += TestRedis_extract_int();
   rc += TestRedis_extract_bulk_string();
   rc += TestRedis_parse_ctx_buffer();
+  rc += TestRedis_parse_resp3();
   rc += TestRedis_parse_ctx_buffer_errors();
   rc += TestSGEAssemble();
 
@@ -0,0 +1,478 @@
+/*
+ * Copyright © 2020 IBM Corporation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+/*
+ * receiver handling of redirects and broken connections
+ * responses are canned and written into socket pairs in place of Redis servers
+ */
+
+#include "test_utils.h"
+#include "../backend/common/dbbe_api.h"
+#include "../redis.h"
+#include "../request.h"
+#include "../protocol.h"
+#include "transports/memcopy.h"
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <sys/socket.h>
+
+#define TEST_NODE_A "127.0.0.1:7001"
+#define TEST_NODE_B "127.0.0.1:7002"
+#define TEST_BUFFER_LEN ( 1048576 )
+
+typedef struct
+{
+  dbBE_Redis_context_t _ctx;
+  dbBE_Redis_connection_t *_conn;
+  int _peer;
+  dbBE_Request_t *_usr[ 4 ];
+} test_env_t;
+
+static
+dbBE_Redis_connection_t* test_connection( test_env_t *env, const char *address, int *peer )
+{
+  int sv[ 2 ];
+  if( socketpair( AF_UNIX, SOCK_STREAM, 0, sv ) != 0 )
+    return NULL;
+
+  dbBE_Redis_connection_t *conn = dbBE_Redis_connection_create( TEST_BUFFER_LEN );
+  if( conn == NULL )
+    return NULL;
+  conn->_socket = sv[ 0 ];
+  conn->_status = DBBE_CONNECTION_STATUS_AUTHORIZED;
+  conn->_address = dbBE_Network_address_from_string( address );
+  snprintf( conn->_url, DBR_SERVER_URL_MAX_LENGTH, "%s", address );
+  if( dbBE_Redis_connection_mgr_add( env->_ctx._conn_mgr, conn ) != 0 )
+    return NULL;
+  *peer = sv[ 1 ];
+  return conn;
+}
+
+static
+int test_setup( test_env_t *env )
+{
+  memset( env, 0, sizeof( test_env_t ) );
+  dbBE_Redis_conn_mgr_config_t config;
+  memset( &config, 0, sizeof( config ) );
+  config._rbuf_len = TEST_BUFFER_LEN;
+  config._sbuf_len = TEST_BUFFER_LEN;
+
+  dbBE_Redis_context_t *ctx = &env->_ctx;
+  ctx->_spec = dbBE_Redis_command_stages_spec_init();
+  ctx->_locator = dbBE_Redis_locator_create();
+  ctx->_conn_mgr = dbBE_Redis_connection_mgr_init( &config );
+  ctx->_compl_q = dbBE_Completion_queue_create( DBBE_REDIS_WORK_QUEUE_DEPTH );
+  ctx->_retry_q = dbBE_Redis_s2r_queue_create( 1 );
+  ctx->_shelf_q = dbBE_Redis_s2r_queue_create( 1 );
+  ctx->_transport = &dbBE_Memcopy_transport;
+  if(( ctx->_spec == NULL ) || ( ctx->_locator == NULL ) || ( ctx->_conn_mgr == NULL ) ||
+      ( ctx->_compl_q == NULL ) || ( ctx->_retry_q == NULL ) || ( ctx->_shelf_q == NULL ))
+    return -ENOMEM;
+
+  env->_conn = test_connection( env, TEST_NODE_A, &env->_peer );
+  return ( env->_conn != NULL ) ? 0 : -ENOTCONN;
+}
+
+static
+void test_cleanup( test_env_t *env )
+{
+  dbBE_Redis_context_t *ctx = &env->_ctx;
+  dbBE_Redis_request_t *request;
+  while(( request = dbBE_Redis_s2r_queue_pop( ctx->_retry_q )) != NULL )
+    dbBE_Redis_request_destroy( request );
+  dbBE_Completion_t *completion;
+  while(( completion = dbBE_Completion_queue_pop( ctx->_compl_q )) != NULL )
+    free( completion );
+  if( env->_peer > 0 )
+    close( env->_peer );
+  dbBE_Redis_connection_mgr_exit( ctx->_conn_mgr );
+  dbBE_Redis_s2r_queue_destroy( ctx->_shelf_q );
+  dbBE_Redis_s2r_queue_destroy( ctx->_retry_q );
+  dbBE_Completion_queue_destroy( ctx->_compl_q );
+  dbBE_Redis_locator_destroy( ctx->_locator );
+  dbBE_Redis_command_stages_spec_destroy( ctx->_spec );
+  int n;
+  for( n = 0; n < 4; ++n )
+    free( env->_usr[ n ] );
+}
+
+/*
+ * a PUT request that already went out on the test connection
+ */
+static
+dbBE_Redis_request_t* test_posted_put( test_env_t *env, const int n, const char *key )
+{
+  dbBE_Request_t *usr = (dbBE_Request_t*)calloc( 1, sizeof( dbBE_Request_t ) + sizeof( dbBE_sge_t ) );
+  if( usr == NULL )
+    return NULL;
+  usr->_opcode = DBBE_OPCODE_PUT;
+  usr->_key = (char*)key;
+  usr->_sge_count = 1;
+  usr->_sge[ 0 ].iov_base = (void*)"value";
+  usr->_sge[ 0 ].iov_len = 5;
+  usr->_user = usr;
+  env->_usr[ n ] = usr;
+
+  dbBE_Redis_request_t *request = dbBE_Redis_request_allocate( usr );
+  if( request != NULL )
+    dbBE_Redis_s2r_queue_push( env->_conn->_posted_q, request );
+  return request;
+}
+
+/*
+ * hand canned responses to the receiver
+ */
+static
+int test_respond( test_env_t *env, const int peer, const char *responses )
+{
+  size_t len = strlen( responses );
+  if( write( peer, responses, len ) != (ssize_t)len )
+    return -EIO;
+  usleep( 1000 );
+  dbBE_Redis_receiver_trigger( &env->_ctx );
+  return 0;
+}
+
+static
+int test_ask_reset()
+{
+  int rc = 0;
+  dbBE_Redis_request_t request;
+  dbBE_Redis_connection_t conn;
+  memset( &request, 0, sizeof( request ) );
+
+  // a pending redirect drops the temporary destination
+  request._location._type = DBBE_REDIS_REQUEST_LOCATION_TYPE_CONNECTION;
+  request._location._data._connection = &conn;
+  request._flags = DBBE_REDIS_REQUEST_FLAG_MASTER_ONLY | DBBE_REDIS_REQUEST_FLAG_ASKING |
+      DBBE_REDIS_REQUEST_FLAG_ASKING_SENT | DBBE_REDIS_REQUEST_FLAG_ASK_DRAIN;
+  dbBE_Redis_request_ask_reset( &request );
+  rc += TEST( request._flags, DBBE_REDIS_REQUEST_FLAG_MASTER_ONLY );
+  rc += TEST( request._location._type, DBBE_REDIS_REQUEST_LOCATION_TYPE_UNKNOWN );
+  rc += TEST( request._location._data._connection, NULL );
+
+  // without a redirect, the location stays (e.g. the connection of an iterator)
+  request._location._type = DBBE_REDIS_REQUEST_LOCATION_TYPE_CONNECTION;
+  request._location._data._connection = &conn;
+  request._flags = DBBE_REDIS_REQUEST_FLAG_ASK_DRAIN;
+  dbBE_Redis_request_ask_reset( &request );
+  rc += TEST( request._flags, 0 );
+  rc += TEST( request._location._type, DBBE_REDIS_REQUEST_LOCATION_TYPE_CONNECTION );
+  rc += TEST( request._location._data._connection, &conn );
+
+  printf( "ASK reset: rc=%d\n", rc );
+  return rc;
+}
+
+/*
+ * ASK to a known node and the ASKING response arriving ahead of the redirected command's response
+ */
+static
+int test_ask_known()
+{
+  int rc = 0;
+  test_env_t env;
+  rc += TEST( test_setup( &env ), 0 );
+  TEST_BREAK( rc, "Setup failed" );
+
+  int peer_b = -1;
+  dbBE_Redis_connection_t *conn_b = test_connection( &env, TEST_NODE_B, &peer_b );
+  rc += TEST_NOT( conn_b, NULL );
+
+  dbBE_Redis_request_t *request = test_posted_put( &env, 0, "key" );
+  rc += TEST_NOT( request, NULL );
+  TEST_BREAK( rc, "Request setup failed" );
+
+  // the redirect goes back to the sender with the destination and ASKING
+  rc += TEST( test_respond( &env, env._peer, "-ASK 1234 "TEST_NODE_B"\r\n" ), 0 );
+  rc += TEST( dbBE_Redis_s2r_queue_pop( env._ctx._retry_q ), request );
+  rc += TEST( request->_flags, DBBE_REDIS_REQUEST_FLAG_ASKING );
+  rc += TEST( request->_location._type, DBBE_REDIS_REQUEST_LOCATION_TYPE_CONNECTION );
+  rc += TEST( request->_location._data._connection, conn_b );
+  rc += TEST( dbBE_Redis_s2r_queue_len( env._conn->_posted_q ), 0 );
+
+  // the sender puts ASKING in front; its response comes alone
+  request->_flags |= DBBE_REDIS_REQUEST_FLAG_ASKING_SENT;
+  dbBE_Redis_s2r_queue_push( conn_b->_posted_q, request );
+  rc += TEST( test_respond( &env, peer_b, "+OK\r\n" ), 0 );
+  rc += TEST( dbBE_Redis_s2r_queue_len( conn_b->_posted_q ), 1 );
+  rc += TEST( request->_flags & DBBE_REDIS_REQUEST_FLAG_ASKING_SENT, 0 );
+  rc += TEST( dbBE_Completion_queue_len( env._ctx._compl_q ), 0 );
+
+  // the next receive resumes with the command's own response
+  rc += TEST( test_respond( &env, peer_b, ":1\r\n" ), 0 );
+  rc += TEST( dbBE_Redis_s2r_queue_len( conn_b->_posted_q ), 0 );
+  dbBE_Completion_t *completion = dbBE_Completion_queue_pop( env._ctx._compl_q );
+  rc += TEST_NOT( completion, NULL );
+  if( completion != NULL )
+  {
+    rc += TEST( completion->_status, DBR_SUCCESS );
+    rc += TEST( completion->_user, env._usr[ 0 ] );
+    free( completion );
+  }
+
+  close( peer_b );
+  test_cleanup( &env );
+  printf( "ASK known node: rc=%d\n", rc );
+  return rc;
+}
+
+/*
+ * ASK in the first response of a multi-response stage: the remaining responses get drained
+ */
+static
+int test_ask_drain()
+{
+  int rc = 0;
+  test_env_t env;
+  rc += TEST( test_setup( &env ), 0 );
+  TEST_BREAK( rc, "Setup failed" );
+
+  int peer_b = -1;
+  dbBE_Redis_connection_t *conn_b = test_connection( &env, TEST_NODE_B, &peer_b );
+  rc += TEST_NOT( conn_b, NULL );
+
+  dbBE_Redis_request_t *request = test_posted_put( &env, 0, "key" );
+  dbBE_Redis_request_t *next = test_posted_put( &env, 1, "other" );
+  rc += TEST_NOT( request, NULL );
+  rc += TEST_NOT( next, NULL );
+  TEST_BREAK( rc, "Request setup failed" );
+
+  dbBE_Redis_command_stage_spec_t multi = *request->_step;
+  multi._resp_cnt = 3;
+  request->_step = &multi;
+
+  rc += TEST( test_respond( &env, env._peer, "-ASK 1234 "TEST_NODE_B"\r\n+QUEUED\r\n-ERR whatever\r\n:1\r\n" ), 0 );
+
+  // the redirected stage is back for retry without the drain flag; the next request completed normally
+  rc += TEST( dbBE_Redis_s2r_queue_pop( env._ctx._retry_q ), request );
+  rc += TEST( request->_flags, DBBE_REDIS_REQUEST_FLAG_ASKING );
+  rc += TEST( request->_location._data._connection, conn_b );
+  dbBE_Completion_t *completion = dbBE_Completion_queue_pop( env._ctx._compl_q );
+  rc += TEST_NOT( completion, NULL );
+  if( completion != NULL )
+  {
+    rc += TEST( completion->_status, DBR_SUCCESS );
+    rc += TEST( completion->_user, env._usr[ 1 ] );
+    free( completion );
+  }
+  rc += TEST( dbBE_Completion_queue_len( env._ctx._compl_q ), 0 );
+  dbBE_Redis_request_destroy( request );
+
+  close( peer_b );
+  test_cleanup( &env );
+  printf( "ASK drain: rc=%d\n", rc );
+  return rc;
+}
+
+/*
+ * ASK to a node without a connection: linking up doesn't block the receiver
+ */
+static
+int test_ask_unknown()
+{
+  int rc = 0;
+  test_env_t env;
+  rc += TEST( test_setup( &env ), 0 );
+  TEST_BREAK( rc, "Setup failed" );
+
+  // a listener that doesn't accept yet
+  int listener = socket( AF_INET, SOCK_STREAM, 0 );
+  struct sockaddr_in addr;
+  socklen_t addrlen = sizeof( addr );
+  memset( &addr, 0, sizeof( addr ) );
+  addr.sin_family = AF_INET;
+  addr.sin_addr.s_addr = htonl( INADDR_LOOPBACK );
+  rc += TEST( bind( listener, (struct sockaddr*)&addr, sizeof( addr ) ), 0 );
+  rc += TEST( listen( listener, 4 ), 0 );
+  rc += TEST( getsockname( listener, (struct sockaddr*)&addr, &addrlen ), 0 );
+
+  dbBE_Redis_request_t *request = test_posted_put( &env, 0, "key" );
+  rc += TEST_NOT( request, NULL );
+  TEST_BREAK( rc, "Request setup failed" );
+
+  char ask[ 128 ];
+  snprintf( ask, sizeof( ask ), "-ASK 1234 127.0.0.1:%d\r\n", ntohs( addr.sin_port ) );
+  rc += TEST( test_respond( &env, env._peer, ask ), 0 );
+
+  rc += TEST( dbBE_Redis_s2r_queue_pop( env._ctx._retry_q ), request );
+  rc += TEST( request->_flags, DBBE_REDIS_REQUEST_FLAG_ASKING );
+  dbBE_Redis_connection_t *dest = request->_location._data._connection;
+  rc += TEST_NOT( dest, NULL );
+  TEST_BREAK( rc, "No pending destination" );
+
+  // the same destination links only once (unless the connect completed right away)
+  char url[ 64 ];
+  snprintf( url, sizeof( url ), "sock://127.0.0.1:%d", ntohs( addr.sin_port ) );
+  if( dbBE_Redis_connection_mgr_link_status( env._ctx._conn_mgr, dest ) > 0 )
+    rc += TEST( dbBE_Redis_connection_mgr_link_async( env._ctx._conn_mgr, url, DBBE_INFO_CATEGORY_UNSPECIFIED ), dest );
+
+  // the event loop of the receiver completes the link-up
+  int i;
+  for( i = 0; ( i < 1000 ) && ( dbBE_Redis_connection_mgr_link_status( env._ctx._conn_mgr, dest ) > 0 ); ++i )
+  {
+    rc += TEST( dbBE_Redis_connection_mgr_get_active( env._ctx._conn_mgr, 0 ), NULL );
+    usleep( 1000 );
+  }
+  rc += TEST( dbBE_Redis_connection_mgr_link_status( env._ctx._conn_mgr, dest ), 0 );
+  rc += TEST( dbBE_Redis_connection_RTS( dest ), 1 );
+  rc += TEST( dbBE_Redis_connection_mgr_get_connection_at( env._ctx._conn_mgr, dest->_index ), dest );
+  dbBE_Redis_request_destroy( request );
+
+  // a refused destination fails without blocking and can be restarted
+  close( listener );
+  rc += TEST_NOT_RC( dbBE_Redis_connection_mgr_link_async( env._ctx._conn_mgr, "sock://127.0.0.1:1", DBBE_INFO_CATEGORY_UNSPECIFIED ), NULL, dest );
+  for( i = 0; ( i < 1000 ) && ( dbBE_Redis_connection_mgr_link_status( env._ctx._conn_mgr, dest ) > 0 ); ++i )
+  {
+    dbBE_Redis_connection_mgr_get_active( env._ctx._conn_mgr, 0 );
+    usleep( 1000 );
+  }
+  rc += TEST( dbBE_Redis_connection_mgr_link_status( env._ctx._conn_mgr, dest ), -ENOTCONN );
+  rc += TEST( dbBE_Redis_connection_RTS( dest ), 0 );
+  rc += TEST( dbBE_Redis_connection_mgr_link_async( env._ctx._conn_mgr, "sock://127.0.0.1:1", DBBE_INFO_CATEGORY_UNSPECIFIED ), dest );
+
+  test_cleanup( &env );
+  printf( "ASK unknown node: rc=%d\n", rc );
+  return rc;
+}
+
+/*
+ * the connection closes in the middle of a response
+ */
+static
+int test_conn_lost()
+{
+  int rc = 0;
+  test_env_t env;
+  rc += TEST( test_setup( &env ), 0 );
+  TEST_BREAK( rc, "Setup failed" );
+
+  dbBE_Redis_request_t *request = test_posted_put( &env, 0, "key" );
+  dbBE_Redis_request_t *next = test_posted_put( &env, 1, "other" );
+  rc += TEST_NOT( request, NULL );
+  rc += TEST_NOT( next, NULL );
+  TEST_BREAK( rc, "Request setup failed" );
+
+  // a redirect in progress is void after the connection is gone
+  request->_flags = DBBE_REDIS_REQUEST_FLAG_ASKING | DBBE_REDIS_REQUEST_FLAG_ASKING_SENT;
+  request->_location._type = DBBE_REDIS_REQUEST_LOCATION_TYPE_CONNECTION;
+  request->_location._data._connection = env._conn;
+
+  rc += TEST( write( env._peer, "+OK\r\n:1", 7 ), 7 );
+  close( env._peer );
+  env._peer = -1;
+  usleep( 1000 );
+  dbBE_Redis_connection_t *conn = env._conn;
+  dbBE_Redis_receiver_trigger( &env._ctx );
+
+  // both requests go for retry in order and the connection is broken
+  rc += TEST( dbBE_Redis_s2r_queue_pop( env._ctx._retry_q ), request );
+  rc += TEST( dbBE_Redis_s2r_queue_pop( env._ctx._retry_q ), next );
+  rc += TEST( request->_flags, 0 );
+  rc += TEST( request->_location._type, DBBE_REDIS_REQUEST_LOCATION_TYPE_UNKNOWN );
+  rc += TEST( env._ctx._conn_mgr->_broken[ conn->_index ], conn );
+  rc += TEST( env._ctx._conn_mgr->_connections[ conn->_index ], NULL );
+  rc += TEST( dbBE_Completion_queue_len( env._ctx._compl_q ), 0 );
+  dbBE_Redis_request_destroy( request );
+  dbBE_Redis_request_destroy( next );
+
+  test_cleanup( &env );
+  printf( "Connection lost: rc=%d\n", rc );
+  return rc;
+}
+
+static
+void test_push_handler( void *arg, dbBE_Redis_connection_t *conn, dbBE_Redis_result_t *push )
+{
+  int *count = (int*)arg;
+  if(( push->_type == dbBE_REDIS_TYPE_PUSH ) && ( push->_data._array._len == 2 ) &&
+      ( strcmp( push->_data._array._data[ 0 ]._data._string._data, "invalidate" ) == 0 ))
+    ++(*count);
+}
+
+/*
+ * RESP3 push frames go to the push handler, not to the posted requests
+ */
+static
+int test_push()
+{
+  int rc = 0;
+  test_env_t env;
+  rc += TEST( test_setup( &env ), 0 );
+  TEST_BREAK( rc, "Setup failed" );
+
+  int pushes = 0;
+  env._ctx._push_handler = test_push_handler;
+  env._ctx._push_arg = &pushes;
+
+  // a push frame without any posted request
+  rc += TEST( test_respond( &env, env._peer, ">2\r\n$10\r\ninvalidate\r\n*1\r\n$3\r\nkey\r\n" ), 0 );
+  rc += TEST( pushes, 1 );
+  rc += TEST( env._ctx._conn_mgr->_connections[ env._conn->_index ], env._conn );
+
+  // push frames in front of and between responses
+  dbBE_Redis_request_t *request = test_posted_put( &env, 0, "key" );
+  dbBE_Redis_request_t *next = test_posted_put( &env, 1, "other" );
+  rc += TEST_NOT( request, NULL );
+  rc += TEST_NOT( next, NULL );
+  TEST_BREAK( rc, "Request setup failed" );
+  rc += TEST( test_respond( &env, env._peer,
+                            ">2\r\n$10\r\ninvalidate\r\n*1\r\n$3\r\nkey\r\n:1\r\n"
+                            ">2\r\n$10\r\ninvalidate\r\n_\r\n:1\r\n" ), 0 );
+  rc += TEST( pushes, 3 );
+  rc += TEST( dbBE_Completion_queue_len( env._ctx._compl_q ), 2 );
+  rc += TEST( dbBE_Redis_s2r_queue_len( env._conn->_posted_q ), 0 );
+  rc += TEST( dbBE_Redis_s2r_queue_len( env._ctx._retry_q ), 0 );
+
+  // the response of a request arrives after a push frame in a separate receive
+  request = test_posted_put( &env, 2, "key" );
+  rc += TEST_NOT( request, NULL );
+  rc += TEST( write( env._peer, ">2\r\n$10\r\ninvalidate\r\n_\r\n", 24 ), 24 );
+  usleep( 1000 );
+  dbBE_Redis_receiver_trigger( &env._ctx );
+  rc += TEST( pushes, 4 );
+  rc += TEST( dbBE_Redis_s2r_queue_len( env._conn->_posted_q ), 1 );
+  rc += TEST( test_respond( &env, env._peer, ":2\r\n" ), 0 );
+  rc += TEST( dbBE_Completion_queue_len( env._ctx._compl_q ), 3 );
+  rc += TEST( dbBE_Redis_s2r_queue_len( env._conn->_posted_q ), 0 );
+
+  test_cleanup( &env );
+  printf( "Push frames: rc=%d\n", rc );
+  return rc;
+}
+
+int main( int argc, char ** argv )
+{
+  int rc = 0;
+
+  setenv( DBR_SERVER_AUTHFILE_ENV, "NONE", 1 );
+  rc += test_ask_reset();
+  rc += test_ask_known();
+  rc += test_ask_drain();
+  rc += test_ask_unknown();
+  rc += test_conn_lost();
+  rc += test_push();
+
+  printf( "Test exiting with rc=%d\n", rc );
+  return rc;
+}
@@ -83,6 +83,25 @@ int TestNSCreate( const char *namespace,
   rc += TEST( dbBE_Redis_parse_sr_buffer( sr_buf, &result ), 0 );
   rc += TEST( dbBE_Redis_process_nscreate( req, &result ), 0 );
 
+  // transition to the refcnt shard stage
+  rc += TEST( dbBE_Redis_request_stage_transition( req ), 0 );
+  rc += TEST( req->_step->_stage, DBBE_REDIS_NSCREATE_STAGE_REFSHARD );
+
+  // returns the new value of the shard (integer)
+  rc += TEST( dbBE_Redis_result_cleanup( &result, 0 ), 0 );
+  dbBE_Transport_sr_buffer_reset( sr_buf );
+
+  len = snprintf( dbBE_Transport_sr_buffer_get_start( sr_buf ),
+                  dbBE_Transport_sr_buffer_get_size( sr_buf ),
+                  ":1\r\n");
+  rc += TEST_NOT( len, -1 );
+  rc += TEST( dbBE_Transport_sr_buffer_add_data( sr_buf, len, 0 ), (size_t)len );
+
+  rc += TEST( dbBE_Redis_parse_sr_buffer( sr_buf, &result ), 0 );
+  rc += TEST( dbBE_Redis_process_nscreate( req, &result ), 0 );
+  rc += TEST( result._type, dbBE_REDIS_TYPE_INT );
+  rc += TEST( result._data._integer, 0 );
+
   rc += TEST( dbBE_Redis_result_cleanup( &result, 0 ), 0 );
 
   return rc;
@@ -119,6 +138,41 @@ int TestNSAttach( const char *namespace,
 
   // transition to next stage
   rc += TEST( dbBE_Redis_request_stage_transition( req ), 0 );
+  rc += TEST( req->_step->_stage, DBBE_REDIS_NSATTACH_STAGE_REFSHARD );
+
+  // create return data to test result of stage 1 (INCR shard)
+  // the shard is opened by this attach: needs to continue with the namespace hash
+  rc += TEST( dbBE_Redis_result_cleanup( &result, 0 ), 0 );
+  dbBE_Transport_sr_buffer_reset( sr_buf );
+
+  len = snprintf( dbBE_Transport_sr_buffer_get_start( sr_buf ),
+                  dbBE_Transport_sr_buffer_get_size( sr_buf ),
+                  ":1\r\n:3\r\n:0\r\n");
+  rc += TEST_NOT( len, -1 );
+  rc += TEST( dbBE_Transport_sr_buffer_add_data( sr_buf, len, 0 ), (size_t)len );
+
+  rc += TEST( dbBE_Redis_parse_sr_buffer( sr_buf, &result ), 0 );
+  rc += TEST( dbBE_Redis_process_nsattach( req, &result ), 0 );
+  rc += TEST( req->_step->_stage, DBBE_REDIS_NSATTACH_STAGE_REFSHARD );
+
+  // the shard was open already: skips to the final stage without touching the namespace hash
+  rc += TEST( dbBE_Redis_result_cleanup( &result, 0 ), 0 );
+  rc += TEST( dbBE_Redis_parse_sr_buffer( sr_buf, &result ), 0 );
+  rc += TEST( dbBE_Redis_process_nsattach( req, &result ), 0 );
+  rc += TEST( req->_step->_stage, DBBE_REDIS_NSATTACH_STAGE_REFCNT );
+  rc += TEST( req->_step->_final, 1 );
+  rc += TEST( result._type, dbBE_REDIS_TYPE_INT );
+  rc += TEST( result._data._integer, 0 );
+
+  // an invalid shard count
+  req->_step = &gRedis_command_spec[ DBBE_OPCODE_NSATTACH * DBBE_REDIS_COMMAND_STAGE_MAX + DBBE_REDIS_NSATTACH_STAGE_REFSHARD ];
+  rc += TEST( dbBE_Redis_result_cleanup( &result, 0 ), 0 );
+  rc += TEST( dbBE_Redis_parse_sr_buffer( sr_buf, &result ), 0 );
+  rc += TEST( dbBE_Redis_process_nsattach( req, &result ), -EOVERFLOW );
+  rc += TEST( req->_step->_stage, DBBE_REDIS_NSATTACH_STAGE_REFSHARD );
+
+  rc += TEST( dbBE_Redis_request_stage_transition( req ), 0 );
+  rc += TEST( req->_step->_stage, DBBE_REDIS_NSATTACH_STAGE_REFCNT );
 
   // create return data to test result of stage 2 (HINCRBY)
   // returns new (increased) value (integer)
@@ -175,7 +229,26 @@ int TestNSDetach( const char *namespace,
   TEST_BREAK( rc, "Conn/ConnMgr setup already failed, can't continue\n" );
 
   // create a dummy request queue (for del)
-  dbBE_Redis_s2r_queue_t *post_queue = dbBE_Redis_s2r_queue_create( 12 );
+  dbBE_Redis_s2r_queue_t *post_queue = dbBE_Redis_s2r_queue_create( 32 );
+
+  // create return data to test the result of stage 0 (DECR shard)
+  // the last reference of the shard needs to continue with the namespace hash
+  rc += TEST( req_io->_step->_stage, DBBE_REDIS_NSDETACH_STAGE_REFSHARD );
+  rc += TEST( dbBE_Redis_result_cleanup( &result, 0 ), 0 );
+  dbBE_Transport_sr_buffer_reset( sr_buf );
+
+  len = snprintf( dbBE_Transport_sr_buffer_get_start( sr_buf ),
+                  dbBE_Transport_sr_buffer_get_size( sr_buf ),
+                  ":0\r\n");
+  rc += TEST_NOT( len, -1 );
+  rc += TEST( dbBE_Transport_sr_buffer_add_data( sr_buf, len, 0 ), (size_t)len );
+
+  rc += TEST( dbBE_Redis_parse_sr_buffer( sr_buf, &result ), 0 );
+  rc += TEST( dbBE_Redis_process_nsdetach( &req_io, &result, post_queue, cmr, 0 ), 0 );
+  rc += TEST( req_io->_step->_stage, DBBE_REDIS_NSDETACH_STAGE_REFSHARD );
+  rc += TEST( req_io->_status.nsdetach.to_delete, 1 );
+  rc += TEST( dbBE_Redis_request_stage_transition( req_io ), 0 );
+  rc += TEST( req_io->_step->_stage, DBBE_REDIS_NSDETACH_STAGE_DELCHECK );
 
 
   // create return data struct to test result of stage one (HMGET refcnt flags)
@@ -228,7 +301,8 @@ int TestNSDetach( const char *namespace,
   rc += TEST( dbBE_Redis_parse_sr_buffer( sr_buf, &result ), 0 );
   rc += TEST( dbBE_Redis_process_nsdetach( &req_io, &result, post_queue, cmr, 0 ), 0 );
 
-  rc += TEST( dbBE_Redis_s2r_queue_len( post_queue ), 5 );
+  // the 5 keys plus the refcnt shards queued by the delete check
+  rc += TEST( dbBE_Redis_s2r_queue_len( post_queue ), 5 + DBBE_REDIS_NAMESPACE_REFCNT_SHARDS );
 
   // pop the first request from the queue to get a prepared delete key request
   req_io = NULL;
@@ -282,8 +356,33 @@ int TestNSDetach( const char *namespace,
   dbBE_Redis_request_destroy( req_io );
   req_io = NULL;
 
-  // reset the request stage
+  // reset the request stage: the shard stays open because of other attachments
   req->_step = &gRedis_command_spec[ DBBE_OPCODE_NSDETACH * DBBE_REDIS_COMMAND_STAGE_MAX + 0 ];
+  rc += TEST( req->_step->_stage, DBBE_REDIS_NSDETACH_STAGE_REFSHARD );
+  rc += TEST( dbBE_Redis_result_cleanup( &result, 0 ), 0 );
+  dbBE_Transport_sr_buffer_reset( sr_buf );
+
+  len = snprintf( dbBE_Transport_sr_buffer_get_start( sr_buf ),
+                  dbBE_Transport_sr_buffer_get_size( sr_buf ),
+                  ":2\r\n:-1\r\n");
+  rc += TEST_NOT( len, -1 );
+  rc += TEST( dbBE_Transport_sr_buffer_add_data( sr_buf, len, 0 ), (size_t)len );
+
+  rc += TEST( dbBE_Redis_parse_sr_buffer( sr_buf, &result ), 0 );
+  rc += TEST( dbBE_Redis_process_nsdetach( &req, &result, post_queue, cmr, 0 ), 0 );
+
+  // detach-only completes in the final stage without touching the namespace hash
+  rc += TEST( req->_step->_stage, DBBE_REDIS_NSDETACH_STAGE_DELNS );
+  rc += TEST( dbBE_Redis_s2r_queue_len( post_queue ), 0 );
+
+  // a negative shard count is an error
+  req->_step = &gRedis_command_spec[ DBBE_OPCODE_NSDETACH * DBBE_REDIS_COMMAND_STAGE_MAX + DBBE_REDIS_NSDETACH_STAGE_REFSHARD ];
+  rc += TEST( dbBE_Redis_result_cleanup( &result, 0 ), 0 );
+  rc += TEST( dbBE_Redis_parse_sr_buffer( sr_buf, &result ), 0 );
+  rc += TEST( dbBE_Redis_process_nsdetach( &req, &result, post_queue, cmr, 0 ), -EOVERFLOW );
+
+  // reset the request stage to the delete check
+  req->_step = &gRedis_command_spec[ DBBE_OPCODE_NSDETACH * DBBE_REDIS_COMMAND_STAGE_MAX + DBBE_REDIS_NSDETACH_STAGE_DELCHECK ];
   rc += TEST( req->_step->_stage, DBBE_REDIS_NSDETACH_STAGE_DELCHECK );
   // Set the first stage response to go the detach-path
   rc += TEST( dbBE_Redis_result_cleanup( &result, 0 ), 0 );
@@ -312,64 +411,65 @@ int TestNSDetach( const char *namespace,
 }
 
 
-int TestNSDelete( const char *namespace,
-                  dbBE_Redis_sr_buffer_t *sr_buf,
-                  dbBE_Redis_request_t *req )
+/*
+ * run the EXIST and REFSHARD stages of a delete with the given responses
+ * leaves the request in the REFSHARD stage
+ */
+static
+int NSDeleteBusyCheck( dbBE_Redis_sr_buffer_t *sr_buf,
+                       dbBE_Redis_request_t *req,
+                       const char *hmget_response,
+                       const char *get_response,
+                       const int expected_rc,
+                       const int64_t expected_others )
 {
   int rc = 0;
   int len;
-  rc += TEST_NOT( req, NULL );
-
   dbBE_Redis_result_t result;
   memset( &result, 0, sizeof( dbBE_Redis_result_t ) );
 
-  rc += TEST( req->_step->_stage, DBBE_REDIS_NSDELETE_STAGE_EXIST );
-
-  // create return data to test result of stage 0 (HMGET refcnt flags)
-  // return needs to be <=1 and 0 (or it's an error)
-  rc += TEST( dbBE_Redis_result_cleanup( &result, 0 ), 0 );
+  req->_step = &gRedis_command_spec[ DBBE_OPCODE_NSDELETE * DBBE_REDIS_COMMAND_STAGE_MAX + DBBE_REDIS_NSDELETE_STAGE_EXIST ];
   dbBE_Transport_sr_buffer_reset( sr_buf );
-
   len = snprintf( dbBE_Transport_sr_buffer_get_start( sr_buf ),
                   dbBE_Transport_sr_buffer_get_size( sr_buf ),
-                  "*2\r\n$1\r\n1\r\n$1\r\n0\r\n");
+                  "%s%s", hmget_response, get_response );
   rc += TEST_NOT( len, -1 );
   rc += TEST( dbBE_Transport_sr_buffer_add_data( sr_buf, len, 0 ), (size_t)len );
 
   rc += TEST( dbBE_Redis_parse_sr_buffer( sr_buf, &result ), 0 );
   rc += TEST( dbBE_Redis_process_nsdelete( req, &result ), 0 );
-
-
   rc += TEST( dbBE_Redis_result_cleanup( &result, 0 ), 0 );
-  dbBE_Transport_sr_buffer_reset( sr_buf );
 
-  // create BUSY error situation with refcnt > 1
-  len = snprintf( dbBE_Transport_sr_buffer_get_start( sr_buf ),
-                  dbBE_Transport_sr_buffer_get_size( sr_buf ),
-                  "*2\r\n$1\r\n2\r\n$1\r\n0\r\n");
-  rc += TEST_NOT( len, -1 );
-  rc += TEST( dbBE_Transport_sr_buffer_add_data( sr_buf, len, 0 ), (size_t)len );
+  rc += TEST( dbBE_Redis_request_stage_transition( req ), 0 );
+  rc += TEST( req->_step->_stage, DBBE_REDIS_NSDELETE_STAGE_REFSHARD );
 
   rc += TEST( dbBE_Redis_parse_sr_buffer( sr_buf, &result ), 0 );
-  rc += TEST( dbBE_Redis_process_nsdelete( req, &result ), EBUSY );
+  rc += TEST( dbBE_Redis_process_nsdelete( req, &result ), expected_rc );
   rc += TEST( result._type, dbBE_REDIS_TYPE_INT );
-  rc += TEST( result._data._integer, 1 );
-
+  rc += TEST( result._data._integer, expected_others );
   rc += TEST( dbBE_Redis_result_cleanup( &result, 0 ), 0 );
-  dbBE_Transport_sr_buffer_reset( sr_buf );
+  return rc;
+}
 
-  // create situation with refcnt = 1; flags set
-  len = snprintf( dbBE_Transport_sr_buffer_get_start( sr_buf ),
-                  dbBE_Transport_sr_buffer_get_size( sr_buf ),
-                  "*2\r\n$1\r\n1\r\n$1\r\n1\r\n");
-  rc += TEST_NOT( len, -1 );
-  rc += TEST( dbBE_Transport_sr_buffer_add_data( sr_buf, len, 0 ), (size_t)len );
+int TestNSDelete( const char *namespace,
+                  dbBE_Redis_sr_buffer_t *sr_buf,
+                  dbBE_Redis_request_t *req )
+{
+  int rc = 0;
+  int len;
+  rc += TEST_NOT( req, NULL );
 
-  rc += TEST( dbBE_Redis_parse_sr_buffer( sr_buf, &result ), 0 );
-  rc += TEST( dbBE_Redis_process_nsdelete( req, &result ), 0 );
-  rc += TEST( result._type, dbBE_REDIS_TYPE_INT );
-  rc += TEST( result._data._integer, 0 );
+  dbBE_Redis_result_t result;
+  memset( &result, 0, sizeof( dbBE_Redis_result_t ) );
+
+  rc += TEST( req->_step->_stage, DBBE_REDIS_NSDELETE_STAGE_EXIST );
 
+  // the namespace is busy if another shard is open (refcnt > 1) or if the own shard has other references
+  rc += NSDeleteBusyCheck( sr_buf, req, "*2\r\n$1\r\n1\r\n$1\r\n0\r\n", "$1\r\n1\r\n", 0, 0 );
+  rc += NSDeleteBusyCheck( sr_buf, req, "*2\r\n$1\r\n2\r\n$1\r\n0\r\n", "$1\r\n1\r\n", EBUSY, 1 );
+  rc += NSDeleteBusyCheck( sr_buf, req, "*2\r\n$1\r\n1\r\n$1\r\n0\r\n", "$1\r\n3\r\n", EBUSY, 2 );
+  rc += NSDeleteBusyCheck( sr_buf, req, "*2\r\n$1\r\n3\r\n$1\r\n0\r\n", "$1\r\n2\r\n", EBUSY, 3 );
+  rc += NSDeleteBusyCheck( sr_buf, req, "*2\r\n$1\r\n1\r\n$1\r\n1\r\n", "$-1\r\n", 0, 0 );
 
   // create return data to test result of stage 1 (HSET)
   // return needs to be 0 (or it's an error)
@@ -737,6 +837,7 @@ int main( int argc, char ** argv )
 
 
   ureq->_opcode = DBBE_OPCODE_NSDETACH;
+  ureq->_ns_hdl = dbBE_Redis_namespace_create( "TestNS" );
   ureq->_sge[0].iov_base = NULL;
   ureq->_sge[0].iov_len = 0;
 
@@ -817,6 +918,7 @@ int main( int argc, char ** argv )
   dbBE_Redis_request_destroy( req );
 
   free( ureq->_key );
+  dbBE_Redis_namespace_destroy( (dbBE_Redis_namespace_t*)ureq->_ns_hdl );
   free( ureq );
 
   dbBE_Transport_sr_buffer_free( sr_buf );
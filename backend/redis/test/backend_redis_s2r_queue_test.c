@@ -85,6 +85,24 @@ int main( int argc, char ** argv )
   }
   rc += TEST( dbBE_Redis_s2r_queue_len( queue ), 0 );
 
+  // put items back in front: into the empty queue and ahead of existing ones
+  rc += TEST( dbBE_Redis_s2r_queue_push_front( queue, NULL ), -EINVAL );
+  rc += TEST( dbBE_Redis_s2r_queue_push_front( queue, &req[1] ), 0 );
+  rc += TEST( dbBE_Redis_s2r_queue_push( queue, &req[2] ), 0 );
+  rc += TEST( dbBE_Redis_s2r_queue_push_front( queue, &req[0] ), 0 );
+  rc += TEST( dbBE_Redis_s2r_queue_len( queue ), 3 );
+  for( i=0; i<3; ++i )
+  {
+    ret = dbBE_Redis_s2r_queue_pop( queue );
+    rc += TEST_NOT( ret, NULL );
+    if( ret != NULL )
+      rc += TEST( ret->_location._data._conn_idx, i );
+  }
+  rc += TEST( dbBE_Redis_s2r_queue_pop( queue ), NULL );
+  rc += TEST( dbBE_Redis_s2r_queue_push_front( queue, &req[3] ), 0 );
+  rc += TEST( dbBE_Redis_s2r_queue_pop( queue ), &req[3] );
+  rc += TEST( dbBE_Redis_s2r_queue_len( queue ), 0 );
+
   // add a few items before destruction, to employ the wiping code path
   for( i=0; i<3; ++i )
     rc += TEST( dbBE_Redis_s2r_queue_push( queue, &req[i] ), 0 );
@@ -0,0 +1,62 @@
+/*
+ * Copyright © 2020 IBM Corporation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#ifndef BACKEND_SHM_DEFINITIONS_H_
+#define BACKEND_SHM_DEFINITIONS_H_
+
+#include <libdatabroker.h>
+
+/*
+ * name of the POSIX shared memory segment (shm_open() name)
+ * all processes on a node using the same name share the same data
+ */
+#define DBR_SHM_NAME_ENV "DBR_SHM_NAME"
+#define DBR_SHM_DEFAULT_NAME "/dbr_shm"
+
+/*
+ * size of the segment in bytes; only relevant for the process that creates the segment
+ */
+#define DBR_SHM_SIZE_ENV "DBR_SHM_SIZE"
+#define DBR_SHM_DEFAULT_SIZE "1073741824"
+
+/*
+ * number of slots of the tuple index (rounded up to a power of 2)
+ * only relevant for the process that creates the segment
+ */
+#define DBR_SHM_INDEX_ENV "DBR_SHM_INDEX_SIZE"
+#define DBR_SHM_DEFAULT_INDEX "65536"
+
+#define DBBE_SHM_MAGIC ( 0x31304d4853524244ull ) // "DBRSHM01"
+#define DBBE_SHM_VERSION ( 2 )
+
+#define DBBE_SHM_WORK_QUEUE_DEPTH ( 4096 )
+
+// max number of namespaces that can exist in one segment at the same time
+#define DBBE_SHM_NAMESPACE_MAX ( 1024 )
+#define DBBE_SHM_NAMESPACE_NAME_MAX ( DBR_MAX_KEY_LEN )
+#define DBBE_SHM_NAMESPACE_GROUPS_MAX ( 63 )
+
+// smallest segment that makes sense (header, index, and some heap)
+#define DBBE_SHM_MIN_SIZE ( 4 * 1024 * 1024 )
+
+// how often open retries if the segment got removed by its last user in the meantime
+#define DBBE_SHM_OPEN_RETRIES ( 10 )
+
+// how long (in sec) a process waits for another process to finish the segment initialization
+#define DBBE_SHM_INIT_TIMEOUT ( 10 )
+
+#endif /* BACKEND_SHM_DEFINITIONS_H_ */
@@ -0,0 +1,410 @@
+/*
+ * Copyright © 2020 IBM Corporation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#include "logutil.h"
+#include "index.h"
+
+#include <errno.h>
+#include <inttypes.h>
+#include <string.h>
+
+// a slot whose key entry got removed; lookups have to probe past it
+#define DBBE_SHM_INDEX_TOMBSTONE ( (dbBE_Shm_offset_t)1 )
+
+static inline
+uint64_t dbBE_Shm_hash( const uint32_t ns_id, const char *key, const size_t len )
+{
+  // FNV-1a seeded with the namespace slot
+  uint64_t h = 0xcbf29ce484222325ull ^ ( (uint64_t)ns_id * 0x9E3779B97F4A7C15ull );
+  size_t n;
+  for( n = 0; n < len; ++n )
+  {
+    h ^= (uint8_t)key[ n ];
+    h *= 0x100000001b3ull;
+  }
+  return h;
+}
+
+static inline
+dbBE_Shm_offset_t* dbBE_Shm_index_slots( dbBE_Shm_segment_t *seg )
+{
+  return (dbBE_Shm_offset_t*)dbBE_Shm_ptr( seg, seg->_index );
+}
+
+static inline
+int dbBE_Shm_key_match( const dbBE_Shm_key_t *k,
+                        const uint64_t hash,
+                        const uint32_t ns_id,
+                        const char *key,
+                        const size_t keylen )
+{
+  return (( k->_hash == hash ) &&
+          ( k->_ns_id == ns_id ) &&
+          ( k->_keylen == keylen ) &&
+          ( memcmp( k->_key, key, keylen ) == 0 ));
+}
+
+dbBE_Shm_key_t* dbBE_Shm_index_lookup( dbBE_Shm_segment_t *seg,
+                                       const uint32_t ns_id,
+                                       const char *key,
+                                       const int create )
+{
+  if(( seg == NULL ) || ( key == NULL ))
+  {
+    errno = EINVAL;
+    return NULL;
+  }
+
+  size_t keylen = strnlen( key, DBR_MAX_KEY_LEN + 1 );
+  if( keylen > DBR_MAX_KEY_LEN )
+  {
+    errno = EINVAL;
+    return NULL;
+  }
+
+  uint64_t hash = dbBE_Shm_hash( ns_id, key, keylen );
+  uint64_t mask = seg->_index_len - 1;
+  dbBE_Shm_offset_t *slots = dbBE_Shm_index_slots( seg );
+  dbBE_Shm_key_t *k = NULL;
+  int64_t free_slot = -1;
+
+  dbBE_Shm_lock( &seg->_index_lock );
+  uint64_t pos = hash & mask;
+  uint64_t probe;
+  for( probe = 0; probe <= mask; ++probe, pos = ( pos + 1 ) & mask )
+  {
+    dbBE_Shm_offset_t off = slots[ pos ];
+    if( off == 0 )
+    {
+      if( free_slot < 0 )
+        free_slot = pos;
+      break;
+    }
+    if( off == DBBE_SHM_INDEX_TOMBSTONE )
+    {
+      if( free_slot < 0 )
+        free_slot = pos;
+      continue;
+    }
+    if( dbBE_Shm_key_match( (dbBE_Shm_key_t*)dbBE_Shm_ptr( seg, off ), hash, ns_id, key, keylen ) )
+    {
+      k = (dbBE_Shm_key_t*)dbBE_Shm_ptr( seg, off );
+      ++k->_users;
+      goto exit;
+    }
+  }
+
+  if( ! create )
+  {
+    errno = ENOENT;
+    goto exit;
+  }
+  if( free_slot < 0 )
+  {
+    LOG( DBG_ERR, stderr, "shm index is full (%"PRIu64" slots)\n", seg->_index_len );
+    errno = ENOSPC;
+    goto exit;
+  }
+
+  dbBE_Shm_offset_t new_off = dbBE_Shm_alloc( seg, sizeof( dbBE_Shm_key_t ) + keylen + 1 );
+  if( new_off == 0 )
+  {
+    errno = ENOMEM;
+    goto exit;
+  }
+  k = (dbBE_Shm_key_t*)dbBE_Shm_ptr( seg, new_off );
+  memset( k, 0, sizeof( dbBE_Shm_key_t ) );
+  if( dbBE_Shm_lock_init( &k->_lock ) != 0 )
+  {
+    dbBE_Shm_free( seg, new_off );
+    k = NULL;
+    errno = ENOMEM;
+    goto exit;
+  }
+  k->_hash = hash;
+  k->_ns_id = ns_id;
+  k->_keylen = keylen;
+  k->_users = 1;
+  memcpy( k->_key, key, keylen );
+  k->_key[ keylen ] = '\0';
+  slots[ free_slot ] = new_off;
+
+exit:
+  dbBE_Shm_unlock( &seg->_index_lock );
+  return k;
+}
+
+dbBE_Shm_key_t* dbBE_Shm_index_next( dbBE_Shm_segment_t *seg,
+                                     uint64_t *pos )
+{
+  if(( seg == NULL ) || ( pos == NULL ))
+    return NULL;
+
+  dbBE_Shm_offset_t *slots = dbBE_Shm_index_slots( seg );
+  dbBE_Shm_key_t *k = NULL;
+  dbBE_Shm_lock( &seg->_index_lock );
+  for( ; *pos < seg->_index_len; ++(*pos) )
+  {
+    dbBE_Shm_offset_t off = slots[ *pos ];
+    if(( off != 0 ) && ( off != DBBE_SHM_INDEX_TOMBSTONE ))
+    {
+      ++(*pos);
+      k = (dbBE_Shm_key_t*)dbBE_Shm_ptr( seg, off );
+      ++k->_users;
+      break;
+    }
+  }
+  dbBE_Shm_unlock( &seg->_index_lock );
+  return k;
+}
+
+void dbBE_Shm_index_release( dbBE_Shm_segment_t *seg,
+                             dbBE_Shm_key_t *k )
+{
+  if(( seg == NULL ) || ( k == NULL ))
+    return;
+
+  dbBE_Shm_lock( &seg->_index_lock );
+  if( --k->_users > 0 )
+  {
+    dbBE_Shm_unlock( &seg->_index_lock );
+    return;
+  }
+
+  // nobody else can find the entry without the index lock; only the values can still change
+  dbBE_Shm_lock( &k->_lock );
+  int empty = ( k->_count == 0 );
+  dbBE_Shm_unlock( &k->_lock );
+  if( empty )
+  {
+    dbBE_Shm_offset_t *slots = dbBE_Shm_index_slots( seg );
+    dbBE_Shm_offset_t off = dbBE_Shm_offset( seg, k );
+    uint64_t mask = seg->_index_len - 1;
+    uint64_t pos = k->_hash & mask;
+    uint64_t probe;
+    for( probe = 0; ( probe <= mask ) && ( slots[ pos ] != off ); ++probe )
+      pos = ( pos + 1 ) & mask;
+    if( slots[ pos ] == off )
+    {
+      // the end of a probe chain can become empty again, everything else has to stay a tombstone
+      slots[ pos ] = ( slots[ ( pos + 1 ) & mask ] == 0 ) ? 0 : DBBE_SHM_INDEX_TOMBSTONE;
+      pthread_mutex_destroy( &k->_lock );
+      dbBE_Shm_free( seg, off );
+    }
+  }
+  dbBE_Shm_unlock( &seg->_index_lock );
+}
+
+static
+int64_t dbBE_Shm_key_drop_values( dbBE_Shm_segment_t *seg,
+                                  dbBE_Shm_key_t *k )
+{
+  int64_t count = 0;
+  dbBE_Shm_offset_t off = k->_head;
+  while( off != 0 )
+  {
+    dbBE_Shm_value_t *v = (dbBE_Shm_value_t*)dbBE_Shm_ptr( seg, off );
+    dbBE_Shm_offset_t next = v->_next;
+    dbBE_Shm_free( seg, off );
+    off = next;
+    ++count;
+  }
+  k->_head = 0;
+  k->_tail = 0;
+  k->_count = 0;
+  return count;
+}
+
+void dbBE_Shm_key_lock( dbBE_Shm_segment_t *seg,
+                        dbBE_Shm_key_t *k,
+                        const uint32_t ns_gen )
+{
+  dbBE_Shm_lock( &k->_lock );
+  if( k->_ns_gen != ns_gen )
+  {
+    dbBE_Shm_key_drop_values( seg, k );
+    k->_ns_gen = ns_gen;
+  }
+}
+
+static inline
+int64_t dbBE_Shm_scatter( const char *data, int64_t len, dbBE_sge_t *sge, const int sge_count )
+{
+  int64_t copied = 0;
+  int n;
+  for( n = 0; ( n < sge_count ) && ( copied < len ); ++n )
+  {
+    int64_t chunk = (int64_t)sge[ n ].iov_len < len - copied ? (int64_t)sge[ n ].iov_len : len - copied;
+    memcpy( sge[ n ].iov_base, data + copied, chunk );
+    copied += chunk;
+  }
+  return copied;
+}
+
+int dbBE_Shm_key_put( dbBE_Shm_segment_t *seg,
+                      dbBE_Shm_key_t *k,
+                      const uint32_t ns_gen,
+                      const dbBE_sge_t *sge,
+                      const int sge_count )
+{
+  if(( seg == NULL ) || ( k == NULL ) || (( sge == NULL ) && ( sge_count > 0 )))
+    return -EINVAL;
+
+  size_t len = dbBE_SGE_get_len( sge, sge_count );
+  dbBE_Shm_offset_t off = dbBE_Shm_alloc( seg, sizeof( dbBE_Shm_value_t ) + len );
+  if( off == 0 )
+    return -ENOMEM;
+
+  // copy the data before the value becomes visible to anyone else
+  dbBE_Shm_value_t *v = (dbBE_Shm_value_t*)dbBE_Shm_ptr( seg, off );
+  v->_next = 0;
+  v->_len = len;
+  size_t pos = 0;
+  int n;
+  for( n = 0; n < sge_count; ++n )
+  {
+    memcpy( v->_data + pos, sge[ n ].iov_base, sge[ n ].iov_len );
+    pos += sge[ n ].iov_len;
+  }
+
+  dbBE_Shm_key_lock( seg, k, ns_gen );
+  if( k->_tail != 0 )
+    ((dbBE_Shm_value_t*)dbBE_Shm_ptr( seg, k->_tail ))->_next = off;
+  else
+    k->_head = off;
+  k->_tail = off;
+  ++k->_count;
+  dbBE_Shm_key_unlock( k );
+  return 0;
+}
+
+int dbBE_Shm_key_fetch( dbBE_Shm_segment_t *seg,
+                        dbBE_Shm_key_t *k,
+                        const uint32_t ns_gen,
+                        const int64_t idx,
+                        const int flags,
+                        dbBE_sge_t *sge,
+                        const int sge_count,
+                        int64_t *size )
+{
+  if(( seg == NULL ) || ( k == NULL ) || ( size == NULL ) || ( idx < 0 ))
+    return -EINVAL;
+
+  int64_t space = dbBE_SGE_get_len( sge, sge_count );
+  int consume = (( flags & DBBE_SHM_FETCH_CONSUME ) != 0 );
+
+  dbBE_Shm_key_lock( seg, k, ns_gen );
+  dbBE_Shm_offset_t off = k->_head;
+  int64_t n;
+  for( n = consume ? 0 : idx; ( n > 0 ) && ( off != 0 ); --n )
+    off = ((dbBE_Shm_value_t*)dbBE_Shm_ptr( seg, off ))->_next;
+
+  if( off == 0 )
+  {
+    dbBE_Shm_key_unlock( k );
+    return -ENOENT;
+  }
+
+  dbBE_Shm_value_t *v = (dbBE_Shm_value_t*)dbBE_Shm_ptr( seg, off );
+  *size = v->_len;
+  if(( v->_len > space ) && (( flags & DBBE_SHM_FETCH_PARTIAL ) == 0 ))
+  {
+    dbBE_Shm_key_unlock( k );
+    return -ENOSPC;
+  }
+
+  if( ! consume )
+  {
+    // the value stays in the list, so it has to be copied under the lock
+    dbBE_Shm_scatter( v->_data, v->_len, sge, sge_count );
+    dbBE_Shm_key_unlock( k );
+    return 0;
+  }
+
+  k->_head = v->_next;
+  if( k->_head == 0 )
+    k->_tail = 0;
+  --k->_count;
+  dbBE_Shm_key_unlock( k );
+
+  // the value is now private to this process
+  dbBE_Shm_scatter( v->_data, v->_len, sge, sge_count );
+  dbBE_Shm_free( seg, off );
+  return 0;
+}
+
+int64_t dbBE_Shm_key_clear( dbBE_Shm_segment_t *seg,
+                            dbBE_Shm_key_t *k,
+                            const uint32_t ns_gen )
+{
+  if(( seg == NULL ) || ( k == NULL ))
+    return -EINVAL;
+
+  dbBE_Shm_key_lock( seg, k, ns_gen );
+  int64_t count = dbBE_Shm_key_drop_values( seg, k );
+  dbBE_Shm_key_unlock( k );
+  return count;
+}
+
+int dbBE_Shm_key_move( dbBE_Shm_segment_t *seg,
+                       dbBE_Shm_key_t *src,
+                       const uint32_t src_gen,
+                       dbBE_Shm_key_t *dst,
+                       const uint32_t dst_gen )
+{
+  if(( seg == NULL ) || ( src == NULL ) || ( dst == NULL ))
+    return -EINVAL;
+
+  if( src == dst )
+  {
+    dbBE_Shm_key_lock( seg, src, src_gen );
+    int rc = ( src->_count > 0 ) ? -EEXIST : -ENOENT;
+    dbBE_Shm_key_unlock( src );
+    return rc;
+  }
+
+  // fixed lock order to prevent deadlocks between concurrent moves
+  if( src < dst )
+  {
+    dbBE_Shm_key_lock( seg, src, src_gen );
+    dbBE_Shm_key_lock( seg, dst, dst_gen );
+  }
+  else
+  {
+    dbBE_Shm_key_lock( seg, dst, dst_gen );
+    dbBE_Shm_key_lock( seg, src, src_gen );
+  }
+
+  int rc = 0;
+  if( src->_count == 0 )
+    rc = -ENOENT;
+  else if( dst->_count != 0 )
+    rc = -EEXIST;
+  else
+  {
+    dst->_head = src->_head;
+    dst->_tail = src->_tail;
+    dst->_count = src->_count;
+    src->_head = 0;
+    src->_tail = 0;
+    src->_count = 0;
+  }
+
+  dbBE_Shm_key_unlock( src );
+  dbBE_Shm_key_unlock( dst );
+  return rc;
+}
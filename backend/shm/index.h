@@ -0,0 +1,145 @@
+/*
+ * Copyright © 2020 IBM Corporation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#ifndef BACKEND_SHM_INDEX_H_
+#define BACKEND_SHM_INDEX_H_
+
+#include "common/sge.h"
+#include "segment.h"
+
+/*
+ * Tuple index:
+ * open addressing hash table with linear probing. A slot is either 0 (empty),
+ * a tombstone, or holds the offset of a key entry. The slots are protected by
+ * the index lock. Every lookup takes a reference on the returned key entry
+ * that has to be dropped with dbBE_Shm_index_release(). Once the last
+ * reference to an entry without values is dropped, the entry is freed and
+ * its slot becomes a tombstone that can be reused by later inserts.
+ *
+ * Each key entry holds the FIFO list of values stored under that key.
+ * The list is protected by a per-key lock. Value data is copied
+ * outside of the lock for put and get.
+ */
+typedef struct
+{
+  dbBE_Shm_offset_t _next;
+  int64_t _len;
+  char _data[];
+} dbBE_Shm_value_t;
+
+typedef struct
+{
+  uint64_t _hash;
+  uint32_t _ns_id;           /**< namespace slot */
+  uint32_t _ns_gen;          /**< namespace generation that the values belong to */
+  uint32_t _keylen;
+  dbBE_Shm_lock_t _lock;
+  int64_t _users;            /**< references from lookups, protected by the index lock */
+  int64_t _count;            /**< number of values in the list */
+  dbBE_Shm_offset_t _head;
+  dbBE_Shm_offset_t _tail;
+  char _key[];
+} dbBE_Shm_key_t;
+
+#define DBBE_SHM_FETCH_CONSUME ( 0x1 )
+#define DBBE_SHM_FETCH_PARTIAL ( 0x2 )
+
+/*
+ * find the key entry of a tuple name in a namespace slot and take a reference
+ * if create is set, a missing entry is inserted
+ * returns NULL and sets errno: ENOENT if not found,
+ *   ENOSPC if the index is full, ENOMEM if the heap is exhausted
+ */
+dbBE_Shm_key_t* dbBE_Shm_index_lookup( dbBE_Shm_segment_t *seg,
+                                       const uint32_t ns_id,
+                                       const char *key,
+                                       const int create );
+
+/*
+ * iterate the index: return the first key entry at or after slot *pos
+ * and set *pos to the slot after it. Returns NULL at the end of the index.
+ * Takes a reference on the returned entry like dbBE_Shm_index_lookup().
+ */
+dbBE_Shm_key_t* dbBE_Shm_index_next( dbBE_Shm_segment_t *seg,
+                                     uint64_t *pos );
+
+/*
+ * drop a reference taken by lookup or next
+ * the entry is removed from the index if it was the last one and the key has no values
+ */
+void dbBE_Shm_index_release( dbBE_Shm_segment_t *seg,
+                             dbBE_Shm_key_t *k );
+
+/*
+ * lock a key entry for the given namespace generation
+ * values left over from an earlier generation of the namespace are dropped
+ */
+void dbBE_Shm_key_lock( dbBE_Shm_segment_t *seg,
+                        dbBE_Shm_key_t *k,
+                        const uint32_t ns_gen );
+
+static inline
+void dbBE_Shm_key_unlock( dbBE_Shm_key_t *k )
+{
+  dbBE_Shm_unlock( &k->_lock );
+}
+
+/*
+ * append a copy of the data in sge to the list of values
+ * returns 0 on success, -ENOMEM if there's not enough space in the segment
+ */
+int dbBE_Shm_key_put( dbBE_Shm_segment_t *seg,
+                      dbBE_Shm_key_t *k,
+                      const uint32_t ns_gen,
+                      const dbBE_sge_t *sge,
+                      const int sge_count );
+
+/*
+ * copy the value at position idx of the list into sge
+ * with DBBE_SHM_FETCH_CONSUME, the first value is removed from the list (idx is ignored)
+ * *size is set to the length of the value
+ * returns 0 on success, -ENOENT if there's no value,
+ *   -ENOSPC if sge is too small (and DBBE_SHM_FETCH_PARTIAL isn't set), the value stays in place
+ */
+int dbBE_Shm_key_fetch( dbBE_Shm_segment_t *seg,
+                        dbBE_Shm_key_t *k,
+                        const uint32_t ns_gen,
+                        const int64_t idx,
+                        const int flags,
+                        dbBE_sge_t *sge,
+                        const int sge_count,
+                        int64_t *size );
+
+/*
+ * remove all values of a key
+ * returns the number of removed values
+ */
+int64_t dbBE_Shm_key_clear( dbBE_Shm_segment_t *seg,
+                            dbBE_Shm_key_t *k,
+                            const uint32_t ns_gen );
+
+/*
+ * move the full list of values from src to dst
+ * returns 0 on success, -ENOENT if src has no values, -EEXIST if dst has values
+ */
+int dbBE_Shm_key_move( dbBE_Shm_segment_t *seg,
+                       dbBE_Shm_key_t *src,
+                       const uint32_t src_gen,
+                       dbBE_Shm_key_t *dst,
+                       const uint32_t dst_gen );
+
+#endif /* BACKEND_SHM_INDEX_H_ */
@@ -0,0 +1,290 @@
+/*
+ * Copyright © 2020 IBM Corporation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#include "logutil.h"
+#include "namespace.h"
+#include "index.h"
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/*
+ * find a used namespace slot by name; requires the namespace lock
+ */
+static
+int dbBE_Shm_namespace_find( dbBE_Shm_segment_t *seg, const char *name )
+{
+  int n;
+  for( n = 0; n < DBBE_SHM_NAMESPACE_MAX; ++n )
+    if(( seg->_ns[ n ]._flags & DBBE_SHM_NSFLAG_USED ) &&
+        ( strncmp( seg->_ns[ n ]._name, name, DBBE_SHM_NAMESPACE_NAME_MAX ) == 0 ))
+      return n;
+  return -1;
+}
+
+static
+dbBE_Shm_namespace_t* dbBE_Shm_namespace_handle( dbBE_Shm_segment_t *seg, const int id )
+{
+  dbBE_Shm_namespace_t *ns = (dbBE_Shm_namespace_t*)calloc( 1, sizeof( dbBE_Shm_namespace_t ) );
+  if( ns == NULL )
+  {
+    errno = ENOMEM;
+    return NULL;
+  }
+  ns->_check = DBBE_SHM_NAMESPACE_CHECK;
+  ns->_id = id;
+  ns->_gen = seg->_ns[ id ]._gen;
+  ns->_local_refcnt = 1;
+  return ns;
+}
+
+static
+void dbBE_Shm_namespace_handle_free( dbBE_Shm_namespace_t *ns )
+{
+  memset( ns, 0, sizeof( dbBE_Shm_namespace_t ) );
+  free( ns );
+}
+
+/*
+ * requires the namespace lock
+ */
+static inline
+int dbBE_Shm_namespace_validate_locked( dbBE_Shm_segment_t *seg,
+                                        dbBE_Shm_namespace_t *ns )
+{
+  if(( ns->_check != DBBE_SHM_NAMESPACE_CHECK ) || ( ns->_id >= DBBE_SHM_NAMESPACE_MAX ))
+    return -EBADF;
+  dbBE_Shm_nsentry_t *entry = &seg->_ns[ ns->_id ];
+  if((( entry->_flags & DBBE_SHM_NSFLAG_USED ) == 0 ) || ( entry->_gen != ns->_gen ))
+    return -ESTALE;
+  return 0;
+}
+
+/*
+ * remove all values of the namespace from the index
+ * requires the namespace lock
+ */
+static
+void dbBE_Shm_namespace_wipe( dbBE_Shm_segment_t *seg, const uint32_t id, const uint32_t gen )
+{
+  uint64_t pos = 0;
+  dbBE_Shm_key_t *k;
+  while(( k = dbBE_Shm_index_next( seg, &pos )) != NULL )
+  {
+    if( k->_ns_id == id )
+      dbBE_Shm_key_clear( seg, k, gen );
+    dbBE_Shm_index_release( seg, k );
+  }
+}
+
+dbBE_Shm_namespace_t* dbBE_Shm_namespace_create( dbBE_Shm_segment_t *seg,
+                                                 const char *name,
+                                                 const char *groups,
+                                                 const size_t groups_len )
+{
+  if(( seg == NULL ) || ( name == NULL ))
+  {
+    errno = EINVAL;
+    return NULL;
+  }
+  if( strnlen( name, DBBE_SHM_NAMESPACE_NAME_MAX + 1 ) > DBBE_SHM_NAMESPACE_NAME_MAX )
+  {
+    errno = E2BIG;
+    return NULL;
+  }
+
+  dbBE_Shm_namespace_t *ns = NULL;
+  dbBE_Shm_lock( &seg->_ns_lock );
+  if( dbBE_Shm_namespace_find( seg, name ) >= 0 )
+  {
+    errno = EEXIST;
+    goto exit;
+  }
+
+  int n;
+  for( n = 0; n < DBBE_SHM_NAMESPACE_MAX; ++n )
+    if(( seg->_ns[ n ]._flags & DBBE_SHM_NSFLAG_USED ) == 0 )
+      break;
+  if( n == DBBE_SHM_NAMESPACE_MAX )
+  {
+    errno = ENOSPC;
+    goto exit;
+  }
+
+  dbBE_Shm_nsentry_t *entry = &seg->_ns[ n ];
+  ++entry->_gen;
+  entry->_refcnt = 1;
+  snprintf( entry->_name, DBBE_SHM_NAMESPACE_NAME_MAX + 1, "%s", name );
+  size_t glen = ( groups != NULL ) ? groups_len : 0;
+  if( glen > DBBE_SHM_NAMESPACE_GROUPS_MAX )
+    glen = DBBE_SHM_NAMESPACE_GROUPS_MAX;
+  if( glen > 0 )
+    memcpy( entry->_groups, groups, glen );
+  entry->_groups[ glen ] = '\0';
+
+  ns = dbBE_Shm_namespace_handle( seg, n );
+  if( ns != NULL )
+    __atomic_store_n( &entry->_flags, DBBE_SHM_NSFLAG_USED, __ATOMIC_RELEASE );
+
+exit:
+  dbBE_Shm_unlock( &seg->_ns_lock );
+  return ns;
+}
+
+dbBE_Shm_namespace_t* dbBE_Shm_namespace_attach( dbBE_Shm_segment_t *seg,
+                                                 const char *name,
+                                                 dbBE_Shm_namespace_t *hdl )
+{
+  if(( seg == NULL ) || ( name == NULL ))
+  {
+    errno = EINVAL;
+    return NULL;
+  }
+  if( strnlen( name, DBBE_SHM_NAMESPACE_NAME_MAX + 1 ) > DBBE_SHM_NAMESPACE_NAME_MAX )
+  {
+    errno = E2BIG;
+    return NULL;
+  }
+
+  dbBE_Shm_namespace_t *ns = NULL;
+  dbBE_Shm_lock( &seg->_ns_lock );
+  int n = dbBE_Shm_namespace_find( seg, name );
+  if(( n < 0 ) || ( seg->_ns[ n ]._flags & DBBE_SHM_NSFLAG_DELETED ))
+  {
+    errno = ENOENT;
+    goto exit;
+  }
+  if( seg->_ns[ n ]._refcnt >= INT32_MAX )
+  {
+    errno = EOVERFLOW;
+    goto exit;
+  }
+
+  if(( hdl != NULL ) && ( dbBE_Shm_namespace_validate_locked( seg, hdl ) == 0 ) && ( hdl->_id == (uint32_t)n ))
+  {
+    ns = hdl;
+    ++ns->_local_refcnt;
+  }
+  else
+    ns = dbBE_Shm_namespace_handle( seg, n );
+  if( ns != NULL )
+    ++seg->_ns[ n ]._refcnt;
+
+exit:
+  dbBE_Shm_unlock( &seg->_ns_lock );
+  return ns;
+}
+
+int dbBE_Shm_namespace_validate( dbBE_Shm_segment_t *seg,
+                                 dbBE_Shm_namespace_t *ns )
+{
+  if(( seg == NULL ) || ( ns == NULL ))
+    return -EINVAL;
+
+  // a racy check is fine here: the generation protects the data of a reused slot
+  if(( ns->_check != DBBE_SHM_NAMESPACE_CHECK ) || ( ns->_id >= DBBE_SHM_NAMESPACE_MAX ))
+    return -EBADF;
+  dbBE_Shm_nsentry_t *entry = &seg->_ns[ ns->_id ];
+  if(( ( __atomic_load_n( &entry->_flags, __ATOMIC_ACQUIRE ) & DBBE_SHM_NSFLAG_USED ) == 0 ) ||
+      ( __atomic_load_n( &entry->_gen, __ATOMIC_ACQUIRE ) != ns->_gen ))
+    return -ESTALE;
+  return 0;
+}
+
+int64_t dbBE_Shm_namespace_detach( dbBE_Shm_segment_t *seg,
+                                   dbBE_Shm_namespace_t *ns )
+{
+  if(( seg == NULL ) || ( ns == NULL ))
+    return -EINVAL;
+
+  dbBE_Shm_lock( &seg->_ns_lock );
+  int64_t rc = dbBE_Shm_namespace_validate_locked( seg, ns );
+  if( rc != 0 )
+    goto exit;
+
+  dbBE_Shm_nsentry_t *entry = &seg->_ns[ ns->_id ];
+  if( entry->_refcnt <= 0 )
+  {
+    rc = -EOVERFLOW;
+    goto exit;
+  }
+
+  rc = --entry->_refcnt;
+  if(( rc == 0 ) && ( entry->_flags & DBBE_SHM_NSFLAG_DELETED ))
+  {
+    LOG( DBG_VERBOSE, stderr, "shm: removing namespace %s\n", entry->_name );
+    dbBE_Shm_namespace_wipe( seg, ns->_id, ns->_gen );
+    entry->_groups[ 0 ] = '\0';
+    entry->_name[ 0 ] = '\0';
+    __atomic_store_n( &entry->_flags, 0, __ATOMIC_RELEASE );
+  }
+  if( --ns->_local_refcnt <= 0 )
+    dbBE_Shm_namespace_handle_free( ns );
+
+exit:
+  dbBE_Shm_unlock( &seg->_ns_lock );
+  return rc;
+}
+
+int64_t dbBE_Shm_namespace_delete( dbBE_Shm_segment_t *seg,
+                                   dbBE_Shm_namespace_t *ns )
+{
+  if(( seg == NULL ) || ( ns == NULL ))
+    return -EINVAL;
+
+  dbBE_Shm_lock( &seg->_ns_lock );
+  int64_t rc = dbBE_Shm_namespace_validate_locked( seg, ns );
+  if( rc == 0 )
+  {
+    seg->_ns[ ns->_id ]._flags |= DBBE_SHM_NSFLAG_DELETED;
+    rc = seg->_ns[ ns->_id ]._refcnt;
+  }
+  dbBE_Shm_unlock( &seg->_ns_lock );
+  return rc;
+}
+
+ssize_t dbBE_Shm_namespace_query( dbBE_Shm_segment_t *seg,
+                                  dbBE_Shm_namespace_t *ns,
+                                  char *buf,
+                                  const size_t space )
+{
+  if(( seg == NULL ) || ( ns == NULL ) || (( buf == NULL ) && ( space > 0 )))
+    return -EINVAL;
+
+  char meta[ DBBE_SHM_NAMESPACE_NAME_MAX + DBBE_SHM_NAMESPACE_GROUPS_MAX + 64 ];
+  dbBE_Shm_lock( &seg->_ns_lock );
+  ssize_t rc = dbBE_Shm_namespace_validate_locked( seg, ns );
+  if( rc == 0 )
+  {
+    dbBE_Shm_nsentry_t *entry = &seg->_ns[ ns->_id ];
+    rc = snprintf( meta, sizeof( meta ), "id:%s:refcnt:%"PRId64":groups:%s:flags:%d:",
+                   entry->_name, entry->_refcnt, entry->_groups,
+                   ( entry->_flags & DBBE_SHM_NSFLAG_DELETED ) ? 1 : 0 );
+  }
+  dbBE_Shm_unlock( &seg->_ns_lock );
+
+  if( rc > 0 )
+  {
+    size_t len = (size_t)rc < space ? (size_t)rc : space;
+    memcpy( buf, meta, len );
+    if( len < space )
+      buf[ len ] = '\0';
+  }
+  return rc;
+}
@@ -0,0 +1,90 @@
+/*
+ * Copyright © 2020 IBM Corporation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#ifndef BACKEND_SHM_NAMESPACE_H_
+#define BACKEND_SHM_NAMESPACE_H_
+
+#include "segment.h"
+
+#include <sys/types.h>
+
+#define DBBE_SHM_NAMESPACE_CHECK ( 0x53484d4e53484e44ull )
+
+/*
+ * process-local namespace handle
+ * refers to a slot of the namespace table in the segment; the generation
+ * detects if the slot got deleted and reused in the meantime
+ * a process shares one handle for all its attachments to a namespace
+ */
+typedef struct
+{
+  uint64_t _check;
+  uint32_t _id;
+  uint32_t _gen;
+  int64_t _local_refcnt;
+} dbBE_Shm_namespace_t;
+
+/*
+ * create a new namespace with refcount 1
+ * returns NULL and sets errno: EEXIST, E2BIG (name too long), ENOSPC (table full)
+ */
+dbBE_Shm_namespace_t* dbBE_Shm_namespace_create( dbBE_Shm_segment_t *seg,
+                                                 const char *name,
+                                                 const char *groups,
+                                                 const size_t groups_len );
+
+/*
+ * attach to an existing namespace
+ * if hdl is this process' handle of the same namespace, it gets reused instead of creating a new one
+ * returns NULL and sets errno: ENOENT, E2BIG (name too long), EOVERFLOW (too many attached)
+ */
+dbBE_Shm_namespace_t* dbBE_Shm_namespace_attach( dbBE_Shm_segment_t *seg,
+                                                 const char *name,
+                                                 dbBE_Shm_namespace_t *hdl );
+
+/*
+ * detach from the namespace; releases the local handle with the last local detach
+ * if the refcount drops to 0 and the namespace is marked deleted, its data gets removed
+ * returns the refcount after detach or a negative error code
+ */
+int64_t dbBE_Shm_namespace_detach( dbBE_Shm_segment_t *seg,
+                                   dbBE_Shm_namespace_t *ns );
+
+/*
+ * mark the namespace for deletion
+ * returns the current refcount or a negative error code
+ */
+int64_t dbBE_Shm_namespace_delete( dbBE_Shm_segment_t *seg,
+                                   dbBE_Shm_namespace_t *ns );
+
+/*
+ * check if the handle refers to an existing namespace
+ * returns 0 if valid, -EBADF for a broken handle, -ESTALE if the namespace is gone
+ */
+int dbBE_Shm_namespace_validate( dbBE_Shm_segment_t *seg,
+                                 dbBE_Shm_namespace_t *ns );
+
+/*
+ * write the namespace meta data as "id:<name>:refcnt:<n>:groups:<groups>:flags:<flags>:"
+ * returns the full length of the meta data (might be larger than space) or negative error code
+ */
+ssize_t dbBE_Shm_namespace_query( dbBE_Shm_segment_t *seg,
+                                  dbBE_Shm_namespace_t *ns,
+                                  char *buf,
+                                  const size_t space );
+
+#endif /* BACKEND_SHM_NAMESPACE_H_ */
@@ -0,0 +1,337 @@
+/*
+ * Copyright © 2020 IBM Corporation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#include "logutil.h"
+#include "segment.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <inttypes.h>
+#include <sched.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#define DBBE_SHM_ALIGN( x ) ( ( (x) + 63 ) & ~(uint64_t)63 )
+
+/*
+ * allocated blocks carry the size class in front of the returned space
+ * free blocks are linked through _next
+ */
+typedef struct
+{
+  uint64_t _class;
+  dbBE_Shm_offset_t _next;
+} dbBE_Shm_block_t;
+
+static inline
+uint64_t dbBE_Shm_class_size( const int c )
+{
+  uint64_t base = 1ull << ( DBBE_SHM_SIZE_CLASS_MIN_SHIFT + ( c >> 2 ) );
+  return base + ( base >> 2 ) * ( c & 3 );
+}
+
+static inline
+int dbBE_Shm_size_class( const size_t len )
+{
+  if( len <= ( 1ull << DBBE_SHM_SIZE_CLASS_MIN_SHIFT ) )
+    return 0;
+
+  // start with the first class of the power of 2 below len and step up
+  int msb = 63 - __builtin_clzll( (unsigned long long)len - 1 );
+  int c = ( msb - DBBE_SHM_SIZE_CLASS_MIN_SHIFT ) * 4;
+  while(( c < DBBE_SHM_SIZE_CLASSES ) && ( dbBE_Shm_class_size( c ) < len ))
+    ++c;
+  return c;
+}
+
+int dbBE_Shm_lock_init( dbBE_Shm_lock_t *lock )
+{
+  pthread_mutexattr_t attr;
+  int rc = pthread_mutexattr_init( &attr );
+  if( rc == 0 )
+    rc = pthread_mutexattr_setpshared( &attr, PTHREAD_PROCESS_SHARED );
+  if( rc == 0 )
+    rc = pthread_mutexattr_setrobust( &attr, PTHREAD_MUTEX_ROBUST );
+  if( rc == 0 )
+    rc = pthread_mutex_init( lock, &attr );
+  pthread_mutexattr_destroy( &attr );
+  return -rc;
+}
+
+void dbBE_Shm_lock( dbBE_Shm_lock_t *lock )
+{
+  int rc = pthread_mutex_lock( lock );
+  if( rc == EOWNERDEAD )
+  {
+    LOG( DBG_ERR, stderr, "shm: a process died while holding a segment lock. Data may be inconsistent.\n" );
+    pthread_mutex_consistent( lock );
+  }
+  else if( rc != 0 )
+    LOG( DBG_ERR, stderr, "shm: failed to acquire segment lock: %s\n", strerror( rc ) );
+}
+
+static
+int dbBE_Shm_segment_init( dbBE_Shm_segment_t *seg,
+                           const size_t size,
+                           uint64_t index_len )
+{
+  // round index length up to power of 2
+  uint64_t len = 1;
+  while( len < index_len )
+    len <<= 1;
+
+  seg->_version = DBBE_SHM_VERSION;
+  seg->_size = size;
+  seg->_index = DBBE_SHM_ALIGN( sizeof( dbBE_Shm_segment_t ) );
+  seg->_index_len = len;
+  seg->_heap = DBBE_SHM_ALIGN( seg->_index + len * sizeof( dbBE_Shm_offset_t ) );
+  seg->_heap_top = seg->_heap;
+  seg->_heap_used = 0;
+
+  if( seg->_heap + DBBE_SHM_MIN_SIZE / 2 > size )
+    return -EINVAL;
+
+  int rc;
+  if((( rc = dbBE_Shm_lock_init( &seg->_attach_lock )) != 0 ) ||
+      (( rc = dbBE_Shm_lock_init( &seg->_index_lock )) != 0 ) ||
+      (( rc = dbBE_Shm_lock_init( &seg->_alloc_lock )) != 0 ) ||
+      (( rc = dbBE_Shm_lock_init( &seg->_ns_lock )) != 0 ))
+    return rc;
+
+  // everything else is zero from ftruncate
+  __atomic_store_n( &seg->_magic, DBBE_SHM_MAGIC, __ATOMIC_RELEASE );
+  return 0;
+}
+
+/*
+ * wait for the segment to be sized and initialized by the creating process
+ */
+static
+dbBE_Shm_segment_t* dbBE_Shm_segment_wait( int fd )
+{
+  time_t start = time( NULL );
+  struct stat st;
+  do
+  {
+    if( fstat( fd, &st ) != 0 )
+      return NULL;
+    if( (size_t)st.st_size >= sizeof( dbBE_Shm_segment_t ) )
+      break;
+    sched_yield();
+  } while( time( NULL ) - start < DBBE_SHM_INIT_TIMEOUT );
+
+  if( (size_t)st.st_size < sizeof( dbBE_Shm_segment_t ) )
+  {
+    errno = ETIMEDOUT;
+    return NULL;
+  }
+
+  dbBE_Shm_segment_t *seg = (dbBE_Shm_segment_t*)mmap( NULL, st.st_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0 );
+  if( seg == MAP_FAILED )
+    return NULL;
+
+  while(( __atomic_load_n( &seg->_magic, __ATOMIC_ACQUIRE ) != DBBE_SHM_MAGIC ) &&
+        ( time( NULL ) - start < DBBE_SHM_INIT_TIMEOUT ))
+    sched_yield();
+
+  if(( seg->_magic != DBBE_SHM_MAGIC ) || ( seg->_version != DBBE_SHM_VERSION ) || ( seg->_size != (uint64_t)st.st_size ))
+  {
+    LOG( DBG_ERR, stderr, "shm segment not initialized or incompatible.\n" );
+    munmap( seg, st.st_size );
+    errno = EPROTO;
+    return NULL;
+  }
+  return seg;
+}
+
+/*
+ * map the segment, create it if needed
+ */
+static
+dbBE_Shm_segment_t* dbBE_Shm_segment_map( const char *name,
+                                          const size_t size,
+                                          const uint64_t index_len )
+{
+  dbBE_Shm_segment_t *seg = NULL;
+  int fd = shm_open( name, O_RDWR | O_CREAT | O_EXCL, 0600 );
+  if( fd >= 0 )
+  {
+    if( ftruncate( fd, size ) != 0 )
+      goto error;
+
+    seg = (dbBE_Shm_segment_t*)mmap( NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0 );
+    if( seg == MAP_FAILED )
+      goto error;
+
+    int rc = dbBE_Shm_segment_init( seg, size, index_len );
+    if( rc != 0 )
+    {
+      munmap( seg, size );
+      errno = -rc;
+      goto error;
+    }
+    LOG( DBG_VERBOSE, stderr, "created shm segment %s with %zd bytes\n", name, size );
+  }
+  else if( errno == EEXIST )
+  {
+    fd = shm_open( name, O_RDWR, 0 );
+    if( fd < 0 )
+      return NULL;
+    seg = dbBE_Shm_segment_wait( fd );
+    if( seg == NULL )
+    {
+      int err = errno;
+      close( fd );
+      errno = err;
+      return NULL;
+    }
+  }
+  else
+    return NULL;
+
+  close( fd );
+  return seg;
+
+error:
+  {
+    int err = errno;
+    close( fd );
+    shm_unlink( name );
+    errno = err;
+  }
+  return NULL;
+}
+
+dbBE_Shm_segment_t* dbBE_Shm_segment_open( const char *name,
+                                           const size_t size,
+                                           const uint64_t index_len )
+{
+  if(( name == NULL ) || ( size < DBBE_SHM_MIN_SIZE ) || ( index_len == 0 ))
+  {
+    errno = EINVAL;
+    return NULL;
+  }
+
+  // the last user may remove the name between our shm_open and attach: retry with a new segment
+  int retry;
+  for( retry = 0; retry < DBBE_SHM_OPEN_RETRIES; ++retry )
+  {
+    dbBE_Shm_segment_t *seg = dbBE_Shm_segment_map( name, size, index_len );
+    if( seg == NULL )
+      return NULL;
+
+    dbBE_Shm_lock( &seg->_attach_lock );
+    int unlinked = seg->_unlinked;
+    if( ! unlinked )
+      ++seg->_attached;
+    dbBE_Shm_unlock( &seg->_attach_lock );
+    if( ! unlinked )
+      return seg;
+
+    munmap( seg, seg->_size );
+  }
+  errno = EAGAIN;
+  return NULL;
+}
+
+int64_t dbBE_Shm_segment_close( dbBE_Shm_segment_t *seg, const char *name )
+{
+  if( seg == NULL )
+    return -EINVAL;
+
+  dbBE_Shm_lock( &seg->_attach_lock );
+  int64_t remaining = --seg->_attached;
+  if(( remaining <= 0 ) && ( name != NULL ))
+  {
+    LOG( DBG_VERBOSE, stderr, "last user of shm segment %s, removing it\n", name );
+    shm_unlink( name );
+    seg->_unlinked = 1;
+  }
+  dbBE_Shm_unlock( &seg->_attach_lock );
+
+  if( munmap( seg, seg->_size ) != 0 )
+    return -errno;
+  return remaining;
+}
+
+int dbBE_Shm_segment_unlink( const char *name )
+{
+  if( name == NULL )
+    return -EINVAL;
+  if( shm_unlink( name ) != 0 )
+    return -errno;
+  return 0;
+}
+
+dbBE_Shm_offset_t dbBE_Shm_alloc( dbBE_Shm_segment_t *seg, const size_t len )
+{
+  if( seg == NULL )
+    return 0;
+
+  int c = dbBE_Shm_size_class( len + sizeof( dbBE_Shm_block_t ) );
+  if( c >= DBBE_SHM_SIZE_CLASSES )
+    return 0;
+  uint64_t csize = dbBE_Shm_class_size( c );
+
+  dbBE_Shm_offset_t boff = 0;
+  dbBE_Shm_lock( &seg->_alloc_lock );
+  if( seg->_free[ c ] != 0 )
+  {
+    boff = seg->_free[ c ];
+    seg->_free[ c ] = ((dbBE_Shm_block_t*)dbBE_Shm_ptr( seg, boff ))->_next;
+  }
+  else if( seg->_heap_top + csize <= seg->_size )
+  {
+    boff = seg->_heap_top;
+    seg->_heap_top += csize;
+  }
+  if( boff != 0 )
+    seg->_heap_used += csize;
+  dbBE_Shm_unlock( &seg->_alloc_lock );
+
+  if( boff == 0 )
+    return 0;
+
+  dbBE_Shm_block_t *block = (dbBE_Shm_block_t*)dbBE_Shm_ptr( seg, boff );
+  block->_class = c;
+  block->_next = 0;
+  return boff + sizeof( dbBE_Shm_block_t );
+}
+
+void dbBE_Shm_free( dbBE_Shm_segment_t *seg, dbBE_Shm_offset_t off )
+{
+  if(( seg == NULL ) || ( off < seg->_heap + sizeof( dbBE_Shm_block_t ) ))
+    return;
+
+  dbBE_Shm_offset_t boff = off - sizeof( dbBE_Shm_block_t );
+  dbBE_Shm_block_t *block = (dbBE_Shm_block_t*)dbBE_Shm_ptr( seg, boff );
+  int c = (int)block->_class;
+  if( c >= DBBE_SHM_SIZE_CLASSES )
+  {
+    LOG( DBG_ERR, stderr, "shm free: corrupted block at offset %"PRIu64"\n", boff );
+    return;
+  }
+
+  dbBE_Shm_lock( &seg->_alloc_lock );
+  block->_next = seg->_free[ c ];
+  seg->_free[ c ] = boff;
+  seg->_heap_used -= dbBE_Shm_class_size( c );
+  dbBE_Shm_unlock( &seg->_alloc_lock );
+}
@@ -0,0 +1,150 @@
+/*
+ * Copyright © 2020 IBM Corporation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#ifndef BACKEND_SHM_SEGMENT_H_
+#define BACKEND_SHM_SEGMENT_H_
+
+#include "definitions.h"
+
+#include <stddef.h>
+#include <stdint.h>
+#include <pthread.h>
+
+/*
+ * The shared memory segment is mapped at different addresses in each process.
+ * Therefore, any reference inside the segment is an offset relative to the
+ * start of the segment. Offset 0 is the segment header and serves as NULL.
+ *
+ * Layout:  [ header | namespace table ][ tuple index slots ][ heap ... ]
+ */
+typedef uint64_t dbBE_Shm_offset_t;
+
+/*
+ * process-shared, robust mutex: a lock held by a process that dies is
+ * handed to the next locker instead of blocking everybody forever
+ */
+typedef pthread_mutex_t dbBE_Shm_lock_t;
+
+// 4 size classes per power of 2, starting at 64 bytes
+#define DBBE_SHM_SIZE_CLASS_MIN_SHIFT ( 6 )
+#define DBBE_SHM_SIZE_CLASSES ( 4 * ( 48 - DBBE_SHM_SIZE_CLASS_MIN_SHIFT ) )
+
+#define DBBE_SHM_NSFLAG_USED ( 0x1 )
+#define DBBE_SHM_NSFLAG_DELETED ( 0x2 )
+
+typedef struct
+{
+  uint32_t _flags;
+  uint32_t _gen;        /**< incremented each time the slot gets reused for a new namespace */
+  int64_t _refcnt;
+  char _name[ DBBE_SHM_NAMESPACE_NAME_MAX + 1 ];
+  char _groups[ DBBE_SHM_NAMESPACE_GROUPS_MAX + 1 ];
+} dbBE_Shm_nsentry_t;
+
+typedef struct
+{
+  volatile uint64_t _magic;  /**< set after initialization is complete */
+  uint32_t _version;
+  uint32_t _reserved;
+  uint64_t _size;            /**< total size of the segment */
+  dbBE_Shm_offset_t _index;  /**< start of the tuple index */
+  uint64_t _index_len;       /**< number of slots in the index (power of 2) */
+  dbBE_Shm_offset_t _heap;   /**< start of the heap */
+
+  dbBE_Shm_lock_t _attach_lock;
+  int64_t _attached;         /**< number of processes that have the segment open */
+  uint32_t _unlinked;        /**< name got removed by the last process, don't attach */
+
+  dbBE_Shm_lock_t _index_lock;
+
+  dbBE_Shm_lock_t _alloc_lock;
+  uint64_t _heap_top;        /**< bump pointer for never allocated heap space */
+  uint64_t _heap_used;       /**< bytes currently handed out by the allocator */
+  dbBE_Shm_offset_t _free[ DBBE_SHM_SIZE_CLASSES ];
+
+  dbBE_Shm_lock_t _ns_lock;
+  dbBE_Shm_nsentry_t _ns[ DBBE_SHM_NAMESPACE_MAX ];
+} dbBE_Shm_segment_t;
+
+
+static inline
+void* dbBE_Shm_ptr( dbBE_Shm_segment_t *seg, dbBE_Shm_offset_t off )
+{
+  return ( off != 0 ) ? (void*)( (char*)seg + off ) : NULL;
+}
+
+static inline
+dbBE_Shm_offset_t dbBE_Shm_offset( dbBE_Shm_segment_t *seg, void *ptr )
+{
+  return ( ptr != NULL ) ? (dbBE_Shm_offset_t)( (char*)ptr - (char*)seg ) : 0;
+}
+
+/*
+ * initialize a lock that lives in the segment
+ * returns 0 on success or a negative errno
+ */
+int dbBE_Shm_lock_init( dbBE_Shm_lock_t *lock );
+
+/*
+ * if the previous owner died while holding the lock, the lock is made
+ * consistent again and an error is logged; the data protected by the lock
+ * may have been left half-updated by the dead process
+ */
+void dbBE_Shm_lock( dbBE_Shm_lock_t *lock );
+
+static inline
+void dbBE_Shm_unlock( dbBE_Shm_lock_t *lock )
+{
+  pthread_mutex_unlock( lock );
+}
+
+/*
+ * map the segment with the given name
+ * creates and initializes the segment if it doesn't exist yet
+ * size and index_len are ignored if the segment already exists
+ * returns NULL and sets errno in case of failure
+ */
+dbBE_Shm_segment_t* dbBE_Shm_segment_open( const char *name,
+                                           const size_t size,
+                                           const uint64_t index_len );
+
+/*
+ * unmap the segment; the data stays available for other processes
+ * the last process that closes the segment also removes its name, so the
+ * next open starts over with an empty segment
+ * returns the number of processes that still have the segment open or <0 on error
+ */
+int64_t dbBE_Shm_segment_close( dbBE_Shm_segment_t *seg, const char *name );
+
+/*
+ * remove the segment name from the system
+ * the memory is released once the last process has unmapped it
+ */
+int dbBE_Shm_segment_unlink( const char *name );
+
+/*
+ * allocate len bytes from the heap of the segment
+ * returns the offset of the allocated space or 0 if out of memory
+ */
+dbBE_Shm_offset_t dbBE_Shm_alloc( dbBE_Shm_segment_t *seg, const size_t len );
+
+/*
+ * return space to the heap
+ */
+void dbBE_Shm_free( dbBE_Shm_segment_t *seg, dbBE_Shm_offset_t off );
+
+#endif /* BACKEND_SHM_SEGMENT_H_ */
@@ -0,0 +1,616 @@
+/*
+ * Copyright © 2020 IBM Corporation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#include "logutil.h"
+#include "common/utility.h"
+#include "common/completion.h"
+#include "shm.h"
+#include "index.h"
+#include "namespace.h"
+
+#include <errno.h>
+#include <fnmatch.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+const dbBE_api_t dbBE =
+    { .initialize = Shm_initialize,
+      .exit = Shm_exit,
+      .post = Shm_post,
+      .cancel = Shm_cancel,
+      .test = Shm_test,
+      .test_any = Shm_test_any
+    };
+
+
+static
+uint64_t dbBE_Shm_env_number( const char *env, const char *def )
+{
+  char *str = dbBE_Extract_env( env, def );
+  if( str == NULL )
+    return 0;
+  uint64_t val = strtoull( str, NULL, 0 );
+  free( str );
+  return val;
+}
+
+dbBE_Handle_t Shm_initialize( void )
+{
+  dbBE_Shm_context_t *ctx = (dbBE_Shm_context_t*)calloc( 1, sizeof( dbBE_Shm_context_t ));
+  if( ctx == NULL )
+    return NULL;
+
+  ctx->_work_q = dbBE_Request_queue_create( DBBE_SHM_WORK_QUEUE_DEPTH );
+  ctx->_pending_q = dbBE_Request_queue_create( DBBE_SHM_WORK_QUEUE_DEPTH );
+  ctx->_compl_q = dbBE_Completion_queue_create( DBBE_SHM_WORK_QUEUE_DEPTH );
+  if(( ctx->_work_q == NULL ) || ( ctx->_pending_q == NULL ) || ( ctx->_compl_q == NULL ))
+  {
+    LOG( DBG_ERR, stderr, "dbBE_Shm_context_t::initialize: Failed to allocate queues.\n" );
+    Shm_exit( ctx );
+    return NULL;
+  }
+
+  ctx->_name = dbBE_Extract_env( DBR_SHM_NAME_ENV, DBR_SHM_DEFAULT_NAME );
+  if( ctx->_name == NULL )
+  {
+    Shm_exit( ctx );
+    return NULL;
+  }
+
+  uint64_t size = dbBE_Shm_env_number( DBR_SHM_SIZE_ENV, DBR_SHM_DEFAULT_SIZE );
+  uint64_t index_len = dbBE_Shm_env_number( DBR_SHM_INDEX_ENV, DBR_SHM_DEFAULT_INDEX );
+
+  ctx->_seg = dbBE_Shm_segment_open( ctx->_name, size, index_len );
+  if( ctx->_seg == NULL )
+  {
+    LOG( DBG_ERR, stderr, "dbBE_Shm_context_t::initialize: Failed to open shm segment %s: %s\n", ctx->_name, strerror( errno ) );
+    Shm_exit( ctx );
+    return NULL;
+  }
+
+  return ctx;
+}
+
+int Shm_exit( dbBE_Handle_t be )
+{
+  if( be == NULL )
+    return -EINVAL;
+
+  dbBE_Shm_context_t *ctx = (dbBE_Shm_context_t*)be;
+
+  if( ctx->_seg != NULL )
+    dbBE_Shm_segment_close( ctx->_seg, ctx->_name );
+
+  if( ctx->_name != NULL )
+    free( ctx->_name );
+
+  if( ctx->_compl_q != NULL )
+    dbBE_Completion_queue_destroy( ctx->_compl_q );
+
+  if( ctx->_pending_q != NULL )
+    dbBE_Request_queue_destroy( ctx->_pending_q );
+
+  if( ctx->_work_q != NULL )
+    dbBE_Request_queue_destroy( ctx->_work_q );
+
+  memset( ctx, 0, sizeof( dbBE_Shm_context_t ));
+  free( ctx );
+  return 0;
+}
+
+static
+int dbBE_Shm_request_sanity_check( dbBE_Request_t *request )
+{
+  int rc = 0;
+  switch( request->_opcode )
+  {
+    case DBBE_OPCODE_PUT:
+    case DBBE_OPCODE_GET:
+    case DBBE_OPCODE_READ:
+    case DBBE_OPCODE_REMOVE:
+      if(( request->_key == NULL ) || ( request->_ns_hdl == NULL ))
+        rc = EINVAL;
+      break;
+    case DBBE_OPCODE_MOVE:
+      if(( request->_key == NULL ) || ( request->_ns_hdl == NULL ) ||
+          ( request->_sge_count != 2 ) || ( request->_sge[0].iov_base == NULL ))
+        rc = EINVAL;
+      break;
+    case DBBE_OPCODE_DIRECTORY:
+      if( request->_sge_count != 2 )
+        rc = ENOTSUP;
+      else if(( request->_sge[0].iov_base == NULL ) || ( request->_sge[0].iov_len < 1 ) ||
+          ( request->_sge[1].iov_base != NULL ) || ( request->_sge[1].iov_len < 1 ))
+        rc = EINVAL;
+      break;
+    case DBBE_OPCODE_ITERATOR:
+      if(( request->_sge_count != 1 ) || ( request->_sge[0].iov_base == NULL ))
+        rc = EINVAL;
+      break;
+    case DBBE_OPCODE_NSCREATE:
+    case DBBE_OPCODE_NSATTACH:
+      if( request->_key == NULL )
+        rc = EINVAL;
+      break;
+    case DBBE_OPCODE_NSDETACH:
+    case DBBE_OPCODE_NSDELETE:
+    case DBBE_OPCODE_NSQUERY:
+      if( request->_ns_hdl == NULL )
+        rc = EINVAL;
+      break;
+    case DBBE_OPCODE_UNSPEC:
+    case DBBE_OPCODE_CANCEL:
+    case DBBE_OPCODE_NSADDUNITS:
+    case DBBE_OPCODE_NSREMOVEUNITS:
+      break;
+    default:
+      rc = EINVAL;
+      break;
+  }
+  return rc;
+}
+
+/*
+ * opcode-independent mapping of errno values to dbr errors
+ */
+static
+DBR_Errorcode_t dbBE_Shm_status( const int64_t rc )
+{
+  switch( rc )
+  {
+    case 0: return DBR_SUCCESS;
+    case -ENOENT: return DBR_ERR_UNAVAIL;
+    case -EEXIST: return DBR_ERR_EXISTS;
+    case -ENOSPC:
+    case -ENOMEM: return DBR_ERR_NOMEMORY;
+    case -EINVAL: return DBR_ERR_INVALID;
+    case -E2BIG:
+    case -EBADF:
+    case -ESTALE: return DBR_ERR_NSINVAL;
+    case -EOVERFLOW: return DBR_ERR_INVALIDOP;
+    default: return ( rc < 0 ) ? DBR_ERR_BE_GENERAL : DBR_SUCCESS;
+  }
+}
+
+static inline
+int dbBE_Shm_matches( const char *pattern, const char *key )
+{
+  return (( pattern == NULL ) || ( pattern[0] == '\0' ) || ( fnmatch( pattern, key, 0 ) == 0 ));
+}
+
+static
+dbBE_Completion_t* dbBE_Shm_execute_put( dbBE_Shm_segment_t *seg, dbBE_Request_t *req )
+{
+  dbBE_Shm_namespace_t *ns = (dbBE_Shm_namespace_t*)req->_ns_hdl;
+  int rc = dbBE_Shm_namespace_validate( seg, ns );
+  if( rc == 0 )
+  {
+    dbBE_Shm_key_t *k = dbBE_Shm_index_lookup( seg, ns->_id, req->_key, 1 );
+    if( k != NULL )
+    {
+      rc = dbBE_Shm_key_put( seg, k, ns->_gen, req->_sge, req->_sge_count );
+      dbBE_Shm_index_release( seg, k );
+    }
+    else
+      rc = -errno;
+  }
+  if( rc != 0 )
+    return dbBE_Completion_create( req, dbBE_Shm_status( rc ), 0 );
+  return dbBE_Completion_create( req, DBR_SUCCESS, 1 );
+}
+
+/*
+ * returns NULL if the request has to wait for the tuple to show up
+ */
+static
+dbBE_Completion_t* dbBE_Shm_execute_fetch( dbBE_Shm_segment_t *seg, dbBE_Request_t *req )
+{
+  dbBE_Shm_namespace_t *ns = (dbBE_Shm_namespace_t*)req->_ns_hdl;
+  int rc = dbBE_Shm_namespace_validate( seg, ns );
+  if( rc != 0 )
+    return dbBE_Completion_create( req, dbBE_Shm_status( rc ), 0 );
+
+  int64_t size = 0;
+  dbBE_Shm_key_t *k = dbBE_Shm_index_lookup( seg, ns->_id, req->_key, 0 );
+  if( k != NULL )
+  {
+    int flags = ( req->_opcode == DBBE_OPCODE_GET ) ? DBBE_SHM_FETCH_CONSUME : 0;
+    if( req->_flags & DBBE_OPCODE_FLAGS_PARTIAL )
+      flags |= DBBE_SHM_FETCH_PARTIAL;
+    int64_t idx = ( req->_opcode == DBBE_OPCODE_READ ) ? ( req->_flags >> DBR_READ_FLAGS_INDEX_SHIFT ) : 0;
+    rc = dbBE_Shm_key_fetch( seg, k, ns->_gen, idx, flags, req->_sge, req->_sge_count, &size );
+    dbBE_Shm_index_release( seg, k );
+  }
+  else
+    rc = ( errno == ENOENT ) ? -ENOENT : -errno;
+
+  switch( rc )
+  {
+    case 0:
+      return dbBE_Completion_create( req, DBR_SUCCESS, size );
+    case -ENOSPC:
+      return dbBE_Completion_create( req, DBR_ERR_UBUFFER, size );
+    case -ENOENT:
+      if( req->_flags & DBBE_OPCODE_FLAGS_IMMEDIATE )
+        return dbBE_Completion_create( req, DBR_ERR_UNAVAIL, 0 );
+      return NULL;
+    default:
+      return dbBE_Completion_create( req, dbBE_Shm_status( rc ), 0 );
+  }
+}
+
+static
+dbBE_Completion_t* dbBE_Shm_execute_move( dbBE_Shm_segment_t *seg, dbBE_Request_t *req )
+{
+  dbBE_Shm_namespace_t *src_ns = (dbBE_Shm_namespace_t*)req->_ns_hdl;
+  dbBE_Shm_namespace_t *dst_ns = (dbBE_Shm_namespace_t*)req->_sge[0].iov_base;
+  int rc = dbBE_Shm_namespace_validate( seg, src_ns );
+  if( rc == 0 )
+    rc = dbBE_Shm_namespace_validate( seg, dst_ns );
+  if( rc == 0 )
+  {
+    dbBE_Shm_key_t *src = dbBE_Shm_index_lookup( seg, src_ns->_id, req->_key, 0 );
+    dbBE_Shm_key_t *dst = NULL;
+    if( src == NULL )
+      rc = -ENOENT;
+    else if(( dst = dbBE_Shm_index_lookup( seg, dst_ns->_id, req->_key, 1 )) == NULL )
+      rc = -errno;
+    else
+      rc = dbBE_Shm_key_move( seg, src, src_ns->_gen, dst, dst_ns->_gen );
+    dbBE_Shm_index_release( seg, dst );
+    dbBE_Shm_index_release( seg, src );
+  }
+  return dbBE_Completion_create( req, dbBE_Shm_status( rc ), 0 );
+}
+
+static
+dbBE_Completion_t* dbBE_Shm_execute_remove( dbBE_Shm_segment_t *seg, dbBE_Request_t *req )
+{
+  dbBE_Shm_namespace_t *ns = (dbBE_Shm_namespace_t*)req->_ns_hdl;
+  int rc = dbBE_Shm_namespace_validate( seg, ns );
+  if( rc == 0 )
+  {
+    dbBE_Shm_key_t *k = dbBE_Shm_index_lookup( seg, ns->_id, req->_key, 0 );
+    if(( k == NULL ) || ( dbBE_Shm_key_clear( seg, k, ns->_gen ) == 0 ))
+      rc = -ENOENT;
+    dbBE_Shm_index_release( seg, k );
+  }
+  return dbBE_Completion_create( req, dbBE_Shm_status( rc ), 0 );
+}
+
+/*
+ * check whether a key entry currently holds any values of the namespace
+ */
+static
+int dbBE_Shm_key_in_use( dbBE_Shm_segment_t *seg, dbBE_Shm_key_t *k, dbBE_Shm_namespace_t *ns )
+{
+  if( k->_ns_id != ns->_id )
+    return 0;
+  dbBE_Shm_key_lock( seg, k, ns->_gen );
+  int in_use = ( k->_count > 0 );
+  dbBE_Shm_key_unlock( k );
+  return in_use;
+}
+
+static
+dbBE_Completion_t* dbBE_Shm_execute_directory( dbBE_Shm_segment_t *seg, dbBE_Request_t *req )
+{
+  dbBE_Shm_namespace_t *ns = (dbBE_Shm_namespace_t*)req->_ns_hdl;
+  int rc = dbBE_Shm_namespace_validate( seg, ns );
+  if( rc != 0 )
+    return dbBE_Completion_create( req, dbBE_Shm_status( rc ), 0 );
+
+  char *buf = (char*)req->_sge[0].iov_base;
+  size_t space = req->_sge[0].iov_len;
+  size_t limit = req->_sge[1].iov_len;
+  size_t len = 0;
+  size_t count = 0;
+  buf[0] = '\0';
+
+  uint64_t pos = 0;
+  dbBE_Shm_key_t *k;
+  while(( count < limit ) && (( k = dbBE_Shm_index_next( seg, &pos )) != NULL ))
+  {
+    if( ! dbBE_Shm_key_in_use( seg, k, ns ) || ! dbBE_Shm_matches( req->_match, k->_key ))
+    {
+      dbBE_Shm_index_release( seg, k );
+      continue;
+    }
+
+    // keys are separated by newline, stop if the next one doesn't fit
+    size_t needed = k->_keylen + ( len > 0 ? 1 : 0 );
+    if( len + needed >= space )
+    {
+      dbBE_Shm_index_release( seg, k );
+      break;
+    }
+    len += snprintf( buf + len, space - len, "%s%s", len > 0 ? "\n" : "", k->_key );
+    ++count;
+    dbBE_Shm_index_release( seg, k );
+  }
+  return dbBE_Completion_create( req, DBR_SUCCESS, len );
+}
+
+/*
+ * the iterator is the index position after the previously returned key
+ */
+static
+dbBE_Completion_t* dbBE_Shm_execute_iterator( dbBE_Shm_segment_t *seg, dbBE_Request_t *req )
+{
+  dbBE_Shm_namespace_t *ns = (dbBE_Shm_namespace_t*)req->_ns_hdl;
+  int rc = dbBE_Shm_namespace_validate( seg, ns );
+  if( rc != 0 )
+    return dbBE_Completion_create( req, DBR_ERR_ITERATOR, 0 );
+
+  char *buf = (char*)req->_sge[0].iov_base;
+  size_t space = req->_sge[0].iov_len;
+  uint64_t pos = (uint64_t)(uintptr_t)req->_key;
+
+  dbBE_Shm_key_t *k;
+  while(( k = dbBE_Shm_index_next( seg, &pos )) != NULL )
+  {
+    if( ! dbBE_Shm_key_in_use( seg, k, ns ) || ! dbBE_Shm_matches( req->_match, k->_key ))
+    {
+      dbBE_Shm_index_release( seg, k );
+      continue;
+    }
+    snprintf( buf, space, "%s", k->_key );
+    dbBE_Shm_index_release( seg, k );
+    return dbBE_Completion_create( req, DBR_SUCCESS, (int64_t)pos );
+  }
+
+  // no more keys
+  snprintf( buf, space, "%c", EOF );
+  return dbBE_Completion_create( req, DBR_SUCCESS, 0 );
+}
+
+static
+dbBE_Completion_t* dbBE_Shm_execute_namespace( dbBE_Shm_segment_t *seg, dbBE_Request_t *req )
+{
+  dbBE_Shm_namespace_t *ns = NULL;
+  int64_t rc = 0;
+  switch( req->_opcode )
+  {
+    case DBBE_OPCODE_NSCREATE:
+      ns = dbBE_Shm_namespace_create( seg, req->_key,
+                                      req->_sge_count > 0 ? (char*)req->_sge[0].iov_base : NULL,
+                                      req->_sge_count > 0 ? req->_sge[0].iov_len : 0 );
+      if( ns == NULL )
+        return dbBE_Completion_create( req, dbBE_Shm_status( -errno ), 0 );
+      return dbBE_Completion_create( req, DBR_SUCCESS, (int64_t)ns );
+
+    case DBBE_OPCODE_NSATTACH:
+      ns = dbBE_Shm_namespace_attach( seg, req->_key, (dbBE_Shm_namespace_t*)req->_ns_hdl );
+      if( ns == NULL )
+        return dbBE_Completion_create( req, dbBE_Shm_status( -errno ), 0 );
+      return dbBE_Completion_create( req, DBR_SUCCESS, (int64_t)ns );
+
+    case DBBE_OPCODE_NSDETACH:
+      rc = dbBE_Shm_namespace_detach( seg, (dbBE_Shm_namespace_t*)req->_ns_hdl );
+      if( rc < 0 )
+        return dbBE_Completion_create( req, dbBE_Shm_status( rc ), 0 );
+      return dbBE_Completion_create( req, DBR_SUCCESS, rc );
+
+    case DBBE_OPCODE_NSDELETE:
+      rc = dbBE_Shm_namespace_delete( seg, (dbBE_Shm_namespace_t*)req->_ns_hdl );
+      if( rc < 0 )
+        return dbBE_Completion_create( req, dbBE_Shm_status( rc ), 0 );
+      // other clients still attached: marked for deletion only
+      if( rc > 1 )
+        return dbBE_Completion_create( req, DBR_ERR_NSBUSY, rc );
+      return dbBE_Completion_create( req, DBR_SUCCESS, 0 );
+
+    case DBBE_OPCODE_NSQUERY:
+    {
+      char meta[ DBBE_SHM_NAMESPACE_NAME_MAX + DBBE_SHM_NAMESPACE_GROUPS_MAX + 64 ];
+      ssize_t len = dbBE_Shm_namespace_query( seg, (dbBE_Shm_namespace_t*)req->_ns_hdl, meta, sizeof( meta ) );
+      if( len < 0 )
+        return dbBE_Completion_create( req, dbBE_Shm_status( len ), 0 );
+
+      size_t space = dbBE_SGE_get_len( req->_sge, req->_sge_count );
+      size_t copied = 0;
+      int n;
+      for( n = 0; ( n < req->_sge_count ) && ( copied < (size_t)len ); ++n )
+      {
+        size_t chunk = req->_sge[ n ].iov_len < len - copied ? req->_sge[ n ].iov_len : len - copied;
+        memcpy( req->_sge[ n ].iov_base, meta + copied, chunk );
+        copied += chunk;
+      }
+      if( space < (size_t)len )
+        return dbBE_Completion_create( req, DBR_ERR_UBUFFER, len );
+      return dbBE_Completion_create( req, DBR_SUCCESS, len );
+    }
+    default:
+      break;
+  }
+  return dbBE_Completion_create( req, DBR_ERR_INVALIDOP, 0 );
+}
+
+/*
+ * execute a request
+ * returns the completion or NULL if the request needs to wait for data
+ */
+static
+dbBE_Completion_t* dbBE_Shm_execute( dbBE_Shm_context_t *ctx, dbBE_Request_t *req )
+{
+  switch( req->_opcode )
+  {
+    case DBBE_OPCODE_PUT:
+      return dbBE_Shm_execute_put( ctx->_seg, req );
+    case DBBE_OPCODE_GET:
+    case DBBE_OPCODE_READ:
+      return dbBE_Shm_execute_fetch( ctx->_seg, req );
+    case DBBE_OPCODE_MOVE:
+      return dbBE_Shm_execute_move( ctx->_seg, req );
+    case DBBE_OPCODE_REMOVE:
+      return dbBE_Shm_execute_remove( ctx->_seg, req );
+    case DBBE_OPCODE_DIRECTORY:
+      return dbBE_Shm_execute_directory( ctx->_seg, req );
+    case DBBE_OPCODE_ITERATOR:
+      return dbBE_Shm_execute_iterator( ctx->_seg, req );
+    case DBBE_OPCODE_NSCREATE:
+    case DBBE_OPCODE_NSATTACH:
+    case DBBE_OPCODE_NSDETACH:
+    case DBBE_OPCODE_NSDELETE:
+    case DBBE_OPCODE_NSQUERY:
+      return dbBE_Shm_execute_namespace( ctx->_seg, req );
+    case DBBE_OPCODE_NSADDUNITS:
+    case DBBE_OPCODE_NSREMOVEUNITS:
+      return dbBE_Completion_create( req, DBR_ERR_NOTIMPL, 0 );
+    default:
+      return dbBE_Completion_create( req, DBR_ERR_INVALIDOP, 0 );
+  }
+}
+
+static
+void dbBE_Shm_complete( dbBE_Shm_context_t *ctx, dbBE_Request_t *req, dbBE_Completion_t *cmpl )
+{
+  if( cmpl == NULL )
+  {
+    LOG( DBG_ERR, stderr, "shm: failed to create completion for op=%d\n", req->_opcode );
+    return;
+  }
+  if( cmpl->_status != DBR_SUCCESS )
+    LOG( DBG_VERBOSE, stderr, "Completion with error: op=%d; err=%d\n", req->_opcode, cmpl->_status );
+  dbBE_Completion_queue_push( ctx->_compl_q, cmpl );
+}
+
+/*
+ * execute all posted requests and retry the ones waiting for data
+ */
+static
+void dbBE_Shm_progress( dbBE_Shm_context_t *ctx )
+{
+  dbBE_Request_t *req;
+  size_t waiting = dbBE_Request_queue_len( ctx->_pending_q );
+  while( waiting-- > 0 )
+  {
+    req = dbBE_Request_queue_pop( ctx->_pending_q );
+    dbBE_Completion_t *cmpl = dbBE_Shm_execute( ctx, req );
+    if( cmpl != NULL )
+      dbBE_Shm_complete( ctx, req, cmpl );
+    else
+      dbBE_Request_queue_push( ctx->_pending_q, req );
+  }
+
+  while(( req = dbBE_Request_queue_pop( ctx->_work_q )) != NULL )
+  {
+    dbBE_Completion_t *cmpl = dbBE_Shm_execute( ctx, req );
+    if( cmpl != NULL )
+      dbBE_Shm_complete( ctx, req, cmpl );
+    else
+      dbBE_Request_queue_push( ctx->_pending_q, req );
+  }
+}
+
+dbBE_Request_handle_t Shm_post( dbBE_Handle_t be,
+                                dbBE_Request_t *request,
+                                int trigger )
+{
+  if(( be == NULL ) || ( request == NULL ))
+  {
+    errno = EINVAL;
+    return NULL;
+  }
+
+  if( dbBE_Shm_request_sanity_check( request ) != 0 )
+  {
+    errno = EINVAL;
+    return NULL;
+  }
+
+  dbBE_Shm_context_t *ctx = (dbBE_Shm_context_t*)be;
+  if( dbBE_Request_queue_len( ctx->_work_q ) >= DBBE_SHM_WORK_QUEUE_DEPTH )
+    dbBE_Shm_progress( ctx );
+
+  if( dbBE_Request_queue_push( ctx->_work_q, request ) != 0 )
+  {
+    errno = ENOENT;
+    return NULL;
+  }
+
+  if( trigger )
+    dbBE_Shm_progress( ctx );
+
+  return (dbBE_Request_handle_t)request;
+}
+
+/*
+ * remove a request from a queue without changing the order of the others
+ */
+static
+int dbBE_Shm_queue_extract( dbBE_Request_queue_t *queue, dbBE_Request_t *request )
+{
+  int found = 0;
+  size_t len = dbBE_Request_queue_len( queue );
+  while( len-- > 0 )
+  {
+    dbBE_Request_t *req = dbBE_Request_queue_pop( queue );
+    if( req == request )
+      found = 1;
+    else
+      dbBE_Request_queue_push( queue, req );
+  }
+  return found;
+}
+
+int Shm_cancel( dbBE_Handle_t be,
+                dbBE_Request_handle_t request )
+{
+  if(( be == NULL ) || ( request == NULL ))
+    return EINVAL;
+
+  dbBE_Shm_context_t *ctx = (dbBE_Shm_context_t*)be;
+  dbBE_Request_t *req = (dbBE_Request_t*)request;
+
+  // only requests that haven't been executed can be cancelled; anything else is already complete
+  if( dbBE_Shm_queue_extract( ctx->_pending_q, req ) || dbBE_Shm_queue_extract( ctx->_work_q, req ))
+  {
+    dbBE_Shm_complete( ctx, req, dbBE_Completion_create( req, DBR_ERR_CANCELLED, 0 ) );
+    return 0;
+  }
+  return ENOENT;
+}
+
+dbBE_Completion_t* Shm_test( dbBE_Handle_t be,
+                             dbBE_Request_handle_t request )
+{
+  errno = ENOSYS;
+  return NULL;
+}
+
+dbBE_Completion_t* Shm_test_any( dbBE_Handle_t be )
+{
+  if( be == NULL )
+  {
+    errno = EINVAL;
+    return NULL;
+  }
+
+  dbBE_Shm_context_t *ctx = (dbBE_Shm_context_t*)be;
+  if( dbBE_Completion_queue_len( ctx->_compl_q ) == 0 )
+  {
+    dbBE_Shm_progress( ctx );
+    if( dbBE_Completion_queue_len( ctx->_compl_q ) == 0 )
+    {
+      errno = EAGAIN;
+      return NULL;
+    }
+  }
+  return dbBE_Completion_queue_pop( ctx->_compl_q );
+}
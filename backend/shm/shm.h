@@ -0,0 +1,56 @@
+/*
+ * Copyright © 2020 IBM Corporation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#ifndef BACKEND_SHM_SHM_H_
+#define BACKEND_SHM_SHM_H_
+
+#include "common/dbbe_api.h"
+#include "common/request_queue.h"
+#include "common/completion_queue.h"
+#include "segment.h"
+
+/*
+ * Node-local backend: namespaces and tuples live in a POSIX shared memory
+ * segment that is mapped by all processes on the node. Requests are executed
+ * directly by the posting process; there's no server involved.
+ */
+typedef struct
+{
+  dbBE_Shm_segment_t *_seg;
+  char *_name;
+  dbBE_Request_queue_t *_work_q;      /**< posted, not yet executed requests */
+  dbBE_Request_queue_t *_pending_q;   /**< get/read requests waiting for data to appear */
+  dbBE_Completion_queue_t *_compl_q;
+} dbBE_Shm_context_t;
+
+dbBE_Handle_t Shm_initialize( void );
+
+int Shm_exit( dbBE_Handle_t be );
+
+dbBE_Request_handle_t Shm_post( dbBE_Handle_t be,
+                                dbBE_Request_t *request,
+                                int trigger );
+
+int Shm_cancel( dbBE_Handle_t be,
+                dbBE_Request_handle_t request );
+
+dbBE_Completion_t* Shm_test( dbBE_Handle_t be,
+                             dbBE_Request_handle_t request );
+
+dbBE_Completion_t* Shm_test_any( dbBE_Handle_t be );
+
+#endif /* BACKEND_SHM_SHM_H_ */
@@ -0,0 +1,250 @@
+/*
+ * Copyright © 2020 IBM Corporation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#include "test_utils.h"
+#include "../segment.h"
+#include "../index.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/wait.h>
+
+#define TEST_SEG_SIZE ( 16 * 1024 * 1024 )
+#define TEST_CHILD_COUNT ( 4 )
+#define TEST_CHILD_PUTS ( 1000 )
+
+static
+int put_string( dbBE_Shm_segment_t *seg, dbBE_Shm_key_t *k, uint32_t gen, const char *str )
+{
+  dbBE_sge_t sge = { .iov_base = (void*)str, .iov_len = strlen( str ) };
+  return dbBE_Shm_key_put( seg, k, gen, &sge, 1 );
+}
+
+/*
+ * each child process puts into its own key and consumes the values of its neighbor
+ */
+static
+int child_main( const char *name, const int id )
+{
+  dbBE_Shm_segment_t *seg = dbBE_Shm_segment_open( name, TEST_SEG_SIZE, 1024 );
+  if( seg == NULL )
+    return 1;
+
+  char key[ 32 ];
+  snprintf( key, 32, "child%d", id );
+  dbBE_Shm_key_t *mine = dbBE_Shm_index_lookup( seg, 0, key, 1 );
+  snprintf( key, 32, "child%d", ( id + 1 ) % TEST_CHILD_COUNT );
+  dbBE_Shm_key_t *other = dbBE_Shm_index_lookup( seg, 0, key, 1 );
+  if(( mine == NULL ) || ( other == NULL ))
+    return 1;
+
+  int failed = 0;
+  int put = 0;
+  int got = 0;
+  while(( put < TEST_CHILD_PUTS ) || ( got < TEST_CHILD_PUTS ))
+  {
+    if( put < TEST_CHILD_PUTS )
+    {
+      int64_t val = put++;
+      dbBE_sge_t sge = { .iov_base = &val, .iov_len = sizeof( val ) };
+      failed += ( dbBE_Shm_key_put( seg, mine, 1, &sge, 1 ) != 0 );
+    }
+
+    int64_t val = -1;
+    int64_t size = 0;
+    dbBE_sge_t sge = { .iov_base = &val, .iov_len = sizeof( val ) };
+    int frc = dbBE_Shm_key_fetch( seg, other, 1, 0, DBBE_SHM_FETCH_CONSUME, &sge, 1, &size );
+    if( frc == 0 )
+    {
+      // values have to arrive in order
+      failed += ( val != got ) || ( size != sizeof( val ) );
+      ++got;
+    }
+    else if( frc != -ENOENT )
+      ++failed;
+  }
+
+  dbBE_Shm_index_release( seg, other );
+  dbBE_Shm_index_release( seg, mine );
+  dbBE_Shm_segment_close( seg, name );
+  return failed ? 1 : 0;
+}
+
+int main( int argc, char ** argv )
+{
+  int rc = 0;
+  char name[ 64 ];
+  snprintf( name, 64, "/dbr_shm_idxtest_%d", getpid() );
+
+  dbBE_Shm_segment_t *seg = NULL;
+  rc += TEST_NOT_RC( dbBE_Shm_segment_open( name, TEST_SEG_SIZE, 1024 ), NULL, seg );
+  TEST_BREAK( rc, "Segment creation failed" );
+
+  dbBE_Shm_key_t *k = NULL;
+  dbBE_Shm_key_t *k2 = NULL;
+  char *toolong = generateLongMsg( DBR_MAX_KEY_LEN + 1 );
+
+  rc += TEST( dbBE_Shm_index_lookup( seg, 0, NULL, 1 ), NULL );
+  rc += TEST( errno, EINVAL );
+  rc += TEST( dbBE_Shm_index_lookup( seg, 0, toolong, 1 ), NULL );
+  rc += TEST( errno, EINVAL );
+  rc += TEST( dbBE_Shm_index_lookup( seg, 0, "HELLO", 0 ), NULL );
+  rc += TEST( errno, ENOENT );
+
+  rc += TEST_NOT_RC( dbBE_Shm_index_lookup( seg, 0, "HELLO", 1 ), NULL, k );
+  rc += TEST( dbBE_Shm_index_lookup( seg, 0, "HELLO", 0 ), k );
+  rc += TEST( dbBE_Shm_index_lookup( seg, 0, "HELLO", 1 ), k );
+  rc += TEST( strcmp( k->_key, "HELLO" ), 0 );
+  rc += TEST( k->_count, 0 );
+
+  // same key in a different namespace is a different entry
+  rc += TEST_NOT_RC( dbBE_Shm_index_lookup( seg, 1, "HELLO", 1 ), NULL, k2 );
+  rc += TEST_NOT( k2, k );
+
+  // FIFO order and read by index
+  char buf[ 16 ];
+  int64_t size = 0;
+  dbBE_sge_t sge = { .iov_base = buf, .iov_len = 16 };
+  rc += TEST( put_string( seg, k, 1, "WORLD1" ), 0 );
+  rc += TEST( put_string( seg, k, 1, "WORLD2" ), 0 );
+  rc += TEST( put_string( seg, k, 1, "WORLD3" ), 0 );
+  rc += TEST( k->_count, 3 );
+
+  memset( buf, 0, 16 );
+  rc += TEST( dbBE_Shm_key_fetch( seg, k, 1, 2, 0, &sge, 1, &size ), 0 );
+  rc += TEST( strcmp( buf, "WORLD3" ), 0 );
+  rc += TEST( size, 6 );
+  rc += TEST( dbBE_Shm_key_fetch( seg, k, 1, 3, 0, &sge, 1, &size ), -ENOENT );
+
+  memset( buf, 0, 16 );
+  rc += TEST( dbBE_Shm_key_fetch( seg, k, 1, 0, DBBE_SHM_FETCH_CONSUME, &sge, 1, &size ), 0 );
+  rc += TEST( strcmp( buf, "WORLD1" ), 0 );
+  rc += TEST( k->_count, 2 );
+
+  // buffer too small: value stays unless partial is requested
+  dbBE_sge_t small = { .iov_base = buf, .iov_len = 3 };
+  memset( buf, 0, 16 );
+  rc += TEST( dbBE_Shm_key_fetch( seg, k, 1, 0, DBBE_SHM_FETCH_CONSUME, &small, 1, &size ), -ENOSPC );
+  rc += TEST( size, 6 );
+  rc += TEST( k->_count, 2 );
+  rc += TEST( dbBE_Shm_key_fetch( seg, k, 1, 0, DBBE_SHM_FETCH_CONSUME | DBBE_SHM_FETCH_PARTIAL, &small, 1, &size ), 0 );
+  rc += TEST( size, 6 );
+  rc += TEST( strcmp( buf, "WOR" ), 0 );
+  rc += TEST( k->_count, 1 );
+
+  // move requires an existing source and an empty destination
+  rc += TEST( dbBE_Shm_key_move( seg, k, 1, k2, 1 ), 0 );
+  rc += TEST( k->_count, 0 );
+  rc += TEST( k2->_count, 1 );
+  rc += TEST( dbBE_Shm_key_move( seg, k, 1, k2, 1 ), -ENOENT );
+  rc += TEST( put_string( seg, k, 1, "WORLD4" ), 0 );
+  rc += TEST( dbBE_Shm_key_move( seg, k, 1, k2, 1 ), -EEXIST );
+
+  memset( buf, 0, 16 );
+  rc += TEST( dbBE_Shm_key_fetch( seg, k2, 1, 0, DBBE_SHM_FETCH_CONSUME, &sge, 1, &size ), 0 );
+  rc += TEST( strcmp( buf, "WORLD3" ), 0 );
+
+  // a new namespace generation doesn't see the old values
+  rc += TEST( dbBE_Shm_key_fetch( seg, k, 2, 0, 0, &sge, 1, &size ), -ENOENT );
+  rc += TEST( k->_count, 0 );
+
+  rc += TEST( put_string( seg, k, 2, "WORLD5" ), 0 );
+  rc += TEST( put_string( seg, k, 2, "WORLD6" ), 0 );
+  rc += TEST( dbBE_Shm_key_clear( seg, k, 2 ), 2 );
+  rc += TEST( dbBE_Shm_key_clear( seg, k, 2 ), 0 );
+
+  // iterate the index
+  uint64_t pos = 0;
+  int entries = 0;
+  while(( k2 = dbBE_Shm_index_next( seg, &pos )) != NULL )
+  {
+    ++entries;
+    dbBE_Shm_index_release( seg, k2 );
+  }
+  rc += TEST( entries, 2 );
+  rc += TEST( seg->_heap_used > 0, 1 );
+
+  TEST_LOG( rc, "Single process" );
+
+  // concurrent producers and consumers in separate processes
+  pid_t children[ TEST_CHILD_COUNT ];
+  int c;
+  for( c = 0; c < TEST_CHILD_COUNT; ++c )
+  {
+    children[ c ] = fork();
+    if( children[ c ] == 0 )
+      exit( child_main( name, c ) );
+  }
+  for( c = 0; c < TEST_CHILD_COUNT; ++c )
+  {
+    int status = 0;
+    rc += TEST( waitpid( children[ c ], &status, 0 ), children[ c ] );
+    rc += TEST( WIFEXITED( status ) && ( WEXITSTATUS( status ) == 0 ), 1 );
+  }
+
+  pos = 0;
+  entries = 0;
+  while(( k2 = dbBE_Shm_index_next( seg, &pos )) != NULL )
+  {
+    ++entries;
+    rc += TEST( k2->_count, 0 );
+    dbBE_Shm_index_release( seg, k2 );
+  }
+  // the keys of the children were removed with their last reference
+  rc += TEST( entries, 2 );
+
+  TEST_LOG( rc, "Multi process" );
+
+  // drop all references to HELLO: the entry without values goes away
+  k2 = dbBE_Shm_index_lookup( seg, 1, "HELLO", 0 );
+  dbBE_Shm_index_release( seg, k2 );
+  dbBE_Shm_index_release( seg, k2 );
+  rc += TEST( put_string( seg, k, 2, "KEEP" ), 0 );
+  dbBE_Shm_index_release( seg, k );
+  dbBE_Shm_index_release( seg, k );
+  dbBE_Shm_index_release( seg, k );
+  rc += TEST( dbBE_Shm_index_lookup( seg, 1, "HELLO", 0 ), NULL );
+  rc += TEST( dbBE_Shm_index_lookup( seg, 0, "HELLO", 0 ), k );
+  rc += TEST( dbBE_Shm_key_clear( seg, k, 2 ), 1 );
+  dbBE_Shm_index_release( seg, k );
+  rc += TEST( dbBE_Shm_index_lookup( seg, 0, "HELLO", 0 ), NULL );
+  int64_t heap_used = seg->_heap_used;
+
+  // removed slots are reused: many more distinct keys than index slots over time
+  int n;
+  char key[ 32 ];
+  for( n = 0; ( n < 4 * (int)seg->_index_len ) && ( rc == 0 ); ++n )
+  {
+    snprintf( key, 32, "cycle%d", n );
+    rc += TEST_NOT_RC( dbBE_Shm_index_lookup( seg, 0, key, 1 ), NULL, k );
+    rc += TEST( put_string( seg, k, 2, key ), 0 );
+    rc += TEST( dbBE_Shm_key_clear( seg, k, 2 ), 1 );
+    dbBE_Shm_index_release( seg, k );
+  }
+  rc += TEST( seg->_heap_used, heap_used );
+
+  TEST_LOG( rc, "Slot reuse" );
+
+  free( toolong );
+  rc += TEST( dbBE_Shm_segment_close( seg, name ), 0 );
+  rc += TEST( dbBE_Shm_segment_unlink( name ), -ENOENT );
+
+  printf( "Test exiting with rc=%d\n", rc );
+  return rc;
+}
@@ -0,0 +1,113 @@
+/*
+ * Copyright © 2020 IBM Corporation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#include "test_utils.h"
+#include "../segment.h"
+#include "../index.h"
+#include "../namespace.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#define TEST_SEG_SIZE ( 8 * 1024 * 1024 )
+
+int main( int argc, char ** argv )
+{
+  int rc = 0;
+  char name[ 64 ];
+  snprintf( name, 64, "/dbr_shm_nstest_%d", getpid() );
+
+  dbBE_Shm_segment_t *seg = NULL;
+  rc += TEST_NOT_RC( dbBE_Shm_segment_open( name, TEST_SEG_SIZE, 1024 ), NULL, seg );
+  TEST_BREAK( rc, "Segment creation failed" );
+
+  char *toolong = generateLongMsg( DBBE_SHM_NAMESPACE_NAME_MAX + 1 );
+  dbBE_Shm_namespace_t *ns = NULL;
+  dbBE_Shm_namespace_t *ns2 = NULL;
+
+  rc += TEST( dbBE_Shm_namespace_create( seg, NULL, NULL, 0 ), NULL );
+  rc += TEST( errno, EINVAL );
+  rc += TEST( dbBE_Shm_namespace_create( seg, toolong, NULL, 0 ), NULL );
+  rc += TEST( errno, E2BIG );
+  rc += TEST( dbBE_Shm_namespace_attach( seg, "Test", NULL ), NULL );
+  rc += TEST( errno, ENOENT );
+
+  rc += TEST_NOT_RC( dbBE_Shm_namespace_create( seg, "Test", "users", 5 ), NULL, ns );
+  TEST_BREAK( rc, "Namespace creation failed" );
+  rc += TEST( dbBE_Shm_namespace_create( seg, "Test", NULL, 0 ), NULL );
+  rc += TEST( errno, EEXIST );
+  rc += TEST( dbBE_Shm_namespace_validate( seg, ns ), 0 );
+
+  char meta[ 128 ];
+  const char *expect = "id:Test:refcnt:1:groups:users:flags:0:";
+  rc += TEST( dbBE_Shm_namespace_query( seg, ns, meta, 128 ), (ssize_t)strlen( expect ) );
+  rc += TEST( strcmp( meta, expect ), 0 );
+  rc += TEST( dbBE_Shm_namespace_query( seg, ns, meta, 4 ), (ssize_t)strlen( expect ) );
+
+  rc += TEST_NOT_RC( dbBE_Shm_namespace_attach( seg, "Test", NULL ), NULL, ns2 );
+  rc += TEST_NOT( ns2, ns );
+  rc += TEST( ns2->_id, ns->_id );
+  rc += TEST( seg->_ns[ ns->_id ]._refcnt, 2 );
+
+  // attaching again with the existing handle shares it
+  rc += TEST( dbBE_Shm_namespace_attach( seg, "Test", ns2 ), ns2 );
+  rc += TEST( ns2->_local_refcnt, 2 );
+  rc += TEST( seg->_ns[ ns->_id ]._refcnt, 3 );
+  rc += TEST( dbBE_Shm_namespace_detach( seg, ns2 ), 2 );
+  rc += TEST( ns2->_local_refcnt, 1 );
+
+  // put some data to check that it gets wiped with the namespace
+  dbBE_Shm_key_t *k = NULL;
+  dbBE_sge_t sge = { .iov_base = "WORLD", .iov_len = 5 };
+  rc += TEST_NOT_RC( dbBE_Shm_index_lookup( seg, ns->_id, "HELLO", 1 ), NULL, k );
+  rc += TEST( dbBE_Shm_key_put( seg, k, ns->_gen, &sge, 1 ), 0 );
+
+  // delete with another client attached only marks the namespace
+  rc += TEST( dbBE_Shm_namespace_delete( seg, ns ), 2 );
+  rc += TEST( dbBE_Shm_namespace_attach( seg, "Test", NULL ), NULL );
+  rc += TEST( errno, ENOENT );
+  rc += TEST( dbBE_Shm_namespace_validate( seg, ns2 ), 0 );
+  rc += TEST( dbBE_Shm_namespace_detach( seg, ns ), 1 );
+  rc += TEST( k->_count, 1 );
+  rc += TEST( dbBE_Shm_namespace_detach( seg, ns2 ), 0 );
+  rc += TEST( k->_count, 0 );
+  dbBE_Shm_index_release( seg, k );
+
+  // the slot gets reused with a new generation
+  uint32_t old_gen = seg->_ns[ 0 ]._gen;
+  rc += TEST_NOT_RC( dbBE_Shm_namespace_create( seg, "Other", NULL, 0 ), NULL, ns );
+  rc += TEST( ns->_gen, old_gen + 1 );
+
+  dbBE_Shm_namespace_t stale = *ns;
+  stale._gen = old_gen;
+  rc += TEST( dbBE_Shm_namespace_validate( seg, &stale ), -ESTALE );
+  stale._check = 0;
+  rc += TEST( dbBE_Shm_namespace_validate( seg, &stale ), -EBADF );
+  rc += TEST( dbBE_Shm_namespace_validate( seg, NULL ), -EINVAL );
+
+  rc += TEST( dbBE_Shm_namespace_delete( seg, ns ), 1 );
+  rc += TEST( dbBE_Shm_namespace_detach( seg, ns ), 0 );
+
+  free( toolong );
+  rc += TEST( dbBE_Shm_segment_close( seg, name ), 0 );
+  rc += TEST( dbBE_Shm_segment_unlink( name ), -ENOENT );
+
+  printf( "Test exiting with rc=%d\n", rc );
+  return rc;
+}
@@ -0,0 +1,99 @@
+/*
+ * Copyright © 2020 IBM Corporation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#include "test_utils.h"
+#include "../segment.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#define TEST_SEG_SIZE ( 8 * 1024 * 1024 )
+
+int main( int argc, char ** argv )
+{
+  int rc = 0;
+  char name[ 64 ];
+  snprintf( name, 64, "/dbr_shm_segtest_%d", getpid() );
+
+  dbBE_Shm_segment_t *seg = NULL;
+  dbBE_Shm_segment_t *seg2 = NULL;
+
+  rc += TEST( dbBE_Shm_segment_open( NULL, TEST_SEG_SIZE, 1024 ), NULL );
+  rc += TEST( errno, EINVAL );
+  rc += TEST( dbBE_Shm_segment_open( name, 1024, 1024 ), NULL );
+  rc += TEST( errno, EINVAL );
+  rc += TEST( dbBE_Shm_segment_open( name, TEST_SEG_SIZE, 0 ), NULL );
+  rc += TEST( errno, EINVAL );
+
+  rc += TEST_NOT_RC( dbBE_Shm_segment_open( name, TEST_SEG_SIZE, 1000 ), NULL, seg );
+  TEST_BREAK( rc, "Segment creation failed" );
+
+  rc += TEST( seg->_magic, DBBE_SHM_MAGIC );
+  rc += TEST( seg->_size, TEST_SEG_SIZE );
+  rc += TEST( seg->_index_len, 1024 );
+  rc += TEST( seg->_heap_used, 0 );
+  rc += TEST( seg->_index > 0, 1 );
+  rc += TEST( seg->_heap >= seg->_index + seg->_index_len * sizeof( dbBE_Shm_offset_t ), 1 );
+
+  // allocation and reuse of freed blocks
+  dbBE_Shm_offset_t a, b, c;
+  rc += TEST_NOT_RC( dbBE_Shm_alloc( seg, 100 ), 0, a );
+  rc += TEST_NOT_RC( dbBE_Shm_alloc( seg, 100 ), 0, b );
+  rc += TEST_NOT( a, b );
+  rc += TEST( seg->_heap_used > 0, 1 );
+  memset( dbBE_Shm_ptr( seg, a ), 'a', 100 );
+  memset( dbBE_Shm_ptr( seg, b ), 'b', 100 );
+  rc += TEST( ((char*)dbBE_Shm_ptr( seg, a ))[ 99 ], 'a' );
+
+  dbBE_Shm_free( seg, a );
+  rc += TEST_RC( dbBE_Shm_alloc( seg, 100 ), a, c );
+  dbBE_Shm_free( seg, b );
+  dbBE_Shm_free( seg, c );
+  rc += TEST( seg->_heap_used, 0 );
+
+  // requests beyond the segment size fail without damage
+  rc += TEST( dbBE_Shm_alloc( seg, TEST_SEG_SIZE ), 0 );
+  rc += TEST_NOT( dbBE_Shm_alloc( seg, 1024 ), 0 );
+
+  // a second mapping of the same name sees the same data regardless of the requested size
+  rc += TEST_NOT_RC( dbBE_Shm_segment_open( name, TEST_SEG_SIZE * 2, 4096 ), NULL, seg2 );
+  if( seg2 != NULL )
+  {
+    rc += TEST_NOT( seg2, seg );
+    rc += TEST( seg2->_size, TEST_SEG_SIZE );
+    rc += TEST( seg2->_index_len, 1024 );
+    rc += TEST( seg2->_heap_used, seg->_heap_used );
+    ((char*)dbBE_Shm_ptr( seg, seg->_heap ))[ 100 ] = 'x';
+    rc += TEST( ((char*)dbBE_Shm_ptr( seg2, seg2->_heap ))[ 100 ], 'x' );
+    rc += TEST( seg->_attached, 2 );
+    rc += TEST( dbBE_Shm_segment_close( seg2, name ), 1 );
+  }
+
+  // the last close removes the segment, the next open starts from scratch
+  rc += TEST( dbBE_Shm_segment_close( seg, name ), 0 );
+  rc += TEST( dbBE_Shm_segment_unlink( name ), -ENOENT );
+  rc += TEST_NOT_RC( dbBE_Shm_segment_open( name, TEST_SEG_SIZE, 1024 ), NULL, seg );
+  rc += TEST( seg->_heap_used, 0 );
+  rc += TEST( seg->_attached, 1 );
+  rc += TEST( dbBE_Shm_segment_close( seg, name ), 0 );
+  rc += TEST( dbBE_Shm_segment_unlink( name ), -ENOENT );
+
+  printf( "Test exiting with rc=%d\n", rc );
+  return rc;
+}
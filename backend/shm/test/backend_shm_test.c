@@ -0,0 +1,309 @@
+/*
+ * Copyright © 2020 IBM Corporation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#include "test_utils.h"
+#include "../backend/common/dbbe_api.h"
+#include "../shm.h"
+#include "../namespace.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+
+static
+dbBE_Completion_t* post_and_wait( dbBE_Handle_t BE, dbBE_Request_t *req )
+{
+  req->_next = NULL;
+  req->_user = req;
+  if( dbBE.post( BE, req, 1 ) == NULL )
+    return NULL;
+  dbBE_Completion_t *comp = NULL;
+  while( comp == NULL )
+    comp = dbBE.test_any( BE );
+  return comp;
+}
+
+static
+int request_check( dbBE_Handle_t BE, dbBE_Request_t *req, DBR_Errorcode_t status, int64_t expect_rc )
+{
+  int rc = 0;
+  dbBE_Completion_t *comp = post_and_wait( BE, req );
+  rc += TEST_NOT( comp, NULL );
+  if( comp != NULL )
+  {
+    rc += TEST( comp->_user, req->_user );
+    rc += TEST( comp->_status, status );
+    rc += TEST( comp->_rc, expect_rc );
+    free( comp );
+  }
+  return rc;
+}
+
+int main( int argc, char ** argv )
+{
+  int rc = 0;
+
+  char name[ 64 ];
+  snprintf( name, 64, "/dbr_shm_betest_%d", getpid() );
+  setenv( DBR_SHM_NAME_ENV, name, 1 );
+  setenv( DBR_SHM_SIZE_ENV, "16777216", 1 );
+
+  dbBE_Handle_t BE = NULL;
+  dbBE_Shm_namespace_t *ns = NULL;
+  dbBE_Shm_namespace_t *sns = NULL;
+  dbBE_Completion_t *comp = NULL;
+
+  rc += TEST_NOT_RC( dbBE.initialize(), NULL, BE );
+  TEST_BREAK( rc, "Backend initialization failed" );
+
+  char buf[128];
+  dbBE_Request_t *req = (dbBE_Request_t*) calloc ( 1, sizeof(dbBE_Request_t) + 2 * sizeof(dbBE_sge_t) );
+
+  // create namespaces
+  req->_key = "KEYSPACE";
+  req->_opcode = DBBE_OPCODE_NSCREATE;
+  req->_sge_count = 1;
+  snprintf( buf, 128, "users" );
+  req->_sge[0].iov_base = (void*)buf;
+  req->_sge[0].iov_len = 5;
+  rc += TEST_NOT_RC( post_and_wait( BE, req ), NULL, comp );
+  if( comp != NULL )
+  {
+    rc += TEST( comp->_status, DBR_SUCCESS );
+    ns = (dbBE_Shm_namespace_t*)comp->_rc;
+    free( comp );
+  }
+  rc += request_check( BE, req, DBR_ERR_EXISTS, 0 );
+
+  req->_key = "NEWSPACE";
+  rc += TEST_NOT_RC( post_and_wait( BE, req ), NULL, comp );
+  if( comp != NULL )
+  {
+    rc += TEST( comp->_status, DBR_SUCCESS );
+    sns = (dbBE_Shm_namespace_t*)comp->_rc;
+    free( comp );
+  }
+  TEST_BREAK( rc, "Namespace creation failed" );
+
+  // invalid requests are rejected at post time
+  req->_key = NULL;
+  req->_ns_hdl = ns;
+  req->_opcode = DBBE_OPCODE_PUT;
+  rc += TEST( dbBE.post( BE, req, 1 ), NULL );
+  rc += TEST( errno, EINVAL );
+
+  // put data in
+  req->_key = "HELLO";
+  req->_ns_hdl = ns;
+  req->_opcode = DBBE_OPCODE_PUT;
+  req->_sge_count = 1;
+  req->_sge[0].iov_base = (void*)buf;
+  req->_sge[0].iov_len = 5;
+  sprintf( buf, "WORLD" );
+  rc += request_check( BE, req, DBR_SUCCESS, 1 );
+  TEST_LOG( rc, "PUT:");
+
+  // read without consuming
+  req->_opcode = DBBE_OPCODE_READ;
+  req->_sge[0].iov_len = 128;
+  memset( buf, 0, 128 );
+  rc += request_check( BE, req, DBR_SUCCESS, 5 );
+  rc += TEST( strncmp( buf, "WORLD", 6 ), 0 );
+
+  // too small buffer
+  req->_sge[0].iov_len = 2;
+  rc += request_check( BE, req, DBR_ERR_UBUFFER, 5 );
+  req->_flags = DBBE_OPCODE_FLAGS_PARTIAL;
+  rc += request_check( BE, req, DBR_SUCCESS, 5 );
+  req->_flags = 0;
+  TEST_LOG( rc, "READ:");
+
+  // directory and iterator
+  req->_opcode = DBBE_OPCODE_DIRECTORY;
+  req->_key = NULL;
+  req->_match = "HEL*";
+  req->_sge_count = 2;
+  req->_sge[0].iov_base = (void*)buf;
+  req->_sge[0].iov_len = 128;
+  req->_sge[1].iov_base = NULL;
+  req->_sge[1].iov_len = 10;
+  rc += request_check( BE, req, DBR_SUCCESS, 5 );
+  rc += TEST( strcmp( buf, "HELLO" ), 0 );
+
+  req->_opcode = DBBE_OPCODE_ITERATOR;
+  req->_match = "";
+  req->_sge_count = 1;
+  rc += TEST_NOT_RC( post_and_wait( BE, req ), NULL, comp );
+  if( comp != NULL )
+  {
+    rc += TEST( comp->_status, DBR_SUCCESS );
+    rc += TEST_NOT( comp->_rc, 0 );
+    rc += TEST( strcmp( buf, "HELLO" ), 0 );
+    req->_key = (char*)comp->_rc;
+    free( comp );
+  }
+  rc += request_check( BE, req, DBR_SUCCESS, 0 );
+  rc += TEST( buf[0], (char)EOF );
+  req->_key = "HELLO";
+  req->_match = NULL;
+  TEST_LOG( rc, "DIRECTORY/ITERATOR:");
+
+  // move to other namespace
+  req->_opcode = DBBE_OPCODE_MOVE;
+  req->_sge_count = 2;
+  req->_sge[0].iov_base = (void*)sns;
+  req->_sge[0].iov_len = sizeof( void* );
+  req->_sge[1].iov_base = DBR_GROUP_EMPTY;
+  req->_sge[1].iov_len = sizeof( DBR_GROUP_EMPTY );
+  rc += request_check( BE, req, DBR_SUCCESS, 0 );
+  rc += request_check( BE, req, DBR_ERR_UNAVAIL, 0 );
+  TEST_LOG( rc, "MOVE" );
+
+  // get data out of the other namespace
+  req->_ns_hdl = sns;
+  req->_opcode = DBBE_OPCODE_GET;
+  req->_sge_count = 1;
+  memset( buf, 0, 128 );
+  req->_sge[0].iov_base = (void*)buf;
+  req->_sge[0].iov_len = 128;
+  rc += request_check( BE, req, DBR_SUCCESS, 5 );
+  rc += TEST( strncmp( buf, "WORLD", 6 ), 0 );
+
+  req->_flags = DBBE_OPCODE_FLAGS_IMMEDIATE;
+  rc += request_check( BE, req, DBR_ERR_UNAVAIL, 0 );
+  req->_flags = 0;
+  TEST_LOG( rc, "GET:");
+
+  // a blocking get waits until the data shows up
+  dbBE_Request_t *put = (dbBE_Request_t*) calloc ( 1, sizeof(dbBE_Request_t) + sizeof(dbBE_sge_t) );
+  put->_key = "HELLO";
+  put->_ns_hdl = sns;
+  put->_opcode = DBBE_OPCODE_PUT;
+  put->_user = put;
+  put->_sge_count = 1;
+  put->_sge[0].iov_base = "LATE";
+  put->_sge[0].iov_len = 4;
+
+  memset( buf, 0, 128 );
+  req->_user = req;
+  rc += TEST_NOT( dbBE.post( BE, req, 1 ), NULL );
+  rc += TEST( dbBE.test_any( BE ), NULL );
+  rc += TEST( dbBE.test_any( BE ), NULL );
+  rc += TEST_NOT( dbBE.post( BE, put, 1 ), NULL );
+  int seen = 0;
+  while( seen < 2 )
+  {
+    comp = dbBE.test_any( BE );
+    if( comp == NULL )
+      continue;
+    ++seen;
+    rc += TEST( comp->_status, DBR_SUCCESS );
+    if( comp->_user == req )
+      rc += TEST( comp->_rc, 4 );
+    free( comp );
+  }
+  rc += TEST( strncmp( buf, "LATE", 5 ), 0 );
+
+  // cancel a waiting get
+  rc += TEST_NOT( dbBE.post( BE, req, 1 ), NULL );
+  rc += TEST( dbBE.test_any( BE ), NULL );
+  rc += TEST( dbBE.cancel( BE, req ), 0 );
+  rc += TEST_NOT_RC( dbBE.test_any( BE ), NULL, comp );
+  if( comp != NULL )
+  {
+    rc += TEST( comp->_user, req );
+    rc += TEST( comp->_status, DBR_ERR_CANCELLED );
+    free( comp );
+  }
+  rc += TEST( dbBE.cancel( BE, req ), ENOENT );
+  free( put );
+  TEST_LOG( rc, "BLOCKING GET/CANCEL:");
+
+  // put and remove
+  req->_ns_hdl = ns;
+  req->_opcode = DBBE_OPCODE_PUT;
+  req->_sge[0].iov_len = 5;
+  rc += request_check( BE, req, DBR_SUCCESS, 1 );
+  req->_opcode = DBBE_OPCODE_REMOVE;
+  rc += request_check( BE, req, DBR_SUCCESS, 0 );
+  rc += request_check( BE, req, DBR_ERR_UNAVAIL, 0 );
+  TEST_LOG( rc, "REMOVE:");
+
+  // attach, query, delete, detach
+  req->_key = "KEYSPACE";
+  req->_ns_hdl = NULL;
+  req->_opcode = DBBE_OPCODE_NSATTACH;
+  req->_sge_count = 0;
+  dbBE_Shm_namespace_t *ans = NULL;
+  rc += TEST_NOT_RC( post_and_wait( BE, req ), NULL, comp );
+  if( comp != NULL )
+  {
+    rc += TEST( comp->_status, DBR_SUCCESS );
+    ans = (dbBE_Shm_namespace_t*)comp->_rc;
+    rc += TEST( ans->_id, ns->_id );
+    free( comp );
+  }
+
+  const char *meta = "id:KEYSPACE:refcnt:2:groups:users:flags:0:";
+  req->_key = NULL;
+  req->_ns_hdl = ns;
+  req->_opcode = DBBE_OPCODE_NSQUERY;
+  req->_sge_count = 1;
+  req->_sge[0].iov_base = (void*)buf;
+  req->_sge[0].iov_len = 128;
+  memset( buf, 0, 128 );
+  rc += request_check( BE, req, DBR_SUCCESS, strlen( meta ) );
+  rc += TEST( strcmp( buf, meta ), 0 );
+  req->_sge[0].iov_len = 8;
+  rc += request_check( BE, req, DBR_ERR_UBUFFER, strlen( meta ) );
+
+  req->_opcode = DBBE_OPCODE_NSDELETE;
+  req->_sge_count = 0;
+  rc += request_check( BE, req, DBR_ERR_NSBUSY, 2 );
+  req->_opcode = DBBE_OPCODE_NSDETACH;
+  rc += request_check( BE, req, DBR_SUCCESS, 1 );
+
+  // last detach removes the namespace; a copy of the handle becomes stale
+  dbBE_Shm_namespace_t stale = *ans;
+  req->_ns_hdl = ans;
+  rc += request_check( BE, req, DBR_SUCCESS, 0 );
+  req->_ns_hdl = &stale;
+  req->_key = "HELLO";
+  req->_opcode = DBBE_OPCODE_READ;
+  req->_sge_count = 1;
+  req->_sge[0].iov_len = 128;
+  rc += request_check( BE, req, DBR_ERR_NSINVAL, 0 );
+
+  req->_key = NULL;
+  req->_ns_hdl = sns;
+  req->_opcode = DBBE_OPCODE_NSDELETE;
+  req->_sge_count = 0;
+  rc += request_check( BE, req, DBR_SUCCESS, 0 );
+  req->_opcode = DBBE_OPCODE_NSDETACH;
+  rc += request_check( BE, req, DBR_SUCCESS, 0 );
+  TEST_LOG( rc, "NAMESPACE:");
+
+  free( req );
+  rc += TEST( dbBE.exit( BE ), 0 );
+  // the backend removed the segment on exit
+  rc += TEST( shm_unlink( name ), -1 );
+
+  printf( "Test exiting with rc=%d\n", rc );
+  return rc;
+}
@@ -48,6 +48,7 @@ typedef struct dbrDA_Request_chain
   int64_t *_ret_size;                 ///< (optional) pointer to reference the location of the return size
   int64_t _size;                      ///< total number of bytes for this request (used for read/get)
   int _sge_count;                     ///< number of SGEs in this request (if any)
+  int _flags;                         ///< (optional) DBR_FLAGS_* added to the flags of the user call for this request
   struct iovec _value_sge[];          ///< variable size, needs to be last entry !!!
 } dbrDA_Request_chain_t;
 
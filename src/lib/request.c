@@ -146,7 +146,7 @@ dbrRequestContext_t* dbrCreate_request_chain( dbBE_Opcode op,
     if( ctx == NULL )
       goto error;
 
-    ctx->_req._flags = flags;
+    ctx->_req._flags = flags | item->_flags;
 
     // chain the request contexts
     if( prev != NULL )
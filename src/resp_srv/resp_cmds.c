@@ -0,0 +1,1126 @@
+/*
+ * Copyright © 2020 IBM Corporation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#include "logutil.h"
+#include "resp_srv.h"
+
+#include <errno.h>
+#include <fnmatch.h>
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <time.h>
+
+typedef void (*dbrResp_cmd_fn_t)( dbrResp_server_t *srv, dbrResp_client_t *c, int argc, dbrResp_str_t *argv );
+
+typedef struct
+{
+  const char *_name;
+  int _arity;       /**< exact arg count incl. command name; negative: minimum */
+  int _first_key;   /**< 0: no key args */
+  int _last_key;    /**< -1: all remaining args */
+  int _key_step;
+  int _readonly;    /**< served by replicas after READONLY */
+  dbrResp_cmd_fn_t _fn;
+} dbrResp_cmd_t;
+
+#define DBR_RESP_WRONGTYPE "WRONGTYPE Operation against a key holding the wrong kind of value"
+
+static
+int dbrResp_parse_int( const dbrResp_str_t *arg, int64_t *val )
+{
+  char buf[ 32 ];
+  if(( arg->_len == 0 ) || ( arg->_len >= sizeof( buf ) ))
+    return -EINVAL;
+  memcpy( buf, arg->_data, arg->_len );
+  buf[ arg->_len ] = '\0';
+  char *end = NULL;
+  errno = 0;
+  long long v = strtoll( buf, &end, 10 );
+  if(( errno != 0 ) || ( *end != '\0' ))
+    return -EINVAL;
+  *val = v;
+  return 0;
+}
+
+static
+dbrResp_obj_t* dbrResp_lookup_typed( dbrResp_server_t *srv, dbrResp_client_t *c,
+                                     dbrResp_str_t *key, dbrResp_obj_type_t type, int *wrongtype )
+{
+  dbrResp_obj_t *obj = dbrResp_store_find( srv->_store, key->_data, key->_len );
+  *wrongtype = (( obj != NULL ) && ( obj->_type != type ));
+  if( *wrongtype )
+  {
+    dbrResp_reply_error( srv, c, DBR_RESP_WRONGTYPE );
+    return NULL;
+  }
+  return obj;
+}
+
+static
+dbrResp_obj_t* dbrResp_create_typed( dbrResp_server_t *srv, dbrResp_client_t *c,
+                                     dbrResp_str_t *key, dbrResp_obj_type_t type )
+{
+  dbrResp_obj_t *obj = dbrResp_store_get_or_create( srv->_store, key->_data, key->_len, type );
+  if( obj == NULL )
+  {
+    if( errno == EEXIST )
+      dbrResp_reply_error( srv, c, DBR_RESP_WRONGTYPE );
+    else
+      dbrResp_reply_error( srv, c, "OOM command not allowed when used memory > 'maxmemory'." );
+  }
+  return obj;
+}
+
+/*
+ * connection and server commands
+ */
+static
+void dbrResp_cmd_ping( dbrResp_server_t *srv, dbrResp_client_t *c, int argc, dbrResp_str_t *argv )
+{
+  if( argc > 1 )
+    dbrResp_reply_bulk( srv, c, argv[1]._data, argv[1]._len );
+  else
+    dbrResp_reply_status( srv, c, "PONG" );
+}
+
+static
+void dbrResp_cmd_echo( dbrResp_server_t *srv, dbrResp_client_t *c, int argc, dbrResp_str_t *argv )
+{
+  dbrResp_reply_bulk( srv, c, argv[1]._data, argv[1]._len );
+}
+
+static
+void dbrResp_cmd_ok( dbrResp_server_t *srv, dbrResp_client_t *c, int argc, dbrResp_str_t *argv )
+{
+  dbrResp_reply_status( srv, c, "OK" );
+}
+
+static
+void dbrResp_cmd_auth( dbrResp_server_t *srv, dbrResp_client_t *c, int argc, dbrResp_str_t *argv )
+{
+  const char *pw = srv->_cfg._password;
+  dbrResp_str_t *given = &argv[ argc - 1 ];
+  if(( pw == NULL ) || (( strlen( pw ) == given->_len ) && ( memcmp( pw, given->_data, given->_len ) == 0 )))
+  {
+    c->_authed = 1;
+    dbrResp_reply_status( srv, c, "OK" );
+  }
+  else
+    dbrResp_reply_error( srv, c, "WRONGPASS invalid username-password pair" );
+}
+
+/*
+ * HELLO [protover [AUTH <user> <password>] [SETNAME <name>]]
+ */
+static
+void dbrResp_cmd_hello( dbrResp_server_t *srv, dbrResp_client_t *c, int argc, dbrResp_str_t *argv )
+{
+  int64_t protocol = c->_protocol;
+  if(( argc > 1 ) && (( dbrResp_parse_int( &argv[1], &protocol ) != 0 ) || ( protocol < 2 ) || ( protocol > 3 )))
+  {
+    dbrResp_reply_error( srv, c, "NOPROTO unsupported protocol version" );
+    return;
+  }
+
+  int n;
+  for( n = 2; n < argc; ++n )
+  {
+    if(( strcasecmp( argv[n]._data, "AUTH" ) == 0 ) && ( n + 2 < argc ))
+    {
+      const char *pw = srv->_cfg._password;
+      dbrResp_str_t *given = &argv[ n + 2 ];
+      if(( pw != NULL ) && (( strlen( pw ) != given->_len ) || ( memcmp( pw, given->_data, given->_len ) != 0 )))
+      {
+        dbrResp_reply_error( srv, c, "WRONGPASS invalid username-password pair" );
+        return;
+      }
+      c->_authed = 1;
+      n += 2;
+    }
+    else if(( strcasecmp( argv[n]._data, "SETNAME" ) == 0 ) && ( n + 1 < argc ))
+      n += 1;
+    else
+    {
+      dbrResp_reply_error( srv, c, "ERR syntax error in HELLO option '%s'", argv[n]._data );
+      return;
+    }
+  }
+  if( ! c->_authed )
+  {
+    dbrResp_reply_error( srv, c, "NOAUTH HELLO must be called with the client already authenticated" );
+    return;
+  }
+
+  c->_protocol = (int)protocol;
+  const char *mode = ( srv->_cfg._nodes > 0 ) ? "cluster" : "standalone";
+  const char *role = c->_replica ? "replica" : "master";
+  dbrResp_reply_map( srv, c, 7 );
+  dbrResp_reply_bulk( srv, c, "server", 6 );
+  dbrResp_reply_bulk( srv, c, "resp_srv", 8 );
+  dbrResp_reply_bulk( srv, c, "version", 7 );
+  dbrResp_reply_bulk( srv, c, "6.0.0", 5 );
+  dbrResp_reply_bulk( srv, c, "proto", 5 );
+  dbrResp_reply_int( srv, c, protocol );
+  dbrResp_reply_bulk( srv, c, "id", 2 );
+  dbrResp_reply_int( srv, c, c->_fd );
+  dbrResp_reply_bulk( srv, c, "mode", 4 );
+  dbrResp_reply_bulk( srv, c, mode, strlen( mode ) );
+  dbrResp_reply_bulk( srv, c, "role", 4 );
+  dbrResp_reply_bulk( srv, c, role, strlen( role ) );
+  dbrResp_reply_bulk( srv, c, "modules", 7 );
+  dbrResp_reply_array( srv, c, 0 );
+}
+
+static
+void dbrResp_cmd_asking( dbrResp_server_t *srv, dbrResp_client_t *c, int argc, dbrResp_str_t *argv )
+{
+  c->_asking = 1;
+  dbrResp_reply_status( srv, c, "OK" );
+}
+
+static
+void dbrResp_cmd_readonly( dbrResp_server_t *srv, dbrResp_client_t *c, int argc, dbrResp_str_t *argv )
+{
+  c->_readonly = ( strcasecmp( argv[0]._data, "READONLY" ) == 0 );
+  dbrResp_reply_status( srv, c, "OK" );
+}
+
+static
+void dbrResp_cmd_quit( dbrResp_server_t *srv, dbrResp_client_t *c, int argc, dbrResp_str_t *argv )
+{
+  c->_closing = 1;
+  dbrResp_reply_status( srv, c, "OK" );
+}
+
+static
+void dbrResp_cmd_role( dbrResp_server_t *srv, dbrResp_client_t *c, int argc, dbrResp_str_t *argv )
+{
+  if( c->_replica )
+  {
+    dbrResp_reply_array( srv, c, 5 );
+    dbrResp_reply_bulk( srv, c, "slave", 5 );
+    dbrResp_reply_bulk( srv, c, srv->_cfg._host, strlen( srv->_cfg._host ) );
+    dbrResp_reply_int( srv, c, srv->_cfg._port + c->_node );
+    dbrResp_reply_bulk( srv, c, "connected", 9 );
+    dbrResp_reply_int( srv, c, 0 );
+    return;
+  }
+  dbrResp_reply_array( srv, c, 3 );
+  dbrResp_reply_bulk( srv, c, "master", 6 );
+  dbrResp_reply_int( srv, c, 0 );
+  dbrResp_reply_array( srv, c, 0 );
+}
+
+static
+void dbrResp_cmd_dbsize( dbrResp_server_t *srv, dbrResp_client_t *c, int argc, dbrResp_str_t *argv )
+{
+  dbrResp_reply_int( srv, c, srv->_store->_keys );
+}
+
+static
+void dbrResp_cmd_flushall( dbrResp_server_t *srv, dbrResp_client_t *c, int argc, dbrResp_str_t *argv )
+{
+  dbrResp_store_flush( srv->_store );
+  dbrResp_reply_status( srv, c, "OK" );
+}
+
+static
+void dbrResp_cmd_shutdown( dbrResp_server_t *srv, dbrResp_client_t *c, int argc, dbrResp_str_t *argv )
+{
+  srv->_keep_running = 0;
+  dbrResp_reply_status( srv, c, "OK" );
+}
+
+static
+void dbrResp_cmd_cluster( dbrResp_server_t *srv, dbrResp_client_t *c, int argc, dbrResp_str_t *argv )
+{
+  if( srv->_cfg._nodes == 0 )
+  {
+    dbrResp_reply_error( srv, c, "ERR This instance has cluster support disabled" );
+    return;
+  }
+
+  if( strncasecmp( argv[1]._data, "SLOTS", argv[1]._len + 1 ) == 0 )
+  {
+    // collect contiguous ranges of the same owner
+    int ranges = 0;
+    int first[ DBR_RESP_HASH_SLOTS ];
+    int s;
+    for( s = 0; s < DBR_RESP_HASH_SLOTS; ++s )
+      if(( s == 0 ) || ( srv->_owner[ s ] != srv->_owner[ s - 1 ] ))
+        first[ ranges++ ] = s;
+
+    dbrResp_reply_array( srv, c, ranges );
+    int r;
+    for( r = 0; r < ranges; ++r )
+    {
+      int last = ( r + 1 < ranges ) ? first[ r + 1 ] - 1 : DBR_RESP_HASH_SLOTS - 1;
+      int node = srv->_owner[ first[ r ] ];
+      char id[ 41 ];
+      snprintf( id, sizeof( id ), "%040d", node );
+      dbrResp_reply_array( srv, c, 3 + srv->_cfg._replicas );
+      dbrResp_reply_int( srv, c, first[ r ] );
+      dbrResp_reply_int( srv, c, last );
+      dbrResp_reply_array( srv, c, 3 );
+      dbrResp_reply_bulk( srv, c, srv->_cfg._host, strlen( srv->_cfg._host ) );
+      dbrResp_reply_int( srv, c, srv->_cfg._port + node );
+      dbrResp_reply_bulk( srv, c, id, 40 );
+      int rep;
+      for( rep = 0; rep < srv->_cfg._replicas; ++rep )
+      {
+        snprintf( id, sizeof( id ), "%040d", ( rep + 1 ) * DBR_RESP_MAX_NODES + node );
+        dbrResp_reply_array( srv, c, 3 );
+        dbrResp_reply_bulk( srv, c, srv->_cfg._host, strlen( srv->_cfg._host ) );
+        dbrResp_reply_int( srv, c, dbrResp_replica_port( &srv->_cfg, node, rep ) );
+        dbrResp_reply_bulk( srv, c, id, 40 );
+      }
+    }
+  }
+  else if( strncasecmp( argv[1]._data, "KEYSLOT", argv[1]._len + 1 ) == 0 )
+  {
+    if( argc != 3 )
+      dbrResp_reply_error( srv, c, "ERR wrong number of arguments for 'cluster|keyslot' command" );
+    else
+      dbrResp_reply_int( srv, c, dbrResp_key_slot( argv[2]._data, argv[2]._len ) );
+  }
+  else if( strncasecmp( argv[1]._data, "INFO", argv[1]._len + 1 ) == 0 )
+  {
+    char info[ 256 ];
+    int len = snprintf( info, sizeof( info ),
+                        "cluster_state:ok\r\ncluster_slots_assigned:%d\r\ncluster_known_nodes:%d\r\ncluster_size:%d\r\n",
+                        DBR_RESP_HASH_SLOTS, srv->_cfg._nodes, srv->_cfg._nodes );
+    dbrResp_reply_bulk( srv, c, info, len );
+  }
+  else
+    dbrResp_reply_error( srv, c, "ERR unknown subcommand '%.*s'", (int)argv[1]._len, argv[1]._data );
+}
+
+/*
+ * runtime control of the stand-in: SIM <subcommand> [args]
+ */
+static
+void dbrResp_cmd_sim( dbrResp_server_t *srv, dbrResp_client_t *c, int argc, dbrResp_str_t *argv )
+{
+  int64_t v1 = 0, v2 = 0;
+  const char *sub = argv[1]._data;
+  if(( strcasecmp( sub, "LATENCY" ) == 0 ) && ( argc == 3 ) && ( dbrResp_parse_int( &argv[2], &v1 ) == 0 ) && ( v1 >= 0 ))
+  {
+    srv->_cfg._latency_us = v1;
+    dbrResp_reply_status( srv, c, "OK" );
+  }
+  else if(( strcasecmp( sub, "BANDWIDTH" ) == 0 ) && ( argc == 3 ) && ( dbrResp_parse_int( &argv[2], &v1 ) == 0 ) && ( v1 >= 0 ))
+  {
+    srv->_cfg._bandwidth = v1;
+    dbrResp_reply_status( srv, c, "OK" );
+  }
+  else if((( strcasecmp( sub, "MIGRATE" ) == 0 ) || ( strcasecmp( sub, "MIGRATING" ) == 0 )) && ( argc == 4 ) &&
+      ( dbrResp_parse_int( &argv[2], &v1 ) == 0 ) && ( dbrResp_parse_int( &argv[3], &v2 ) == 0 ) &&
+      ( v1 >= 0 ) && ( v1 < DBR_RESP_HASH_SLOTS ) && ( v2 >= 0 ) && ( v2 < srv->_cfg._nodes ))
+  {
+    // MIGRATING starts to move the slot (ASK from the owner), MIGRATE completes it (MOVED)
+    if(( strcasecmp( sub, "MIGRATING" ) == 0 ) && ( srv->_owner[ v1 ] != v2 ))
+      srv->_migrating[ v1 ] = (uint8_t)v2;
+    else
+    {
+      srv->_owner[ v1 ] = (uint8_t)v2;
+      srv->_migrating[ v1 ] = 0xFF;
+    }
+    dbrResp_reply_status( srv, c, "OK" );
+  }
+  else if(( strcasecmp( sub, "DOWN" ) == 0 ) && ( argc == 4 ) &&
+      ( dbrResp_parse_int( &argv[2], &v1 ) == 0 ) && ( dbrResp_parse_int( &argv[3], &v2 ) == 0 ) &&
+      ( v1 >= 0 ) && ( v1 < srv->_cfg._nodes ) && ( v2 >= 0 ))
+  {
+    // the network loop drops the node's connections and refuses new ones for <msec>
+    struct timespec until;
+    clock_gettime( CLOCK_MONOTONIC, &until );
+    until.tv_sec += v2 / 1000;
+    until.tv_nsec += ( v2 % 1000 ) * 1000000;
+    if( until.tv_nsec >= 1000000000 )
+    {
+      until.tv_sec += 1;
+      until.tv_nsec -= 1000000000;
+    }
+    srv->_down_until[ v1 ] = until;
+    dbrResp_reply_status( srv, c, "OK" );
+  }
+  else if(( strcasecmp( sub, "DROP" ) == 0 ) && ( argc == 3 ) &&
+      ( dbrResp_parse_int( &argv[2], &v1 ) == 0 ) && ( v1 >= 0 ) && ( v1 < srv->_cfg._nodes ))
+  {
+    srv->_drop_replicas[ v1 ] = 1;
+    dbrResp_reply_status( srv, c, "OK" );
+  }
+  else if(( strcasecmp( sub, "INJECT" ) == 0 ) && ( argc == 4 ) && ( dbrResp_parse_int( &argv[3], &v1 ) == 0 ) && ( v1 >= 0 ))
+  {
+    const char *what = argv[2]._data;
+    if( strcasecmp( what, "MOVED" ) == 0 )
+      srv->_cfg._moved_every = v1;
+    else if( strcasecmp( what, "ASK" ) == 0 )
+      srv->_cfg._ask_every = v1;
+    else if( strcasecmp( what, "CLUSTERDOWN" ) == 0 )
+      srv->_cfg._clusterdown_every = v1;
+    else if( strcasecmp( what, "PUSH" ) == 0 )
+      srv->_cfg._push_every = v1;
+    else
+    {
+      dbrResp_reply_error( srv, c, "ERR unknown injection '%s'", what );
+      return;
+    }
+    dbrResp_reply_status( srv, c, "OK" );
+  }
+  else if(( strcasecmp( sub, "STATS" ) == 0 ) && ( argc == 2 ))
+  {
+    char info[ 512 ];
+    dbrResp_stats_t *st = &srv->_stats;
+    int len = snprintf( info, sizeof( info ),
+                        "commands:%"PRIu64"\r\nkeyed:%"PRIu64"\r\nbytes_in:%"PRIu64"\r\nbytes_out:%"PRIu64"\r\n"
+                        "moved:%"PRIu64"\r\nask:%"PRIu64"\r\nclusterdown:%"PRIu64"\r\nreplica_reads:%"PRIu64"\r\nconnections:%"PRIu64"\r\n"
+                        "pushes:%"PRIu64"\r\nkeys:%zu\r\nvalue_bytes:%zu\r\n",
+                        st->_commands, st->_keyed, st->_bytes_in, st->_bytes_out,
+                        st->_moved, st->_ask, st->_clusterdown, st->_replica_reads, st->_connections, st->_pushes,
+                        srv->_store->_keys, srv->_store->_bytes );
+    dbrResp_reply_bulk( srv, c, info, len );
+  }
+  else
+    dbrResp_reply_error( srv, c, "ERR SIM LATENCY <us> | BANDWIDTH <bytes/s> | MIGRATE|MIGRATING <slot> <node>"
+                                 " | DOWN <node> <msec> | DROP <node> | INJECT MOVED|ASK|CLUSTERDOWN|PUSH <every> | STATS" );
+}
+
+/*
+ * key space commands
+ */
+static
+void dbrResp_cmd_exists( dbrResp_server_t *srv, dbrResp_client_t *c, int argc, dbrResp_str_t *argv )
+{
+  int64_t count = 0;
+  int n;
+  for( n = 1; n < argc; ++n )
+    if( dbrResp_store_find( srv->_store, argv[n]._data, argv[n]._len ) != NULL )
+      ++count;
+  dbrResp_reply_int( srv, c, count );
+}
+
+static
+void dbrResp_cmd_del( dbrResp_server_t *srv, dbrResp_client_t *c, int argc, dbrResp_str_t *argv )
+{
+  int64_t count = 0;
+  int n;
+  for( n = 1; n < argc; ++n )
+    count += dbrResp_store_delete( srv->_store, argv[n]._data, argv[n]._len );
+  dbrResp_reply_int( srv, c, count );
+}
+
+static
+void dbrResp_cmd_type( dbrResp_server_t *srv, dbrResp_client_t *c, int argc, dbrResp_str_t *argv )
+{
+  dbrResp_obj_t *obj = dbrResp_store_find( srv->_store, argv[1]._data, argv[1]._len );
+  if( obj == NULL )
+    dbrResp_reply_status( srv, c, "none" );
+  else
+    dbrResp_reply_status( srv, c, obj->_type == DBR_RESP_OBJ_LIST ? "list" :
+                                  obj->_type == DBR_RESP_OBJ_HASH ? "hash" : "string" );
+}
+
+typedef struct
+{
+  dbrResp_server_t *_srv;
+  int _node;
+  dbrResp_str_t *_pattern;
+  dbrResp_str_t **_keys;
+  size_t _count;
+  size_t _cap;
+} dbrResp_scan_ctx_t;
+
+static
+void dbrResp_scan_collect( dbrResp_obj_t *obj, void *arg )
+{
+  dbrResp_scan_ctx_t *sctx = (dbrResp_scan_ctx_t*)arg;
+
+  // each node only reports the keys of its own slots
+  if(( sctx->_srv->_cfg._nodes > 0 ) && ( sctx->_srv->_owner[ obj->_slot ] != sctx->_node ))
+    return;
+  if(( sctx->_pattern != NULL ) && ( fnmatch( sctx->_pattern->_data, obj->_key._data, 0 ) != 0 ))
+    return;
+
+  if( sctx->_count == sctx->_cap )
+  {
+    size_t cap = sctx->_cap ? sctx->_cap * 2 : 16;
+    dbrResp_str_t **keys = (dbrResp_str_t**)realloc( sctx->_keys, cap * sizeof( dbrResp_str_t* ) );
+    if( keys == NULL )
+      return;
+    sctx->_keys = keys;
+    sctx->_cap = cap;
+  }
+  sctx->_keys[ sctx->_count++ ] = &obj->_key;
+}
+
+static
+void dbrResp_cmd_scan( dbrResp_server_t *srv, dbrResp_client_t *c, int argc, dbrResp_str_t *argv )
+{
+  char *end = NULL;
+  uint64_t cursor = strtoull( argv[1]._data, &end, 10 );
+  if(( end == NULL ) || ( *end != '\0' ))
+  {
+    dbrResp_reply_error( srv, c, "ERR invalid cursor" );
+    return;
+  }
+
+  dbrResp_scan_ctx_t sctx = { ._srv = srv, ._node = c->_node, ._pattern = NULL, ._keys = NULL, ._count = 0, ._cap = 0 };
+  int64_t count = 10;
+  int n;
+  for( n = 2; n < argc; n += 2 )
+  {
+    if(( n + 1 < argc ) && ( strcasecmp( argv[n]._data, "MATCH" ) == 0 ))
+      sctx._pattern = &argv[ n + 1 ];
+    else if(( n + 1 < argc ) && ( strcasecmp( argv[n]._data, "COUNT" ) == 0 ) &&
+        ( dbrResp_parse_int( &argv[ n + 1 ], &count ) == 0 ) && ( count > 0 ))
+      continue;
+    else
+    {
+      dbrResp_reply_error( srv, c, "ERR syntax error" );
+      return;
+    }
+  }
+
+  cursor = dbrResp_store_scan( srv->_store, cursor, count, dbrResp_scan_collect, &sctx );
+
+  char cbuf[ 32 ];
+  int clen = snprintf( cbuf, sizeof( cbuf ), "%"PRIu64, cursor );
+  dbrResp_reply_array( srv, c, 2 );
+  dbrResp_reply_bulk( srv, c, cbuf, clen );
+  dbrResp_reply_array( srv, c, sctx._count );
+  size_t k;
+  for( k = 0; k < sctx._count; ++k )
+    dbrResp_reply_bulk( srv, c, sctx._keys[ k ]->_data, sctx._keys[ k ]->_len );
+  free( sctx._keys );
+}
+
+static
+void dbrResp_cmd_dump( dbrResp_server_t *srv, dbrResp_client_t *c, int argc, dbrResp_str_t *argv )
+{
+  dbrResp_obj_t *obj = dbrResp_store_find( srv->_store, argv[1]._data, argv[1]._len );
+  if( obj == NULL )
+  {
+    dbrResp_reply_nil( srv, c );
+    return;
+  }
+  size_t len = 0;
+  char *payload = dbrResp_obj_dump( obj, &len );
+  if( payload == NULL )
+  {
+    dbrResp_reply_error( srv, c, "OOM command not allowed when used memory > 'maxmemory'." );
+    return;
+  }
+  dbrResp_reply_bulk( srv, c, payload, len );
+  free( payload );
+}
+
+static
+void dbrResp_cmd_restore( dbrResp_server_t *srv, dbrResp_client_t *c, int argc, dbrResp_str_t *argv )
+{
+  int64_t ttl = 0;
+  if(( dbrResp_parse_int( &argv[2], &ttl ) != 0 ) || ( ttl < 0 ))
+  {
+    dbrResp_reply_error( srv, c, "ERR Invalid TTL value, must be >= 0" );
+    return;
+  }
+  if(( argc == 5 ) && ( strcasecmp( argv[4]._data, "REPLACE" ) == 0 ))
+    dbrResp_store_delete( srv->_store, argv[1]._data, argv[1]._len );
+  else if( argc != 4 )
+  {
+    dbrResp_reply_error( srv, c, "ERR syntax error" );
+    return;
+  }
+
+  switch( dbrResp_obj_restore( srv->_store, argv[1]._data, argv[1]._len, argv[3]._data, argv[3]._len ) )
+  {
+    case 0:
+      dbrResp_reply_status( srv, c, "OK" );
+      break;
+    case -EEXIST:
+      dbrResp_reply_error( srv, c, "BUSYKEY Target key name already exists." );
+      break;
+    case -EPROTO:
+      dbrResp_reply_error( srv, c, "ERR DUMP payload version or checksum are wrong" );
+      break;
+    default:
+      dbrResp_reply_error( srv, c, "OOM command not allowed when used memory > 'maxmemory'." );
+      break;
+  }
+}
+
+/*
+ * list commands
+ */
+static
+void dbrResp_cmd_rpush( dbrResp_server_t *srv, dbrResp_client_t *c, int argc, dbrResp_str_t *argv )
+{
+  dbrResp_obj_t *obj = dbrResp_create_typed( srv, c, &argv[1], DBR_RESP_OBJ_LIST );
+  if( obj == NULL )
+    return;
+  int n;
+  for( n = 2; n < argc; ++n )
+    if( dbrResp_list_push( srv->_store, obj, argv[n]._data, argv[n]._len ) != 0 )
+    {
+      dbrResp_reply_error( srv, c, "OOM command not allowed when used memory > 'maxmemory'." );
+      return;
+    }
+  dbrResp_reply_int( srv, c, obj->_count );
+}
+
+static
+void dbrResp_cmd_lpop( dbrResp_server_t *srv, dbrResp_client_t *c, int argc, dbrResp_str_t *argv )
+{
+  int wrongtype;
+  dbrResp_obj_t *obj = dbrResp_lookup_typed( srv, c, &argv[1], DBR_RESP_OBJ_LIST, &wrongtype );
+  if( wrongtype )
+    return;
+
+  dbrResp_str_t value;
+  if(( obj == NULL ) || ( dbrResp_list_pop( srv->_store, obj, &value ) != 0 ))
+  {
+    dbrResp_reply_nil( srv, c );
+    return;
+  }
+  dbrResp_reply_bulk( srv, c, value._data, value._len );
+  free( value._data );
+
+  // like redis, empty lists don't exist
+  if( obj->_count == 0 )
+    dbrResp_store_delete( srv->_store, argv[1]._data, argv[1]._len );
+}
+
+static
+void dbrResp_cmd_lindex( dbrResp_server_t *srv, dbrResp_client_t *c, int argc, dbrResp_str_t *argv )
+{
+  int64_t idx = 0;
+  if( dbrResp_parse_int( &argv[2], &idx ) != 0 )
+  {
+    dbrResp_reply_error( srv, c, "ERR value is not an integer or out of range" );
+    return;
+  }
+  int wrongtype;
+  dbrResp_obj_t *obj = dbrResp_lookup_typed( srv, c, &argv[1], DBR_RESP_OBJ_LIST, &wrongtype );
+  if( wrongtype )
+    return;
+  dbrResp_str_t *value = dbrResp_list_index( obj, idx );
+  if( value == NULL )
+    dbrResp_reply_nil( srv, c );
+  else
+    dbrResp_reply_bulk( srv, c, value->_data, value->_len );
+}
+
+static
+void dbrResp_cmd_llen( dbrResp_server_t *srv, dbrResp_client_t *c, int argc, dbrResp_str_t *argv )
+{
+  int wrongtype;
+  dbrResp_obj_t *obj = dbrResp_lookup_typed( srv, c, &argv[1], DBR_RESP_OBJ_LIST, &wrongtype );
+  if( ! wrongtype )
+    dbrResp_reply_int( srv, c, obj ? obj->_count : 0 );
+}
+
+/*
+ * hash commands
+ */
+static
+void dbrResp_cmd_hset( dbrResp_server_t *srv, dbrResp_client_t *c, int argc, dbrResp_str_t *argv )
+{
+  if(( argc & 1 ) != 0 )
+  {
+    dbrResp_reply_error( srv, c, "ERR wrong number of arguments for '%s' command", argv[0]._data );
+    return;
+  }
+  dbrResp_obj_t *obj = dbrResp_create_typed( srv, c, &argv[1], DBR_RESP_OBJ_HASH );
+  if( obj == NULL )
+    return;
+
+  int64_t added = 0;
+  int n;
+  for( n = 2; n < argc; n += 2 )
+  {
+    int rc = dbrResp_hash_set( srv->_store, obj, argv[n]._data, argv[n]._len, argv[n+1]._data, argv[n+1]._len );
+    if( rc < 0 )
+    {
+      dbrResp_reply_error( srv, c, "OOM command not allowed when used memory > 'maxmemory'." );
+      return;
+    }
+    added += rc;
+  }
+  if( strcasecmp( argv[0]._data, "HMSET" ) == 0 )
+    dbrResp_reply_status( srv, c, "OK" );
+  else
+    dbrResp_reply_int( srv, c, added );
+}
+
+static
+void dbrResp_cmd_hsetnx( dbrResp_server_t *srv, dbrResp_client_t *c, int argc, dbrResp_str_t *argv )
+{
+  int wrongtype;
+  dbrResp_obj_t *obj = dbrResp_lookup_typed( srv, c, &argv[1], DBR_RESP_OBJ_HASH, &wrongtype );
+  if( wrongtype )
+    return;
+  if(( obj != NULL ) && ( dbrResp_hash_get( obj, argv[2]._data, argv[2]._len ) != NULL ))
+  {
+    dbrResp_reply_int( srv, c, 0 );
+    return;
+  }
+  dbrResp_cmd_hset( srv, c, argc, argv );
+}
+
+static
+void dbrResp_cmd_hget( dbrResp_server_t *srv, dbrResp_client_t *c, int argc, dbrResp_str_t *argv )
+{
+  int wrongtype;
+  dbrResp_obj_t *obj = dbrResp_lookup_typed( srv, c, &argv[1], DBR_RESP_OBJ_HASH, &wrongtype );
+  if( wrongtype )
+    return;
+  dbrResp_str_t *value = dbrResp_hash_get( obj, argv[2]._data, argv[2]._len );
+  if( value == NULL )
+    dbrResp_reply_nil( srv, c );
+  else
+    dbrResp_reply_bulk( srv, c, value->_data, value->_len );
+}
+
+static
+void dbrResp_cmd_hmget( dbrResp_server_t *srv, dbrResp_client_t *c, int argc, dbrResp_str_t *argv )
+{
+  int wrongtype;
+  dbrResp_obj_t *obj = dbrResp_lookup_typed( srv, c, &argv[1], DBR_RESP_OBJ_HASH, &wrongtype );
+  if( wrongtype )
+    return;
+  dbrResp_reply_array( srv, c, argc - 2 );
+  int n;
+  for( n = 2; n < argc; ++n )
+  {
+    dbrResp_str_t *value = dbrResp_hash_get( obj, argv[n]._data, argv[n]._len );
+    if( value == NULL )
+      dbrResp_reply_nil( srv, c );
+    else
+      dbrResp_reply_bulk( srv, c, value->_data, value->_len );
+  }
+}
+
+static
+void dbrResp_cmd_hgetall( dbrResp_server_t *srv, dbrResp_client_t *c, int argc, dbrResp_str_t *argv )
+{
+  int wrongtype;
+  dbrResp_obj_t *obj = dbrResp_lookup_typed( srv, c, &argv[1], DBR_RESP_OBJ_HASH, &wrongtype );
+  if( wrongtype )
+    return;
+  if( obj == NULL )
+  {
+    dbrResp_reply_array( srv, c, 0 );
+    return;
+  }
+  dbrResp_reply_map( srv, c, obj->_count / 2 );
+  size_t n;
+  for( n = 0; n < obj->_count; ++n )
+    dbrResp_reply_bulk( srv, c, obj->_items[ n ]._data, obj->_items[ n ]._len );
+}
+
+static
+void dbrResp_cmd_hincrby( dbrResp_server_t *srv, dbrResp_client_t *c, int argc, dbrResp_str_t *argv )
+{
+  int64_t incr = 0;
+  if( dbrResp_parse_int( &argv[3], &incr ) != 0 )
+  {
+    dbrResp_reply_error( srv, c, "ERR value is not an integer or out of range" );
+    return;
+  }
+  dbrResp_obj_t *obj = dbrResp_create_typed( srv, c, &argv[1], DBR_RESP_OBJ_HASH );
+  if( obj == NULL )
+    return;
+
+  int64_t val = 0;
+  dbrResp_str_t *cur = dbrResp_hash_get( obj, argv[2]._data, argv[2]._len );
+  if(( cur != NULL ) && ( dbrResp_parse_int( cur, &val ) != 0 ))
+  {
+    dbrResp_reply_error( srv, c, "ERR hash value is not an integer" );
+    return;
+  }
+  val += incr;
+  char buf[ 32 ];
+  int len = snprintf( buf, sizeof( buf ), "%"PRId64, val );
+  if( dbrResp_hash_set( srv->_store, obj, argv[2]._data, argv[2]._len, buf, len ) < 0 )
+  {
+    dbrResp_reply_error( srv, c, "OOM command not allowed when used memory > 'maxmemory'." );
+    return;
+  }
+  dbrResp_reply_int( srv, c, val );
+}
+
+/*
+ * string commands (counters)
+ */
+static
+void dbrResp_cmd_get( dbrResp_server_t *srv, dbrResp_client_t *c, int argc, dbrResp_str_t *argv )
+{
+  int wrongtype;
+  dbrResp_obj_t *obj = dbrResp_lookup_typed( srv, c, &argv[1], DBR_RESP_OBJ_STRING, &wrongtype );
+  if( wrongtype )
+    return;
+  dbrResp_str_t *value = dbrResp_string_get( obj );
+  if( value == NULL )
+    dbrResp_reply_nil( srv, c );
+  else
+    dbrResp_reply_bulk( srv, c, value->_data, value->_len );
+}
+
+static
+void dbrResp_cmd_incr( dbrResp_server_t *srv, dbrResp_client_t *c, int argc, dbrResp_str_t *argv )
+{
+  int64_t incr = ( strcasecmp( argv[0]._data, "DECR" ) == 0 ) ? -1 : 1;
+  dbrResp_obj_t *obj = dbrResp_create_typed( srv, c, &argv[1], DBR_RESP_OBJ_STRING );
+  if( obj == NULL )
+    return;
+
+  int64_t val = 0;
+  dbrResp_str_t *cur = dbrResp_string_get( obj );
+  if(( cur != NULL ) && ( dbrResp_parse_int( cur, &val ) != 0 ))
+  {
+    dbrResp_reply_error( srv, c, "ERR value is not an integer or out of range" );
+    return;
+  }
+  val += incr;
+  char buf[ 32 ];
+  int len = snprintf( buf, sizeof( buf ), "%"PRId64, val );
+  if( dbrResp_string_set( srv->_store, obj, buf, len ) < 0 )
+  {
+    dbrResp_reply_error( srv, c, "OOM command not allowed when used memory > 'maxmemory'." );
+    return;
+  }
+  dbrResp_reply_int( srv, c, val );
+}
+
+/*
+ * transactions: commands are queued and executed together on EXEC
+ */
+static
+void dbrResp_cmd_multi( dbrResp_server_t *srv, dbrResp_client_t *c, int argc, dbrResp_str_t *argv )
+{
+  if( c->_multi )
+  {
+    dbrResp_reply_error( srv, c, "ERR MULTI calls can not be nested" );
+    return;
+  }
+  c->_multi = 1;
+  c->_multi_error = 0;
+  dbrResp_reply_status( srv, c, "OK" );
+}
+
+void dbrResp_client_discard_queue( dbrResp_client_t *c )
+{
+  int q, n;
+  for( q = 0; q < c->_queued; ++q )
+  {
+    for( n = 0; n < c->_queue_argc[ q ]; ++n )
+      free( c->_queue[ q ][ n ]._data );
+    free( c->_queue[ q ] );
+  }
+  free( c->_queue );
+  free( c->_queue_argc );
+  c->_queue = NULL;
+  c->_queue_argc = NULL;
+  c->_queued = 0;
+  c->_multi = 0;
+  c->_multi_error = 0;
+  c->_asking = 0;
+}
+
+static
+void dbrResp_cmd_exec( dbrResp_server_t *srv, dbrResp_client_t *c, int argc, dbrResp_str_t *argv )
+{
+  if( ! c->_multi )
+  {
+    dbrResp_reply_error( srv, c, "ERR EXEC without MULTI" );
+    return;
+  }
+  if( c->_multi_error )
+  {
+    dbrResp_client_discard_queue( c );
+    dbrResp_reply_error( srv, c, "EXECABORT Transaction discarded because of previous errors." );
+    return;
+  }
+
+  // detach the queue so the queued commands execute normally
+  int queued = c->_queued;
+  dbrResp_str_t **queue = c->_queue;
+  int *queue_argc = c->_queue_argc;
+  c->_queue = NULL;
+  c->_queue_argc = NULL;
+  c->_queued = 0;
+  c->_multi = 0;
+
+  dbrResp_reply_array( srv, c, queued );
+  c->_exec = 1;
+  int q;
+  for( q = 0; q < queued; ++q )
+    dbrResp_execute( srv, c, queue_argc[ q ], queue[ q ] );
+  c->_exec = 0;
+
+  c->_queue = queue;
+  c->_queue_argc = queue_argc;
+  c->_queued = queued;
+  dbrResp_client_discard_queue( c );
+}
+
+static
+void dbrResp_cmd_discard( dbrResp_server_t *srv, dbrResp_client_t *c, int argc, dbrResp_str_t *argv )
+{
+  if( ! c->_multi )
+  {
+    dbrResp_reply_error( srv, c, "ERR DISCARD without MULTI" );
+    return;
+  }
+  dbrResp_client_discard_queue( c );
+  dbrResp_reply_status( srv, c, "OK" );
+}
+
+static
+int dbrResp_queue_command( dbrResp_client_t *c, int argc, dbrResp_str_t *argv )
+{
+  dbrResp_str_t **queue = (dbrResp_str_t**)realloc( c->_queue, ( c->_queued + 1 ) * sizeof( dbrResp_str_t* ) );
+  if( queue == NULL )
+    return -ENOMEM;
+  c->_queue = queue;
+  int *queue_argc = (int*)realloc( c->_queue_argc, ( c->_queued + 1 ) * sizeof( int ) );
+  if( queue_argc == NULL )
+    return -ENOMEM;
+  c->_queue_argc = queue_argc;
+
+  dbrResp_str_t *args = (dbrResp_str_t*)calloc( argc, sizeof( dbrResp_str_t ) );
+  if( args == NULL )
+    return -ENOMEM;
+  int n;
+  for( n = 0; n < argc; ++n )
+  {
+    args[ n ]._data = (char*)malloc( argv[ n ]._len + 1 );
+    if( args[ n ]._data == NULL )
+    {
+      while( n-- > 0 )
+        free( args[ n ]._data );
+      free( args );
+      return -ENOMEM;
+    }
+    memcpy( args[ n ]._data, argv[ n ]._data, argv[ n ]._len + 1 );
+    args[ n ]._len = argv[ n ]._len;
+  }
+  c->_queue[ c->_queued ] = args;
+  c->_queue_argc[ c->_queued ] = argc;
+  ++c->_queued;
+  return 0;
+}
+
+static const dbrResp_cmd_t dbrResp_commands[] =
+{
+  { "PING",     -1, 0, 0, 0, 0, dbrResp_cmd_ping },
+  { "ECHO",      2, 0, 0, 0, 0, dbrResp_cmd_echo },
+  { "AUTH",     -2, 0, 0, 0, 0, dbrResp_cmd_auth },
+  { "HELLO",    -1, 0, 0, 0, 0, dbrResp_cmd_hello },
+  { "SELECT",    2, 0, 0, 0, 0, dbrResp_cmd_ok },
+  { "CLIENT",   -2, 0, 0, 0, 0, dbrResp_cmd_ok },
+  { "ASKING",    1, 0, 0, 0, 0, dbrResp_cmd_asking },
+  { "READONLY",  1, 0, 0, 0, 0, dbrResp_cmd_readonly },
+  { "READWRITE", 1, 0, 0, 0, 0, dbrResp_cmd_readonly },
+  { "QUIT",      1, 0, 0, 0, 0, dbrResp_cmd_quit },
+  { "ROLE",      1, 0, 0, 0, 0, dbrResp_cmd_role },
+  { "CLUSTER",  -2, 0, 0, 0, 0, dbrResp_cmd_cluster },
+  { "DBSIZE",    1, 0, 0, 0, 0, dbrResp_cmd_dbsize },
+  { "FLUSHALL", -1, 0, 0, 0, 0, dbrResp_cmd_flushall },
+  { "FLUSHDB",  -1, 0, 0, 0, 0, dbrResp_cmd_flushall },
+  { "SHUTDOWN", -1, 0, 0, 0, 0, dbrResp_cmd_shutdown },
+  { "SIM",      -2, 0, 0, 0, 0, dbrResp_cmd_sim },
+  { "MULTI",     1, 0, 0, 0, 0, dbrResp_cmd_multi },
+  { "EXEC",      1, 0, 0, 0, 0, dbrResp_cmd_exec },
+  { "DISCARD",   1, 0, 0, 0, 0, dbrResp_cmd_discard },
+  { "SCAN",     -2, 0, 0, 0, 0, dbrResp_cmd_scan },
+  { "EXISTS",   -2, 1, -1, 1, 1, dbrResp_cmd_exists },
+  { "DEL",      -2, 1, -1, 1, 0, dbrResp_cmd_del },
+  { "TYPE",      2, 1, 1, 1, 1, dbrResp_cmd_type },
+  { "DUMP",      2, 1, 1, 1, 1, dbrResp_cmd_dump },
+  { "RESTORE",  -4, 1, 1, 1, 0, dbrResp_cmd_restore },
+  { "RPUSH",    -3, 1, 1, 1, 0, dbrResp_cmd_rpush },
+  { "LPOP",      2, 1, 1, 1, 0, dbrResp_cmd_lpop },
+  { "LINDEX",    3, 1, 1, 1, 1, dbrResp_cmd_lindex },
+  { "LLEN",      2, 1, 1, 1, 1, dbrResp_cmd_llen },
+  { "HSET",     -4, 1, 1, 1, 0, dbrResp_cmd_hset },
+  { "HMSET",    -4, 1, 1, 1, 0, dbrResp_cmd_hset },
+  { "HSETNX",    4, 1, 1, 1, 0, dbrResp_cmd_hsetnx },
+  { "HGET",      3, 1, 1, 1, 1, dbrResp_cmd_hget },
+  { "HMGET",    -3, 1, 1, 1, 1, dbrResp_cmd_hmget },
+  { "HGETALL",   2, 1, 1, 1, 1, dbrResp_cmd_hgetall },
+  { "HINCRBY",   4, 1, 1, 1, 0, dbrResp_cmd_hincrby },
+  { "GET",       2, 1, 1, 1, 1, dbrResp_cmd_get },
+  { "INCR",      2, 1, 1, 1, 0, dbrResp_cmd_incr },
+  { "DECR",      2, 1, 1, 1, 0, dbrResp_cmd_incr },
+  { NULL, 0, 0, 0, 0, 0, NULL }
+};
+
+static
+const dbrResp_cmd_t* dbrResp_find_command( const dbrResp_str_t *name )
+{
+  const dbrResp_cmd_t *cmd;
+  for( cmd = dbrResp_commands; cmd->_name != NULL; ++cmd )
+    if(( strlen( cmd->_name ) == name->_len ) && ( strncasecmp( cmd->_name, name->_data, name->_len ) == 0 ))
+      return cmd;
+  return NULL;
+}
+
+/*
+ * cluster mode: check slot ownership of the key arguments and apply injected redirects
+ * returns 0 if the command can be executed, otherwise the error response has been sent
+ */
+static
+int dbrResp_route( dbrResp_server_t *srv, dbrResp_client_t *c, const dbrResp_cmd_t *cmd, int argc, dbrResp_str_t *argv )
+{
+  ++srv->_stats._keyed;
+  if( srv->_cfg._nodes == 0 )
+    return 0;
+
+  int last = ( cmd->_last_key < 0 ) ? argc - 1 : cmd->_last_key;
+  int slot = -1;
+  int n;
+  for( n = cmd->_first_key; n <= last; n += cmd->_key_step )
+  {
+    int s = dbrResp_key_slot( argv[n]._data, argv[n]._len );
+    if(( slot >= 0 ) && ( s != slot ))
+    {
+      dbrResp_reply_error( srv, c, "CROSSSLOT Keys in request don't hash to the same slot" );
+      return -1;
+    }
+    slot = s;
+  }
+
+  // ASKING covers the next command or all commands of a transaction
+  int asking = c->_asking;
+  if( ! c->_multi )
+    c->_asking = 0;
+
+  int owner = srv->_owner[ slot ];
+  int target = srv->_migrating[ slot ];
+  const dbrResp_config_t *cfg = &srv->_cfg;
+  if(( owner != c->_node ) && !( asking && ( target == c->_node )))
+  {
+    ++srv->_stats._moved;
+    dbrResp_reply_error( srv, c, "MOVED %d %s:%d", slot, cfg->_host, cfg->_port + owner );
+    return -1;
+  }
+
+  // a migrating slot: the keys are assumed to be at the target already
+  if(( owner == c->_node ) && ( target != 0xFF ) && ! c->_replica )
+  {
+    ++srv->_stats._ask;
+    dbrResp_reply_error( srv, c, "ASK %d %s:%d", slot, cfg->_host, cfg->_port + target );
+    return -1;
+  }
+
+  // replicas redirect everything to their master except reads of READONLY clients
+  if( c->_replica && ( ! c->_readonly || ! cmd->_readonly ))
+  {
+    ++srv->_stats._moved;
+    dbrResp_reply_error( srv, c, "MOVED %d %s:%d", slot, cfg->_host, cfg->_port + owner );
+    return -1;
+  }
+
+  uint64_t k = srv->_stats._keyed;
+  if(( cfg->_clusterdown_every > 0 ) && ( k % cfg->_clusterdown_every == 0 ))
+  {
+    ++srv->_stats._clusterdown;
+    dbrResp_reply_error( srv, c, "CLUSTERDOWN The cluster is down" );
+    return -1;
+  }
+  if(( cfg->_moved_every > 0 ) && ( k % cfg->_moved_every == 0 ))
+  {
+    ++srv->_stats._moved;
+    dbrResp_reply_error( srv, c, "MOVED %d %s:%d", slot, cfg->_host, cfg->_port + owner );
+    return -1;
+  }
+  if(( cfg->_ask_every > 0 ) && ( k % cfg->_ask_every == 0 ) && ! asking )
+  {
+    ++srv->_stats._ask;
+    dbrResp_reply_error( srv, c, "ASK %d %s:%d", slot, cfg->_host, cfg->_port + owner );
+    return -1;
+  }
+  if( c->_replica )
+    ++srv->_stats._replica_reads;
+  return 0;
+}
+
+void dbrResp_execute( dbrResp_server_t *srv, dbrResp_client_t *c, int argc, dbrResp_str_t *argv )
+{
+  if( argc <= 0 )
+    return;
+
+  ++srv->_stats._commands;
+  const dbrResp_cmd_t *cmd = dbrResp_find_command( &argv[0] );
+  if( cmd == NULL )
+  {
+    if( c->_multi )
+      c->_multi_error = 1;
+    dbrResp_reply_error( srv, c, "ERR unknown command '%.*s'", (int)argv[0]._len, argv[0]._data );
+    return;
+  }
+
+  if(( cmd->_arity > 0 && argc != cmd->_arity ) || ( cmd->_arity < 0 && argc < -cmd->_arity ))
+  {
+    if( c->_multi )
+      c->_multi_error = 1;
+    dbrResp_reply_error( srv, c, "ERR wrong number of arguments for '%s' command", cmd->_name );
+    return;
+  }
+
+  if( ! c->_authed && ( srv->_cfg._password != NULL ) && ( cmd->_fn != dbrResp_cmd_auth ) && ( cmd->_fn != dbrResp_cmd_hello ) )
+  {
+    dbrResp_reply_error( srv, c, "NOAUTH Authentication required." );
+    return;
+  }
+
+  if(( cmd->_first_key > 0 ) && ! c->_exec && ( dbrResp_route( srv, c, cmd, argc, argv ) != 0 ))
+  {
+    if( c->_multi )
+      c->_multi_error = 1;
+    return;
+  }
+
+  if( c->_multi && ( cmd->_fn != dbrResp_cmd_exec ) && ( cmd->_fn != dbrResp_cmd_discard ) && ( cmd->_fn != dbrResp_cmd_multi ))
+  {
+    if( dbrResp_queue_command( c, argc, argv ) != 0 )
+    {
+      c->_multi_error = 1;
+      dbrResp_reply_error( srv, c, "OOM command not allowed when used memory > 'maxmemory'." );
+      return;
+    }
+    dbrResp_reply_status( srv, c, "QUEUED" );
+    return;
+  }
+
+  // invalidation of the key as an out-of-band push frame ahead of the reply
+  if(( cmd->_first_key > 0 ) && ( c->_protocol == 3 ) && ! c->_exec &&
+      ( srv->_cfg._push_every > 0 ) && ( srv->_stats._keyed % srv->_cfg._push_every == 0 ))
+  {
+    ++srv->_stats._pushes;
+    dbrResp_reply_push( srv, c, 2 );
+    dbrResp_reply_bulk( srv, c, "invalidate", 10 );
+    dbrResp_reply_array( srv, c, 1 );
+    dbrResp_reply_bulk( srv, c, argv[ cmd->_first_key ]._data, argv[ cmd->_first_key ]._len );
+  }
+
+  cmd->_fn( srv, c, argc, argv );
+}
@@ -0,0 +1,1089 @@
+/*
+ * Copyright © 2020 IBM Corporation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#include "logutil.h"
+#include "resp_srv.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <inttypes.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <unistd.h>
+
+static dbrResp_server_t *g_srv = NULL;
+
+void dbrResp_termination_handler( int sig )
+{
+  if( g_srv != NULL )
+    g_srv->_keep_running = 0;
+  else
+    raise( sig );
+}
+
+static inline
+void dbrResp_now( struct timespec *ts )
+{
+  clock_gettime( CLOCK_MONOTONIC, ts );
+}
+
+static inline
+int64_t dbrResp_diff_us( const struct timespec *a, const struct timespec *b )
+{
+  return ( a->tv_sec - b->tv_sec ) * 1000000ll + ( a->tv_nsec - b->tv_nsec ) / 1000;
+}
+
+static inline
+void dbrResp_add_us( struct timespec *ts, const int64_t us )
+{
+  ts->tv_sec += us / 1000000;
+  ts->tv_nsec += ( us % 1000000 ) * 1000;
+  if( ts->tv_nsec >= 1000000000 )
+  {
+    ts->tv_nsec -= 1000000000;
+    ++ts->tv_sec;
+  }
+}
+
+/*
+ * output buffer and response helpers
+ */
+static
+int dbrResp_out_reserve( dbrResp_client_t *c, const size_t len )
+{
+  if( c->_out_len + len <= c->_out_cap )
+    return 0;
+  size_t cap = c->_out_cap ? c->_out_cap : 4096;
+  while( cap < c->_out_len + len )
+    cap *= 2;
+  char *out = (char*)realloc( c->_out, cap );
+  if( out == NULL )
+    return -ENOMEM;
+  c->_out = out;
+  c->_out_cap = cap;
+  return 0;
+}
+
+void dbrResp_reply_raw( dbrResp_server_t *srv, dbrResp_client_t *c, const char *data, const size_t len )
+{
+  if( dbrResp_out_reserve( c, len ) != 0 )
+  {
+    LOG( DBG_ERR, stderr, "resp_srv: failed to allocate %zu bytes of output for client %d; closing\n", len, c->_fd );
+    c->_closing = 1;
+    return;
+  }
+  memcpy( c->_out + c->_out_len, data, len );
+  c->_out_len += len;
+}
+
+void dbrResp_reply_status( dbrResp_server_t *srv, dbrResp_client_t *c, const char *status )
+{
+  char buf[ 256 ];
+  int len = snprintf( buf, sizeof( buf ), "+%s\r\n", status );
+  dbrResp_reply_raw( srv, c, buf, len );
+}
+
+void dbrResp_reply_error( dbrResp_server_t *srv, dbrResp_client_t *c, const char *fmt, ... )
+{
+  char buf[ 512 ];
+  buf[ 0 ] = '-';
+  va_list args;
+  va_start( args, fmt );
+  int len = vsnprintf( buf + 1, sizeof( buf ) - 3, fmt, args );
+  va_end( args );
+  if( len > (int)sizeof( buf ) - 4 )
+    len = sizeof( buf ) - 4;
+  // no line breaks inside of an error string
+  int n;
+  for( n = 1; n <= len; ++n )
+    if(( buf[ n ] == '\r' ) || ( buf[ n ] == '\n' ))
+      buf[ n ] = ' ';
+  memcpy( buf + len + 1, "\r\n", 2 );
+  dbrResp_reply_raw( srv, c, buf, len + 3 );
+}
+
+void dbrResp_reply_int( dbrResp_server_t *srv, dbrResp_client_t *c, const int64_t val )
+{
+  char buf[ 32 ];
+  int len = snprintf( buf, sizeof( buf ), ":%"PRId64"\r\n", val );
+  dbrResp_reply_raw( srv, c, buf, len );
+}
+
+void dbrResp_reply_bulk( dbrResp_server_t *srv, dbrResp_client_t *c, const char *data, const size_t len )
+{
+  char buf[ 32 ];
+  int hlen = snprintf( buf, sizeof( buf ), "$%zu\r\n", len );
+  if( dbrResp_out_reserve( c, hlen + len + 2 ) != 0 )
+  {
+    LOG( DBG_ERR, stderr, "resp_srv: failed to allocate %zu bytes of output for client %d; closing\n", len, c->_fd );
+    c->_closing = 1;
+    return;
+  }
+  dbrResp_reply_raw( srv, c, buf, hlen );
+  dbrResp_reply_raw( srv, c, data, len );
+  dbrResp_reply_raw( srv, c, "\r\n", 2 );
+}
+
+void dbrResp_reply_nil( dbrResp_server_t *srv, dbrResp_client_t *c )
+{
+  if( c->_protocol == 3 )
+    dbrResp_reply_raw( srv, c, "_\r\n", 3 );
+  else
+    dbrResp_reply_raw( srv, c, "$-1\r\n", 5 );
+}
+
+void dbrResp_reply_array( dbrResp_server_t *srv, dbrResp_client_t *c, const int64_t len )
+{
+  char buf[ 32 ];
+  int hlen = snprintf( buf, sizeof( buf ), "*%"PRId64"\r\n", len );
+  dbrResp_reply_raw( srv, c, buf, hlen );
+}
+
+/*
+ * RESP2 clients get maps as flat arrays of keys and values
+ */
+void dbrResp_reply_map( dbrResp_server_t *srv, dbrResp_client_t *c, const int64_t pairs )
+{
+  char buf[ 32 ];
+  int hlen;
+  if( c->_protocol == 3 )
+    hlen = snprintf( buf, sizeof( buf ), "%%%"PRId64"\r\n", pairs );
+  else
+    hlen = snprintf( buf, sizeof( buf ), "*%"PRId64"\r\n", 2 * pairs );
+  dbrResp_reply_raw( srv, c, buf, hlen );
+}
+
+void dbrResp_reply_push( dbrResp_server_t *srv, dbrResp_client_t *c, const int64_t len )
+{
+  char buf[ 32 ];
+  int hlen = snprintf( buf, sizeof( buf ), ">%"PRId64"\r\n", len );
+  dbrResp_reply_raw( srv, c, buf, hlen );
+}
+
+/*
+ * the output of a command is complete: schedule its release after the configured latency
+ * release times stay monotonic so that responses are never reordered
+ */
+static
+void dbrResp_response_complete( dbrResp_server_t *srv, dbrResp_client_t *c, const struct timespec *now )
+{
+  size_t end = c->_mark_count ? c->_marks[ c->_mark_head + c->_mark_count - 1 ]._end : c->_out_ready;
+  if( c->_out_len == end )
+    return;
+
+  if(( srv->_cfg._latency_us == 0 ) && ( c->_mark_count == 0 ))
+  {
+    c->_out_ready = c->_out_len;
+    return;
+  }
+
+  if( c->_mark_head + c->_mark_count == c->_mark_cap )
+  {
+    if( c->_mark_head > 0 )
+    {
+      memmove( c->_marks, &c->_marks[ c->_mark_head ], c->_mark_count * sizeof( dbrResp_mark_t ) );
+      c->_mark_head = 0;
+    }
+    else
+    {
+      size_t cap = c->_mark_cap ? c->_mark_cap * 2 : 64;
+      dbrResp_mark_t *marks = (dbrResp_mark_t*)realloc( c->_marks, cap * sizeof( dbrResp_mark_t ) );
+      if( marks == NULL )
+      {
+        // can't delay: release immediately
+        c->_out_ready = c->_out_len;
+        return;
+      }
+      c->_marks = marks;
+      c->_mark_cap = cap;
+    }
+  }
+
+  dbrResp_mark_t *mark = &c->_marks[ c->_mark_head + c->_mark_count ];
+  mark->_end = c->_out_len;
+  mark->_release = *now;
+  dbrResp_add_us( &mark->_release, srv->_cfg._latency_us );
+  if(( c->_mark_count > 0 ) && ( dbrResp_diff_us( &mark->_release, &mark[ -1 ]._release ) < 0 ))
+    mark->_release = mark[ -1 ]._release;
+  ++c->_mark_count;
+}
+
+static
+void dbrResp_release( dbrResp_client_t *c, const struct timespec *now )
+{
+  while(( c->_mark_count > 0 ) && ( dbrResp_diff_us( &c->_marks[ c->_mark_head ]._release, now ) <= 0 ))
+  {
+    c->_out_ready = c->_marks[ c->_mark_head ]._end;
+    ++c->_mark_head;
+    --c->_mark_count;
+  }
+  if( c->_mark_count == 0 )
+    c->_mark_head = 0;
+}
+
+/*
+ * token bucket bandwidth limit; returns the number of bytes that may be sent now
+ */
+static
+size_t dbrResp_bandwidth_allow( dbrResp_server_t *srv, dbrResp_client_t *c, const struct timespec *now )
+{
+  int64_t bw = srv->_cfg._bandwidth;
+  if( bw <= 0 )
+    return SIZE_MAX;
+
+  double burst = bw / 100 > 1500 ? bw / 100 : 1500;
+  c->_tokens += dbrResp_diff_us( now, &c->_refill ) * (double)bw / 1000000.0;
+  if( c->_tokens > burst )
+    c->_tokens = burst;
+  c->_refill = *now;
+  return c->_tokens >= 1.0 ? (size_t)c->_tokens : 0;
+}
+
+static
+void dbrResp_out_compact( dbrResp_client_t *c )
+{
+  if( c->_out_sent == c->_out_len )
+  {
+    c->_out_len = 0;
+    c->_out_sent = 0;
+    c->_out_ready = 0;
+    return;
+  }
+  if(( c->_out_sent < 1024 * 1024 ) || ( c->_out_sent < c->_out_len / 2 ))
+    return;
+
+  size_t shift = c->_out_sent;
+  memmove( c->_out, c->_out + shift, c->_out_len - shift );
+  c->_out_len -= shift;
+  c->_out_ready -= shift;
+  c->_out_sent = 0;
+  size_t m;
+  for( m = c->_mark_head; m < c->_mark_head + c->_mark_count; ++m )
+    c->_marks[ m ]._end -= shift;
+}
+
+static
+int dbrResp_client_send( dbrResp_server_t *srv, dbrResp_client_t *c, const struct timespec *now )
+{
+  dbrResp_release( c, now );
+  size_t pending = c->_out_ready - c->_out_sent;
+  if( pending == 0 )
+    return 0;
+
+  size_t allow = dbrResp_bandwidth_allow( srv, c, now );
+  if( allow < pending )
+    pending = allow;
+  if( pending == 0 )
+    return 0;
+
+  ssize_t rc = send( c->_fd, c->_out + c->_out_sent, pending, MSG_NOSIGNAL | MSG_DONTWAIT );
+  if( rc < 0 )
+    return (( errno == EAGAIN ) || ( errno == EWOULDBLOCK ) || ( errno == EINTR )) ? 0 : -errno;
+
+  c->_out_sent += rc;
+  srv->_stats._bytes_out += rc;
+  if( srv->_cfg._bandwidth > 0 )
+    c->_tokens -= rc;
+  dbrResp_out_compact( c );
+  return 0;
+}
+
+/*
+ * time in usec until the client has something to send; -1 if nothing is waiting
+ */
+static
+int64_t dbrResp_client_next_event( dbrResp_server_t *srv, dbrResp_client_t *c, const struct timespec *now )
+{
+  int64_t wait = -1;
+  if(( c->_out_sent < c->_out_ready ) && ( srv->_cfg._bandwidth > 0 ) && ( c->_tokens < 1.0 ))
+    wait = (int64_t)(( 1.0 - c->_tokens ) * 1000000.0 / srv->_cfg._bandwidth ) + 1;
+  if( c->_mark_count > 0 )
+  {
+    int64_t release = dbrResp_diff_us( &c->_marks[ c->_mark_head ]._release, now );
+    if( release < 0 )
+      release = 0;
+    if(( wait < 0 ) || ( release < wait ))
+      wait = release;
+  }
+  return wait;
+}
+
+/*
+ * protocol parsing
+ */
+static
+int dbrResp_argv_reserve( dbrResp_server_t *srv, const size_t argc )
+{
+  if( argc <= srv->_argv_cap )
+    return 0;
+  size_t cap = srv->_argv_cap ? srv->_argv_cap : 64;
+  while( cap < argc )
+    cap *= 2;
+  dbrResp_str_t *argv = (dbrResp_str_t*)realloc( srv->_argv, cap * sizeof( dbrResp_str_t ) );
+  if( argv == NULL )
+    return -ENOMEM;
+  srv->_argv = argv;
+  srv->_argv_cap = cap;
+  return 0;
+}
+
+/*
+ * parse the integer of a "<type><int>\r\n" header line starting at p
+ * returns the position after the line, NULL if incomplete, or sets *err on protocol errors
+ */
+static
+char* dbrResp_parse_header( char *p, char *end, int64_t *val, int *err )
+{
+  char *cr = memchr( p, '\r', end - p );
+  if(( cr == NULL ) || ( cr + 1 >= end ))
+  {
+    if( end - p > 32 )
+      *err = 1;
+    return NULL;
+  }
+  if(( cr[ 1 ] != '\n' ) || ( cr == p + 1 ))
+  {
+    *err = 1;
+    return NULL;
+  }
+
+  int neg = ( p[ 1 ] == '-' );
+  int64_t v = 0;
+  char *d;
+  for( d = p + 1 + neg; d < cr; ++d )
+  {
+    if(( *d < '0' ) || ( *d > '9' ) || ( v > INT64_MAX / 10 ))
+    {
+      *err = 1;
+      return NULL;
+    }
+    v = v * 10 + ( *d - '0' );
+  }
+  *val = neg ? -v : v;
+  return cr + 2;
+}
+
+/*
+ * parse one command from the input buffer at *pos
+ * arguments point into the input buffer and are 0-terminated in place
+ * returns 1 if a command is complete, 0 if more data is needed, -EPROTO on protocol errors
+ */
+static
+int dbrResp_parse_command( dbrResp_server_t *srv, dbrResp_client_t *c, size_t *pos, int *argc )
+{
+  char *p = c->_in + *pos;
+  char *end = c->_in + c->_in_len;
+  int err = 0;
+  *argc = 0;
+
+  if( p >= end )
+    return 0;
+
+  if( *p != '*' )
+  {
+    // inline command
+    char *nl = memchr( p, '\n', end - p );
+    if( nl == NULL )
+      return ( end - p > 64 * 1024 ) ? -EPROTO : 0;
+    char *line_end = (( nl > p ) && ( nl[ -1 ] == '\r' )) ? nl - 1 : nl;
+    char *q = p;
+    while( q < line_end )
+    {
+      while(( q < line_end ) && (( *q == ' ' ) || ( *q == '\t' )))
+        ++q;
+      if( q == line_end )
+        break;
+      char *tok = q;
+      while(( q < line_end ) && ( *q != ' ' ) && ( *q != '\t' ))
+        ++q;
+      if( dbrResp_argv_reserve( srv, *argc + 1 ) != 0 )
+        return -ENOMEM;
+      srv->_argv[ *argc ]._data = tok;
+      srv->_argv[ *argc ]._len = q - tok;
+      ++(*argc);
+      if( q < line_end )
+        *q++ = '\0';
+    }
+    *line_end = '\0';
+    *pos = nl + 1 - c->_in;
+    return 1;
+  }
+
+  int64_t n = 0;
+  char *q = dbrResp_parse_header( p, end, &n, &err );
+  if( q == NULL )
+    return err ? -EPROTO : 0;
+  if( n > DBR_RESP_MAX_ARGS )
+    return -EPROTO;
+  if(( n > 0 ) && ( dbrResp_argv_reserve( srv, n ) != 0 ))
+    return -ENOMEM;
+
+  int64_t a;
+  for( a = 0; a < n; ++a )
+  {
+    if( q >= end )
+      return 0;
+    if( *q != '$' )
+      return -EPROTO;
+    int64_t len = 0;
+    char *data = dbrResp_parse_header( q, end, &len, &err );
+    if( data == NULL )
+      return err ? -EPROTO : 0;
+    if( len < 0 )
+      return -EPROTO;
+    if( end - data < len + 2 )
+      return 0;
+    if(( data[ len ] != '\r' ) || ( data[ len + 1 ] != '\n' ))
+      return -EPROTO;
+    srv->_argv[ a ]._data = data;
+    srv->_argv[ a ]._len = len;
+    q = data + len + 2;
+  }
+
+  // complete: terminate the arguments in place of their \r
+  for( a = 0; a < n; ++a )
+    srv->_argv[ a ]._data[ srv->_argv[ a ]._len ] = '\0';
+  *argc = n > 0 ? n : 0;
+  *pos = q - c->_in;
+  return 1;
+}
+
+static
+void dbrResp_client_process( dbrResp_server_t *srv, dbrResp_client_t *c, const struct timespec *now )
+{
+  size_t pos = 0;
+  while( ! c->_closing && ( c->_out_len - c->_out_sent < DBR_RESP_OUTPUT_LIMIT ))
+  {
+    int argc = 0;
+    int rc = dbrResp_parse_command( srv, c, &pos, &argc );
+    if( rc == 0 )
+      break;
+    if( rc < 0 )
+    {
+      LOG( DBG_WARN, stderr, "resp_srv: protocol error from client %d; closing\n", c->_fd );
+      dbrResp_reply_error( srv, c, "ERR Protocol error" );
+      dbrResp_response_complete( srv, c, now );
+      c->_closing = 1;
+      break;
+    }
+    dbrResp_execute( srv, c, argc, srv->_argv );
+    dbrResp_response_complete( srv, c, now );
+  }
+
+  if( pos > 0 )
+  {
+    memmove( c->_in, c->_in + pos, c->_in_len - pos );
+    c->_in_len -= pos;
+  }
+}
+
+static
+int dbrResp_client_recv( dbrResp_server_t *srv, dbrResp_client_t *c )
+{
+  if( c->_in_cap - c->_in_len < DBR_RESP_RECV_CHUNK )
+  {
+    size_t cap = c->_in_cap ? c->_in_cap * 2 : DBR_RESP_RECV_CHUNK;
+    while( cap - c->_in_len < DBR_RESP_RECV_CHUNK )
+      cap *= 2;
+    char *in = (char*)realloc( c->_in, cap );
+    if( in == NULL )
+      return -ENOMEM;
+    c->_in = in;
+    c->_in_cap = cap;
+  }
+
+  ssize_t rc = recv( c->_fd, c->_in + c->_in_len, c->_in_cap - c->_in_len, MSG_DONTWAIT );
+  if( rc == 0 )
+    return -ENOTCONN;
+  if( rc < 0 )
+    return (( errno == EAGAIN ) || ( errno == EWOULDBLOCK ) || ( errno == EINTR )) ? 0 : -errno;
+  c->_in_len += rc;
+  srv->_stats._bytes_in += rc;
+  return rc;
+}
+
+/*
+ * connection management
+ */
+static
+void dbrResp_client_close( dbrResp_server_t *srv, const int idx )
+{
+  dbrResp_client_t *c = srv->_clients[ idx ];
+  LOG( DBG_VERBOSE, stderr, "resp_srv: closing client %d\n", c->_fd );
+  dbrResp_client_discard_queue( c );
+  close( c->_fd );
+  free( c->_in );
+  free( c->_out );
+  free( c->_marks );
+  free( c );
+  srv->_clients[ idx ] = NULL;
+}
+
+static
+void dbrResp_accept( dbrResp_server_t *srv, const int listener, const struct timespec *now )
+{
+  int fd = accept( srv->_listen[ listener ], NULL, NULL );
+  if( fd < 0 )
+    return;
+
+  int idx;
+  for( idx = 0; idx < DBR_RESP_MAX_CLIENTS; ++idx )
+    if( srv->_clients[ idx ] == NULL )
+      break;
+  dbrResp_client_t *c = NULL;
+  if( idx < DBR_RESP_MAX_CLIENTS )
+    c = (dbrResp_client_t*)calloc( 1, sizeof( dbrResp_client_t ) );
+  if( c == NULL )
+  {
+    LOG( DBG_ERR, stderr, "resp_srv: rejecting connection; client limit reached\n" );
+    close( fd );
+    return;
+  }
+
+  int one = 1;
+  setsockopt( fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof( one ) );
+  fcntl( fd, F_SETFL, fcntl( fd, F_GETFL ) | O_NONBLOCK );
+
+  // listeners: one per node, followed by the replicas of node 0, node 1, ...
+  int node = listener;
+  if(( srv->_cfg._nodes > 0 ) && ( listener >= srv->_cfg._nodes ))
+  {
+    node = ( listener - srv->_cfg._nodes ) / srv->_cfg._replicas;
+    c->_replica = 1;
+  }
+
+  c->_fd = fd;
+  c->_node = node;
+  c->_authed = ( srv->_cfg._password == NULL );
+  c->_protocol = 2;
+  c->_tokens = srv->_cfg._bandwidth / 100 > 1500 ? srv->_cfg._bandwidth / 100 : 1500;
+  c->_refill = *now;
+  srv->_clients[ idx ] = c;
+  ++srv->_stats._connections;
+  LOG( DBG_VERBOSE, stderr, "resp_srv: node %d%s accepted client %d\n", node, c->_replica ? " (replica)" : "", fd );
+}
+
+static
+int dbrResp_listen_port( dbrResp_server_t *srv, const int n )
+{
+  char port[ 16 ];
+  snprintf( port, sizeof( port ), "%d", srv->_cfg._port + n );
+
+  struct addrinfo hints, *addrs = NULL;
+  memset( &hints, 0, sizeof( hints ) );
+  hints.ai_family = AF_INET;
+  hints.ai_socktype = SOCK_STREAM;
+  hints.ai_flags = AI_PASSIVE;
+  int rc = getaddrinfo( srv->_cfg._host, port, &hints, &addrs );
+  if( rc != 0 )
+  {
+    LOG( DBG_ERR, stderr, "resp_srv: cannot resolve %s:%s: %s\n", srv->_cfg._host, port, gai_strerror( rc ) );
+    return -EINVAL;
+  }
+
+  int fd = socket( addrs->ai_family, addrs->ai_socktype, addrs->ai_protocol );
+  int one = 1;
+  if(( fd < 0 ) ||
+      ( setsockopt( fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof( one ) ) != 0 ) ||
+      ( bind( fd, addrs->ai_addr, addrs->ai_addrlen ) != 0 ) ||
+      ( listen( fd, 128 ) != 0 ))
+  {
+    rc = -errno;
+    LOG( DBG_ERR, stderr, "resp_srv: cannot listen on %s:%s: %s\n", srv->_cfg._host, port, strerror( errno ) );
+    if( fd >= 0 )
+      close( fd );
+    freeaddrinfo( addrs );
+    return rc;
+  }
+  freeaddrinfo( addrs );
+  fcntl( fd, F_SETFL, fcntl( fd, F_GETFL ) | O_NONBLOCK );
+  srv->_listen[ n ] = fd;
+  return 0;
+}
+
+static
+int dbrResp_listen( dbrResp_server_t *srv )
+{
+  int count = srv->_cfg._nodes > 0 ? srv->_cfg._nodes * ( 1 + srv->_cfg._replicas ) : 1;
+  int n;
+  for( n = 0; n < count; ++n )
+  {
+    int rc = dbrResp_listen_port( srv, n );
+    if( rc != 0 )
+      return rc;
+    srv->_listeners = n + 1;
+  }
+  return 0;
+}
+
+/*
+ * take nodes down (SIM DOWN) and bring them back once their down time is over
+ * returns the number of nodes that are currently down
+ */
+static
+int dbrResp_nodes_update( dbrResp_server_t *srv, const struct timespec *now )
+{
+  int down_count = 0;
+  int node;
+  for( node = 0; node < srv->_cfg._nodes; ++node )
+  {
+    if( srv->_drop_replicas[ node ] )
+    {
+      // replica connections break without affecting the master
+      LOG( DBG_INFO, stderr, "resp_srv: dropping replica connections of node %d\n", node );
+      srv->_drop_replicas[ node ] = 0;
+      int n;
+      for( n = 0; n < DBR_RESP_MAX_CLIENTS; ++n )
+        if(( srv->_clients[ n ] != NULL ) && ( srv->_clients[ n ]->_node == node ) && srv->_clients[ n ]->_replica )
+          dbrResp_client_close( srv, n );
+    }
+
+    int down = ( dbrResp_diff_us( &srv->_down_until[ node ], now ) > 0 );
+    if( down && ( srv->_listen[ node ] >= 0 ))
+    {
+      // a crashed master: connections drop and new ones get refused; replicas stay up
+      LOG( DBG_INFO, stderr, "resp_srv: node %d down\n", node );
+      close( srv->_listen[ node ] );
+      srv->_listen[ node ] = -1;
+      int n;
+      for( n = 0; n < DBR_RESP_MAX_CLIENTS; ++n )
+        if(( srv->_clients[ n ] != NULL ) && ( srv->_clients[ n ]->_node == node ) && ( ! srv->_clients[ n ]->_replica ))
+          dbrResp_client_close( srv, n );
+    }
+    else if( ! down && ( srv->_listen[ node ] < 0 ))
+    {
+      if( dbrResp_listen_port( srv, node ) == 0 )
+        LOG( DBG_INFO, stderr, "resp_srv: node %d up\n", node );
+    }
+    down_count += ( srv->_listen[ node ] < 0 );
+  }
+  return down_count;
+}
+
+static
+void dbrResp_loop( dbrResp_server_t *srv )
+{
+  struct pollfd fds[ DBR_RESP_MAX_LISTENERS + DBR_RESP_MAX_CLIENTS ];
+  int fd_client[ DBR_RESP_MAX_LISTENERS + DBR_RESP_MAX_CLIENTS ];
+
+  while( srv->_keep_running )
+  {
+    struct timespec now;
+    dbrResp_now( &now );
+    int nodes_down = dbrResp_nodes_update( srv, &now );
+
+    int nfds = 0;
+    int n;
+    for( n = 0; n < srv->_listeners; ++n )
+    {
+      fds[ nfds ].fd = srv->_listen[ n ];
+      fds[ nfds ].events = POLLIN;
+      fd_client[ nfds++ ] = -1;
+    }
+
+    int64_t timeout_us = -1;
+    for( n = 0; n < DBR_RESP_MAX_CLIENTS; ++n )
+    {
+      dbrResp_client_t *c = srv->_clients[ n ];
+      if( c == NULL )
+        continue;
+      fds[ nfds ].fd = c->_fd;
+      fds[ nfds ].events = 0;
+      if( ! c->_closing && ( c->_out_len - c->_out_sent < DBR_RESP_OUTPUT_LIMIT ))
+        fds[ nfds ].events |= POLLIN;
+      if(( c->_out_sent < c->_out_ready ) && (( srv->_cfg._bandwidth <= 0 ) || ( c->_tokens >= 1.0 )))
+        fds[ nfds ].events |= POLLOUT;
+      fd_client[ nfds++ ] = n;
+
+      int64_t wait = dbrResp_client_next_event( srv, c, &now );
+      if(( wait >= 0 ) && (( timeout_us < 0 ) || ( wait < timeout_us )))
+        timeout_us = wait;
+    }
+
+    // wake up regularly to notice termination requests
+    int timeout_ms = ( timeout_us < 0 ) ? 1000 : (int)(( timeout_us + 999 ) / 1000 );
+    if( timeout_ms > 1000 )
+      timeout_ms = 1000;
+    // check back often enough to restart downed nodes on time
+    if(( nodes_down > 0 ) && ( timeout_ms > 10 ))
+      timeout_ms = 10;
+
+    int rc = poll( fds, nfds, timeout_ms );
+    if(( rc < 0 ) && ( errno != EINTR ))
+    {
+      LOG( DBG_ERR, stderr, "resp_srv: poll failed: %s\n", strerror( errno ) );
+      break;
+    }
+
+    dbrResp_now( &now );
+    for( n = 0; ( rc > 0 ) && ( n < nfds ); ++n )
+    {
+      if( fds[ n ].revents == 0 )
+        continue;
+      if( fd_client[ n ] < 0 )
+      {
+        dbrResp_accept( srv, n, &now );
+        continue;
+      }
+      dbrResp_client_t *c = srv->_clients[ fd_client[ n ] ];
+      if( fds[ n ].revents & ( POLLIN | POLLHUP | POLLERR ))
+      {
+        int rrc = dbrResp_client_recv( srv, c );
+        if( rrc < 0 )
+        {
+          dbrResp_client_close( srv, fd_client[ n ] );
+          fd_client[ n ] = -2;
+          continue;
+        }
+      }
+    }
+
+    // process input and push out whatever is released; clients with backlogged input continue here too
+    for( n = 0; n < DBR_RESP_MAX_CLIENTS; ++n )
+    {
+      dbrResp_client_t *c = srv->_clients[ n ];
+      if( c == NULL )
+        continue;
+      if( c->_in_len > 0 )
+        dbrResp_client_process( srv, c, &now );
+      if( dbrResp_client_send( srv, c, &now ) != 0 )
+      {
+        dbrResp_client_close( srv, n );
+        continue;
+      }
+      if( c->_closing && ( c->_out_sent == c->_out_len ))
+        dbrResp_client_close( srv, n );
+    }
+  }
+}
+
+static
+void dbrResp_print_stats( dbrResp_server_t *srv )
+{
+  dbrResp_stats_t *st = &srv->_stats;
+  LOG( DBG_INFO, stderr, "resp_srv: commands=%"PRIu64" keyed=%"PRIu64" in=%"PRIu64" out=%"PRIu64
+       " moved=%"PRIu64" ask=%"PRIu64" clusterdown=%"PRIu64" replica_reads=%"PRIu64" connections=%"PRIu64" keys=%zu\n",
+       st->_commands, st->_keyed, st->_bytes_in, st->_bytes_out,
+       st->_moved, st->_ask, st->_clusterdown, st->_replica_reads, st->_connections, srv->_store->_keys );
+}
+
+int dbrResp_slots_init( dbrResp_server_t *srv )
+{
+  dbrResp_config_t *cfg = &srv->_cfg;
+  int s, r;
+  memset( srv->_migrating, 0xFF, sizeof( srv->_migrating ) );
+  if( cfg->_nodes == 0 )
+  {
+    memset( srv->_owner, 0, sizeof( srv->_owner ) );
+    return 0;
+  }
+
+  if( cfg->_slot_ranges == 0 )
+  {
+    for( s = 0; s < DBR_RESP_HASH_SLOTS; ++s )
+      srv->_owner[ s ] = (uint8_t)( (int64_t)s * cfg->_nodes / DBR_RESP_HASH_SLOTS );
+    return 0;
+  }
+
+  memset( srv->_owner, 0xFF, sizeof( srv->_owner ) );
+  for( r = 0; r < cfg->_slot_ranges; ++r )
+    for( s = cfg->_slot_first[ r ]; s <= cfg->_slot_last[ r ]; ++s )
+      srv->_owner[ s ] = (uint8_t)r;
+  for( s = 0; s < DBR_RESP_HASH_SLOTS; ++s )
+    if( srv->_owner[ s ] == 0xFF )
+    {
+      LOG( DBG_ERR, stderr, "resp_srv: slot map doesn't cover slot %d\n", s );
+      return -EINVAL;
+    }
+  return 0;
+}
+
+void usage()
+{
+  fprintf( stderr, " resp_srv [options]\n\n"\
+                   "   -h             display help\n"\
+                   "   -H <host>      listen and advertise address (default: 127.0.0.1)\n"\
+                   "   -p <port>      port of the first node (default: %d)\n"\
+                   "   -n <nodes>     emulate a cluster of <nodes> on consecutive ports (default: standalone)\n"\
+                   "   -s <a-b,...>   slot range of each cluster node (default: even split)\n"\
+                   "   -r <n>         replicas per cluster node on the ports after the last node\n"\
+                   "   -a <password>  require AUTH with password\n"\
+                   "   -l <usec>      response latency\n"\
+                   "   -b <bytes/s>   per-connection response bandwidth\n"\
+                   "   -M <n>         inject MOVED for every n-th keyed command (cluster only)\n"\
+                   "   -A <n>         inject ASK for every n-th keyed command (cluster only)\n"\
+                   "   -D <n>         inject CLUSTERDOWN for every n-th keyed command (cluster only)\n"\
+                   "   -I <n>         push an invalidation ahead of every n-th keyed reply (RESP3 clients)\n"\
+                   "   -d             run as daemon\n"\
+                   "   -P <file>      write the server pid to file\n"\
+                   "   -k             stop the server of the pid file (-P) and exit\n\n",
+                   DBR_RESP_DEFAULT_PORT );
+}
+
+static
+int dbrResp_parse_ranges( char *spec, dbrResp_config_t *cfg )
+{
+  char *save = NULL;
+  char *tok;
+  for( tok = strtok_r( spec, ",", &save ); tok != NULL; tok = strtok_r( NULL, ",", &save ) )
+  {
+    int first, last;
+    if(( sscanf( tok, "%d-%d", &first, &last ) != 2 ) ||
+        ( first < 0 ) || ( last >= DBR_RESP_HASH_SLOTS ) || ( first > last ) ||
+        ( cfg->_slot_ranges >= DBR_RESP_MAX_NODES ))
+      return -EINVAL;
+    cfg->_slot_first[ cfg->_slot_ranges ] = first;
+    cfg->_slot_last[ cfg->_slot_ranges ] = last;
+    ++cfg->_slot_ranges;
+  }
+  return cfg->_slot_ranges > 0 ? 0 : -EINVAL;
+}
+
+int dbrResp_parse_cmdline( int argc, char **argv, dbrResp_config_t *cfg )
+{
+  if( cfg == NULL )
+    return -EINVAL;
+
+  int option;
+  memset( cfg, 0, sizeof( dbrResp_config_t ) );
+  cfg->_host = "127.0.0.1";
+  cfg->_port = DBR_RESP_DEFAULT_PORT;
+  while(( option = getopt(argc, argv, "hH:p:n:r:s:a:l:b:M:A:D:I:dP:k")) != -1 )
+  {
+    switch( option )
+    {
+      case 'h':
+        usage();
+        exit(0);
+      case 'H':
+        cfg->_host = optarg;
+        break;
+      case 'p':
+        cfg->_port = strtol( optarg, NULL, 10 );
+        break;
+      case 'n':
+        cfg->_nodes = strtol( optarg, NULL, 10 );
+        break;
+      case 'r':
+        cfg->_replicas = strtol( optarg, NULL, 10 );
+        break;
+      case 's':
+        if( dbrResp_parse_ranges( optarg, cfg ) != 0 )
+        {
+          fprintf( stderr, "invalid slot ranges: %s\n", optarg );
+          return -EINVAL;
+        }
+        break;
+      case 'a':
+        cfg->_password = optarg;
+        break;
+      case 'l':
+        cfg->_latency_us = strtoll( optarg, NULL, 10 );
+        break;
+      case 'b':
+        cfg->_bandwidth = strtoll( optarg, NULL, 10 );
+        break;
+      case 'M':
+        cfg->_moved_every = strtoull( optarg, NULL, 10 );
+        break;
+      case 'A':
+        cfg->_ask_every = strtoull( optarg, NULL, 10 );
+        break;
+      case 'D':
+        cfg->_clusterdown_every = strtoull( optarg, NULL, 10 );
+        break;
+      case 'I':
+        cfg->_push_every = strtoull( optarg, NULL, 10 );
+        break;
+      case 'd': // daemonize
+        cfg->_daemon = 1;
+        break;
+      case 'P':
+        cfg->_pidfile = optarg;
+        break;
+      case 'k':
+        cfg->_kill = 1;
+        break;
+      default:
+        usage();
+        return -EINVAL;
+    }
+  }
+
+  if(( cfg->_slot_ranges > 0 ) && ( cfg->_nodes == 0 ))
+    cfg->_nodes = cfg->_slot_ranges;
+  if(( cfg->_slot_ranges > 0 ) && ( cfg->_nodes != cfg->_slot_ranges ))
+  {
+    fprintf( stderr, "number of slot ranges (%d) doesn't match number of nodes (%d)\n", cfg->_slot_ranges, cfg->_nodes );
+    return -EINVAL;
+  }
+  if(( cfg->_replicas > 0 ) && ( cfg->_nodes == 0 ))
+  {
+    fprintf( stderr, "replicas (-r) require cluster mode (-n)\n" );
+    return -EINVAL;
+  }
+  if(( cfg->_nodes < 0 ) || ( cfg->_nodes > DBR_RESP_MAX_NODES ) ||
+      ( cfg->_replicas < 0 ) || ( cfg->_replicas > DBR_RESP_MAX_REPLICAS ) ||
+      ( cfg->_port <= 0 ) || ( cfg->_port + ( cfg->_nodes ? cfg->_nodes * ( 1 + cfg->_replicas ) : 1 ) > 65536 ) ||
+      ( cfg->_latency_us < 0 ) || ( cfg->_bandwidth < 0 ))
+  {
+    usage();
+    return -EINVAL;
+  }
+  if( cfg->_kill && ( cfg->_pidfile == NULL ))
+  {
+    fprintf( stderr, "-k requires a pid file (-P)\n" );
+    return -EINVAL;
+  }
+  return 0;
+}
+
+static
+int dbrResp_write_pidfile( const char *pidfile, const pid_t pid )
+{
+  FILE *f = fopen( pidfile, "w" );
+  if( f == NULL )
+  {
+    LOG( DBG_ERR, stderr, "resp_srv: cannot write pid file %s: %s\n", pidfile, strerror( errno ) );
+    return -errno;
+  }
+  fprintf( f, "%d\n", (int)pid );
+  fclose( f );
+  return 0;
+}
+
+/*
+ * terminate the server listed in the pid file and wait for it to exit
+ */
+static
+int dbrResp_kill( const char *pidfile )
+{
+  FILE *f = fopen( pidfile, "r" );
+  int pid = 0;
+  if(( f == NULL ) || ( fscanf( f, "%d", &pid ) != 1 ) || ( pid <= 0 ))
+  {
+    LOG( DBG_ERR, stderr, "resp_srv: no valid pid in %s\n", pidfile );
+    if( f != NULL )
+      fclose( f );
+    return 1;
+  }
+  fclose( f );
+
+  int rc = 0;
+  if( kill( pid, SIGTERM ) == 0 )
+  {
+    int wait;
+    for( wait = 0; ( wait < 1000 ) && ( kill( pid, 0 ) == 0 ); ++wait )
+      usleep( 10000 );
+    if( wait == 1000 )
+    {
+      LOG( DBG_ERR, stderr, "resp_srv: server %d didn't terminate\n", pid );
+      rc = 1;
+    }
+  }
+  unlink( pidfile );
+  return rc;
+}
+
+int main( int argc, char **argv )
+{
+  dbrResp_server_t *srv = (dbrResp_server_t*)calloc( 1, sizeof( dbrResp_server_t ) );
+  if( srv == NULL )
+    return ENOMEM;
+  if( dbrResp_parse_cmdline( argc, argv, &srv->_cfg ) != 0 )
+    return 1;
+
+  if( srv->_cfg._kill )
+    return dbrResp_kill( srv->_cfg._pidfile );
+
+  srv->_store = dbrResp_store_create( 1024 );
+  if(( srv->_store == NULL ) || ( dbrResp_slots_init( srv ) != 0 ))
+    return 1;
+
+  // listen before daemonizing, so clients can connect once the launcher returns
+  if( dbrResp_listen( srv ) != 0 )
+    return 1;
+
+  // daemonize if (-d)
+  if( srv->_cfg._daemon != 0 )
+  {
+    pid_t pid = fork();
+    if( pid < 0 )
+    {
+      LOG( DBG_ERR, stderr, "failed to fork resp_srv daemon.\n" );
+      exit( 1 );
+    }
+    if( pid != 0 )
+    {
+      if(( srv->_cfg._pidfile != NULL ) && ( dbrResp_write_pidfile( srv->_cfg._pidfile, pid ) != 0 ))
+      {
+        kill( pid, SIGTERM );
+        exit( 1 );
+      }
+      exit( 0 );
+    }
+
+    // detach from the launcher's terminal and output pipes
+    setsid();
+    int devnull = open( "/dev/null", O_RDWR );
+    if( devnull >= 0 )
+    {
+      dup2( devnull, STDIN_FILENO );
+      dup2( devnull, STDOUT_FILENO );
+      dup2( devnull, STDERR_FILENO );
+      if( devnull > STDERR_FILENO )
+        close( devnull );
+    }
+  }
+  else if(( srv->_cfg._pidfile != NULL ) && ( dbrResp_write_pidfile( srv->_cfg._pidfile, getpid() ) != 0 ))
+    return 1;
+
+  g_srv = srv;
+  srv->_keep_running = 1;
+  signal( SIGPIPE, SIG_IGN );
+  signal( SIGTERM, dbrResp_termination_handler );
+  signal( SIGINT, dbrResp_termination_handler );
+
+  LOG( DBG_INFO, stderr, "resp_srv: listening on %s:%d (%s%d nodes, %d replicas each)\n",
+       srv->_cfg._host, srv->_cfg._port, srv->_cfg._nodes ? "cluster, " : "standalone, ",
+       srv->_cfg._nodes ? srv->_cfg._nodes : 1, srv->_cfg._replicas );
+
+  dbrResp_loop( srv );
+  dbrResp_print_stats( srv );
+
+  int n;
+  for( n = 0; n < DBR_RESP_MAX_CLIENTS; ++n )
+    if( srv->_clients[ n ] != NULL )
+      dbrResp_client_close( srv, n );
+  for( n = 0; n < srv->_listeners; ++n )
+    if( srv->_listen[ n ] >= 0 )
+      close( srv->_listen[ n ] );
+  g_srv = NULL;
+  dbrResp_store_destroy( srv->_store );
+  free( srv->_argv );
+  free( srv );
+  return 0;
+}
@@ -0,0 +1,176 @@
+/*
+ * Copyright © 2020 IBM Corporation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#ifndef SRC_RESP_SRV_RESP_SRV_H_
+#define SRC_RESP_SRV_RESP_SRV_H_
+
+#include "resp_store.h"
+
+#include <stdarg.h>
+#include <stdint.h>
+#include <time.h>
+
+/*
+ * RESP stand-in server
+ * A single-threaded in-memory server that speaks enough RESP to serve the
+ * redis backend. It can pretend to be a cluster of several nodes (one port
+ * per node, shared key space, per-node slot ownership), optionally with
+ * replica ports that serve reads after READONLY, and allows to shape
+ * the response timing and to inject redirects and errors.
+ */
+
+#define DBR_RESP_DEFAULT_PORT ( 6379 )
+#define DBR_RESP_MAX_NODES ( 64 )
+#define DBR_RESP_MAX_REPLICAS ( 7 )
+#define DBR_RESP_MAX_LISTENERS ( DBR_RESP_MAX_NODES * ( DBR_RESP_MAX_REPLICAS + 1 ))
+#define DBR_RESP_MAX_CLIENTS ( 1024 )
+#define DBR_RESP_HASH_SLOTS ( 16384 )
+#define DBR_RESP_MAX_ARGS ( 1024 * 1024 )
+#define DBR_RESP_RECV_CHUNK ( 256 * 1024 )
+#define DBR_RESP_OUTPUT_LIMIT ( 64 * 1024 * 1024 )  /**< stop reading from a client with this much unsent output */
+
+typedef struct dbrResp_config
+{
+  char *_host;               /**< listen and advertised address */
+  int _port;                 /**< port of the first node */
+  int _nodes;                /**< number of nodes; 0 = standalone (no cluster support) */
+  int _replicas;             /**< replicas per node; listening on the ports after the last node */
+  int _slot_first[ DBR_RESP_MAX_NODES ];  /**< custom slot map; empty = even split */
+  int _slot_last[ DBR_RESP_MAX_NODES ];
+  int _slot_ranges;
+  char *_password;           /**< NULL: any AUTH succeeds */
+  int64_t _latency_us;       /**< added to every response */
+  int64_t _bandwidth;        /**< bytes/sec per connection; 0 = unlimited */
+  uint64_t _moved_every;     /**< inject MOVED for every n-th keyed command; 0 = off */
+  uint64_t _ask_every;       /**< inject ASK for every n-th keyed command; 0 = off */
+  uint64_t _clusterdown_every; /**< inject CLUSTERDOWN for every n-th keyed command; 0 = off */
+  uint64_t _push_every;      /**< push an invalidation of the key ahead of every n-th keyed reply (RESP3 clients); 0 = off */
+  int _daemon;
+  int _kill;                 /**< stop the server of the pidfile and exit */
+  char *_pidfile;
+} dbrResp_config_t;
+
+/*
+ * response data waiting for its release time
+ */
+typedef struct
+{
+  size_t _end;               /**< offset in the output buffer where the response ends */
+  struct timespec _release;
+} dbrResp_mark_t;
+
+typedef struct dbrResp_client
+{
+  int _fd;
+  int _node;                 /**< node index this client is connected to */
+  int _replica;              /**< connected to a replica port of the node */
+  int _readonly;             /**< READONLY received: replicas serve reads */
+  int _authed;
+  int _asking;               /**< ASKING received for the next command */
+  int _protocol;             /**< RESP version selected with HELLO (2 or 3) */
+  int _closing;              /**< close after all output is sent */
+
+  char *_in;
+  size_t _in_len;
+  size_t _in_cap;
+
+  char *_out;
+  size_t _out_len;
+  size_t _out_sent;
+  size_t _out_ready;         /**< end of the released part of the output */
+  size_t _out_cap;
+  dbrResp_mark_t *_marks;
+  size_t _mark_head;
+  size_t _mark_count;
+  size_t _mark_cap;
+
+  double _tokens;            /**< bandwidth token bucket in bytes */
+  struct timespec _refill;
+
+  int _multi;                /**< inside MULTI */
+  int _multi_error;          /**< a queued command got rejected: EXEC aborts */
+  int _exec;                 /**< EXEC is running the queue; routing was checked at queue time */
+  int _queued;
+  dbrResp_str_t **_queue;    /**< copies of the queued command arguments */
+  int *_queue_argc;
+} dbrResp_client_t;
+
+typedef struct dbrResp_stats
+{
+  uint64_t _commands;
+  uint64_t _keyed;
+  uint64_t _bytes_in;
+  uint64_t _bytes_out;
+  uint64_t _moved;
+  uint64_t _ask;
+  uint64_t _clusterdown;
+  uint64_t _replica_reads;
+  uint64_t _connections;
+  uint64_t _pushes;
+} dbrResp_stats_t;
+
+typedef struct dbrResp_server
+{
+  dbrResp_config_t _cfg;
+  dbrResp_store_t *_store;
+  int _listen[ DBR_RESP_MAX_LISTENERS ];
+  int _listeners;
+  uint8_t _owner[ DBR_RESP_HASH_SLOTS ];  /**< node index that owns each slot */
+  uint8_t _migrating[ DBR_RESP_HASH_SLOTS ];  /**< target node of a slot migration; 0xFF = none */
+  struct timespec _down_until[ DBR_RESP_MAX_NODES ];  /**< node refuses connections until then (SIM DOWN) */
+  int _drop_replicas[ DBR_RESP_MAX_NODES ];  /**< close the replica connections of the node (SIM DROP) */
+  dbrResp_client_t *_clients[ DBR_RESP_MAX_CLIENTS ];
+  dbrResp_str_t *_argv;      /**< argument vector of the command being parsed */
+  size_t _argv_cap;
+  dbrResp_stats_t _stats;
+  volatile int _keep_running;
+} dbrResp_server_t;
+
+/*
+ * port of the r-th replica of a node
+ */
+#define dbrResp_replica_port( cfg, node, r ) ( (cfg)->_port + (cfg)->_nodes + (node) * (cfg)->_replicas + (r) )
+
+int dbrResp_parse_cmdline( int argc, char **argv, dbrResp_config_t *cfg );
+
+/*
+ * assign slots to nodes either from the configured ranges or evenly
+ */
+int dbrResp_slots_init( dbrResp_server_t *srv );
+
+/*
+ * execute one command and append the response(s) to the client's output
+ */
+void dbrResp_execute( dbrResp_server_t *srv, dbrResp_client_t *c, int argc, dbrResp_str_t *argv );
+
+void dbrResp_client_discard_queue( dbrResp_client_t *c );
+
+/*
+ * response helpers append to the client's output; the network loop releases
+ * the complete response of a command after the configured latency
+ */
+void dbrResp_reply_raw( dbrResp_server_t *srv, dbrResp_client_t *c, const char *data, const size_t len );
+void dbrResp_reply_status( dbrResp_server_t *srv, dbrResp_client_t *c, const char *status );
+void dbrResp_reply_error( dbrResp_server_t *srv, dbrResp_client_t *c, const char *fmt, ... );
+void dbrResp_reply_int( dbrResp_server_t *srv, dbrResp_client_t *c, const int64_t val );
+void dbrResp_reply_bulk( dbrResp_server_t *srv, dbrResp_client_t *c, const char *data, const size_t len );
+void dbrResp_reply_nil( dbrResp_server_t *srv, dbrResp_client_t *c );
+void dbrResp_reply_array( dbrResp_server_t *srv, dbrResp_client_t *c, const int64_t len );
+void dbrResp_reply_map( dbrResp_server_t *srv, dbrResp_client_t *c, const int64_t pairs );
+void dbrResp_reply_push( dbrResp_server_t *srv, dbrResp_client_t *c, const int64_t len );
+
+#endif /* SRC_RESP_SRV_RESP_SRV_H_ */
@@ -0,0 +1,506 @@
+/*
+ * Copyright © 2020 IBM Corporation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#include "logutil.h"
+#include "redis/crc16.h"
+#include "resp_store.h"
+
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define DBR_RESP_SLOT_MASK ( 0x3FFF )
+
+// DUMP payload: magic, type, item count, then length+data of each item
+#define DBR_RESP_DUMP_MAGIC "DBRRESP1"
+#define DBR_RESP_DUMP_MAGIC_LEN ( 8 )
+
+static inline
+uint64_t dbrResp_hash( const char *key, const size_t len )
+{
+  uint64_t h = 0xcbf29ce484222325ull;
+  size_t n;
+  for( n = 0; n < len; ++n )
+  {
+    h ^= (uint8_t)key[ n ];
+    h *= 0x100000001b3ull;
+  }
+  return h;
+}
+
+uint16_t dbrResp_key_slot( const char *key, const size_t len )
+{
+  // only the part between the first { and the next } is hashed if non-empty
+  size_t start, end;
+  for( start = 0; ( start < len ) && ( key[ start ] != '{' ); ++start );
+  if( start < len )
+  {
+    for( end = start + 1; ( end < len ) && ( key[ end ] != '}' ); ++end );
+    if(( end < len ) && ( end > start + 1 ))
+      return (uint16_t)crcremainder( key + start + 1, end - start - 1 ) & DBR_RESP_SLOT_MASK;
+  }
+  return (uint16_t)crcremainder( key, len ) & DBR_RESP_SLOT_MASK;
+}
+
+dbrResp_store_t* dbrResp_store_create( const size_t initial_buckets )
+{
+  dbrResp_store_t *store = (dbrResp_store_t*)calloc( 1, sizeof( dbrResp_store_t ) );
+  if( store == NULL )
+    return NULL;
+
+  uint64_t buckets = 16;
+  while( buckets < initial_buckets )
+    buckets <<= 1;
+
+  store->_buckets = (dbrResp_obj_t**)calloc( buckets, sizeof( dbrResp_obj_t* ) );
+  if( store->_buckets == NULL )
+  {
+    free( store );
+    return NULL;
+  }
+  store->_mask = buckets - 1;
+  return store;
+}
+
+static
+void dbrResp_obj_free( dbrResp_obj_t *obj )
+{
+  size_t n;
+  for( n = obj->_head; n < obj->_head + obj->_count; ++n )
+    free( obj->_items[ n ]._data );
+  free( obj->_items );
+  free( obj->_key._data );
+  free( obj );
+}
+
+void dbrResp_store_flush( dbrResp_store_t *store )
+{
+  if( store == NULL )
+    return;
+  uint64_t b;
+  for( b = 0; b <= store->_mask; ++b )
+  {
+    dbrResp_obj_t *obj = store->_buckets[ b ];
+    while( obj != NULL )
+    {
+      dbrResp_obj_t *next = obj->_next;
+      dbrResp_obj_free( obj );
+      obj = next;
+    }
+    store->_buckets[ b ] = NULL;
+  }
+  store->_keys = 0;
+  store->_bytes = 0;
+}
+
+void dbrResp_store_destroy( dbrResp_store_t *store )
+{
+  if( store == NULL )
+    return;
+  dbrResp_store_flush( store );
+  free( store->_buckets );
+  free( store );
+}
+
+/*
+ * double the bucket count; objects of bucket b end up in b or b+oldsize
+ */
+static
+void dbrResp_store_grow( dbrResp_store_t *store )
+{
+  uint64_t old_size = store->_mask + 1;
+  dbrResp_obj_t **buckets = (dbrResp_obj_t**)calloc( old_size * 2, sizeof( dbrResp_obj_t* ) );
+  if( buckets == NULL )
+    return; // keep going with longer chains
+
+  uint64_t mask = old_size * 2 - 1;
+  uint64_t b;
+  for( b = 0; b < old_size; ++b )
+  {
+    dbrResp_obj_t *obj = store->_buckets[ b ];
+    while( obj != NULL )
+    {
+      dbrResp_obj_t *next = obj->_next;
+      obj->_next = buckets[ obj->_hash & mask ];
+      buckets[ obj->_hash & mask ] = obj;
+      obj = next;
+    }
+  }
+  free( store->_buckets );
+  store->_buckets = buckets;
+  store->_mask = mask;
+}
+
+dbrResp_obj_t* dbrResp_store_find( dbrResp_store_t *store, const char *key, const size_t len )
+{
+  if(( store == NULL ) || ( key == NULL ))
+    return NULL;
+
+  uint64_t h = dbrResp_hash( key, len );
+  dbrResp_obj_t *obj;
+  for( obj = store->_buckets[ h & store->_mask ]; obj != NULL; obj = obj->_next )
+    if(( obj->_hash == h ) && ( obj->_key._len == len ) && ( memcmp( obj->_key._data, key, len ) == 0 ))
+      return obj;
+  return NULL;
+}
+
+dbrResp_obj_t* dbrResp_store_get_or_create( dbrResp_store_t *store,
+                                            const char *key,
+                                            const size_t len,
+                                            const dbrResp_obj_type_t type )
+{
+  dbrResp_obj_t *obj = dbrResp_store_find( store, key, len );
+  if( obj != NULL )
+  {
+    if( obj->_type != type )
+    {
+      errno = EEXIST;
+      return NULL;
+    }
+    return obj;
+  }
+
+  obj = (dbrResp_obj_t*)calloc( 1, sizeof( dbrResp_obj_t ) );
+  if( obj == NULL )
+  {
+    errno = ENOMEM;
+    return NULL;
+  }
+  obj->_key._data = (char*)malloc( len + 1 );
+  if( obj->_key._data == NULL )
+  {
+    free( obj );
+    errno = ENOMEM;
+    return NULL;
+  }
+  memcpy( obj->_key._data, key, len );
+  obj->_key._data[ len ] = '\0';
+  obj->_key._len = len;
+  obj->_hash = dbrResp_hash( key, len );
+  obj->_slot = dbrResp_key_slot( key, len );
+  obj->_type = type;
+
+  if( store->_keys >= store->_mask + 1 )
+    dbrResp_store_grow( store );
+
+  obj->_next = store->_buckets[ obj->_hash & store->_mask ];
+  store->_buckets[ obj->_hash & store->_mask ] = obj;
+  ++store->_keys;
+  return obj;
+}
+
+int dbrResp_store_delete( dbrResp_store_t *store, const char *key, const size_t len )
+{
+  if(( store == NULL ) || ( key == NULL ))
+    return 0;
+
+  uint64_t h = dbrResp_hash( key, len );
+  dbrResp_obj_t **prev = &store->_buckets[ h & store->_mask ];
+  dbrResp_obj_t *obj;
+  for( obj = *prev; obj != NULL; prev = &obj->_next, obj = obj->_next )
+    if(( obj->_hash == h ) && ( obj->_key._len == len ) && ( memcmp( obj->_key._data, key, len ) == 0 ))
+    {
+      *prev = obj->_next;
+      size_t n;
+      for( n = obj->_head; n < obj->_head + obj->_count; ++n )
+        store->_bytes -= obj->_items[ n ]._len;
+      dbrResp_obj_free( obj );
+      --store->_keys;
+      return 1;
+    }
+  return 0;
+}
+
+static inline
+uint64_t dbrResp_rev( uint64_t v )
+{
+  uint64_t r = 0;
+  int n;
+  for( n = 0; n < 64; ++n, v >>= 1 )
+    r = ( r << 1 ) | ( v & 1 );
+  return r;
+}
+
+uint64_t dbrResp_store_scan( dbrResp_store_t *store,
+                             uint64_t cursor,
+                             const size_t count,
+                             void (*fn)( dbrResp_obj_t *obj, void *arg ),
+                             void *arg )
+{
+  if(( store == NULL ) || ( fn == NULL ))
+    return 0;
+
+  uint64_t mask = store->_mask;
+  size_t visited = 0;
+  do
+  {
+    dbrResp_obj_t *obj;
+    for( obj = store->_buckets[ cursor & mask ]; obj != NULL; obj = obj->_next, ++visited )
+      fn( obj, arg );
+
+    // increment the reversed cursor: covers all buckets even if the table grows in between calls
+    cursor |= ~mask;
+    cursor = dbrResp_rev( cursor );
+    ++cursor;
+    cursor = dbrResp_rev( cursor );
+  } while(( cursor != 0 ) && ( visited < count ));
+  return cursor;
+}
+
+static
+int dbrResp_obj_reserve( dbrResp_obj_t *obj, const size_t more )
+{
+  // compact the popped space of lists before growing
+  if(( obj->_head > 0 ) && ( obj->_head + obj->_count + more > obj->_cap ))
+  {
+    memmove( obj->_items, obj->_items + obj->_head, obj->_count * sizeof( dbrResp_str_t ) );
+    obj->_head = 0;
+  }
+  if( obj->_count + more <= obj->_cap )
+    return 0;
+
+  size_t cap = obj->_cap ? obj->_cap * 2 : 4;
+  while( cap < obj->_count + more )
+    cap *= 2;
+  dbrResp_str_t *items = (dbrResp_str_t*)realloc( obj->_items, cap * sizeof( dbrResp_str_t ) );
+  if( items == NULL )
+    return -ENOMEM;
+  obj->_items = items;
+  obj->_cap = cap;
+  return 0;
+}
+
+static inline
+int dbrResp_str_copy( dbrResp_str_t *dst, const char *data, const size_t len )
+{
+  dst->_data = (char*)malloc( len + 1 );
+  if( dst->_data == NULL )
+    return -ENOMEM;
+  if( len > 0 )
+    memcpy( dst->_data, data, len );
+  dst->_data[ len ] = '\0';
+  dst->_len = len;
+  return 0;
+}
+
+int dbrResp_list_push( dbrResp_store_t *store, dbrResp_obj_t *obj, const char *data, const size_t len )
+{
+  if(( obj == NULL ) || ( obj->_type != DBR_RESP_OBJ_LIST ))
+    return -EINVAL;
+  if( dbrResp_obj_reserve( obj, 1 ) != 0 )
+    return -ENOMEM;
+  if( dbrResp_str_copy( &obj->_items[ obj->_head + obj->_count ], data, len ) != 0 )
+    return -ENOMEM;
+  ++obj->_count;
+  store->_bytes += len;
+  return 0;
+}
+
+int dbrResp_list_pop( dbrResp_store_t *store, dbrResp_obj_t *obj, dbrResp_str_t *out )
+{
+  if(( obj == NULL ) || ( obj->_type != DBR_RESP_OBJ_LIST ) || ( out == NULL ))
+    return -EINVAL;
+  if( obj->_count == 0 )
+    return -ENOENT;
+  *out = obj->_items[ obj->_head ];
+  ++obj->_head;
+  --obj->_count;
+  store->_bytes -= out->_len;
+  if( obj->_count == 0 )
+    obj->_head = 0;
+  return 0;
+}
+
+dbrResp_str_t* dbrResp_list_index( dbrResp_obj_t *obj, int64_t idx )
+{
+  if(( obj == NULL ) || ( obj->_type != DBR_RESP_OBJ_LIST ))
+    return NULL;
+  if( idx < 0 )
+    idx += obj->_count;
+  if(( idx < 0 ) || ( (size_t)idx >= obj->_count ))
+    return NULL;
+  return &obj->_items[ obj->_head + idx ];
+}
+
+dbrResp_str_t* dbrResp_hash_get( dbrResp_obj_t *obj, const char *field, const size_t flen )
+{
+  if(( obj == NULL ) || ( obj->_type != DBR_RESP_OBJ_HASH ))
+    return NULL;
+  size_t n;
+  for( n = 0; n < obj->_count; n += 2 )
+    if(( obj->_items[ n ]._len == flen ) && ( memcmp( obj->_items[ n ]._data, field, flen ) == 0 ))
+      return &obj->_items[ n + 1 ];
+  return NULL;
+}
+
+int dbrResp_hash_set( dbrResp_store_t *store, dbrResp_obj_t *obj,
+                      const char *field, const size_t flen,
+                      const char *value, const size_t vlen )
+{
+  if(( obj == NULL ) || ( obj->_type != DBR_RESP_OBJ_HASH ))
+    return -EINVAL;
+
+  dbrResp_str_t *v = dbrResp_hash_get( obj, field, flen );
+  if( v != NULL )
+  {
+    dbrResp_str_t nv;
+    if( dbrResp_str_copy( &nv, value, vlen ) != 0 )
+      return -ENOMEM;
+    store->_bytes += vlen - v->_len;
+    free( v->_data );
+    *v = nv;
+    return 0;
+  }
+
+  if( dbrResp_obj_reserve( obj, 2 ) != 0 )
+    return -ENOMEM;
+  if( dbrResp_str_copy( &obj->_items[ obj->_count ], field, flen ) != 0 )
+    return -ENOMEM;
+  if( dbrResp_str_copy( &obj->_items[ obj->_count + 1 ], value, vlen ) != 0 )
+  {
+    free( obj->_items[ obj->_count ]._data );
+    return -ENOMEM;
+  }
+  obj->_count += 2;
+  store->_bytes += flen + vlen;
+  return 1;
+}
+
+dbrResp_str_t* dbrResp_string_get( dbrResp_obj_t *obj )
+{
+  if(( obj == NULL ) || ( obj->_type != DBR_RESP_OBJ_STRING ) || ( obj->_count == 0 ))
+    return NULL;
+  return &obj->_items[ 0 ];
+}
+
+int dbrResp_string_set( dbrResp_store_t *store, dbrResp_obj_t *obj, const char *value, const size_t vlen )
+{
+  if(( obj == NULL ) || ( obj->_type != DBR_RESP_OBJ_STRING ))
+    return -EINVAL;
+
+  dbrResp_str_t nv;
+  if( dbrResp_str_copy( &nv, value, vlen ) != 0 )
+    return -ENOMEM;
+  if( obj->_count == 0 )
+  {
+    if( dbrResp_obj_reserve( obj, 1 ) != 0 )
+    {
+      free( nv._data );
+      return -ENOMEM;
+    }
+    obj->_count = 1;
+  }
+  else
+  {
+    store->_bytes -= obj->_items[ 0 ]._len;
+    free( obj->_items[ 0 ]._data );
+  }
+  obj->_items[ 0 ] = nv;
+  store->_bytes += vlen;
+  return 0;
+}
+
+char* dbrResp_obj_dump( dbrResp_obj_t *obj, size_t *len )
+{
+  if(( obj == NULL ) || ( len == NULL ))
+    return NULL;
+
+  size_t total = DBR_RESP_DUMP_MAGIC_LEN + 2 * sizeof( uint64_t );
+  size_t n;
+  for( n = obj->_head; n < obj->_head + obj->_count; ++n )
+    total += sizeof( uint64_t ) + obj->_items[ n ]._len;
+
+  char *payload = (char*)malloc( total );
+  if( payload == NULL )
+    return NULL;
+
+  char *p = payload;
+  uint64_t val;
+  memcpy( p, DBR_RESP_DUMP_MAGIC, DBR_RESP_DUMP_MAGIC_LEN ); p += DBR_RESP_DUMP_MAGIC_LEN;
+  val = obj->_type; memcpy( p, &val, sizeof( val ) ); p += sizeof( val );
+  val = obj->_count; memcpy( p, &val, sizeof( val ) ); p += sizeof( val );
+  for( n = obj->_head; n < obj->_head + obj->_count; ++n )
+  {
+    val = obj->_items[ n ]._len;
+    memcpy( p, &val, sizeof( val ) ); p += sizeof( val );
+    memcpy( p, obj->_items[ n ]._data, val ); p += val;
+  }
+  *len = total;
+  return payload;
+}
+
+int dbrResp_obj_restore( dbrResp_store_t *store, const char *key, const size_t keylen,
+                         const char *payload, const size_t len )
+{
+  if(( store == NULL ) || ( key == NULL ) || ( payload == NULL ))
+    return -EINVAL;
+
+  const char *p = payload;
+  const char *end = payload + len;
+  uint64_t type, count, n;
+  if(( len < DBR_RESP_DUMP_MAGIC_LEN + 2 * sizeof( uint64_t ) ) ||
+      ( memcmp( p, DBR_RESP_DUMP_MAGIC, DBR_RESP_DUMP_MAGIC_LEN ) != 0 ))
+    return -EPROTO;
+  p += DBR_RESP_DUMP_MAGIC_LEN;
+  memcpy( &type, p, sizeof( type ) ); p += sizeof( type );
+  memcpy( &count, p, sizeof( count ) ); p += sizeof( count );
+  if((( type != DBR_RESP_OBJ_LIST ) && ( type != DBR_RESP_OBJ_HASH ) && ( type != DBR_RESP_OBJ_STRING )) ||
+      (( type == DBR_RESP_OBJ_HASH ) && ( count & 1 )) ||
+      (( type == DBR_RESP_OBJ_STRING ) && ( count != 1 )))
+    return -EPROTO;
+
+  // validate the whole payload before touching the store
+  const char *q = p;
+  for( n = 0; n < count; ++n )
+  {
+    uint64_t ilen;
+    if( q + sizeof( ilen ) > end )
+      return -EPROTO;
+    memcpy( &ilen, q, sizeof( ilen ) );
+    q += sizeof( ilen );
+    if( ilen > (uint64_t)( end - q ) )
+      return -EPROTO;
+    q += ilen;
+  }
+
+  if( dbrResp_store_find( store, key, keylen ) != NULL )
+    return -EEXIST;
+
+  dbrResp_obj_t *obj = dbrResp_store_get_or_create( store, key, keylen, (dbrResp_obj_type_t)type );
+  if( obj == NULL )
+    return -errno;
+  if( dbrResp_obj_reserve( obj, count ) != 0 )
+  {
+    dbrResp_store_delete( store, key, keylen );
+    return -ENOMEM;
+  }
+  for( n = 0; n < count; ++n )
+  {
+    uint64_t ilen;
+    memcpy( &ilen, p, sizeof( ilen ) );
+    p += sizeof( ilen );
+    if( dbrResp_str_copy( &obj->_items[ obj->_count ], p, ilen ) != 0 )
+    {
+      dbrResp_store_delete( store, key, keylen );
+      return -ENOMEM;
+    }
+    ++obj->_count;
+    store->_bytes += ilen;
+    p += ilen;
+  }
+  return 0;
+}
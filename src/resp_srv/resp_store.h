@@ -0,0 +1,124 @@
+/*
+ * Copyright © 2020 IBM Corporation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#ifndef SRC_RESP_SRV_RESP_STORE_H_
+#define SRC_RESP_SRV_RESP_STORE_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+ * in-memory key space of the RESP stand-in server
+ * covers the value types the redis backend uses: lists, hashes, and strings (counters)
+ */
+
+typedef enum
+{
+  DBR_RESP_OBJ_LIST = 1,
+  DBR_RESP_OBJ_HASH = 2,
+  DBR_RESP_OBJ_STRING = 3
+} dbrResp_obj_type_t;
+
+typedef struct
+{
+  char *_data;
+  size_t _len;
+} dbrResp_str_t;
+
+typedef struct dbrResp_obj
+{
+  struct dbrResp_obj *_next;   /**< bucket chain */
+  uint64_t _hash;
+  uint16_t _slot;              /**< cluster hash slot of the key */
+  dbrResp_obj_type_t _type;
+  dbrResp_str_t _key;
+  dbrResp_str_t *_items;       /**< list: values; hash: alternating field/value; string: the value */
+  size_t _head;                /**< list: index of the first value */
+  size_t _count;               /**< number of used items */
+  size_t _cap;
+} dbrResp_obj_t;
+
+typedef struct
+{
+  dbrResp_obj_t **_buckets;
+  uint64_t _mask;              /**< bucket count - 1 (power of 2) */
+  size_t _keys;
+  size_t _bytes;               /**< sum of all value sizes */
+} dbrResp_store_t;
+
+dbrResp_store_t* dbrResp_store_create( const size_t initial_buckets );
+void dbrResp_store_destroy( dbrResp_store_t *store );
+void dbrResp_store_flush( dbrResp_store_t *store );
+
+/*
+ * hash slot of a key incl. redis' {hashtag} rule
+ */
+uint16_t dbrResp_key_slot( const char *key, const size_t len );
+
+dbrResp_obj_t* dbrResp_store_find( dbrResp_store_t *store, const char *key, const size_t len );
+
+/*
+ * find or create an object of the requested type
+ * returns NULL and sets errno: EEXIST if the key exists with a different type, ENOMEM
+ */
+dbrResp_obj_t* dbrResp_store_get_or_create( dbrResp_store_t *store,
+                                            const char *key,
+                                            const size_t len,
+                                            const dbrResp_obj_type_t type );
+
+/*
+ * remove and free the object of key
+ * returns 1 if deleted, 0 if not found
+ */
+int dbrResp_store_delete( dbrResp_store_t *store, const char *key, const size_t len );
+
+/*
+ * redis-style reverse-binary cursor iteration that stays consistent while the table grows
+ * calls fn for each object of the visited buckets until at least count objects were visited
+ * returns the next cursor (0 when done)
+ */
+uint64_t dbrResp_store_scan( dbrResp_store_t *store,
+                             uint64_t cursor,
+                             const size_t count,
+                             void (*fn)( dbrResp_obj_t *obj, void *arg ),
+                             void *arg );
+
+/* list operations; values are copied */
+int dbrResp_list_push( dbrResp_store_t *store, dbrResp_obj_t *obj, const char *data, const size_t len );
+/* pops the first value; caller owns the returned data */
+int dbrResp_list_pop( dbrResp_store_t *store, dbrResp_obj_t *obj, dbrResp_str_t *out );
+dbrResp_str_t* dbrResp_list_index( dbrResp_obj_t *obj, int64_t idx );
+
+/* hash operations */
+dbrResp_str_t* dbrResp_hash_get( dbrResp_obj_t *obj, const char *field, const size_t flen );
+/* returns 1 if the field is new, 0 if it got updated, negative error code */
+int dbrResp_hash_set( dbrResp_store_t *store, dbrResp_obj_t *obj,
+                      const char *field, const size_t flen,
+                      const char *value, const size_t vlen );
+
+/* string operations */
+dbrResp_str_t* dbrResp_string_get( dbrResp_obj_t *obj );
+int dbrResp_string_set( dbrResp_store_t *store, dbrResp_obj_t *obj, const char *value, const size_t vlen );
+
+/*
+ * serialize an object into a malloc'd DUMP payload and back
+ */
+char* dbrResp_obj_dump( dbrResp_obj_t *obj, size_t *len );
+int dbrResp_obj_restore( dbrResp_store_t *store, const char *key, const size_t keylen,
+                         const char *payload, const size_t len );
+
+#endif /* SRC_RESP_SRV_RESP_STORE_H_ */
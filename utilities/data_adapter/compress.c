@@ -0,0 +1,748 @@
+/*
+ * Copyright © 2020 IBM Corporation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+/*
+ * Compression data adapter
+ *
+ * Compresses tuple values in pre_write and decompresses them into the
+ * user SGEs in post_read. The codec is selected per key by the policy
+ * in DBR_COMPRESS_POLICY, a comma-separated list of rules:
+ *
+ *     <key-glob>=<codec>[:<level>][@<min-bytes>]
+ *
+ * e.g. "snap_*=zstd:5@65536,*.log=lz4@4096,*=none"
+ * The first rule with a matching glob decides. Values smaller than the
+ * rule's threshold are stored uncompressed. Available codecs are lz4
+ * (latency), zstd (ratio), zlib and none. A codec that wasn't compiled in
+ * falls back to the closest available one.
+ *
+ * Compressed values carry a 16-byte header, so compressed and uncompressed
+ * tuples can coexist in the same namespace:
+ *
+ *     [0..3] magic "DBRZ"  [4] version  [5] codec  [6..7] reserved
+ *     [8..15] uncompressed size (little endian)
+ *
+ * Values are only stored compressed if that saves space. Uncompressed
+ * values that happen to start with the magic get a codec=none header
+ * to keep the format unambiguous.
+ */
+
+#include <libdatabroker.h>
+#include <dbrda_api.h>
+
+#include <errno.h> // errno
+#include <stdlib.h> // calloc
+#include <string.h> // memset, strlen
+#include <stdio.h> // fprintf
+#include <fnmatch.h> // fnmatch
+#include <pthread.h> // pthread_once
+
+#ifdef DBRDA_HAVE_LZ4
+#include <lz4.h>
+#endif
+#ifdef DBRDA_HAVE_ZSTD
+#include <zstd.h>
+#endif
+#ifdef DBRDA_HAVE_ZLIB
+#include <zlib.h>
+#endif
+
+#define DBRDA_COMPRESS_POLICY_ENV ( "DBR_COMPRESS_POLICY" )
+#define DBRDA_COMPRESS_DEFAULT_POLICY ( "*=lz4@4096" )
+#define DBRDA_COMPRESS_MAX_RULES ( 32 )
+#define DBRDA_COMPRESS_HEADER_LEN ( 16 )
+#define DBRDA_COMPRESS_VERSION ( 1 )
+
+static const char dbrDA_Compress_magic[ 4 ] = { 'D', 'B', 'R', 'Z' };
+
+typedef enum
+{
+  DBRDA_CODEC_NONE = 0,
+  DBRDA_CODEC_LZ4 = 1,
+  DBRDA_CODEC_ZSTD = 2,
+  DBRDA_CODEC_ZLIB = 3,
+  DBRDA_CODEC_MAX
+} dbrDA_Codec_t;
+
+typedef struct
+{
+  char *_pattern;
+  dbrDA_Codec_t _codec;
+  int _level;
+  int64_t _threshold;
+} dbrDA_Compress_rule_t;
+
+typedef struct
+{
+  int _rule_count;
+  dbrDA_Compress_rule_t _rules[ DBRDA_COMPRESS_MAX_RULES ];
+} dbrDA_Compress_policy_t;
+
+static dbrDA_Compress_policy_t gCompress_policy;
+static pthread_once_t gCompress_policy_once = PTHREAD_ONCE_INIT;
+
+
+/*
+ * map a requested codec to the closest one that got compiled in
+ */
+static
+dbrDA_Codec_t dbrDA_Compress_codec_resolve( dbrDA_Codec_t codec, int *level )
+{
+  switch( codec )
+  {
+    case DBRDA_CODEC_LZ4:
+#ifdef DBRDA_HAVE_LZ4
+      return DBRDA_CODEC_LZ4;
+#elif defined DBRDA_HAVE_ZLIB
+      *level = 1;
+      return DBRDA_CODEC_ZLIB;
+#elif defined DBRDA_HAVE_ZSTD
+      *level = 1;
+      return DBRDA_CODEC_ZSTD;
+#else
+      return DBRDA_CODEC_NONE;
+#endif
+    case DBRDA_CODEC_ZSTD:
+#ifdef DBRDA_HAVE_ZSTD
+      return DBRDA_CODEC_ZSTD;
+#elif defined DBRDA_HAVE_ZLIB
+      if(( *level <= 0 ) || ( *level > 9 ))
+        *level = 6;
+      return DBRDA_CODEC_ZLIB;
+#elif defined DBRDA_HAVE_LZ4
+      return DBRDA_CODEC_LZ4;
+#else
+      return DBRDA_CODEC_NONE;
+#endif
+    case DBRDA_CODEC_ZLIB:
+#ifdef DBRDA_HAVE_ZLIB
+      return DBRDA_CODEC_ZLIB;
+#else
+      return dbrDA_Compress_codec_resolve( DBRDA_CODEC_ZSTD, level );
+#endif
+    default:
+      return DBRDA_CODEC_NONE;
+  }
+}
+
+static const char* dbrDA_Compress_codec_names[ DBRDA_CODEC_MAX ] = { "none", "lz4", "zstd", "zlib" };
+
+static
+dbrDA_Codec_t dbrDA_Compress_codec_parse( const char *name )
+{
+  int c;
+  for( c = 0; c < DBRDA_CODEC_MAX; ++c )
+    if( strcmp( name, dbrDA_Compress_codec_names[ c ] ) == 0 )
+      return (dbrDA_Codec_t)c;
+  return DBRDA_CODEC_MAX;
+}
+
+/*
+ * parse one rule: <key-glob>=<codec>[:<level>][@<min-bytes>]
+ * the rule string is modified in place
+ */
+static
+int dbrDA_Compress_rule_parse( char *rule, dbrDA_Compress_rule_t *out )
+{
+  char *codec = strrchr( rule, '=' );
+  if(( codec == NULL ) || ( codec == rule ))
+    return -EINVAL;
+  *codec++ = '\0';
+
+  int64_t threshold = 0;
+  char *at = strchr( codec, '@' );
+  if( at != NULL )
+  {
+    *at++ = '\0';
+    char *end = NULL;
+    threshold = strtoll( at, &end, 10 );
+    if(( end == at ) || ( *end != '\0' ) || ( threshold < 0 ))
+      return -EINVAL;
+  }
+
+  int level = 0;
+  char *colon = strchr( codec, ':' );
+  if( colon != NULL )
+  {
+    *colon++ = '\0';
+    level = atoi( colon );
+  }
+
+  dbrDA_Codec_t c = dbrDA_Compress_codec_parse( codec );
+  if( c == DBRDA_CODEC_MAX )
+    return -EINVAL;
+
+  out->_pattern = strdup( rule );
+  if( out->_pattern == NULL )
+    return -ENOMEM;
+  out->_codec = dbrDA_Compress_codec_resolve( c, &level );
+  if( out->_codec != c )
+    fprintf( stderr, "dbrda_compress: codec %s not available, using %s for '%s'\n",
+             dbrDA_Compress_codec_names[ c ], dbrDA_Compress_codec_names[ out->_codec ], rule );
+  out->_level = level;
+  out->_threshold = threshold;
+  return 0;
+}
+
+static
+void dbrDA_Compress_policy_init( void )
+{
+  const char *env = getenv( DBRDA_COMPRESS_POLICY_ENV );
+  if(( env == NULL ) || ( env[0] == '\0' ))
+    env = DBRDA_COMPRESS_DEFAULT_POLICY;
+
+  char *policy = strdup( env );
+  if( policy == NULL )
+    return;
+
+  char *save = NULL;
+  char *rule = strtok_r( policy, ",", &save );
+  while(( rule != NULL ) && ( gCompress_policy._rule_count < DBRDA_COMPRESS_MAX_RULES ))
+  {
+    if( dbrDA_Compress_rule_parse( rule, &gCompress_policy._rules[ gCompress_policy._rule_count ] ) == 0 )
+      ++gCompress_policy._rule_count;
+    else
+      fprintf( stderr, "dbrda_compress: ignoring invalid policy rule '%s'\n", rule );
+    rule = strtok_r( NULL, ",", &save );
+  }
+  free( policy );
+}
+
+/*
+ * find the rule for a key/size; NULL means store uncompressed
+ */
+static
+const dbrDA_Compress_rule_t* dbrDA_Compress_policy_lookup( const char *key, const int64_t size )
+{
+  pthread_once( &gCompress_policy_once, dbrDA_Compress_policy_init );
+
+  int n;
+  for( n = 0; n < gCompress_policy._rule_count; ++n )
+  {
+    const dbrDA_Compress_rule_t *rule = &gCompress_policy._rules[ n ];
+    if( fnmatch( rule->_pattern, key, 0 ) != 0 )
+      continue;
+    if(( rule->_codec == DBRDA_CODEC_NONE ) || ( size < rule->_threshold ))
+      return NULL;
+    return rule;
+  }
+  return NULL;
+}
+
+
+static
+int64_t dbrDA_Compress_bound( const dbrDA_Codec_t codec, const int64_t size )
+{
+  switch( codec )
+  {
+#ifdef DBRDA_HAVE_LZ4
+    case DBRDA_CODEC_LZ4:
+      if( size > LZ4_MAX_INPUT_SIZE )
+        return -EFBIG;
+      return LZ4_compressBound( (int)size );
+#endif
+#ifdef DBRDA_HAVE_ZSTD
+    case DBRDA_CODEC_ZSTD:
+      return (int64_t)ZSTD_compressBound( (size_t)size );
+#endif
+#ifdef DBRDA_HAVE_ZLIB
+    case DBRDA_CODEC_ZLIB:
+      return (int64_t)compressBound( (uLong)size );
+#endif
+    default:
+      return -ENOTSUP;
+  }
+}
+
+/*
+ * compress src into dst; returns the compressed length or <0 on error
+ */
+static
+int64_t dbrDA_Compress_encode( const dbrDA_Compress_rule_t *rule,
+                               const char *src, const int64_t srclen,
+                               char *dst, const int64_t dstcap )
+{
+  switch( rule->_codec )
+  {
+#ifdef DBRDA_HAVE_LZ4
+    case DBRDA_CODEC_LZ4:
+    {
+      int len = LZ4_compress_default( src, dst, (int)srclen, (int)dstcap );
+      return len > 0 ? len : -EIO;
+    }
+#endif
+#ifdef DBRDA_HAVE_ZSTD
+    case DBRDA_CODEC_ZSTD:
+    {
+      size_t len = ZSTD_compress( dst, (size_t)dstcap, src, (size_t)srclen,
+                                  rule->_level > 0 ? rule->_level : 3 );
+      return ZSTD_isError( len ) ? -EIO : (int64_t)len;
+    }
+#endif
+#ifdef DBRDA_HAVE_ZLIB
+    case DBRDA_CODEC_ZLIB:
+    {
+      uLongf len = (uLongf)dstcap;
+      if( compress2( (Bytef*)dst, &len, (const Bytef*)src, (uLong)srclen,
+                     rule->_level > 0 ? rule->_level : Z_DEFAULT_COMPRESSION ) != Z_OK )
+        return -EIO;
+      return (int64_t)len;
+    }
+#endif
+    default:
+      return -ENOTSUP;
+  }
+}
+
+/*
+ * decompress src into dst; returns the decompressed length or <0 on error
+ */
+static
+int64_t dbrDA_Compress_decode( const dbrDA_Codec_t codec,
+                               const char *src, const int64_t srclen,
+                               char *dst, const int64_t dstcap )
+{
+  switch( codec )
+  {
+#ifdef DBRDA_HAVE_LZ4
+    case DBRDA_CODEC_LZ4:
+    {
+      int len = LZ4_decompress_safe( src, dst, (int)srclen, (int)dstcap );
+      return len >= 0 ? len : -EBADMSG;
+    }
+#endif
+#ifdef DBRDA_HAVE_ZSTD
+    case DBRDA_CODEC_ZSTD:
+    {
+      size_t len = ZSTD_decompress( dst, (size_t)dstcap, src, (size_t)srclen );
+      return ZSTD_isError( len ) ? -EBADMSG : (int64_t)len;
+    }
+#endif
+#ifdef DBRDA_HAVE_ZLIB
+    case DBRDA_CODEC_ZLIB:
+    {
+      uLongf len = (uLongf)dstcap;
+      if( uncompress( (Bytef*)dst, &len, (const Bytef*)src, (uLong)srclen ) != Z_OK )
+        return -EBADMSG;
+      return (int64_t)len;
+    }
+#endif
+    default:
+      return -ENOTSUP;
+  }
+}
+
+
+static
+void dbrDA_Compress_header_write( char *hdr, const dbrDA_Codec_t codec, const uint64_t size )
+{
+  memcpy( hdr, dbrDA_Compress_magic, sizeof( dbrDA_Compress_magic ) );
+  hdr[4] = DBRDA_COMPRESS_VERSION;
+  hdr[5] = (char)codec;
+  hdr[6] = 0;
+  hdr[7] = 0;
+  int i;
+  for( i = 0; i < 8; ++i )
+    hdr[ 8 + i ] = (char)( ( size >> ( 8 * i ) ) & 0xff );
+}
+
+/*
+ * returns the codec of a valid header or -1 if the data has no header
+ */
+static
+int dbrDA_Compress_header_read( const char *hdr, uint64_t *size )
+{
+  if(( memcmp( hdr, dbrDA_Compress_magic, sizeof( dbrDA_Compress_magic ) ) != 0 )
+      || ( hdr[4] != DBRDA_COMPRESS_VERSION )
+      || ( (unsigned char)hdr[5] >= DBRDA_CODEC_MAX ))
+    return -1;
+
+  uint64_t s = 0;
+  int i;
+  for( i = 0; i < 8; ++i )
+    s |= ( (uint64_t)(unsigned char)hdr[ 8 + i ] ) << ( 8 * i );
+  *size = s;
+  return (unsigned char)hdr[5];
+}
+
+
+static
+int64_t dbrDA_Compress_sge_size( const struct iovec *sge, const int count )
+{
+  int64_t total = 0;
+  int n;
+  for( n = 0; n < count; ++n )
+    total += sge[ n ].iov_len;
+  return total;
+}
+
+/*
+ * copy up to len bytes starting at offset of the SGE list into dst
+ */
+static
+int64_t dbrDA_Compress_sge_gather( const struct iovec *sge, const int count,
+                                   int64_t offset, char *dst, int64_t len )
+{
+  int64_t copied = 0;
+  int n;
+  for( n = 0; ( n < count ) && ( len > 0 ); ++n )
+  {
+    int64_t ilen = (int64_t)sge[ n ].iov_len;
+    if( offset >= ilen )
+    {
+      offset -= ilen;
+      continue;
+    }
+    int64_t chunk = ilen - offset < len ? ilen - offset : len;
+    memcpy( dst + copied, (char*)sge[ n ].iov_base + offset, chunk );
+    copied += chunk;
+    len -= chunk;
+    offset = 0;
+  }
+  return copied;
+}
+
+static
+int64_t dbrDA_Compress_sge_scatter( const struct iovec *sge, const int count,
+                                    const char *src, int64_t len )
+{
+  int64_t copied = 0;
+  int n;
+  for( n = 0; ( n < count ) && ( len > 0 ); ++n )
+  {
+    int64_t chunk = (int64_t)sge[ n ].iov_len < len ? (int64_t)sge[ n ].iov_len : len;
+    memmove( sge[ n ].iov_base, src + copied, chunk );
+    copied += chunk;
+    len -= chunk;
+  }
+  return copied;
+}
+
+
+/*
+ * every chain entry created by this adapter has one hidden SGE slot after
+ * the visible ones to track the buffer owned by the adapter (if any)
+ */
+#define dbrDA_Compress_owned( req ) ( (req)->_value_sge[ (req)->_sge_count ].iov_base )
+
+static
+dbrDA_Request_chain_t* dbrDA_Compress_entry_create( const dbrDA_Request_chain_t *input, const int sge_count )
+{
+  dbrDA_Request_chain_t *entry = (dbrDA_Request_chain_t*)calloc( 1, sizeof( dbrDA_Request_chain_t ) + ( sge_count + 1 ) * sizeof( struct iovec ) );
+  if( entry == NULL )
+    return NULL;
+  entry->_key = input->_key;
+  entry->_size = input->_size;
+  entry->_ret_size = &entry->_size;
+  entry->_sge_count = sge_count;
+  return entry;
+}
+
+static
+void dbrDA_Compress_chain_destroy( dbrDA_Request_chain_t *custom )
+{
+  while( custom != NULL )
+  {
+    dbrDA_Request_chain_t *next = custom->_next;
+    free( dbrDA_Compress_owned( custom ) );
+    memset( custom, 0, sizeof( dbrDA_Request_chain_t) + ( custom->_sge_count + 1 ) * sizeof( struct iovec ) );
+    free( custom );
+    custom = next;
+  }
+}
+
+
+/*
+ * try to create a compressed version of the input request
+ * returns NULL if the policy or the data doesn't make compression worthwhile
+ */
+static
+dbrDA_Request_chain_t* dbrDA_Compress_entry_compress( const dbrDA_Request_chain_t *input,
+                                                      const int64_t total )
+{
+  if(( input->_sge_count == 0 ) || ( total == 0 ))
+    return NULL;
+
+  const dbrDA_Compress_rule_t *rule = dbrDA_Compress_policy_lookup( input->_key, total );
+  if( rule == NULL )
+    return NULL;
+
+  int64_t bound = dbrDA_Compress_bound( rule->_codec, total );
+  if( bound < 0 )
+    return NULL;
+
+  // the codecs need contiguous input; only gather if the user data is scattered
+  char *gathered = NULL;
+  const char *src = (const char*)input->_value_sge[0].iov_base;
+  if( input->_sge_count > 1 )
+  {
+    gathered = (char*)malloc( total );
+    if( gathered == NULL )
+      return NULL;
+    dbrDA_Compress_sge_gather( input->_value_sge, input->_sge_count, 0, gathered, total );
+    src = gathered;
+  }
+
+  dbrDA_Request_chain_t *entry = NULL;
+  char *dst = (char*)malloc( DBRDA_COMPRESS_HEADER_LEN + bound );
+  if( dst == NULL )
+    goto exit_compress;
+
+  int64_t clen = dbrDA_Compress_encode( rule, src, total, dst + DBRDA_COMPRESS_HEADER_LEN, bound );
+  if(( clen < 0 ) || ( clen + DBRDA_COMPRESS_HEADER_LEN >= total ))
+    goto exit_compress;
+
+  entry = dbrDA_Compress_entry_create( input, 1 );
+  if( entry == NULL )
+    goto exit_compress;
+
+  dbrDA_Compress_header_write( dst, rule->_codec, (uint64_t)total );
+  entry->_value_sge[0].iov_base = dst;
+  entry->_value_sge[0].iov_len = clen + DBRDA_COMPRESS_HEADER_LEN;
+  dbrDA_Compress_owned( entry ) = dst;
+  dst = NULL;
+
+exit_compress:
+  free( dst );
+  free( gathered );
+  return entry;
+}
+
+/*
+ * wrap the user data without copying;
+ * data that would be mistaken for a header gets an explicit codec=none header
+ */
+static
+dbrDA_Request_chain_t* dbrDA_Compress_entry_plain( const dbrDA_Request_chain_t *input,
+                                                   const int64_t total )
+{
+  char peek[ sizeof( dbrDA_Compress_magic ) ];
+  int needs_header = (( total >= (int64_t)sizeof( peek ) )
+      && ( dbrDA_Compress_sge_gather( input->_value_sge, input->_sge_count, 0, peek, sizeof( peek ) ) == sizeof( peek ) )
+      && ( memcmp( peek, dbrDA_Compress_magic, sizeof( peek ) ) == 0 ));
+
+  dbrDA_Request_chain_t *entry = dbrDA_Compress_entry_create( input, input->_sge_count + needs_header );
+  if( entry == NULL )
+    return NULL;
+
+  if( needs_header )
+  {
+    char *hdr = (char*)malloc( DBRDA_COMPRESS_HEADER_LEN );
+    if( hdr == NULL )
+    {
+      dbrDA_Compress_chain_destroy( entry );
+      return NULL;
+    }
+    dbrDA_Compress_header_write( hdr, DBRDA_CODEC_NONE, (uint64_t)total );
+    entry->_value_sge[0].iov_base = hdr;
+    entry->_value_sge[0].iov_len = DBRDA_COMPRESS_HEADER_LEN;
+    dbrDA_Compress_owned( entry ) = hdr;
+  }
+  memcpy( &entry->_value_sge[ needs_header ], input->_value_sge, input->_sge_count * sizeof( struct iovec ) );
+  return entry;
+}
+
+
+dbrDA_Handle_t dbrDA_Compress_Init(void)
+{
+  pthread_once( &gCompress_policy_once, dbrDA_Compress_policy_init );
+  return NULL;
+}
+
+int dbrDA_Compress_Exit( dbrDA_Handle_t da )
+{
+  return 0;
+}
+
+dbrDA_Request_chain_t* dbrDA_Compress_prewrite( dbrDA_Request_chain_t *input_req )
+{
+  dbrDA_Request_chain_t *custom = NULL;
+  dbrDA_Request_chain_t *prev = NULL;
+  while( input_req != NULL )
+  {
+    int64_t total = dbrDA_Compress_sge_size( input_req->_value_sge, input_req->_sge_count );
+
+    dbrDA_Request_chain_t *tail = dbrDA_Compress_entry_compress( input_req, total );
+    if( tail == NULL )
+      tail = dbrDA_Compress_entry_plain( input_req, total );
+    if( tail == NULL )
+    {
+      dbrDA_Compress_chain_destroy( custom );
+      return NULL;
+    }
+
+    if( prev == NULL )
+      custom = tail;
+    else
+      prev->_next = tail;
+    prev = tail;
+    input_req = input_req->_next;
+  }
+  return custom;
+}
+
+/*
+ * compressed values are always smaller than the original data, but plain
+ * values that got a codec=none header are 16 bytes larger than what the user
+ * expects to read back. Reads therefore go directly into the user SGEs plus
+ * one adapter-owned SGE of header size that takes any overflow.
+ */
+dbrDA_Request_chain_t* dbrDA_Compress_preread( dbrDA_Request_chain_t *input_req )
+{
+  dbrDA_Request_chain_t *custom = NULL;
+  dbrDA_Request_chain_t *prev = NULL;
+  while( input_req != NULL )
+  {
+    char *overflow = (char*)malloc( DBRDA_COMPRESS_HEADER_LEN );
+    dbrDA_Request_chain_t *tail = NULL;
+    if( overflow != NULL )
+      tail = dbrDA_Compress_entry_create( input_req, input_req->_sge_count + 1 );
+    if( tail == NULL )
+    {
+      free( overflow );
+      dbrDA_Compress_chain_destroy( custom );
+      return NULL;
+    }
+    memcpy( tail->_value_sge, input_req->_value_sge, input_req->_sge_count * sizeof( struct iovec ) );
+    tail->_value_sge[ input_req->_sge_count ].iov_base = overflow;
+    tail->_value_sge[ input_req->_sge_count ].iov_len = DBRDA_COMPRESS_HEADER_LEN;
+    dbrDA_Compress_owned( tail ) = overflow;
+
+    if( prev == NULL )
+      custom = tail;
+    else
+      prev->_next = tail;
+    prev = tail;
+    input_req = input_req->_next;
+  }
+  return custom;
+}
+
+DBR_Errorcode_t dbrDA_Compress_postwrite( dbrDA_Request_chain_t* custom,
+                                          DBR_Errorcode_t rc )
+{
+  dbrDA_Compress_chain_destroy( custom );
+  return rc;
+}
+
+/*
+ * decode the data that was received into the SGEs of entry (the user SGEs
+ * plus the overflow SGE) and place the result in the user SGEs of input
+ * returns the size of the user data or <0 on error
+ */
+static
+int64_t dbrDA_Compress_entry_decompress( dbrDA_Request_chain_t *entry,
+                                         dbrDA_Request_chain_t *input,
+                                         const int64_t received )
+{
+  int64_t capacity = dbrDA_Compress_sge_size( input->_value_sge, input->_sge_count );
+
+  char hdr[ DBRDA_COMPRESS_HEADER_LEN ];
+  uint64_t orig_size = 0;
+  int codec = -1;
+  if(( received >= DBRDA_COMPRESS_HEADER_LEN )
+      && ( dbrDA_Compress_sge_gather( entry->_value_sge, entry->_sge_count, 0, hdr, DBRDA_COMPRESS_HEADER_LEN ) == DBRDA_COMPRESS_HEADER_LEN ))
+    codec = dbrDA_Compress_header_read( hdr, &orig_size );
+
+  // plain data written without (or before) compression
+  if( codec < 0 )
+    return ( received > capacity ) ? -ENOSPC : received;
+
+  int64_t payload_len = received - DBRDA_COMPRESS_HEADER_LEN;
+  if( (int64_t)orig_size > capacity )
+    return -ENOSPC;
+
+  // the payload and its decompressed result overlap in the user buffer; copy it out
+  char *payload = (char*)malloc( payload_len > 0 ? payload_len : 1 );
+  if( payload == NULL )
+    return -ENOMEM;
+  dbrDA_Compress_sge_gather( entry->_value_sge, entry->_sge_count, DBRDA_COMPRESS_HEADER_LEN, payload, payload_len );
+
+  int64_t len;
+  if( codec == DBRDA_CODEC_NONE )
+    len = dbrDA_Compress_sge_scatter( input->_value_sge, input->_sge_count, payload, payload_len );
+  else if( input->_sge_count == 1 )
+    len = dbrDA_Compress_decode( codec, payload, payload_len, (char*)input->_value_sge[0].iov_base, orig_size );
+  else
+  {
+    char *plain = (char*)malloc( orig_size > 0 ? orig_size : 1 );
+    len = -ENOMEM;
+    if( plain != NULL )
+    {
+      len = dbrDA_Compress_decode( codec, payload, payload_len, plain, orig_size );
+      if( len >= 0 )
+        dbrDA_Compress_sge_scatter( input->_value_sge, input->_sge_count, plain, len );
+      free( plain );
+    }
+  }
+  free( payload );
+
+  if(( len >= 0 ) && ( (uint64_t)len != orig_size ))
+    return -EBADMSG;
+  return len;
+}
+
+DBR_Errorcode_t dbrDA_Compress_postread( dbrDA_Request_chain_t* custom,
+                                         dbrDA_Request_chain_t* input,
+                                         DBR_Errorcode_t rc )
+{
+  dbrDA_Request_chain_t *entry = custom;
+  while(( entry != NULL ) && ( input != NULL ))
+  {
+    if( rc == DBR_SUCCESS )
+    {
+      int64_t len = dbrDA_Compress_entry_decompress( entry, input, entry->_size );
+      if( len >= 0 )
+        input->_size = len;
+      else
+      {
+        input->_size = 0;
+        rc = ( len == -ENOSPC ) ? DBR_ERR_UBUFFER : DBR_ERR_PLUGIN;
+      }
+    }
+    else
+      input->_size = entry->_size;
+
+    if( input->_ret_size != NULL )
+      *input->_ret_size = input->_size;
+
+    entry = entry->_next;
+    input = input->_next;
+  }
+
+  dbrDA_Compress_chain_destroy( custom );
+  return rc;
+}
+
+DBR_Errorcode_t dbrDA_Compress_error_handler( dbrDA_Request_chain_t *custom,
+                                              dbrDA_Operation_t op,
+                                              DBR_Errorcode_t rc )
+{
+  dbrDA_Compress_chain_destroy( custom );
+  return rc;
+}
+
+dbrDA_api_t dbrDA =
+  {
+    .initialize = dbrDA_Compress_Init,
+    .exit = dbrDA_Compress_Exit,
+    .pre_write = dbrDA_Compress_prewrite,
+    .pre_read = dbrDA_Compress_preread,
+    .post_write = dbrDA_Compress_postwrite,
+    .post_read = dbrDA_Compress_postread,
+    .error_handler = dbrDA_Compress_error_handler
+  };
@@ -0,0 +1,226 @@
+/*
+ * Copyright © 2020 IBM Corporation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+/*
+ * round-trip test of the compression adapter without a backend:
+ * the 'stored' value is the flattened SGE list returned by pre_write
+ * and the 'read' is simulated by copying it into the SGEs from pre_read
+ */
+
+#include <libdatabroker.h>
+#include <dbrda_api.h>
+
+#include "test_utils.h"
+
+#define COMPRESS_TEST_SIZE ( 256 * 1024 )
+
+static
+dbrDA_Request_chain_t* create_request( char *key, char *buf, int64_t len, int sges, int64_t *ret_size )
+{
+  dbrDA_Request_chain_t *req = (dbrDA_Request_chain_t*)calloc( 1, sizeof( dbrDA_Request_chain_t ) + sges * sizeof( struct iovec ) );
+  req->_key = key;
+  req->_size = len;
+  req->_ret_size = ret_size;
+  req->_sge_count = sges;
+  int n;
+  for( n = 0; n < sges; ++n )
+  {
+    req->_value_sge[ n ].iov_base = buf + n * ( len / sges );
+    req->_value_sge[ n ].iov_len = ( n == sges - 1 ) ? len - n * ( len / sges ) : len / sges;
+  }
+  return req;
+}
+
+static
+int64_t store( dbrDA_Request_chain_t *chain, char *storage )
+{
+  int64_t len = 0;
+  int n;
+  for( n = 0; n < chain->_sge_count; ++n )
+  {
+    memcpy( storage + len, chain->_value_sge[ n ].iov_base, chain->_value_sge[ n ].iov_len );
+    len += chain->_value_sge[ n ].iov_len;
+  }
+  return len;
+}
+
+/*
+ * simulates the backend: values that don't fit the SGEs are rejected
+ */
+static
+DBR_Errorcode_t retrieve( dbrDA_Request_chain_t *chain, char *storage, int64_t len )
+{
+  int64_t pos = 0;
+  int n;
+  for( n = 0; ( n < chain->_sge_count ) && ( pos < len ); ++n )
+  {
+    int64_t chunk = (int64_t)chain->_value_sge[ n ].iov_len < len - pos ? (int64_t)chain->_value_sge[ n ].iov_len : len - pos;
+    memcpy( chain->_value_sge[ n ].iov_base, storage + pos, chunk );
+    pos += chunk;
+  }
+  *chain->_ret_size = len;
+  return ( pos < len ) ? DBR_ERR_UBUFFER : DBR_SUCCESS;
+}
+
+// header of the most recently stored value
+static char last_header[ 16 ];
+
+/*
+ * put and read one value through the adapter into an exact-size buffer
+ * returns 0 if the data came back unmodified, stored size in *stored
+ */
+static
+int roundtrip( char *key, char *data, int64_t len, int sges, int64_t *stored )
+{
+  int rc = 0;
+  int64_t ret_size = 0;
+  char *storage = (char*)calloc( 1, len + 1024 );
+  char *out = (char*)calloc( 1, len + 1 );
+
+  dbrDA_Request_chain_t *wreq = create_request( key, data, len, sges, &ret_size );
+  dbrDA_Request_chain_t *wchain = NULL;
+  rc += TEST_NOT_RC( dbrDA.pre_write( wreq ), NULL, wchain );
+  if( wchain == NULL )
+    return 1;
+  rc += TEST( wchain->_next, NULL );
+  *stored = store( wchain, storage );
+  memcpy( last_header, storage, sizeof( last_header ) );
+  rc += TEST( dbrDA.post_write( wchain, DBR_SUCCESS ), DBR_SUCCESS );
+
+  dbrDA_Request_chain_t *rreq = create_request( key, out, len, sges, &ret_size );
+  dbrDA_Request_chain_t *rchain = NULL;
+  rc += TEST_NOT_RC( dbrDA.pre_read( rreq ), NULL, rchain );
+  if( rchain == NULL )
+    return 1;
+  rc += TEST( retrieve( rchain, storage, *stored ), DBR_SUCCESS );
+  rc += TEST( dbrDA.post_read( rchain, rreq, DBR_SUCCESS ), DBR_SUCCESS );
+  rc += TEST( rreq->_size, len );
+  rc += TEST( ret_size, len );
+  rc += TEST( memcmp( data, out, len ), 0 );
+
+  // one byte short must not fit, whether or not there's a header
+  if( len > 1 )
+  {
+    dbrDA_Request_chain_t *sreq = create_request( key, out, len - 1, 1, &ret_size );
+    rc += TEST_NOT_RC( dbrDA.pre_read( sreq ), NULL, rchain );
+    if( rchain == NULL )
+      return 1;
+    DBR_Errorcode_t be_rc = retrieve( rchain, storage, *stored );
+    rc += TEST( dbrDA.post_read( rchain, sreq, be_rc ), DBR_ERR_UBUFFER );
+    free( sreq );
+  }
+
+  free( rreq );
+  free( wreq );
+  free( out );
+  free( storage );
+  return rc;
+}
+
+/*
+ * check that a compressible value is stored with the expected codec
+ */
+static
+int codec_roundtrip( char *key, char *data, int64_t len, int expected )
+{
+  int64_t stored = 0;
+  int rc = roundtrip( key, data, len, 1, &stored );
+  rc += TEST( stored < len / 2, 1 );
+  rc += TEST( memcmp( last_header, "DBRZ", 4 ), 0 );
+  if( expected >= 0 )
+    rc += TEST( last_header[5], expected );
+  else
+    rc += TEST_NOT( last_header[5], 0 );
+  return rc;
+}
+
+int main( int argc, char **argv )
+{
+  int rc = 0;
+  setenv( "DBR_COMPRESS_POLICY", "raw_*=none,small_*=zstd@100000,lz4_*=lz4,zstd_*=zstd:5,zlib_*=zlib:9,*=lz4@1024", 1 );
+
+  char *compressible = (char*)calloc( 1, COMPRESS_TEST_SIZE );
+  int64_t i;
+  for( i = 0; i < COMPRESS_TEST_SIZE; ++i )
+    compressible[ i ] = (char)( 'a' + ( i / 64 ) % 8 );
+  char *random_data = (char*)malloc( COMPRESS_TEST_SIZE );
+  for( i = 0; i < COMPRESS_TEST_SIZE; ++i )
+    random_data[ i ] = (char)random();
+
+  int64_t stored = 0;
+
+  // compressible data gets compressed, single and scattered SGEs
+  rc += roundtrip( "snapshot", compressible, COMPRESS_TEST_SIZE, 1, &stored );
+  rc += TEST( stored < COMPRESS_TEST_SIZE / 2, 1 );
+  rc += roundtrip( "snapshot", compressible, COMPRESS_TEST_SIZE, 3, &stored );
+  rc += TEST( stored < COMPRESS_TEST_SIZE / 2, 1 );
+
+  // each compiled-in codec is used as requested, the others fall back to an available one
+#ifdef DBRDA_HAVE_LZ4
+  rc += codec_roundtrip( "lz4_snapshot", compressible, COMPRESS_TEST_SIZE, 1 );
+#else
+  rc += codec_roundtrip( "lz4_snapshot", compressible, COMPRESS_TEST_SIZE, -1 );
+#endif
+#ifdef DBRDA_HAVE_ZSTD
+  rc += codec_roundtrip( "zstd_snapshot", compressible, COMPRESS_TEST_SIZE, 2 );
+#else
+  rc += codec_roundtrip( "zstd_snapshot", compressible, COMPRESS_TEST_SIZE, -1 );
+#endif
+#ifdef DBRDA_HAVE_ZLIB
+  rc += codec_roundtrip( "zlib_snapshot", compressible, COMPRESS_TEST_SIZE, 3 );
+#else
+  rc += codec_roundtrip( "zlib_snapshot", compressible, COMPRESS_TEST_SIZE, -1 );
+#endif
+
+  // policy: explicit none and threshold not reached
+  rc += roundtrip( "raw_snapshot", compressible, COMPRESS_TEST_SIZE, 1, &stored );
+  rc += TEST( stored, COMPRESS_TEST_SIZE );
+  rc += roundtrip( "small_snapshot", compressible, 4096, 1, &stored );
+  rc += TEST( stored, 4096 );
+  rc += roundtrip( "snapshot", compressible, 512, 2, &stored );
+  rc += TEST( stored, 512 );
+
+  // incompressible data stays uncompressed
+  rc += roundtrip( "random", random_data, COMPRESS_TEST_SIZE, 1, &stored );
+  rc += TEST( stored, COMPRESS_TEST_SIZE );
+
+  // plain data that starts with the header magic needs a codec=none header
+  memcpy( random_data, "DBRZ", 4 );
+  rc += roundtrip( "random", random_data, 8192, 1, &stored );
+  rc += TEST( stored, 8192 + 16 );
+
+  rc += roundtrip( "random", random_data, 8192, 3, &stored );
+  rc += TEST( stored, 8192 + 16 );
+
+  // a value without SGEs is passed through
+  int64_t ret_size = 0;
+  dbrDA_Request_chain_t *ereq = create_request( "empty", NULL, 0, 0, &ret_size );
+  dbrDA_Request_chain_t *echain = NULL;
+  rc += TEST_NOT_RC( dbrDA.pre_write( ereq ), NULL, echain );
+  if( echain != NULL )
+  {
+    rc += TEST( echain->_sge_count, 0 );
+    rc += TEST( dbrDA.post_write( echain, DBR_SUCCESS ), DBR_SUCCESS );
+  }
+  free( ereq );
+
+  free( random_data );
+  free( compressible );
+
+  printf( "Test exiting with rc=%d\n", rc );
+  return rc;
+}
@@ -0,0 +1,618 @@
+/*
+ * Copyright © 2020 IBM Corporation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+/*
+ * Striping data adapter
+ *
+ * Splits values that are larger than one chunk into fixed-size chunks.
+ * Chunk 0 is stored under the original key, chunk i > 0 under <key>#<i>.
+ * The chunk keys hash to different slots, so a chain of chunk requests gets
+ * spread across the shards of a cluster and is transferred in parallel.
+ * Chunks also keep each stored value below the 512MiB limit of a single
+ * Redis bulk string.
+ *
+ * The chunk size is selected per key by DBR_STRIPE_POLICY, a comma-separated
+ * list of rules <key-glob>=<chunk-size>[K|M|G]; the first matching rule
+ * decides (default: "*=64M"). A chunk size of 0 disables striping for
+ * matching keys. Values up to one chunk are stored as they are.
+ * Readers have to use the same policy as writers.
+ *
+ * Each chunk of a striped value starts with a 24-byte header:
+ *
+ *     [0..3] magic "DBRS"  [4] version  [5..7] reserved
+ *     [8..11] chunk index  [12..15] chunk count  [16..23] total value size
+ *
+ * (all little endian). The count in chunk 0 decides how many chunks make up
+ * the value. Unstriped values that happen to start with the magic get a
+ * header with count 1 to keep the format unambiguous.
+ *
+ * A reader can't know the chunk count before chunk 0 arrived, so it requests
+ * as many chunks as fit its buffer. Chunk 0 is read like the user's request
+ * (blocking unless DBR_FLAGS_NOWAIT); the other chunks are read with
+ * DBR_FLAGS_NOWAIT and the ones that don't exist are ignored. Chunk i is read
+ * directly into the user buffer at offset i*<chunk-size>.
+ *
+ * Limitations:
+ *  - only put, get, and read are striped; remove and move only affect
+ *    chunk 0 and directory/iterator list the <key>#<i> chunks as well
+ *  - keys with a {hashtag} keep all chunks in one slot (no parallel transfer)
+ *  - a reader that races with the writer of the same key may find chunk 0
+ *    before the other chunks and fails with DBR_ERR_UNAVAIL
+ */
+
+#include <libdatabroker.h>
+#include <dbrda_api.h>
+
+#include <errno.h> // errno
+#include <stdlib.h> // calloc
+#include <string.h> // memset, strlen
+#include <stdio.h> // snprintf
+#include <fnmatch.h> // fnmatch
+#include <pthread.h> // pthread_once
+
+#define DBRDA_STRIPE_POLICY_ENV ( "DBR_STRIPE_POLICY" )
+#define DBRDA_STRIPE_DEFAULT_POLICY ( "*=64M" )
+#define DBRDA_STRIPE_MAX_RULES ( 32 )
+#define DBRDA_STRIPE_MIN_CHUNK ( 1024ll )
+#define DBRDA_STRIPE_MAX_CHUNK ( 511ll * 1024 * 1024 ) // chunk + header stays below the Redis bulk limit
+#define DBRDA_STRIPE_MAX_COUNT ( 0x7fffffffll )
+#define DBRDA_STRIPE_HEADER_LEN ( 24 )
+#define DBRDA_STRIPE_VERSION ( 2 )
+#define DBRDA_STRIPE_KEY_SUFFIX_LEN ( 12 ) // '#' + up to 10 digits + NUL
+
+static const char dbrDA_Stripe_magic[ 4 ] = { 'D', 'B', 'R', 'S' };
+
+typedef struct
+{
+  char *_pattern;
+  int64_t _chunk;
+} dbrDA_Stripe_rule_t;
+
+typedef struct
+{
+  int _rule_count;
+  dbrDA_Stripe_rule_t _rules[ DBRDA_STRIPE_MAX_RULES ];
+} dbrDA_Stripe_policy_t;
+
+typedef struct
+{
+  int _index;
+  int _count;
+  uint64_t _total;
+} dbrDA_Stripe_header_t;
+
+static dbrDA_Stripe_policy_t gStripe_policy;
+static pthread_once_t gStripe_policy_once = PTHREAD_ONCE_INIT;
+
+
+/*
+ * parse a size with optional K/M/G suffix; returns <0 if invalid
+ */
+static
+int64_t dbrDA_Stripe_size_parse( const char *str )
+{
+  char *end = NULL;
+  long long size = strtoll( str, &end, 10 );
+  if(( end == str ) || ( size < 0 ))
+    return -1;
+  switch( *end )
+  {
+    case 'G': case 'g': size *= 1024; // fall through
+    case 'M': case 'm': size *= 1024; // fall through
+    case 'K': case 'k': size *= 1024; ++end; break;
+    default: break;
+  }
+  return ( *end == '\0' ) ? size : -1;
+}
+
+static
+void dbrDA_Stripe_policy_init( void )
+{
+  const char *env = getenv( DBRDA_STRIPE_POLICY_ENV );
+  if(( env == NULL ) || ( env[0] == '\0' ))
+    env = DBRDA_STRIPE_DEFAULT_POLICY;
+
+  char *policy = strdup( env );
+  if( policy == NULL )
+    return;
+
+  char *save = NULL;
+  char *rule = strtok_r( policy, ",", &save );
+  while(( rule != NULL ) && ( gStripe_policy._rule_count < DBRDA_STRIPE_MAX_RULES ))
+  {
+    char *chunk = strrchr( rule, '=' );
+    int64_t c = -1;
+    if(( chunk != NULL ) && ( chunk != rule ))
+    {
+      *chunk++ = '\0';
+      c = dbrDA_Stripe_size_parse( chunk );
+    }
+    if(( c < 0 ) || (( c > 0 ) && ( c < DBRDA_STRIPE_MIN_CHUNK )) || ( c > DBRDA_STRIPE_MAX_CHUNK ))
+      fprintf( stderr, "dbrda_stripe: ignoring invalid policy rule '%s' (chunk size 0 or %lld..%lld)\n",
+               rule, DBRDA_STRIPE_MIN_CHUNK, DBRDA_STRIPE_MAX_CHUNK );
+    else
+    {
+      dbrDA_Stripe_rule_t *r = &gStripe_policy._rules[ gStripe_policy._rule_count ];
+      r->_pattern = strdup( rule );
+      r->_chunk = c;
+      if( r->_pattern != NULL )
+        ++gStripe_policy._rule_count;
+    }
+    rule = strtok_r( NULL, ",", &save );
+  }
+  free( policy );
+}
+
+/*
+ * return the chunk size for a key (0 == not striped)
+ */
+static
+int64_t dbrDA_Stripe_chunk( const char *key )
+{
+  pthread_once( &gStripe_policy_once, dbrDA_Stripe_policy_init );
+
+  int n;
+  for( n = 0; n < gStripe_policy._rule_count; ++n )
+    if( fnmatch( gStripe_policy._rules[ n ]._pattern, key, 0 ) == 0 )
+      return gStripe_policy._rules[ n ]._chunk;
+  return 0;
+}
+
+/*
+ * number of chunks for size bytes (at least 1)
+ */
+static inline
+int64_t dbrDA_Stripe_count( const int64_t size, const int64_t chunk )
+{
+  return size > chunk ? ( size + chunk - 1 ) / chunk : 1;
+}
+
+
+static
+void dbrDA_Stripe_put32( char *dst, const uint32_t val )
+{
+  int i;
+  for( i = 0; i < 4; ++i )
+    dst[ i ] = (char)( ( val >> ( 8 * i ) ) & 0xff );
+}
+
+static
+uint32_t dbrDA_Stripe_get32( const char *src )
+{
+  uint32_t val = 0;
+  int i;
+  for( i = 0; i < 4; ++i )
+    val |= ( (uint32_t)(unsigned char)src[ i ] ) << ( 8 * i );
+  return val;
+}
+
+static
+void dbrDA_Stripe_header_write( char *hdr, const int index, const int count, const uint64_t total )
+{
+  memcpy( hdr, dbrDA_Stripe_magic, sizeof( dbrDA_Stripe_magic ) );
+  hdr[4] = DBRDA_STRIPE_VERSION;
+  hdr[5] = hdr[6] = hdr[7] = 0;
+  dbrDA_Stripe_put32( hdr + 8, (uint32_t)index );
+  dbrDA_Stripe_put32( hdr + 12, (uint32_t)count );
+  dbrDA_Stripe_put32( hdr + 16, (uint32_t)( total & 0xffffffff ) );
+  dbrDA_Stripe_put32( hdr + 20, (uint32_t)( total >> 32 ) );
+}
+
+/*
+ * returns 0 and fills h if hdr is a valid header, -1 otherwise
+ */
+static
+int dbrDA_Stripe_header_read( const char *hdr, dbrDA_Stripe_header_t *h )
+{
+  if(( memcmp( hdr, dbrDA_Stripe_magic, sizeof( dbrDA_Stripe_magic ) ) != 0 )
+      || ( hdr[4] != DBRDA_STRIPE_VERSION ))
+    return -1;
+
+  h->_index = (int)dbrDA_Stripe_get32( hdr + 8 );
+  h->_count = (int)dbrDA_Stripe_get32( hdr + 12 );
+  h->_total = (uint64_t)dbrDA_Stripe_get32( hdr + 16 ) | ( (uint64_t)dbrDA_Stripe_get32( hdr + 20 ) << 32 );
+  if(( h->_index < 0 ) || ( h->_count < 1 ) || ( h->_index >= h->_count ))
+    return -1;
+  return 0;
+}
+
+
+static
+int64_t dbrDA_Stripe_sge_size( const struct iovec *sge, const int count )
+{
+  int64_t total = 0;
+  int n;
+  for( n = 0; n < count; ++n )
+    total += sge[ n ].iov_len;
+  return total;
+}
+
+/*
+ * describe the byte range [offset, offset+len) of an SGE list with a new SGE list
+ * returns the number of created SGEs (at most max_out)
+ */
+static
+int dbrDA_Stripe_sge_slice( const struct iovec *sge, const int count,
+                            int64_t offset, int64_t len,
+                            struct iovec *out, const int max_out )
+{
+  int created = 0;
+  int n;
+  for( n = 0; ( n < count ) && ( len > 0 ) && ( created < max_out ); ++n )
+  {
+    int64_t ilen = (int64_t)sge[ n ].iov_len;
+    if( offset >= ilen )
+    {
+      offset -= ilen;
+      continue;
+    }
+    int64_t chunk = ilen - offset < len ? ilen - offset : len;
+    out[ created ].iov_base = (char*)sge[ n ].iov_base + offset;
+    out[ created ].iov_len = chunk;
+    ++created;
+    len -= chunk;
+    offset = 0;
+  }
+  return created;
+}
+
+/*
+ * copy len bytes between buf and the byte range at offset of an SGE list
+ */
+static
+void dbrDA_Stripe_sge_copy( const struct iovec *sge, const int count, const int64_t offset,
+                            char *buf, int64_t len, const int to_sge )
+{
+  struct iovec slice[ count > 0 ? count : 1 ];
+  int n = dbrDA_Stripe_sge_slice( sge, count, offset, len, slice, count );
+  int i;
+  for( i = 0; i < n; ++i )
+  {
+    if( to_sge )
+      memcpy( slice[ i ].iov_base, buf, slice[ i ].iov_len );
+    else
+      memcpy( buf, slice[ i ].iov_base, slice[ i ].iov_len );
+    buf += slice[ i ].iov_len;
+  }
+}
+
+
+/*
+ * a chunk entry holds its header and key in the same allocation:
+ * [ chain entry | (1 + sge_count) iovecs | header | key ]
+ * _value_sge[0] always points to the header
+ */
+static
+dbrDA_Request_chain_t* dbrDA_Stripe_entry_create( const char *key, const int index,
+                                                  const struct iovec *sge, const int sge_count,
+                                                  const int64_t offset, const int64_t len )
+{
+  size_t keylen = strlen( key ) + DBRDA_STRIPE_KEY_SUFFIX_LEN;
+  size_t sge_space = ( 1 + sge_count ) * sizeof( struct iovec );
+  dbrDA_Request_chain_t *entry = (dbrDA_Request_chain_t*)calloc( 1, sizeof( dbrDA_Request_chain_t ) + sge_space + DBRDA_STRIPE_HEADER_LEN + keylen );
+  if( entry == NULL )
+    return NULL;
+
+  char *hdr = (char*)entry + sizeof( dbrDA_Request_chain_t ) + sge_space;
+  entry->_key = hdr + DBRDA_STRIPE_HEADER_LEN;
+  if( index == 0 )
+    snprintf( entry->_key, keylen, "%s", key );
+  else
+    snprintf( entry->_key, keylen, "%s#%d", key, index );
+
+  entry->_value_sge[0].iov_base = hdr;
+  entry->_value_sge[0].iov_len = DBRDA_STRIPE_HEADER_LEN;
+  entry->_sge_count = 1 + dbrDA_Stripe_sge_slice( sge, sge_count, offset, len, &entry->_value_sge[1], sge_count );
+  entry->_size = dbrDA_Stripe_sge_size( entry->_value_sge, entry->_sge_count );
+  entry->_ret_size = &entry->_size;
+  return entry;
+}
+
+/*
+ * non-striped keys are forwarded as a plain copy of the input entry
+ * to keep the ownership of all chain entries with the adapter
+ */
+static
+dbrDA_Request_chain_t* dbrDA_Stripe_entry_copy( const dbrDA_Request_chain_t *input )
+{
+  dbrDA_Request_chain_t *entry = (dbrDA_Request_chain_t*)calloc( 1, sizeof( dbrDA_Request_chain_t ) + input->_sge_count * sizeof( struct iovec ) );
+  if( entry == NULL )
+    return NULL;
+  entry->_key = input->_key;
+  entry->_size = input->_size;
+  entry->_ret_size = &entry->_size;
+  entry->_sge_count = input->_sge_count;
+  memcpy( entry->_value_sge, input->_value_sge, input->_sge_count * sizeof( struct iovec ) );
+  return entry;
+}
+
+static
+void dbrDA_Stripe_chain_destroy( dbrDA_Request_chain_t *custom )
+{
+  while( custom != NULL )
+  {
+    dbrDA_Request_chain_t *next = custom->_next;
+    memset( custom, 0, sizeof( dbrDA_Request_chain_t ) );
+    free( custom );
+    custom = next;
+  }
+}
+
+/*
+ * create the chunk requests of one input request
+ * chunk i covers [i*chunk, (i+1)*chunk) of the input SGEs
+ * chunk 0 goes last: writers store it after the others and readers see
+ * the completion status of the blocking chunk 0 read as the chain status
+ */
+static
+dbrDA_Request_chain_t* dbrDA_Stripe_split( dbrDA_Request_chain_t *input,
+                                           const int64_t chunk,
+                                           const int writing,
+                                           dbrDA_Request_chain_t **tail )
+{
+  int64_t size = dbrDA_Stripe_sge_size( input->_value_sge, input->_sge_count );
+  int64_t count = dbrDA_Stripe_count( size, chunk );
+  if( count > DBRDA_STRIPE_MAX_COUNT )
+  {
+    fprintf( stderr, "dbrda_stripe: %s: too many chunks (%lld)\n", input->_key, (long long)count );
+    return NULL;
+  }
+  if(( count > 1 ) && ( snprintf( NULL, 0, "%s#%lld", input->_key, (long long)count - 1 ) > DBR_MAX_KEY_LEN ))
+  {
+    fprintf( stderr, "dbrda_stripe: %s: key too long for chunk suffix\n", input->_key );
+    return NULL;
+  }
+
+  dbrDA_Request_chain_t *head = NULL;
+  int64_t i;
+  for( i = 1; i <= count; ++i )
+  {
+    int index = (int)( i % count );
+    int64_t offset = index * chunk;
+    int64_t len = offset < size ? ( size - offset < chunk ? size - offset : chunk ) : 0;
+    dbrDA_Request_chain_t *entry = dbrDA_Stripe_entry_create( input->_key, index,
+                                                              input->_value_sge, input->_sge_count,
+                                                              offset, len );
+    if( entry == NULL )
+    {
+      dbrDA_Stripe_chain_destroy( head );
+      return NULL;
+    }
+    if( writing )
+      dbrDA_Stripe_header_write( (char*)entry->_value_sge[0].iov_base, index, (int)count, (uint64_t)size );
+    else
+    {
+      entry->_size = -1; // not received
+      if( index != 0 )
+        entry->_flags = DBR_FLAGS_NOWAIT;
+    }
+
+    if( head == NULL )
+      head = entry;
+    else
+      (*tail)->_next = entry;
+    *tail = entry;
+  }
+  return head;
+}
+
+static
+dbrDA_Request_chain_t* dbrDA_Stripe_pre( dbrDA_Request_chain_t *input_req, const int writing )
+{
+  dbrDA_Request_chain_t *custom = NULL;
+  dbrDA_Request_chain_t *tail = NULL;
+  while( input_req != NULL )
+  {
+    dbrDA_Request_chain_t *head;
+    dbrDA_Request_chain_t *last = NULL;
+    int64_t chunk = dbrDA_Stripe_chunk( input_req->_key );
+    if( chunk > 0 )
+      head = dbrDA_Stripe_split( input_req, chunk, writing, &last );
+    else
+    {
+      head = last = dbrDA_Stripe_entry_copy( input_req );
+      if(( head != NULL ) && ! writing )
+        head->_size = -1;
+    }
+
+    if( head == NULL )
+    {
+      dbrDA_Stripe_chain_destroy( custom );
+      return NULL;
+    }
+
+    if( tail == NULL )
+      custom = head;
+    else
+      tail->_next = head;
+    tail = last;
+    input_req = input_req->_next;
+  }
+  return custom;
+}
+
+
+dbrDA_Handle_t dbrDA_Stripe_Init(void)
+{
+  pthread_once( &gStripe_policy_once, dbrDA_Stripe_policy_init );
+  return NULL;
+}
+
+int dbrDA_Stripe_Exit( dbrDA_Handle_t da )
+{
+  return 0;
+}
+
+dbrDA_Request_chain_t* dbrDA_Stripe_prewrite( dbrDA_Request_chain_t *input_req )
+{
+  return dbrDA_Stripe_pre( input_req, 1 );
+}
+
+dbrDA_Request_chain_t* dbrDA_Stripe_preread( dbrDA_Request_chain_t *input_req )
+{
+  return dbrDA_Stripe_pre( input_req, 0 );
+}
+
+DBR_Errorcode_t dbrDA_Stripe_postwrite( dbrDA_Request_chain_t* custom,
+                                        DBR_Errorcode_t rc )
+{
+  dbrDA_Stripe_chain_destroy( custom );
+  return rc;
+}
+
+/*
+ * a value without header that was written without the adapter:
+ * its first bytes went into the header buffer, move them into place
+ */
+static
+int64_t dbrDA_Stripe_assemble_plain( dbrDA_Request_chain_t *input, dbrDA_Request_chain_t *chunk0 )
+{
+  int64_t size = chunk0->_size;
+  if( size > dbrDA_Stripe_sge_size( input->_value_sge, input->_sge_count ) )
+    return -ENOSPC;
+
+  int64_t tail = size > DBRDA_STRIPE_HEADER_LEN ? size - DBRDA_STRIPE_HEADER_LEN : 0;
+  char *tmp = (char*)malloc( tail > 0 ? tail : 1 );
+  if( tmp == NULL )
+    return -ENOMEM;
+  dbrDA_Stripe_sge_copy( input->_value_sge, input->_sge_count, 0, tmp, tail, 0 );
+  dbrDA_Stripe_sge_copy( input->_value_sge, input->_sge_count, DBRDA_STRIPE_HEADER_LEN, tmp, tail, 1 );
+  dbrDA_Stripe_sge_copy( input->_value_sge, input->_sge_count, 0, (char*)chunk0->_value_sge[0].iov_base, size - tail, 1 );
+  free( tmp );
+  return size;
+}
+
+/*
+ * validate the chunks of one input request; the data is already in place
+ * *entry is advanced past the chunks of this request
+ * returns the total size or <0 on error (-EAGAIN: a chunk is missing)
+ */
+static
+int64_t dbrDA_Stripe_assemble( dbrDA_Request_chain_t *input, const int64_t chunk,
+                               dbrDA_Request_chain_t **entry )
+{
+  int64_t capacity = dbrDA_Stripe_sge_size( input->_value_sge, input->_sge_count );
+  int64_t requested = dbrDA_Stripe_count( capacity, chunk );
+
+  // chunks 1..requested-1 followed by chunk 0
+  dbrDA_Request_chain_t *first = *entry;
+  dbrDA_Request_chain_t *chunk0 = first;
+  int64_t i;
+  for( i = 1; ( i < requested ) && ( chunk0 != NULL ); ++i )
+    chunk0 = chunk0->_next;
+  if( chunk0 == NULL )
+  {
+    *entry = NULL;
+    return -EBADMSG;
+  }
+  *entry = chunk0->_next;
+
+  if( chunk0->_size < 0 )
+    return -ENODATA;
+
+  dbrDA_Stripe_header_t h;
+  if(( chunk0->_size < DBRDA_STRIPE_HEADER_LEN )
+      || ( dbrDA_Stripe_header_read( (const char*)chunk0->_value_sge[0].iov_base, &h ) != 0 )
+      || ( h._index != 0 ))
+    return dbrDA_Stripe_assemble_plain( input, chunk0 );
+
+  int64_t total = (int64_t)h._total;
+  if( total > capacity )
+    return -ENOSPC;
+  if(( h._count != dbrDA_Stripe_count( total, chunk ) )
+      || ( chunk0->_size - DBRDA_STRIPE_HEADER_LEN != ( total < chunk ? total : chunk ) ))
+    return -EBADMSG; // written with a different chunk size
+
+  dbrDA_Request_chain_t *stripe = first;
+  for( i = 1; i < h._count; ++i, stripe = stripe->_next )
+  {
+    if( stripe->_size < 0 )
+      return -EAGAIN;
+
+    dbrDA_Stripe_header_t sh;
+    int64_t offset = i * chunk;
+    int64_t expected = total - offset < chunk ? total - offset : chunk;
+    if(( stripe->_size < DBRDA_STRIPE_HEADER_LEN )
+        || ( dbrDA_Stripe_header_read( (const char*)stripe->_value_sge[0].iov_base, &sh ) != 0 )
+        || ( sh._index != i ) || ( sh._count != h._count ) || ( sh._total != h._total )
+        || ( stripe->_size - DBRDA_STRIPE_HEADER_LEN != expected ))
+      return -EBADMSG;
+  }
+  return total;
+}
+
+/*
+ * rc is the combined status of all chunk requests and includes the
+ * DBR_ERR_UNAVAIL of chunks beyond the end of the value; the status of each
+ * request is therefore derived from the chunks themselves
+ */
+DBR_Errorcode_t dbrDA_Stripe_postread( dbrDA_Request_chain_t* custom,
+                                       dbrDA_Request_chain_t* input,
+                                       DBR_Errorcode_t rc )
+{
+  DBR_Errorcode_t ret = DBR_SUCCESS;
+  dbrDA_Request_chain_t *entry = custom;
+  while(( entry != NULL ) && ( input != NULL ))
+  {
+    int64_t chunk = dbrDA_Stripe_chunk( input->_key );
+    int64_t len;
+    if( chunk > 0 )
+      len = dbrDA_Stripe_assemble( input, chunk, &entry );
+    else
+    {
+      len = ( entry->_size >= 0 ) ? entry->_size : -ENODATA;
+      entry = entry->_next;
+    }
+
+    switch( len )
+    {
+      case -ENODATA: ret = ( rc != DBR_SUCCESS ) ? rc : DBR_ERR_UNAVAIL; break;
+      case -EAGAIN: ret = DBR_ERR_UNAVAIL; break;
+      case -ENOSPC: ret = DBR_ERR_UBUFFER; break;
+      default:
+        if( len < 0 )
+          ret = DBR_ERR_PLUGIN;
+        break;
+    }
+    input->_size = len < 0 ? 0 : len;
+    if( input->_ret_size != NULL )
+      *input->_ret_size = input->_size;
+    input = input->_next;
+  }
+
+  dbrDA_Stripe_chain_destroy( custom );
+  return ret;
+}
+
+DBR_Errorcode_t dbrDA_Stripe_error_handler( dbrDA_Request_chain_t *custom,
+                                            dbrDA_Operation_t op,
+                                            DBR_Errorcode_t rc )
+{
+  dbrDA_Stripe_chain_destroy( custom );
+  return rc;
+}
+
+dbrDA_api_t dbrDA =
+  {
+    .initialize = dbrDA_Stripe_Init,
+    .exit = dbrDA_Stripe_Exit,
+    .pre_write = dbrDA_Stripe_prewrite,
+    .pre_read = dbrDA_Stripe_preread,
+    .post_write = dbrDA_Stripe_postwrite,
+    .post_read = dbrDA_Stripe_postread,
+    .error_handler = dbrDA_Stripe_error_handler
+  };
@@ -0,0 +1,283 @@
+/*
+ * Copyright © 2020 IBM Corporation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+/*
+ * round-trip test of the striping adapter without a backend:
+ * the request chains are executed against a small in-memory key-value table
+ */
+
+#include <libdatabroker.h>
+#include <dbrda_api.h>
+
+#include "test_utils.h"
+
+#define STRIPE_TEST_SIZE ( 1024 * 1024 + 17 )
+#define STRIPE_TEST_KEYS ( 64 )
+
+typedef struct
+{
+  char *_key;
+  char *_value;
+  int64_t _len;
+} kv_t;
+
+static kv_t table[ STRIPE_TEST_KEYS ];
+
+static
+kv_t* kv_find( const char *key, int create )
+{
+  int n;
+  for( n = 0; n < STRIPE_TEST_KEYS; ++n )
+  {
+    if(( table[ n ]._key != NULL ) && ( strcmp( table[ n ]._key, key ) == 0 ))
+      return &table[ n ];
+    if(( table[ n ]._key == NULL ) && create )
+    {
+      table[ n ]._key = strdup( key );
+      return &table[ n ];
+    }
+  }
+  return NULL;
+}
+
+static
+void kv_clear( void )
+{
+  int n;
+  for( n = 0; n < STRIPE_TEST_KEYS; ++n )
+  {
+    free( table[ n ]._key );
+    free( table[ n ]._value );
+    memset( &table[ n ], 0, sizeof( kv_t ) );
+  }
+}
+
+static
+void kv_remove( const char *key )
+{
+  kv_t *kv = kv_find( key, 0 );
+  if( kv == NULL )
+    return;
+  free( kv->_key );
+  free( kv->_value );
+  memset( kv, 0, sizeof( kv_t ) );
+}
+
+static
+int kv_count( void )
+{
+  int n, c = 0;
+  for( n = 0; n < STRIPE_TEST_KEYS; ++n )
+    c += ( table[ n ]._key != NULL );
+  return c;
+}
+
+static
+void backend_put( dbrDA_Request_chain_t *chain )
+{
+  for( ; chain != NULL; chain = chain->_next )
+  {
+    kv_t *kv = kv_find( chain->_key, 1 );
+    int64_t len = 0;
+    int n;
+    for( n = 0; n < chain->_sge_count; ++n )
+      len += chain->_value_sge[ n ].iov_len;
+    kv->_value = (char*)realloc( kv->_value, len + 1 );
+    kv->_len = 0;
+    for( n = 0; n < chain->_sge_count; ++n )
+    {
+      memcpy( kv->_value + kv->_len, chain->_value_sge[ n ].iov_base, chain->_value_sge[ n ].iov_len );
+      kv->_len += chain->_value_sge[ n ].iov_len;
+    }
+  }
+}
+
+/*
+ * reads with DBR_FLAGS_NOWAIT skip missing keys and report DBR_ERR_UNAVAIL,
+ * without the flag a missing key fails the test (it would block)
+ */
+static
+DBR_Errorcode_t backend_read( dbrDA_Request_chain_t *chain )
+{
+  DBR_Errorcode_t rc = DBR_SUCCESS;
+  for( ; chain != NULL; chain = chain->_next )
+  {
+    kv_t *kv = kv_find( chain->_key, 0 );
+    if( kv == NULL )
+    {
+      if(( chain->_flags & DBR_FLAGS_NOWAIT ) == 0 )
+        return DBR_ERR_TIMEOUT;
+      rc = DBR_ERR_UNAVAIL;
+      continue;
+    }
+    int64_t pos = 0;
+    int n;
+    for( n = 0; ( n < chain->_sge_count ) && ( pos < kv->_len ); ++n )
+    {
+      int64_t chunk = (int64_t)chain->_value_sge[ n ].iov_len < kv->_len - pos ? (int64_t)chain->_value_sge[ n ].iov_len : kv->_len - pos;
+      memcpy( chain->_value_sge[ n ].iov_base, kv->_value + pos, chunk );
+      pos += chunk;
+    }
+    if( pos < kv->_len )
+      return DBR_ERR_UBUFFER;
+    *chain->_ret_size = kv->_len;
+  }
+  return rc;
+}
+
+static
+dbrDA_Request_chain_t* create_request( char *key, char *buf, int64_t len, int sges, int64_t *ret_size )
+{
+  dbrDA_Request_chain_t *req = (dbrDA_Request_chain_t*)calloc( 1, sizeof( dbrDA_Request_chain_t ) + sges * sizeof( struct iovec ) );
+  req->_key = key;
+  req->_size = len;
+  req->_ret_size = ret_size;
+  req->_sge_count = sges;
+  int n;
+  for( n = 0; n < sges; ++n )
+  {
+    req->_value_sge[ n ].iov_base = buf + n * ( len / sges );
+    req->_value_sge[ n ].iov_len = ( n == sges - 1 ) ? len - n * ( len / sges ) : len / sges;
+  }
+  return req;
+}
+
+static
+int roundtrip( char *key, char *data, int64_t len, int64_t space, int sges, int expect_keys )
+{
+  int rc = 0;
+  int64_t ret_size = 0;
+  char *out = (char*)calloc( 1, space );
+  kv_clear();
+
+  dbrDA_Request_chain_t *wreq = create_request( key, data, len, sges, &ret_size );
+  dbrDA_Request_chain_t *wchain = NULL;
+  rc += TEST_NOT_RC( dbrDA.pre_write( wreq ), NULL, wchain );
+  if( wchain == NULL )
+    return 1;
+  backend_put( wchain );
+  rc += TEST( dbrDA.post_write( wchain, DBR_SUCCESS ), DBR_SUCCESS );
+  rc += TEST( kv_count(), expect_keys );
+
+  dbrDA_Request_chain_t *rreq = create_request( key, out, space, sges, &ret_size );
+  dbrDA_Request_chain_t *rchain = NULL;
+  rc += TEST_NOT_RC( dbrDA.pre_read( rreq ), NULL, rchain );
+  if( rchain == NULL )
+    return 1;
+  rc += TEST( dbrDA.post_read( rchain, rreq, backend_read( rchain ) ), DBR_SUCCESS );
+  rc += TEST( rreq->_size, len );
+  rc += TEST( ret_size, len );
+  rc += TEST( memcmp( data, out, len ), 0 );
+
+  free( rreq );
+  free( wreq );
+  free( out );
+  return rc;
+}
+
+int main( int argc, char **argv )
+{
+  int rc = 0;
+  setenv( "DBR_STRIPE_POLICY", "plain*=0,wide*=64K,bad*=100,*=256K", 1 );
+
+  char *data = generateLongMsg( STRIPE_TEST_SIZE );
+
+  // 1MiB+17 in 256KiB chunks: 5 chunks; exact and oversized user buffers, contiguous and scattered
+  rc += roundtrip( "big", data, STRIPE_TEST_SIZE, STRIPE_TEST_SIZE, 1, 5 );
+  rc += roundtrip( "big", data, STRIPE_TEST_SIZE, STRIPE_TEST_SIZE + 4099, 1, 5 );
+  rc += roundtrip( "big", data, STRIPE_TEST_SIZE, 3 * STRIPE_TEST_SIZE, 5, 5 );
+  rc += roundtrip( "wide", data, STRIPE_TEST_SIZE, 2 * STRIPE_TEST_SIZE, 3, 17 );
+
+  // values up to one chunk are stored in a single key; large buffers don't matter
+  rc += roundtrip( "small", data, 1000, STRIPE_TEST_SIZE, 1, 1 );
+  rc += roundtrip( "chunk", data, 256 * 1024, 256 * 1024, 2, 1 );
+  rc += roundtrip( "empty", data, 0, 1024, 1, 1 );
+
+  // not striped; invalid rules are ignored
+  rc += roundtrip( "plain", data, STRIPE_TEST_SIZE, STRIPE_TEST_SIZE, 1, 1 );
+  rc += roundtrip( "bad", data, STRIPE_TEST_SIZE, STRIPE_TEST_SIZE, 1, 5 );
+
+  int64_t ret_size = 0;
+  char *out = (char*)calloc( 1, 2 * STRIPE_TEST_SIZE );
+  dbrDA_Request_chain_t *wreq = create_request( "big", data, STRIPE_TEST_SIZE, 1, &ret_size );
+  dbrDA_Request_chain_t *rreq = create_request( "big", out, STRIPE_TEST_SIZE, 1, &ret_size );
+  dbrDA_Request_chain_t *wchain, *rchain;
+
+  // the chunk count is in the header of chunk 0 which is stored under the plain key
+  kv_clear();
+  wchain = dbrDA.pre_write( wreq );
+  backend_put( wchain );
+  dbrDA.post_write( wchain, DBR_SUCCESS );
+  rc += TEST_NOT( kv_find( "big", 0 ), NULL );
+  rc += TEST_NOT( kv_find( "big#4", 0 ), NULL );
+  rc += TEST( kv_find( "big#5", 0 ), NULL );
+  rc += TEST( memcmp( kv_find( "big", 0 )->_value, "DBRS", 4 ), 0 );
+  rc += TEST( kv_find( "big", 0 )->_value[ 12 ], 5 );
+
+  // a user buffer that is too small
+  dbrDA_Request_chain_t *sreq = create_request( "big", out, STRIPE_TEST_SIZE - 1, 1, &ret_size );
+  rchain = dbrDA.pre_read( sreq );
+  rc += TEST( dbrDA.post_read( rchain, sreq, backend_read( rchain ) ), DBR_ERR_UBUFFER );
+  free( sreq );
+
+  // a missing chunk (e.g. racing with the writer) is reported as unavailable
+  kv_remove( "big#3" );
+  rchain = dbrDA.pre_read( rreq );
+  rc += TEST( dbrDA.post_read( rchain, rreq, backend_read( rchain ) ), DBR_ERR_UNAVAIL );
+
+  // a chunk that wasn't written by the adapter is detected
+  kv_clear();
+  wchain = dbrDA.pre_write( wreq );
+  backend_put( wchain );
+  dbrDA.post_write( wchain, DBR_SUCCESS );
+  memset( kv_find( "big#2", 0 )->_value, 'x', 4 );
+  rchain = dbrDA.pre_read( rreq );
+  rc += TEST( dbrDA.post_read( rchain, rreq, backend_read( rchain ) ), DBR_ERR_PLUGIN );
+
+  // a value written without the adapter is read back unmodified
+  kv_clear();
+  kv_t *kv = kv_find( "big", 1 );
+  kv->_value = strdup( "a value without any header" );
+  kv->_len = strlen( kv->_value );
+  rchain = dbrDA.pre_read( rreq );
+  rc += TEST( dbrDA.post_read( rchain, rreq, backend_read( rchain ) ), DBR_SUCCESS );
+  rc += TEST( ret_size, kv->_len );
+  rc += TEST( memcmp( out, kv->_value, kv->_len ), 0 );
+
+  // keys that leave no room for the chunk suffix are rejected
+  char longkey[ DBR_MAX_KEY_LEN + 1 ];
+  memset( longkey, 'k', DBR_MAX_KEY_LEN - 1 );
+  longkey[ DBR_MAX_KEY_LEN - 1 ] = '\0';
+  dbrDA_Request_chain_t *lreq = create_request( longkey, data, STRIPE_TEST_SIZE, 1, &ret_size );
+  rc += TEST( dbrDA.pre_write( lreq ), NULL );
+  free( lreq );
+
+  // failed requests only clean up
+  rchain = dbrDA.pre_read( rreq );
+  rc += TEST( dbrDA.post_read( rchain, rreq, DBR_ERR_TIMEOUT ), DBR_ERR_TIMEOUT );
+  rchain = dbrDA.pre_read( rreq );
+  rc += TEST( dbrDA.error_handler( rchain, DBRDA_READ, DBR_ERR_UNAVAIL ), DBR_ERR_UNAVAIL );
+
+  free( rreq );
+  free( wreq );
+  free( out );
+  kv_clear();
+  free( data );
+
+  printf( "Test exiting with rc=%d\n", rc );
+  return rc;
+}
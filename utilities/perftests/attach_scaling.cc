@@ -0,0 +1,278 @@
+/*
+ * Copyright © 2020 IBM Corporation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+/*
+ * Attach/detach latency of many clients that share one namespace.
+ *
+ * Forks <clients> processes for each count in the list. Every client connects
+ * with an untimed attach+detach first, so the measurement excludes the library
+ * init (see startup_time for that). Then all clients are released together and
+ * each runs <cycles> of timed dbrAttach()/dbrDetach() of the same namespace.
+ * Reports the distribution of attach and detach times across all clients and
+ * the time until the last client finished its first attach.
+ */
+
+#include <iostream>
+#include <iomanip>
+#include <sstream>
+#include <vector>
+#include <algorithm>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
+
+#include "timing.h"
+#include "commandline.h"
+
+#include "libdatabroker.h"
+
+static const char* TEST_NAMESPACE = "attachscale";
+static const int MAX_CYCLES = 1024;
+
+struct attach_config
+{
+  std::vector<int> _clients = { 1, 16, 64 };
+  int _cycles = 10;
+};
+static attach_config acfg;
+
+struct attach_result
+{
+  double _attach[ MAX_CYCLES ];
+  double _detach[ MAX_CYCLES ];
+  double _first_end;
+  int _rc;
+};
+
+static int
+attach_extraParse( const int opt, dbr::config *cfg )
+{
+  switch( opt )
+  {
+    case 'c': // list of client counts
+    {
+      std::stringstream list( optarg );
+      std::string c;
+      acfg._clients.clear();
+      while( std::getline( list, c, ',' ) )
+        acfg._clients.push_back( std::strtol( c.c_str(), NULL, 10 ) );
+      break;
+    }
+    case 'i':
+      acfg._cycles = std::strtol( optarg, NULL, 10 );
+      break;
+    default:
+      return -1;
+  }
+  return 0;
+}
+
+static inline double
+percentile( const std::vector<double> &sorted, const double p )
+{
+  size_t idx = (size_t)( p * ( sorted.size() - 1 ) + 0.5 );
+  return sorted[ std::min( idx, sorted.size() - 1 ) ];
+}
+
+/*
+ * run a namespace operation in a child process to keep the parent free of library state
+ */
+static int
+run_child( bool create )
+{
+  pid_t pid = fork();
+  if( pid == 0 )
+  {
+    int rc;
+    if( create )
+    {
+      // detach again; a namespace can only be deleted by its last attached client
+      DBR_Handle_t h = dbrCreate( (DBR_Name_t)TEST_NAMESPACE, DBR_PERST_VOLATILE_SIMPLE, DBR_GROUP_LIST_EMPTY );
+      rc = (( h != NULL ) && ( dbrDetach( h ) == DBR_SUCCESS )) ? 0 : 1;
+    }
+    else  // delete requires a local attach
+      rc = (( dbrAttach( (DBR_Name_t)TEST_NAMESPACE ) != NULL ) &&
+          ( dbrDelete( (DBR_Name_t)TEST_NAMESPACE ) == DBR_SUCCESS )) ? 0 : 1;
+    _exit( rc );
+  }
+  int status = 1;
+  if(( pid < 0 ) || ( waitpid( pid, &status, 0 ) != pid ))
+    return -1;
+  return WIFEXITED( status ) ? WEXITSTATUS( status ) : -1;
+}
+
+/*
+ * the results are too large for atomic pipe writes, each client fills its own slot of a shared mapping
+ */
+static void
+client( int ready_fd, int start_fd, attach_result *result )
+{
+  char c = 0;
+  attach_result &res = *result;
+
+  // connect to the cluster outside of the measurement
+  DBR_Handle_t h = dbrAttach( (DBR_Name_t)TEST_NAMESPACE );
+  res._rc = (( h != NULL ) && ( dbrDetach( h ) == DBR_SUCCESS )) ? 0 : 1;
+  if( write( ready_fd, &c, 1 ) != 1 )
+    res._rc = 1;
+  close( ready_fd );
+
+  // released when the parent closes the write end
+  while( read( start_fd, &c, 1 ) > 0 );
+
+  for( int i = 0; ( i < acfg._cycles ) && ( res._rc == 0 ); ++i )
+  {
+    double start = dbr::myTime();
+    h = dbrAttach( (DBR_Name_t)TEST_NAMESPACE );
+    double end = dbr::myTime();
+    res._attach[ i ] = end - start;
+    if( i == 0 )
+      res._first_end = end;
+    if( h == NULL )
+    {
+      res._rc = 1;
+      break;
+    }
+
+    start = dbr::myTime();
+    if( dbrDetach( h ) != DBR_SUCCESS )
+      res._rc = 1;
+    res._detach[ i ] = dbr::myTime() - start;
+  }
+  _exit( res._rc );
+}
+
+int main( int argc, char **argv )
+{
+  std::string extraHelp = "\
+  -c <counts>        comma separated list of client counts to test (1,16,64)\n\
+  -i <cycles>        attach/detach cycles per client (10)\n\
+";
+
+  dbr::config *config = dbr::ParseCommandline( argc, argv, "hc:i:", attach_extraParse, extraHelp, true );
+  if( config == NULL )
+  {
+    std::cerr << "Failed to create configuration." << std::endl;
+    return -1;
+  }
+  if(( acfg._cycles <= 0 ) || ( acfg._cycles > MAX_CYCLES ))
+  {
+    std::cerr << "Invalid settings." << std::endl;
+    return -1;
+  }
+
+  if( run_child( true ) != 0 )
+  {
+    std::cerr << "Failed to create namespace" << std::endl;
+    return -1;
+  }
+
+  std::cout << "# attach scaling: cycles=" << acfg._cycles << std::endl;
+  std::cout << std::setw( 8 ) << "clients"
+      << std::setw( 12 ) << "att-p50[us]"
+      << std::setw( 12 ) << "att-p99[us]"
+      << std::setw( 12 ) << "att-max[us]"
+      << std::setw( 12 ) << "det-p50[us]"
+      << std::setw( 12 ) << "det-p99[us]"
+      << std::setw( 12 ) << "first[ms]"
+      << std::setw( 8 ) << "errors" << std::endl;
+
+  int rc = 0;
+  for( auto clients : acfg._clients )
+  {
+    int ready_pipe[ 2 ], start_pipe[ 2 ];
+    size_t result_size = clients * sizeof( attach_result );
+    attach_result *results = NULL;
+    if( clients > 0 )
+      results = (attach_result*)mmap( NULL, result_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0 );
+    if(( results == NULL ) || ( results == MAP_FAILED ) || ( pipe( ready_pipe ) != 0 ) || ( pipe( start_pipe ) != 0 ))
+    {
+      std::cerr << "Failed to create pipes or result buffer" << std::endl;
+      rc = 1;
+      break;
+    }
+    // clients that failed to start count as errors
+    for( int n = 0; n < clients; ++n )
+      results[ n ]._rc = 1;
+
+    int spawned = 0;
+    for( ; spawned < clients; ++spawned )
+    {
+      pid_t pid = fork();
+      if( pid < 0 )
+        break;
+      if( pid == 0 )
+      {
+        close( ready_pipe[ 0 ] );
+        close( start_pipe[ 1 ] );
+        client( ready_pipe[ 1 ], start_pipe[ 0 ], &results[ spawned ] );
+      }
+    }
+    close( ready_pipe[ 1 ] );
+    close( start_pipe[ 0 ] );
+
+    // wait until all clients are connected, then release them at once
+    char c;
+    while( read( ready_pipe[ 0 ], &c, 1 ) > 0 );
+    close( ready_pipe[ 0 ] );
+    double start = dbr::myTime();
+    close( start_pipe[ 1 ] );
+
+    while( wait( NULL ) > 0 );
+
+    std::vector<double> attach, detach;
+    double last = start;
+    int errors = 0;
+    for( int n = 0; n < clients; ++n )
+    {
+      attach_result &res = results[ n ];
+      if( res._rc != 0 )
+      {
+        ++errors;
+        continue;
+      }
+      attach.insert( attach.end(), res._attach, res._attach + acfg._cycles );
+      detach.insert( detach.end(), res._detach, res._detach + acfg._cycles );
+      last = std::max( last, res._first_end );
+    }
+    munmap( results, result_size );
+
+    std::sort( attach.begin(), attach.end() );
+    std::sort( detach.begin(), detach.end() );
+    std::cout << std::setw( 8 ) << clients << std::fixed << std::setprecision( 1 );
+    if( attach.empty() )
+      std::cout << std::setw( 72 ) << "-";
+    else
+      std::cout << std::setw( 12 ) << percentile( attach, 0.5 )
+          << std::setw( 12 ) << percentile( attach, 0.99 )
+          << std::setw( 12 ) << attach.back()
+          << std::setw( 12 ) << percentile( detach, 0.5 )
+          << std::setw( 12 ) << percentile( detach, 0.99 )
+          << std::setw( 12 ) << ( last - start ) / 1000.;
+    std::cout << std::setw( 8 ) << errors << std::endl;
+    if( errors > 0 )
+      rc = 1;
+  }
+
+  if( run_child( false ) != 0 )
+    std::cerr << "There were errors. You might want to check for remaining data in the databroker." << std::endl;
+
+  delete config;
+  return rc;
+}
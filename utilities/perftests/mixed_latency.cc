@@ -0,0 +1,307 @@
+/*
+ * Copyright © 2020 IBM Corporation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+/*
+ * Latency of small requests that share the nodes with a stream of large values.
+ *
+ * One large value is always in flight (alternating put and get of the same key)
+ * while small reads are timed one at a time. The small keys are spread across
+ * all slots, so with a single connection per node, a small read waits behind
+ * the large transfer whenever it goes to the same node. Each connection count
+ * in the list runs in a separate process with DBR_CONNECTIONS_PER_NODE set
+ * accordingly; the reported p99 shows how much of that head-of-line blocking
+ * is left.
+ */
+
+#include <iostream>
+#include <iomanip>
+#include <sstream>
+#include <vector>
+#include <algorithm>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/wait.h>
+
+#include "timing.h"
+#include "commandline.h"
+
+#include "libdatabroker.h"
+
+static const char* TEST_NAMESPACE = "mixedlat";
+static const int SMALL_KEYS = 64;
+static char match[] = "";
+
+struct mixed_config
+{
+  std::vector<int> _connections = { 1, 4 };
+  size_t _large = 32 * 1024 * 1024;
+};
+static mixed_config mcfg;
+
+struct mixed_result
+{
+  double _p50;
+  double _p99;
+  double _max;
+  size_t _large_ops;
+  int _rc;
+};
+
+static int
+mixed_extraParse( const int opt, dbr::config *cfg )
+{
+  switch( opt )
+  {
+    case 'c': // list of connection counts
+    {
+      std::stringstream list( optarg );
+      std::string c;
+      mcfg._connections.clear();
+      while( std::getline( list, c, ',' ) )
+        mcfg._connections.push_back( std::strtol( c.c_str(), NULL, 10 ) );
+      break;
+    }
+    case 'l':
+      mcfg._large = std::strtol( optarg, NULL, 10 ) * 1024 * 1024;
+      break;
+    default:
+      return -1;
+  }
+  return 0;
+}
+
+static inline double
+percentile( const std::vector<double> &sorted, const double p )
+{
+  size_t idx = (size_t)( p * ( sorted.size() - 1 ) + 0.5 );
+  return sorted[ std::min( idx, sorted.size() - 1 ) ];
+}
+
+/*
+ * keep one large request in flight: put the value, then get it back, repeat
+ */
+static DBR_Errorcode_t
+large_progress( DBR_Handle_t h, DBR_Tag_t *tag, bool *is_put, char *large, mixed_result *res )
+{
+  DBR_Errorcode_t rc = ( *tag != DB_TAG_ERROR ) ? dbrTest( *tag ) : DBR_SUCCESS;
+  if( rc == DBR_ERR_INPROGRESS )
+    return DBR_SUCCESS;
+  if( rc != DBR_SUCCESS )
+    return rc;
+
+  if( *tag != DB_TAG_ERROR )
+    ++res->_large_ops;
+  *is_put = ! *is_put;
+  if( *is_put )
+    *tag = dbrPutA( h, large, mcfg._large, (DBR_Tuple_name_t)"large", DBR_GROUP_EMPTY );
+  else
+  {
+    // the size gets filled in at completion
+    static int64_t size;
+    size = mcfg._large;
+    *tag = dbrGetA( h, large, &size, (DBR_Tuple_name_t)"large", match, DBR_GROUP_EMPTY, DBR_FLAGS_NONE );
+  }
+  return ( *tag != DB_TAG_ERROR ) ? DBR_SUCCESS : DBR_ERR_TAGERROR;
+}
+
+static void
+client( int connections, dbr::config *config, int result_fd )
+{
+  mixed_result res;
+  memset( &res, 0, sizeof( res ) );
+  res._rc = 1;
+
+  std::stringstream c;
+  c << connections;
+  setenv( "DBR_CONNECTIONS_PER_NODE", c.str().c_str(), 1 );
+
+  char *large = (char*)malloc( mcfg._large );
+  char *small = (char*)malloc( config->_datasize );
+  DBR_Handle_t h = dbrAttach( (DBR_Name_t)TEST_NAMESPACE );
+  if(( h != NULL ) && ( large != NULL ) && ( small != NULL ))
+  {
+    memset( large, 'L', mcfg._large );
+    memset( small, 's', config->_datasize );
+
+    int n;
+    res._rc = 0;
+    for( n = 0; ( n < SMALL_KEYS ) && ( res._rc == 0 ); ++n )
+    {
+      std::stringstream key;
+      key << "small" << n;
+      if( dbrPut( h, small, config->_datasize, (DBR_Tuple_name_t)key.str().c_str(), DBR_GROUP_EMPTY ) != DBR_SUCCESS )
+        res._rc = 1;
+    }
+
+    std::vector<double> times;
+    DBR_Tag_t large_tag = DB_TAG_ERROR;
+    bool is_put = false;
+    for( size_t i = 0; ( i < config->_iterations ) && ( res._rc == 0 ); ++i )
+    {
+      std::stringstream key;
+      key << "small" << ( i % SMALL_KEYS );
+      int64_t size = config->_datasize;
+
+      if( large_progress( h, &large_tag, &is_put, large, &res ) != DBR_SUCCESS )
+        res._rc = 1;
+
+      double start = dbr::myTime();
+      DBR_Tag_t tag = dbrReadA( h, small, &size, (DBR_Tuple_name_t)key.str().c_str(), match, DBR_GROUP_EMPTY, DBR_FLAGS_NONE );
+      DBR_Errorcode_t rc = ( tag != DB_TAG_ERROR ) ? DBR_ERR_INPROGRESS : DBR_ERR_TAGERROR;
+      while( rc == DBR_ERR_INPROGRESS )
+      {
+        rc = dbrTest( tag );
+        if( large_progress( h, &large_tag, &is_put, large, &res ) != DBR_SUCCESS )
+          res._rc = 1;
+      }
+      times.push_back( dbr::myTime() - start );
+      if( rc != DBR_SUCCESS )
+        res._rc = 1;
+    }
+
+    // drain the large request; a put leaves its value behind for the next run
+    DBR_Errorcode_t rc = DBR_ERR_INPROGRESS;
+    while(( large_tag != DB_TAG_ERROR ) && ( rc == DBR_ERR_INPROGRESS ))
+      rc = dbrTest( large_tag );
+    if( is_put )
+    {
+      int64_t size = mcfg._large;
+      dbrGet( h, large, &size, (DBR_Tuple_name_t)"large", match, DBR_GROUP_EMPTY, DBR_FLAGS_NONE );
+    }
+    for( n = 0; n < SMALL_KEYS; ++n )
+    {
+      std::stringstream key;
+      key << "small" << n;
+      int64_t size = config->_datasize;
+      dbrGet( h, small, &size, (DBR_Tuple_name_t)key.str().c_str(), match, DBR_GROUP_EMPTY, DBR_FLAGS_NONE );
+    }
+
+    if( ! times.empty() )
+    {
+      std::sort( times.begin(), times.end() );
+      res._p50 = percentile( times, 0.5 );
+      res._p99 = percentile( times, 0.99 );
+      res._max = times.back();
+    }
+    dbrDetach( h );
+  }
+  free( small );
+  free( large );
+  if( write( result_fd, &res, sizeof( res ) ) != sizeof( res ) )
+    res._rc = 1;
+  _exit( res._rc );
+}
+
+/*
+ * run a namespace operation in a child process to keep the parent free of library state
+ */
+static int
+run_child( bool create )
+{
+  pid_t pid = fork();
+  if( pid == 0 )
+  {
+    int rc;
+    if( create )
+    {
+      DBR_Handle_t h = dbrCreate( (DBR_Name_t)TEST_NAMESPACE, DBR_PERST_VOLATILE_SIMPLE, DBR_GROUP_LIST_EMPTY );
+      rc = (( h != NULL ) && ( dbrDetach( h ) == DBR_SUCCESS )) ? 0 : 1;
+    }
+    else
+      rc = (( dbrAttach( (DBR_Name_t)TEST_NAMESPACE ) != NULL ) &&
+          ( dbrDelete( (DBR_Name_t)TEST_NAMESPACE ) == DBR_SUCCESS )) ? 0 : 1;
+    _exit( rc );
+  }
+  int status = 1;
+  if(( pid < 0 ) || ( waitpid( pid, &status, 0 ) != pid ))
+    return -1;
+  return WIFEXITED( status ) ? WEXITSTATUS( status ) : -1;
+}
+
+int main( int argc, char **argv )
+{
+  std::string extraHelp = "\
+  -c <counts>        comma separated list of connections per node to test (1,4)\n\
+  -l <MiB>           size of the large values (32)\n\
+";
+
+  dbr::config *config = dbr::ParseCommandline( argc, argv, "c:d:hl:n:", mixed_extraParse, extraHelp, true );
+  if( config == NULL )
+  {
+    std::cerr << "Failed to create configuration." << std::endl;
+    return -1;
+  }
+  // no warmup iterations here
+  config->_iterations -= 2 * config->_inflight;
+
+  if( run_child( true ) != 0 )
+  {
+    std::cerr << "Failed to create namespace" << std::endl;
+    return -1;
+  }
+
+  std::cout << "# mixed latency: small=" << config->_datasize
+      << " large=" << mcfg._large
+      << " iterations=" << config->_iterations << std::endl;
+  std::cout << std::setw( 6 ) << "conns"
+      << std::setw( 10 ) << "p50[us]"
+      << std::setw( 10 ) << "p99[us]"
+      << std::setw( 10 ) << "max[us]"
+      << std::setw( 8 ) << "large" << std::endl;
+
+  int rc = 0;
+  for( auto c : mcfg._connections )
+  {
+    int result_pipe[ 2 ];
+    if( pipe( result_pipe ) != 0 )
+    {
+      rc = 1;
+      break;
+    }
+    pid_t pid = fork();
+    if( pid == 0 )
+    {
+      close( result_pipe[ 0 ] );
+      client( c, config, result_pipe[ 1 ] );
+    }
+    close( result_pipe[ 1 ] );
+    mixed_result res;
+    if(( pid < 0 ) || ( read( result_pipe[ 0 ], &res, sizeof( res ) ) != sizeof( res ) ))
+      res._rc = 1;
+    close( result_pipe[ 0 ] );
+    while( wait( NULL ) > 0 );
+
+    std::cout << std::setw( 6 ) << c << std::fixed << std::setprecision( 1 );
+    if( res._rc != 0 )
+    {
+      std::cout << std::setw( 38 ) << "failed" << std::endl;
+      rc = 1;
+      continue;
+    }
+    std::cout << std::setw( 10 ) << res._p50
+        << std::setw( 10 ) << res._p99
+        << std::setw( 10 ) << res._max
+        << std::setw( 8 ) << res._large_ops << std::endl;
+  }
+
+  if( run_child( false ) != 0 )
+    std::cerr << "There were errors. You might want to check for remaining data in the databroker." << std::endl;
+
+  delete config;
+  return rc;
+}
@@ -0,0 +1,343 @@
+/*
+ * Copyright © 2020 IBM Corporation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+/*
+ * Throughput benchmark while hash slots move between cluster nodes.
+ *
+ * Keeps <inflight> reads/puts of random keys in flight and reports the
+ * completed requests per interval. Requests for migrating slots are answered
+ * with ASK and repeated at the migration target, requests for moved slots
+ * get MOVED and update the slot map. The throughput should stay flat.
+ *
+ * With -s <host:port> of a resp_srv cluster (e.g. resp_srv -n 3), the
+ * benchmark moves the slots itself: each step sets <m> slots to migrating
+ * (SIM MIGRATING) for one interval and completes the move (SIM MIGRATE) at
+ * the start of the next step. Against a real Redis cluster, run
+ * redis-cli --cluster reshard while the benchmark runs instead.
+ */
+
+#include <iostream>
+#include <iomanip>
+#include <sstream>
+#include <vector>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <netdb.h>
+#include <sys/socket.h>
+
+#include "timing.h"
+#include "commandline.h"
+
+#include "libdatabroker.h"
+
+#define RESHARD_HASH_SLOTS ( 16384 )
+
+static const char* TEST_NAMESPACE = "reshard";
+
+struct reshard_config
+{
+  size_t _inflight = 16;
+  size_t _interval_ms = 500;
+  int _write_pct = 20;
+  int _warmup = 2;
+  int _steps = 8;
+  int _cooldown = 2;
+  int _nodes = 3;
+  int _slots_per_step = 1024;
+  std::string _sim;
+};
+static reshard_config rcfg;
+
+static int
+reshard_extraParse( const int opt, dbr::config *cfg )
+{
+  switch( opt )
+  {
+    case 'p': rcfg._inflight = std::strtol( optarg, NULL, 10 ); break;
+    case 'i': rcfg._interval_ms = std::strtol( optarg, NULL, 10 ); break;
+    case 'w': rcfg._write_pct = std::strtol( optarg, NULL, 10 ); break;
+    case 'S': rcfg._steps = std::strtol( optarg, NULL, 10 ); break;
+    case 'N': rcfg._nodes = std::strtol( optarg, NULL, 10 ); break;
+    case 'm': rcfg._slots_per_step = std::strtol( optarg, NULL, 10 ); break;
+    case 's': rcfg._sim = optarg; break;
+    default:
+      return -1;
+  }
+  return 0;
+}
+
+/*
+ * minimal control connection to resp_srv for the SIM commands
+ */
+static int
+sim_connect( const std::string &hostport )
+{
+  size_t colon = hostport.rfind( ':' );
+  if( colon == std::string::npos )
+    return -1;
+  std::string host = hostport.substr( 0, colon );
+  std::string port = hostport.substr( colon + 1 );
+
+  struct addrinfo hints, *res = NULL;
+  memset( &hints, 0, sizeof( hints ) );
+  hints.ai_family = AF_UNSPEC;
+  hints.ai_socktype = SOCK_STREAM;
+  if( getaddrinfo( host.c_str(), port.c_str(), &hints, &res ) != 0 )
+    return -1;
+  int fd = socket( res->ai_family, res->ai_socktype, res->ai_protocol );
+  if(( fd >= 0 ) && ( connect( fd, res->ai_addr, res->ai_addrlen ) != 0 ))
+  {
+    close( fd );
+    fd = -1;
+  }
+  freeaddrinfo( res );
+  return fd;
+}
+
+/*
+ * send a pipeline of SIM <op> <slot> <node> commands and wait for all replies
+ */
+static int
+sim_pipeline( int fd, const char *op, std::vector<std::pair<int,int> > &moves )
+{
+  std::stringstream cmds;
+  for( auto &m : moves )
+  {
+    std::string slot = std::to_string( m.first );
+    std::string node = std::to_string( m.second );
+    cmds << "*4\r\n$3\r\nSIM\r\n$" << strlen( op ) << "\r\n" << op << "\r\n"
+        << "$" << slot.size() << "\r\n" << slot << "\r\n"
+        << "$" << node.size() << "\r\n" << node << "\r\n";
+  }
+  std::string out = cmds.str();
+  size_t sent = 0;
+  while( sent < out.size() )
+  {
+    ssize_t rc = send( fd, out.data() + sent, out.size() - sent, 0 );
+    if( rc <= 0 )
+      return -1;
+    sent += rc;
+  }
+
+  size_t lines = 0;
+  int rc = 0;
+  bool line_start = true;
+  char buf[ 4096 ];
+  while( lines < moves.size() )
+  {
+    ssize_t len = recv( fd, buf, sizeof( buf ), 0 );
+    if( len <= 0 )
+      return -1;
+    for( ssize_t n = 0; n < len; ++n )
+    {
+      if( line_start && ( buf[ n ] != '+' ))
+        rc = -1;
+      line_start = ( buf[ n ] == '\n' );
+      if( line_start )
+        ++lines;
+    }
+  }
+  return rc;
+}
+
+int main( int argc, char **argv )
+{
+  std::string extraHelp = "\
+  -p <inflight>      number of requests kept in flight (16)\n\
+  -i <msec>          length of a measurement interval (500)\n\
+  -w <percent>       share of puts in the request mix (20)\n\
+  -s <host:port>     resp_srv cluster node to drive the slot migration (off)\n\
+  -N <nodes>         number of resp_srv cluster nodes (3)\n\
+  -m <slots>         slots to move per step (1024)\n\
+  -S <steps>         number of migration steps; one interval each (8)\n\
+";
+
+  dbr::config *config = dbr::ParseCommandline( argc, argv, "d:hn:p:i:w:s:N:m:S:", reshard_extraParse, extraHelp, true );
+  if( config == NULL )
+  {
+    std::cerr << "Failed to create configuration." << std::endl;
+    return -1;
+  }
+  config->_iterations -= 2 * config->_inflight;
+  if(( rcfg._inflight == 0 ) || ( rcfg._nodes < 2 ) || ( rcfg._slots_per_step <= 0 ))
+  {
+    std::cerr << "Invalid settings." << std::endl;
+    return -1;
+  }
+
+  int sim = -1;
+  if( ! rcfg._sim.empty() )
+  {
+    sim = sim_connect( rcfg._sim );
+    if( sim < 0 )
+    {
+      std::cerr << "Failed to connect to resp_srv at " << rcfg._sim << std::endl;
+      return -1;
+    }
+  }
+
+  dbr::test_start = dbr::myTime();
+  char *data = (char*)malloc( config->_datasize * rcfg._inflight );
+  for( size_t i = 0; i < config->_datasize * rcfg._inflight; ++i )
+    data[ i ] = (char)( random() % 26 + 97 );
+
+  DBR_Handle_t h = dbrCreate( (DBR_Name_t)TEST_NAMESPACE, DBR_PERST_VOLATILE_SIMPLE, DBR_GROUP_LIST_EMPTY );
+  if( h == NULL )
+  {
+    std::cerr << "Failed to create namespace" << std::endl;
+    free( data );
+    return -1;
+  }
+
+  std::vector<std::string> keys( config->_iterations );
+  for( size_t n = 0; n < keys.size(); ++n )
+  {
+    keys[ n ] = "rk" + std::to_string( n );
+    if( dbrPut( h, data, config->_datasize, (DBR_Tuple_name_t)keys[ n ].c_str(), DBR_GROUP_EMPTY ) != DBR_SUCCESS )
+    {
+      std::cerr << "Failed to populate key " << keys[ n ] << std::endl;
+      free( data );
+      return -1;
+    }
+  }
+
+  // the slot map of the resp_srv default even split; updated as slots move
+  std::vector<int> owner( RESHARD_HASH_SLOTS );
+  for( int s = 0; s < RESHARD_HASH_SLOTS; ++s )
+    owner[ s ] = (int)( (int64_t)s * rcfg._nodes / RESHARD_HASH_SLOTS );
+  std::vector<std::pair<int,int> > migrating;
+  int next_slot = 0;
+
+  std::vector<DBR_Tag_t> tags( rcfg._inflight, DB_TAG_ERROR );
+  std::vector<int64_t> sizes( rcfg._inflight );
+  char match[] = "";
+
+  std::cout << "# reshard throughput: datasize=" << config->_datasize
+      << " keys=" << keys.size()
+      << " inflight=" << rcfg._inflight
+      << " puts=" << rcfg._write_pct << "%"
+      << " driver=" << ( sim >= 0 ? rcfg._sim : "external" ) << std::endl;
+  std::cout << std::setw( 8 ) << "interval"
+      << std::setw( 10 ) << "phase"
+      << std::setw( 12 ) << "slots"
+      << std::setw( 14 ) << "ops/s"
+      << std::setw( 8 ) << "errors" << std::endl;
+
+  int rc = 0;
+  double idle_sum = 0.0, move_sum = 0.0, move_min = -1.0;
+  int idle_cnt = 0, move_cnt = 0;
+  int intervals = rcfg._warmup + rcfg._steps + 1 + rcfg._cooldown;
+  for( int iv = 0; ( iv < intervals ) && ( rc == 0 ); ++iv )
+  {
+    // migration step at the interval boundary: complete the last batch, start the next one
+    bool moving = ( iv >= rcfg._warmup ) && ( iv < rcfg._warmup + rcfg._steps );
+    if( sim >= 0 )
+    {
+      if( ! migrating.empty() )
+      {
+        if( sim_pipeline( sim, "MIGRATE", migrating ) != 0 )
+          rc = 1;
+        for( auto &m : migrating )
+          owner[ m.first ] = m.second;
+        migrating.clear();
+      }
+      for( int n = 0; moving && ( n < rcfg._slots_per_step ); ++n, next_slot = ( next_slot + 1 ) % RESHARD_HASH_SLOTS )
+        migrating.push_back( std::make_pair( next_slot, ( owner[ next_slot ] + 1 ) % rcfg._nodes ) );
+      if( ! migrating.empty() && ( sim_pipeline( sim, "MIGRATING", migrating ) != 0 ))
+        rc = 1;
+      if( rc != 0 )
+      {
+        std::cerr << "SIM command failed" << std::endl;
+        break;
+      }
+    }
+
+    size_t ops = 0, errors = 0;
+    double start = dbr::myTime();
+    double end = start + rcfg._interval_ms * 1000.;
+    size_t t = 0;
+    while( dbr::myTime() < end )
+    {
+      for( t = 0; t < rcfg._inflight; ++t )
+      {
+        if( tags[ t ] != DB_TAG_ERROR )
+        {
+          DBR_Errorcode_t trc = dbrTest( tags[ t ] );
+          if( trc == DBR_ERR_INPROGRESS )
+            continue;
+          ++ops;
+          if( trc != DBR_SUCCESS )
+            ++errors;
+        }
+
+        char *buf = data + t * config->_datasize;
+        DBR_Tuple_name_t key = (DBR_Tuple_name_t)keys[ random() % keys.size() ].c_str();
+        if( (int)( random() % 100 ) < rcfg._write_pct )
+          tags[ t ] = dbrPutA( h, buf, config->_datasize, key, DBR_GROUP_EMPTY );
+        else
+        {
+          sizes[ t ] = config->_datasize;
+          tags[ t ] = dbrReadA( h, buf, &sizes[ t ], key, match, DBR_GROUP_EMPTY, DBR_FLAGS_NONE );
+        }
+        if( tags[ t ] == DB_TAG_ERROR )
+          ++errors;
+      }
+    }
+    double rate = ops / (( dbr::myTime() - start ) / 1000000. );
+
+    if( moving )
+    {
+      move_sum += rate;
+      ++move_cnt;
+      if(( move_min < 0 ) || ( rate < move_min ))
+        move_min = rate;
+    }
+    else
+    {
+      idle_sum += rate;
+      ++idle_cnt;
+    }
+    std::cout << std::setw( 8 ) << iv
+        << std::setw( 10 ) << ( moving ? "migrate" : "idle" )
+        << std::setw( 12 ) << migrating.size()
+        << std::setw( 14 ) << std::fixed << std::setprecision( 0 ) << rate
+        << std::setw( 8 ) << errors << std::endl;
+    if( errors > 0 )
+      rc = 1;
+  }
+
+  // let the remaining requests finish
+  for( auto tag : tags )
+    if( tag != DB_TAG_ERROR )
+      while( dbrTest( tag ) == DBR_ERR_INPROGRESS );
+
+  if(( idle_cnt > 0 ) && ( move_cnt > 0 ) && ( idle_sum > 0.0 ))
+    std::cout << "# idle avg=" << std::fixed << std::setprecision( 0 ) << idle_sum / idle_cnt
+        << " ops/s; migrating avg=" << move_sum / move_cnt
+        << " min=" << move_min
+        << " ops/s (" << std::setprecision( 1 ) << 100. * ( move_sum / move_cnt ) / ( idle_sum / idle_cnt ) << "%)" << std::endl;
+
+  if( dbrDelete( (DBR_Name_t)TEST_NAMESPACE ) != DBR_SUCCESS )
+    std::cerr << "There were errors. You might want to check for remaining data in the databroker." << std::endl;
+
+  if( sim >= 0 )
+    close( sim );
+  free( data );
+  delete config;
+  return rc;
+}
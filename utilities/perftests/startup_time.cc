@@ -0,0 +1,233 @@
+/*
+ * Copyright © 2020 IBM Corporation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+/*
+ * Startup time benchmark for many clients that attach at the same moment.
+ *
+ * Forks <clients> processes that are released together and each time their
+ * first dbrAttach() (library init, connect+AUTH to all cluster nodes, and the
+ * attach itself). Reports the distribution of the per-client attach times and
+ * the time until the last client was ready. With -j, each client waits a random
+ * time up to <msec> before connecting (DBR_STARTUP_JITTER); the reported times
+ * include that delay.
+ */
+
+#include <iostream>
+#include <iomanip>
+#include <vector>
+#include <algorithm>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/wait.h>
+
+#include "timing.h"
+#include "commandline.h"
+
+#include "libdatabroker.h"
+
+static const char* TEST_NAMESPACE = "startup";
+
+struct startup_config
+{
+  int _clients = 64;
+  int _rounds = 3;
+  std::string _jitter;
+};
+static startup_config scfg;
+
+struct startup_result
+{
+  double _usec;
+  double _end;
+  int _rc;
+};
+
+static int
+startup_extraParse( const int opt, dbr::config *cfg )
+{
+  switch( opt )
+  {
+    case 'c': scfg._clients = std::strtol( optarg, NULL, 10 ); break;
+    case 'r': scfg._rounds = std::strtol( optarg, NULL, 10 ); break;
+    case 'j': scfg._jitter = optarg; break;
+    default:
+      return -1;
+  }
+  return 0;
+}
+
+/*
+ * run a namespace operation in a child process to keep the parent free of library state
+ */
+static int
+run_child( bool create )
+{
+  pid_t pid = fork();
+  if( pid == 0 )
+  {
+    int rc;
+    if( create )
+    {
+      // detach again; a namespace can only be deleted by its last attached client
+      DBR_Handle_t h = dbrCreate( (DBR_Name_t)TEST_NAMESPACE, DBR_PERST_VOLATILE_SIMPLE, DBR_GROUP_LIST_EMPTY );
+      rc = (( h != NULL ) && ( dbrDetach( h ) == DBR_SUCCESS )) ? 0 : 1;
+    }
+    else  // delete requires a local attach
+      rc = (( dbrAttach( (DBR_Name_t)TEST_NAMESPACE ) != NULL ) &&
+          ( dbrDelete( (DBR_Name_t)TEST_NAMESPACE ) == DBR_SUCCESS )) ? 0 : 1;
+    _exit( rc );
+  }
+  int status = 1;
+  if(( pid < 0 ) || ( waitpid( pid, &status, 0 ) != pid ))
+    return -1;
+  return WIFEXITED( status ) ? WEXITSTATUS( status ) : -1;
+}
+
+static void
+client( int start_fd, int result_fd )
+{
+  char c;
+  startup_result res;
+
+  // released when the parent closes the write end
+  while( read( start_fd, &c, 1 ) > 0 );
+
+  double start = dbr::myTime();
+  DBR_Handle_t h = dbrAttach( (DBR_Name_t)TEST_NAMESPACE );
+  res._end = dbr::myTime();
+  res._usec = res._end - start;
+  res._rc = ( h != NULL ) ? 0 : 1;
+  if( write( result_fd, &res, sizeof( res ) ) != sizeof( res ) )
+    res._rc = 1;
+  if( h != NULL )
+    dbrDetach( h );
+  _exit( res._rc );
+}
+
+static inline double
+percentile( const std::vector<double> &sorted, const double p )
+{
+  size_t idx = (size_t)( p * ( sorted.size() - 1 ) + 0.5 );
+  return sorted[ std::min( idx, sorted.size() - 1 ) ];
+}
+
+int main( int argc, char **argv )
+{
+  std::string extraHelp = "\
+  -c <clients>       number of simultaneously starting clients (64)\n\
+  -r <rounds>        number of repetitions (3)\n\
+  -j <msec>          startup jitter of each client (DBR_STARTUP_JITTER, off)\n\
+";
+
+  dbr::config *config = dbr::ParseCommandline( argc, argv, "hc:r:j:", startup_extraParse, extraHelp, true );
+  if( config == NULL )
+  {
+    std::cerr << "Failed to create configuration." << std::endl;
+    return -1;
+  }
+  if(( scfg._clients <= 0 ) || ( scfg._rounds <= 0 ))
+  {
+    std::cerr << "Invalid settings." << std::endl;
+    return -1;
+  }
+  if( ! scfg._jitter.empty() )
+    setenv( "DBR_STARTUP_JITTER", scfg._jitter.c_str(), 1 );
+
+  if( run_child( true ) != 0 )
+  {
+    std::cerr << "Failed to create namespace" << std::endl;
+    return -1;
+  }
+
+  std::cout << "# startup time: clients=" << scfg._clients
+      << " jitter=" << ( scfg._jitter.empty() ? "0" : scfg._jitter ) << "ms" << std::endl;
+  std::cout << std::setw( 6 ) << "round"
+      << std::setw( 10 ) << "min[ms]"
+      << std::setw( 10 ) << "p50[ms]"
+      << std::setw( 10 ) << "p99[ms]"
+      << std::setw( 10 ) << "max[ms]"
+      << std::setw( 10 ) << "all[ms]"
+      << std::setw( 8 ) << "errors" << std::endl;
+
+  int rc = 0;
+  for( int round = 0; ( round < scfg._rounds ) && ( rc == 0 ); ++round )
+  {
+    int start_pipe[ 2 ], result_pipe[ 2 ];
+    if(( pipe( start_pipe ) != 0 ) || ( pipe( result_pipe ) != 0 ))
+    {
+      std::cerr << "Failed to create pipes" << std::endl;
+      rc = 1;
+      break;
+    }
+
+    int spawned = 0;
+    for( ; spawned < scfg._clients; ++spawned )
+    {
+      pid_t pid = fork();
+      if( pid < 0 )
+        break;
+      if( pid == 0 )
+      {
+        close( start_pipe[ 1 ] );
+        close( result_pipe[ 0 ] );
+        client( start_pipe[ 0 ], result_pipe[ 1 ] );
+      }
+    }
+    close( start_pipe[ 0 ] );
+    close( result_pipe[ 1 ] );
+
+    // release all clients at once
+    double start = dbr::myTime();
+    close( start_pipe[ 1 ] );
+
+    // clients that failed to start or exited without a result count as errors
+    std::vector<double> times;
+    double last = start;
+    startup_result res;
+    while( read( result_pipe[ 0 ], &res, sizeof( res ) ) == sizeof( res ) )
+      if( res._rc == 0 )
+      {
+        times.push_back( res._usec / 1000. );
+        last = std::max( last, res._end );
+      }
+    int errors = scfg._clients - (int)times.size();
+    double all = ( last - start ) / 1000.;
+    close( result_pipe[ 0 ] );
+    while( wait( NULL ) > 0 );
+
+    std::sort( times.begin(), times.end() );
+    std::cout << std::setw( 6 ) << round << std::fixed << std::setprecision( 1 );
+    if( times.empty() )
+      std::cout << std::setw( 50 ) << "-";
+    else
+      std::cout << std::setw( 10 ) << times.front()
+          << std::setw( 10 ) << percentile( times, 0.5 )
+          << std::setw( 10 ) << percentile( times, 0.99 )
+          << std::setw( 10 ) << times.back()
+          << std::setw( 10 ) << all;
+    std::cout << std::setw( 8 ) << errors << std::endl;
+    if( errors > 0 )
+      rc = 1;
+  }
+
+  if( run_child( false ) != 0 )
+    std::cerr << "There were errors. You might want to check for remaining data in the databroker." << std::endl;
+
+  delete config;
+  return rc;
+}
@@ -0,0 +1,195 @@
+/*
+ * Copyright © 2020 IBM Corporation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+/*
+ * Bandwidth benchmark for large tuples with the striping data adapter.
+ *
+ * Requires a data broker built with WITH_DATA_ADAPTERS and
+ * DBR_PLUGIN=<path>/libdbrda_stripe.so
+ *
+ * The benchmark puts and reads values with keys bw<C>_<n> and sets up
+ * DBR_STRIPE_POLICY so that keys with prefix bw<C>_ get split into chunks
+ * of C MiB (0: not striped). Running it against clusters with different
+ * numbers of shards shows how the aggregate throughput scales with shard
+ * count and chunk size.
+ */
+
+#include <iostream>
+#include <iomanip>
+#include <sstream>
+#include <vector>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include "timing.h"
+#include "commandline.h"
+
+#include "libdatabroker.h"
+
+static const char* TEST_NAMESPACE = "stripebw";
+static std::vector<int> chunk_sizes;
+
+// options of the common parser that got set on the command line
+static bool datasize_given = false;
+static bool iterations_given = false;
+
+static int
+stripe_extraParse( const int opt, dbr::config *cfg )
+{
+  switch( opt )
+  {
+    case 'c': // list of chunk sizes
+    {
+      std::stringstream list( optarg );
+      std::string c;
+      chunk_sizes.clear();
+      while( std::getline( list, c, ',' ) )
+        chunk_sizes.push_back( std::strtol( c.c_str(), NULL, 10 ) );
+      break;
+    }
+    default:
+      return -1;
+  }
+  return 0;
+}
+
+static double
+run( DBR_Handle_t h, int testcase, int chunk, dbr::config *config, char *data )
+{
+  char match[] = "";
+  double start = dbr::myTime();
+  for( size_t n = 0; n < config->_iterations; ++n )
+  {
+    std::stringstream key;
+    key << "bw" << chunk << "_" << n;
+    DBR_Errorcode_t rc;
+    if( testcase == dbr::TEST_CASE_PUT )
+      rc = dbrPut( h, data, config->_datasize, (DBR_Tuple_name_t)key.str().c_str(), DBR_GROUP_EMPTY );
+    else
+    {
+      int64_t size = config->_datasize;
+      rc = dbrRead( h, data, &size, (DBR_Tuple_name_t)key.str().c_str(), match, DBR_GROUP_EMPTY, DBR_FLAGS_NONE );
+      if(( rc == DBR_SUCCESS ) && ( size != (int64_t)config->_datasize ))
+        rc = DBR_ERR_UBUFFER;
+    }
+    if( rc != DBR_SUCCESS )
+    {
+      std::cerr << "Request failed for key " << key.str() << ": " << dbrGet_error( rc ) << std::endl;
+      return -1.0;
+    }
+  }
+  return dbr::myTime() - start;
+}
+
+/*
+ * the common parser fills in defaults for small tuples;
+ * find out which of its options were actually given
+ */
+static void
+scan_given( int argc, char **argv, const char *optstring )
+{
+  int saved_opterr = opterr;
+  opterr = 0;
+  int opt;
+  while(( opt = getopt( argc, argv, optstring )) != -1 )
+  {
+    if( opt == 'd' )
+      datasize_given = true;
+    if( opt == 'n' )
+      iterations_given = true;
+  }
+  optind = 1;
+  opterr = saved_opterr;
+}
+
+int main( int argc, char **argv )
+{
+  std::string extraHelp = "\
+  -c <sizes>         comma separated list of chunk sizes in MiB to test, 0: not striped (0,4,16,64)\n\
+";
+
+  const char *optstring = "c:d:hn:";
+  chunk_sizes = { 0, 4, 16, 64 };
+  scan_given( argc, argv, optstring );
+  dbr::config *config = dbr::ParseCommandline( argc, argv, optstring, stripe_extraParse, extraHelp, true );
+  if( config == NULL )
+  {
+    std::cerr << "Failed to create configuration." << std::endl;
+    return -1;
+  }
+  // no warmup iterations here
+  config->_iterations -= 2 * config->_inflight;
+  if( ! datasize_given )
+    config->_datasize = 256 * 1024 * 1024;
+  if( ! iterations_given )
+    config->_iterations = 8;
+
+  if( getenv( "DBR_PLUGIN" ) == NULL )
+    std::cerr << "WARN: DBR_PLUGIN not set. Values will not be striped." << std::endl;
+
+  // the policy has to be in place before the first data broker call loads the adapter
+  std::stringstream policy;
+  for( auto c : chunk_sizes )
+    policy << "bw" << c << "_*=" << c << "M,";
+  policy << "*=0";
+  setenv( "DBR_STRIPE_POLICY", policy.str().c_str(), 0 );
+
+  dbr::test_start = dbr::myTime();
+  char *data = (char*)malloc( config->_datasize );
+  for( size_t i = 0; i < config->_datasize; ++i )
+    data[ i ] = (char)( random() % 26 + 97 );
+
+  DBR_Handle_t h = dbrCreate( (DBR_Name_t)TEST_NAMESPACE, DBR_PERST_VOLATILE_SIMPLE, DBR_GROUP_LIST_EMPTY );
+  if( h == NULL )
+  {
+    std::cerr << "Failed to create namespace" << std::endl;
+    free( data );
+    return -1;
+  }
+
+  double total_mb = (double)config->_datasize * config->_iterations / ( 1024. * 1024. );
+  std::cout << "# stripe bandwidth: datasize=" << config->_datasize
+      << " iterations=" << config->_iterations
+      << " policy=" << getenv( "DBR_STRIPE_POLICY" ) << std::endl;
+  std::cout << std::setw( 12 ) << "chunk[MiB]"
+      << std::setw( 14 ) << "PUT[MiB/s]"
+      << std::setw( 14 ) << "READ[MiB/s]" << std::endl;
+
+  int rc = 0;
+  for( auto c : chunk_sizes )
+  {
+    double put_time = run( h, dbr::TEST_CASE_PUT, c, config, data );
+    double read_time = ( put_time > 0 ) ? run( h, dbr::TEST_CASE_READ, c, config, data ) : -1.0;
+    if(( put_time <= 0 ) || ( read_time <= 0 ))
+    {
+      rc = 1;
+      break;
+    }
+    std::cout << std::setw( 12 ) << c
+        << std::setw( 14 ) << std::fixed << std::setprecision( 1 ) << total_mb / ( put_time / 1000000. )
+        << std::setw( 14 ) << std::fixed << std::setprecision( 1 ) << total_mb / ( read_time / 1000000. )
+        << std::endl;
+  }
+
+  // delete while still attached; a detached client can't delete
+  if( dbrDelete( (DBR_Name_t)TEST_NAMESPACE ) != DBR_SUCCESS )
+    std::cerr << "There were errors. You might want to check for remaining data in the databroker." << std::endl;
+
+  free( data );
+  delete config;
+  return rc;
+}